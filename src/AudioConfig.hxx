@@ -25,6 +25,13 @@ struct AudioFormat;
 AudioFormat
 getOutputAudioFormat(AudioFormat inFormat);
 
+/**
+ * Returns the "audio_output_format" setting.  Attributes which are
+ * not forced by the setting are undefined.
+ */
+AudioFormat
+getConfiguredAudioFormat();
+
 /* make sure initPlayerData is called before this function!! */
 void
 initAudioConfig();
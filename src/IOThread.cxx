@@ -23,6 +23,7 @@
 #include "thread/Cond.hxx"
 #include "thread/Thread.hxx"
 #include "thread/Name.hxx"
+#include "thread/Policy.hxx"
 #include "event/Loop.hxx"
 #include "system/FatalError.hxx"
 #include "util/Error.hxx"
@@ -50,6 +51,7 @@ static void
 io_thread_func(gcc_unused void *arg)
 {
 	SetThreadName("io");
+	ApplyThreadPolicy(ThreadClass::IO);
 
 	/* lock+unlock to synchronize with io_thread_start(), to be
 	   sure that io.thread is set */
@@ -24,6 +24,9 @@
 #include "PlaylistFile.hxx"
 #include "PlaylistGlobal.hxx"
 #include "MusicChunk.hxx"
+#include "MusicBuffer.hxx"
+#include "pcm/PcmBuffer.hxx"
+#include "AudioFormat.hxx"
 #include "StateFile.hxx"
 #include "player/Thread.hxx"
 #include "Mapper.hxx"
@@ -35,6 +38,7 @@
 #include "Partition.hxx"
 #include "tag/TagConfig.hxx"
 #include "ReplayGainConfig.hxx"
+#include "ThreadConfig.hxx"
 #include "Idle.hxx"
 #include "Log.hxx"
 #include "LogInit.hxx"
@@ -47,6 +51,8 @@
 #include "playlist/PlaylistRegistry.hxx"
 #include "zeroconf/ZeroconfGlue.hxx"
 #include "decoder/DecoderList.hxx"
+#include "decoder/DecoderCache.hxx"
+#include "decoder/SeekIndex.hxx"
 #include "AudioConfig.hxx"
 #include "pcm/PcmConvert.hxx"
 #include "unix/SignalHandlers.hxx"
@@ -55,6 +61,7 @@
 #include "util/Error.hxx"
 #include "thread/Id.hxx"
 #include "thread/Slack.hxx"
+#include "thread/Policy.hxx"
 #include "lib/icu/Init.hxx"
 #include "config/ConfigGlobal.hxx"
 #include "config/Param.hxx"
@@ -264,6 +271,24 @@ glue_sticker_init(void)
 #endif
 }
 
+/**
+ * Configure and initialize the seek index cache.
+ */
+static void
+glue_seek_index_init()
+{
+	Error error;
+	auto directory = config_get_path(ConfigOption::SEEK_INDEX_DIRECTORY,
+					 error);
+	if (directory.IsNull()) {
+		if (error.IsDefined())
+			FatalError(error);
+		return;
+	}
+
+	seek_index_global_init(std::move(directory));
+}
+
 static bool
 glue_state_file_init(Error &error)
 {
@@ -313,6 +338,25 @@ static void winsock_init(void)
 #endif
 }
 
+/**
+ * Parse the "audio_buffer_memory" setting, which specifies how the
+ * #MusicBuffer memory is allocated.
+ */
+static BufferMemory
+GetBufferMemory()
+{
+	const auto param = config_get_param(ConfigOption::AUDIO_BUFFER_MEMORY);
+	if (param == nullptr || param->value == "default")
+		return BufferMemory::DEFAULT;
+	else if (param->value == "lock")
+		return BufferMemory::LOCKED;
+	else if (param->value == "hugetlb")
+		return BufferMemory::HUGETLB;
+	else
+		FormatFatalError("buffer memory \"%s\" is not valid, line %i",
+				 param->value.c_str(), param->line);
+}
+
 /**
  * Initialize the decoder and player core, including the music pipe.
  */
@@ -336,7 +380,28 @@ initialize_decoder_and_player(void)
 
 	buffer_size *= 1024;
 
-	const unsigned buffered_chunks = buffer_size / CHUNK_SIZE;
+	/* check the value (in kB) before multiplying, which
+	   might overflow */
+	const unsigned chunk_kb =
+		config_get_positive(ConfigOption::AUDIO_CHUNK_SIZE, 0);
+	if (chunk_kb > MAX_CHUNK_SIZE / 1024)
+		FormatFatalError("chunk size \"%u\" is too big", chunk_kb);
+
+	size_t chunk_size = size_t(chunk_kb) * 1024;
+
+	if (chunk_size == 0) {
+		/* not configured: if the output format is fixed,
+		   choose a chunk size suitable for it */
+		const AudioFormat audio_format = getConfiguredAudioFormat();
+		chunk_size = audio_format.IsFullyDefined()
+			? CalcChunkSize(audio_format)
+			: DEFAULT_CHUNK_SIZE;
+	}
+
+	const unsigned buffered_chunks = buffer_size / chunk_size;
+
+	const BufferMemory buffer_memory = GetBufferMemory();
+	PcmBuffer::SetLocked(buffer_memory != BufferMemory::DEFAULT);
 
 	if (buffered_chunks >= 1 << 15)
 		FormatFatalError("buffer size \"%lu\" is too big",
@@ -364,9 +429,15 @@ initialize_decoder_and_player(void)
 		config_get_positive(ConfigOption::MAX_PLAYLIST_LENGTH,
 				    DEFAULT_PLAYLIST_MAX_LENGTH);
 
+	const unsigned prefetch_songs =
+		config_get_unsigned(ConfigOption::PREFETCH_SONGS, 0);
+
 	instance->partition = new Partition(*instance,
 					    max_length,
+					    prefetch_songs,
 					    buffered_chunks,
+					    chunk_size,
+					    buffer_memory,
 					    buffered_before_play);
 }
 
@@ -502,6 +573,8 @@ int mpd_main(int argc, char *argv[])
 		config_get_positive(ConfigOption::MAX_CONN, 10);
 	instance->client_list = new ClientList(max_clients);
 
+	thread_config_global_init();
+	initAudioConfig();
 	initialize_decoder_and_player();
 
 	if (!listen_global_init(*instance->event_loop, *instance->partition,
@@ -565,6 +638,8 @@ static int mpd_main_after_fork(struct options options)
 	}
 
 	decoder_plugin_init_all();
+	decoder_cache_global_init();
+	glue_seek_index_init();
 
 #ifdef ENABLE_DATABASE
 	const bool create_db = InitDatabaseAndStorage();
@@ -573,7 +648,6 @@ static int mpd_main_after_fork(struct options options)
 	glue_sticker_init();
 
 	command_init();
-	initAudioConfig();
 	instance->partition->outputs.Configure(*instance->event_loop,
 					       instance->partition->pc);
 	client_manager_init();
@@ -656,6 +730,8 @@ static int mpd_main_after_fork(struct options options)
 	   a huge value to allow the kernel to reduce CPU wakeups */
 	SetThreadTimerSlackMS(100);
 
+	ApplyThreadPolicy(ThreadClass::MAIN);
+
 #ifdef ENABLE_SYSTEMD_DAEMON
 	sd_notify(0, "READY=1");
 #endif
@@ -721,6 +797,8 @@ static int mpd_main_after_fork(struct options options)
 
 	delete instance->partition;
 	command_finish();
+	decoder_cache_global_finish();
+	seek_index_global_finish();
 	decoder_plugin_deinit_all();
 #ifdef ENABLE_ARCHIVE
 	archive_plugin_deinit_all();
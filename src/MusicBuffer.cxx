@@ -21,20 +21,167 @@
 #include "MusicBuffer.hxx"
 #include "MusicChunk.hxx"
 #include "system/FatalError.hxx"
+#include "util/HugeAllocator.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+#include <thread>
+#include <new>
 
 #include <assert.h>
 
-MusicBuffer::MusicBuffer(unsigned num_chunks)
-	:buffer(num_chunks) {
-	if (buffer.IsOOM())
+static constexpr Domain buffer_domain("buffer");
+
+/**
+ * Round up to the alignment of #MusicChunk, so the next chunk
+ * object can follow the PCM buffer.
+ */
+static constexpr size_t
+AlignChunk(size_t size)
+{
+	return (size + alignof(MusicChunk) - 1) & ~(alignof(MusicChunk) - 1);
+}
+
+MusicBuffer::MusicBuffer(unsigned num_chunks, size_t _chunk_size,
+			 BufferMemory memory)
+	:n_max(num_chunks),
+	 chunk_size(_chunk_size),
+	 stride(AlignChunk(sizeof(MusicChunk) + chunk_size)),
+	 allocation_size(n_max * stride),
+	 data(nullptr), locked(false),
+	 links(new std::atomic<uint32_t>[n_max]),
+	 available(NONE),
+	 n_initialized(0), n_allocated(0) {
+	assert(n_max > 0);
+	assert(n_max < NONE);
+	assert(chunk_size > 0);
+	assert(chunk_size <= MAX_CHUNK_SIZE);
+
+	if (memory == BufferMemory::HUGETLB) {
+		data = (uint8_t *)HugeAllocateReserved(allocation_size);
+		if (data == nullptr)
+			FormatErrno(buffer_domain,
+				    "Failed to allocate %lu bytes of reserved huge pages",
+				    (unsigned long)allocation_size);
+	}
+
+	if (data == nullptr)
+		data = (uint8_t *)HugeAllocate(allocation_size);
+
+	if (data == nullptr)
 		FatalError("Failed to allocate buffer");
+
+	if (memory != BufferMemory::DEFAULT) {
+		locked = HugeLock(data, allocation_size);
+		if (!locked)
+			FormatErrno(buffer_domain,
+				    "Failed to lock %lu bytes of memory",
+				    (unsigned long)allocation_size);
+	}
+}
+
+MusicBuffer::~MusicBuffer()
+{
+	/* all chunks must be returned explicitly, and this
+	   assertion checks for leaks */
+	assert(n_allocated == 0);
+
+	delete[] links;
+	HugeFree(data, allocation_size);
+}
+
+inline uint32_t
+MusicBuffer::Pop()
+{
+	uint64_t head = available.load(std::memory_order_acquire);
+	while (true) {
+		const uint32_t i = GetIndex(head);
+		if (i == NONE)
+			break;
+
+		assert(i < n_initialized);
+
+		const uint32_t next = links[i].load(std::memory_order_relaxed);
+		if (available.compare_exchange_weak(head, MakeHead(next, head),
+						    std::memory_order_acquire))
+			return i;
+	}
+
+	/* the list is empty: initialize a new chunk */
+
+	unsigned n = n_initialized.load(std::memory_order_relaxed);
+	do {
+		if (n == n_max)
+			/* buffer is full */
+			return NONE;
+	} while (!n_initialized.compare_exchange_weak(n, n + 1,
+						      std::memory_order_relaxed));
+
+	return n;
 }
 
 MusicChunk *
 MusicBuffer::Allocate()
 {
-	const ScopeLock protect(mutex);
-	return buffer.Allocate();
+	/* announce the allocation, so Discard() doesn't run
+	   meanwhile */
+	while (n_allocated.fetch_add(1, std::memory_order_acquire) >= DISCARDING) {
+		n_allocated.fetch_sub(1, std::memory_order_relaxed);
+		std::this_thread::yield();
+	}
+
+	const uint32_t i = Pop();
+	if (i == NONE) {
+		n_allocated.fetch_sub(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	return ::new((void *)GetChunk(i)) MusicChunk(chunk_size);
+}
+
+inline void
+MusicBuffer::Free(MusicChunk *chunk)
+{
+	assert((uint8_t *)chunk >= data);
+	assert((uint8_t *)chunk < data + n_max * stride);
+	assert(((uint8_t *)chunk - data) % stride == 0);
+
+	const uint32_t i = ((uint8_t *)chunk - data) / stride;
+
+	/* destruct the object */
+	chunk->~MusicChunk();
+
+	/* insert the chunk in the "available" list */
+	uint64_t head = available.load(std::memory_order_relaxed);
+	do {
+		links[i].store(GetIndex(head), std::memory_order_relaxed);
+	} while (!available.compare_exchange_weak(head, MakeHead(i, head),
+						  std::memory_order_release,
+						  std::memory_order_relaxed));
+
+	if (n_allocated.fetch_sub(1, std::memory_order_acq_rel) == 1 &&
+	    !locked)
+		Discard();
+}
+
+void
+MusicBuffer::Discard()
+{
+	unsigned expected = 0;
+	if (!n_allocated.compare_exchange_strong(expected, DISCARDING,
+						 std::memory_order_acquire))
+		/* another thread has allocated a chunk meanwhile */
+		return;
+
+	/* give memory back to the kernel when the last chunk was
+	   freed */
+	HugeDiscard(data, allocation_size);
+	n_initialized.store(0, std::memory_order_relaxed);
+	available.store(MakeHead(NONE,
+				 available.load(std::memory_order_relaxed)),
+			std::memory_order_relaxed);
+
+	n_allocated.fetch_sub(DISCARDING, std::memory_order_release);
 }
 
 void
@@ -42,12 +189,10 @@ MusicBuffer::Return(MusicChunk *chunk)
 {
 	assert(chunk != nullptr);
 
-	const ScopeLock protect(mutex);
-
 	if (chunk->other != nullptr) {
 		assert(chunk->other->other == nullptr);
-		buffer.Free(chunk->other);
+		Free(chunk->other);
 	}
 
-	buffer.Free(chunk);
+	Free(chunk);
 }
@@ -20,19 +20,109 @@
 #ifndef MPD_MUSIC_BUFFER_HXX
 #define MPD_MUSIC_BUFFER_HXX
 
-#include "util/SliceBuffer.hxx"
-#include "thread/Mutex.hxx"
+#include "Compiler.h"
+
+#include <atomic>
+
+#include <stdint.h>
+#include <stddef.h>
 
 struct MusicChunk;
 
+/**
+ * How the memory of a #MusicBuffer is obtained.
+ */
+enum class BufferMemory : uint8_t {
+	/**
+	 * Normal pages, which the kernel may page out.
+	 */
+	DEFAULT,
+
+	/**
+	 * Lock the buffer into RAM.
+	 */
+	LOCKED,
+
+	/**
+	 * Use explicitly reserved huge pages, and lock them into
+	 * RAM.  Falls back to #LOCKED if there are not enough.
+	 */
+	HUGETLB,
+};
+
 /**
  * An allocator for #MusicChunk objects.
+ *
+ * The free list is a lock-free stack, because chunks are allocated
+ * and returned by the decoder, player and output threads.
  */
 class MusicBuffer {
-	/** a mutex which protects #buffer */
-	Mutex mutex;
+	/**
+	 * Marks the "available" list as empty.
+	 */
+	static constexpr uint32_t NONE = ~uint32_t(0);
+
+	/**
+	 * Added to #n_allocated while the memory is being given back
+	 * to the kernel.  Allocate() waits until that is finished.
+	 */
+	static constexpr unsigned DISCARDING = 1u << 30;
+
+	/**
+	 * The maximum number of chunks in this buffer.
+	 */
+	const unsigned n_max;
+
+	/**
+	 * The size of the PCM buffer in each chunk.
+	 */
+	const size_t chunk_size;
+
+	/**
+	 * The distance between two chunks in #data: the #MusicChunk
+	 * object followed by its PCM buffer.
+	 */
+	const size_t stride;
+
+	/**
+	 * The size of the allocation at #data, which may have been
+	 * rounded up to the huge page size.
+	 */
+	size_t allocation_size;
+
+	uint8_t *data;
+
+	/**
+	 * Is #data locked into RAM?  Then there's no point in giving
+	 * it back to the kernel while the buffer is empty.
+	 */
+	bool locked;
 
-	SliceBuffer<MusicChunk> buffer;
+	/**
+	 * For each free chunk, the index of the next free chunk in
+	 * the "available" list.
+	 */
+	std::atomic<uint32_t> *const links;
+
+	/**
+	 * The head of the list of free chunks: the index of the
+	 * first chunk in the lower 32 bits, and a counter which is
+	 * incremented on each modification in the upper 32 bits (to
+	 * avoid the ABA problem).
+	 */
+	std::atomic<uint64_t> available;
+
+	/**
+	 * The number of chunks that are initialized.  This is used
+	 * to avoid page faulting on the new allocation, so the
+	 * kernel does not need to reserve physical memory pages.
+	 */
+	std::atomic_uint n_initialized;
+
+	/**
+	 * The number of chunks currently allocated.
+	 */
+	std::atomic_uint n_allocated;
 
 public:
 	/**
@@ -40,17 +130,23 @@ public:
 	 *
 	 * @param num_chunks the number of #MusicChunk reserved in
 	 * this buffer
+	 * @param chunk_size the size of the PCM buffer in each chunk
 	 */
-	MusicBuffer(unsigned num_chunks);
+	MusicBuffer(unsigned num_chunks, size_t chunk_size,
+		    BufferMemory memory=BufferMemory::DEFAULT);
+
+	~MusicBuffer();
+
+	MusicBuffer(const MusicBuffer &) = delete;
+	MusicBuffer &operator=(const MusicBuffer &) = delete;
 
 #ifndef NDEBUG
 	/**
-	 * Check whether the buffer is empty.  This call is not
-	 * protected with the mutex, and may only be used while this
-	 * object is inaccessible to other threads.
+	 * Check whether the buffer is empty.  This call may only be
+	 * used while this object is inaccessible to other threads.
 	 */
 	bool IsEmptyUnsafe() const {
-		return buffer.IsEmpty();
+		return n_allocated.load(std::memory_order_relaxed) == 0;
 	}
 #endif
 
@@ -61,7 +157,15 @@ public:
 	 */
 	gcc_pure
 	unsigned GetSize() const {
-		return buffer.GetCapacity();
+		return n_max;
+	}
+
+	/**
+	 * Returns the number of bytes which fit into each chunk.
+	 */
+	gcc_pure
+	size_t GetChunkSize() const {
+		return chunk_size;
 	}
 
 	/**
@@ -78,6 +182,35 @@ public:
 	 * Allocate() then.
 	 */
 	void Return(MusicChunk *chunk);
+
+private:
+	MusicChunk *GetChunk(uint32_t i) const {
+		return (MusicChunk *)(data + i * stride);
+	}
+
+	static constexpr uint32_t GetIndex(uint64_t head) {
+		return uint32_t(head);
+	}
+
+	static constexpr uint64_t MakeHead(uint32_t index, uint64_t old) {
+		return ((old >> 32) + 1) << 32 | index;
+	}
+
+	/**
+	 * Pop a chunk from the "available" list, or initialize a new
+	 * one.
+	 *
+	 * @return the chunk index or #NONE
+	 */
+	uint32_t Pop();
+
+	void Free(MusicChunk *chunk);
+
+	/**
+	 * Give memory back to the kernel after the last chunk was
+	 * freed.
+	 */
+	void Discard();
 };
 
 #endif
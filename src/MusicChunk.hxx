@@ -21,6 +21,7 @@
 #define MPD_MUSIC_CHUNK_HXX
 
 #include "Chrono.hxx"
+#include "Compiler.h"
 #include "ReplayGainInfo.hxx"
 #include "util/WritableBuffer.hxx"
 
@@ -28,10 +29,21 @@
 #include "AudioFormat.hxx"
 #endif
 
+#include <atomic>
+
 #include <stdint.h>
 #include <stddef.h>
 
-static constexpr size_t CHUNK_SIZE = 4096;
+/**
+ * The default size of the PCM buffer in each #MusicChunk, see
+ * MusicBuffer::GetChunkSize().
+ */
+static constexpr size_t DEFAULT_CHUNK_SIZE = 4096;
+
+/**
+ * The maximum size of the PCM buffer in each #MusicChunk.
+ */
+static constexpr size_t MAX_CHUNK_SIZE = 64 * 1024;
 
 struct AudioFormat;
 struct Tag;
@@ -41,8 +53,12 @@ struct Tag;
  * MusicPipe::Push() caller.
  */
 struct MusicChunk {
-	/** the next chunk in a linked list */
-	MusicChunk *next;
+	/**
+	 * The next chunk in a linked list.  This is atomic because
+	 * #MusicPipe links new chunks while other threads walk the
+	 * list.
+	 */
+	std::atomic<MusicChunk *> next;
 
 	/**
 	 * An optional chunk which should be mixed into this chunk.
@@ -57,7 +73,7 @@ struct MusicChunk {
 	float mix_ratio;
 
 	/** number of bytes stored in this chunk */
-	uint16_t length;
+	uint32_t length;
 
 	/** current bit rate of the source file */
 	uint16_t bit_rate;
@@ -86,18 +102,29 @@ struct MusicChunk {
 	 */
 	unsigned replay_gain_serial;
 
-	/** the data (probably PCM) */
-	uint8_t data[CHUNK_SIZE];
+	/** the number of bytes which fit into #data */
+	const size_t capacity;
+
+	/**
+	 * The data (probably PCM).  It is located right after this
+	 * object, in memory allocated by #MusicBuffer.
+	 */
+	uint8_t *const data;
 
 #ifndef NDEBUG
 	AudioFormat audio_format;
 #endif
 
-	MusicChunk()
+	explicit MusicChunk(size_t _capacity)
 		:other(nullptr),
 		 length(0),
 		 tag(nullptr),
-		 replay_gain_serial(0) {}
+		 replay_gain_serial(0),
+		 capacity(_capacity),
+		 data((uint8_t *)(this + 1)) {}
+
+	MusicChunk(const MusicChunk &) = delete;
+	MusicChunk &operator=(const MusicChunk &) = delete;
 
 	~MusicChunk();
 
@@ -141,4 +168,15 @@ struct MusicChunk {
 	bool Expand(AudioFormat af, size_t length);
 };
 
+/**
+ * Calculates a chunk size which holds about as much time of the
+ * given audio format as #DEFAULT_CHUNK_SIZE holds of CD audio, so
+ * per-chunk overhead stays the same for high-resolution formats.
+ * The result is a power of two between #DEFAULT_CHUNK_SIZE and
+ * #MAX_CHUNK_SIZE.
+ */
+gcc_pure
+size_t
+CalcChunkSize(AudioFormat af);
+
 #endif
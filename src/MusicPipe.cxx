@@ -22,14 +22,14 @@
 #include "MusicBuffer.hxx"
 #include "MusicChunk.hxx"
 
+#include <thread>
+
 #ifndef NDEBUG
 
 bool
 MusicPipe::Contains(const MusicChunk *chunk) const
 {
-	const ScopeLock protect(mutex);
-
-	for (const MusicChunk *i = head; i != nullptr; i = i->next)
+	for (const MusicChunk *i = Peek(); i != nullptr; i = i->next)
 		if (i == chunk)
 			return true;
 
@@ -41,33 +41,46 @@ MusicPipe::Contains(const MusicChunk *chunk) const
 MusicChunk *
 MusicPipe::Shift()
 {
-	const ScopeLock protect(mutex);
-
-	MusicChunk *chunk = head;
-	if (chunk != nullptr) {
-		assert(!chunk->IsEmpty());
+	MusicChunk *chunk = head.load(std::memory_order_acquire);
+	if (chunk == nullptr)
+		return nullptr;
 
-		head = chunk->next;
-		--size;
-
-		if (head == nullptr) {
-			assert(size == 0);
-			assert(tail_r == &chunk->next);
-
-			tail_r = &head;
+	assert(!chunk->IsEmpty());
+	assert(size > 0);
+
+	MusicChunk *next = chunk->next.load(std::memory_order_acquire);
+	if (next == nullptr) {
+		MusicChunk *expected = chunk;
+		if (tail.compare_exchange_strong(expected, nullptr,
+						 std::memory_order_acq_rel)) {
+			/* this was the last chunk; if the producer
+			   has meanwhile pushed a new one, it has
+			   already replaced the head, and this fails */
+			expected = chunk;
+			head.compare_exchange_strong(expected, nullptr,
+						     std::memory_order_acq_rel);
 		} else {
-			assert(size > 0);
-			assert(tail_r != &chunk->next);
+			/* the producer has appended a chunk, but has
+			   not linked it yet; this is a very short
+			   window */
+			while ((next = chunk->next.load(std::memory_order_acquire)) == nullptr)
+				std::this_thread::yield();
+
+			head.store(next, std::memory_order_release);
 		}
+	} else
+		head.store(next, std::memory_order_release);
 
 #ifndef NDEBUG
-		/* poison the "next" reference */
-		chunk->next = (MusicChunk *)(void *)0x01010101;
+	/* poison the "next" reference */
+	chunk->next = (MusicChunk *)(void *)0x01010101;
 
-		if (size == 0)
-			audio_format.Clear();
+	const ScopeLock protect(mutex);
+	if (size == 1)
+		audio_format.Clear();
 #endif
-	}
+
+	size.fetch_sub(1, std::memory_order_relaxed);
 
 	return chunk;
 }
@@ -87,20 +100,27 @@ MusicPipe::Push(MusicChunk *chunk)
 	assert(!chunk->IsEmpty());
 	assert(chunk->length == 0 || chunk->audio_format.IsValid());
 
-	const ScopeLock protect(mutex);
+#ifndef NDEBUG
+	{
+		const ScopeLock protect(mutex);
 
-	assert(size > 0 || !audio_format.IsDefined());
-	assert(!audio_format.IsDefined() ||
-	       chunk->CheckFormat(audio_format));
+		assert(size > 0 || !audio_format.IsDefined());
+		assert(!audio_format.IsDefined() ||
+		       chunk->CheckFormat(audio_format));
 
-#ifndef NDEBUG
-	if (!audio_format.IsDefined() && chunk->length > 0)
-		audio_format = chunk->audio_format;
+		if (!audio_format.IsDefined() && chunk->length > 0)
+			audio_format = chunk->audio_format;
+	}
 #endif
 
-	chunk->next = nullptr;
-	*tail_r = chunk;
-	tail_r = &chunk->next;
+	chunk->next.store(nullptr, std::memory_order_relaxed);
+
+	size.fetch_add(1, std::memory_order_relaxed);
 
-	++size;
+	MusicChunk *prev = tail.exchange(chunk, std::memory_order_acq_rel);
+	if (prev == nullptr)
+		/* the pipe was empty */
+		head.store(chunk, std::memory_order_release);
+	else
+		prev->next.store(chunk, std::memory_order_release);
 }
@@ -20,13 +20,15 @@
 #ifndef MPD_PIPE_H
 #define MPD_PIPE_H
 
-#include "thread/Mutex.hxx"
 #include "Compiler.h"
 
 #ifndef NDEBUG
+#include "thread/Mutex.hxx"
 #include "AudioFormat.hxx"
 #endif
 
+#include <atomic>
+
 #include <assert.h>
 
 struct MusicChunk;
@@ -35,21 +37,44 @@ class MusicBuffer;
 /**
  * A queue of #MusicChunk objects.  One party appends chunks at the
  * tail, and the other consumes them from the head.
+ *
+ * This class is lock-free, but it supports only one producer thread
+ * (calling Push()) and one consumer thread (calling Shift() and
+ * Clear()).  Other threads may call Peek() and walk the list
+ * through MusicChunk::next.
+ *
+ * The consumer role may be handed to another thread while the
+ * consumer is blocked, as long as both threads synchronize through a
+ * mutex before and after.  The decoder thread does this while
+ * handling #DecoderCommand::SEEK: the player thread waits in
+ * DecoderControl::Seek(), and the decoder clears the pipe with
+ * DecoderControl::mutex locked before it finishes the command.
  */
 class MusicPipe {
-	/** the first chunk */
-	MusicChunk *head;
+	/**
+	 * The first chunk.  Only the consumer modifies it, except
+	 * when the pipe is empty: then the producer sets it.
+	 */
+	std::atomic<MusicChunk *> head;
 
-	/** a pointer to the tail of the chunk */
-	MusicChunk **tail_r;
+	/**
+	 * The last chunk.  The producer swaps in new chunks, and the
+	 * consumer resets it to nullptr when it removes the last
+	 * chunk.
+	 */
+	std::atomic<MusicChunk *> tail;
 
-	/** the current number of chunks */
-	unsigned size;
+	/**
+	 * The current number of chunks.  Push() increments it before
+	 * linking the chunk, so it is never less than the number of
+	 * chunks visible to the consumer.
+	 */
+	std::atomic_uint size;
 
-	/** a mutex which protects #head and #tail_r */
+#ifndef NDEBUG
+	/** a mutex which protects #audio_format */
 	mutable Mutex mutex;
 
-#ifndef NDEBUG
 	AudioFormat audio_format;
 #endif
 
@@ -58,7 +83,7 @@ public:
 	 * Creates a new #MusicPipe object.  It is empty.
 	 */
 	MusicPipe()
-		:head(nullptr), tail_r(&head), size(0) {
+		:head(nullptr), tail(nullptr), size(0) {
 #ifndef NDEBUG
 		audio_format.Clear();
 #endif
@@ -69,7 +94,7 @@ public:
 	 */
 	~MusicPipe() {
 		assert(head == nullptr);
-		assert(tail_r == &head);
+		assert(tail == nullptr);
 	}
 
 #ifndef NDEBUG
@@ -79,6 +104,7 @@ public:
 	 */
 	gcc_pure
 	bool CheckFormat(AudioFormat other) const {
+		const ScopeLock protect(mutex);
 		return !audio_format.IsDefined() ||
 			audio_format == other;
 	}
@@ -96,23 +122,27 @@ public:
 	 */
 	gcc_pure
 	const MusicChunk *Peek() const {
-		return head;
+		return head.load(std::memory_order_acquire);
 	}
 
 	/**
 	 * Removes the first chunk from the head, and returns it.
+	 * Must only be called by the consumer.
 	 */
 	MusicChunk *Shift();
 
 	/**
 	 * Clears the whole pipe and returns the chunks to the buffer.
+	 * Must only be called by the consumer (or by a thread the
+	 * consumer has handed over to, see above).
 	 *
 	 * @param buffer the buffer object to return the chunks to
 	 */
 	void Clear(MusicBuffer &buffer);
 
 	/**
-	 * Pushes a chunk to the tail of the pipe.
+	 * Pushes a chunk to the tail of the pipe.  Must only be
+	 * called by the producer.
 	 */
 	void Push(MusicChunk *chunk);
 
@@ -121,7 +151,7 @@ public:
 	 */
 	gcc_pure
 	unsigned GetSize() const {
-		return size;
+		return size.load(std::memory_order_relaxed);
 	}
 
 	gcc_pure
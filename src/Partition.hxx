@@ -47,11 +47,15 @@ struct Partition final : private PlayerListener, private MixerListener {
 
 	Partition(Instance &_instance,
 		  unsigned max_length,
+		  unsigned prefetch_songs,
 		  unsigned buffer_chunks,
+		  size_t chunk_size,
+		  BufferMemory buffer_memory,
 		  unsigned buffered_before_play)
-		:instance(_instance), playlist(max_length),
+		:instance(_instance), playlist(max_length, prefetch_songs),
 		 outputs(*this),
-		 pc(*this, outputs, buffer_chunks, buffered_before_play) {}
+		 pc(*this, outputs, buffer_chunks, chunk_size,
+		    buffer_memory, buffered_before_play) {}
 
 	void ClearQueue() {
 		playlist.Clear(pc);
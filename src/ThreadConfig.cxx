@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "ThreadConfig.hxx"
+#include "thread/Policy.hxx"
+#include "config/ConfigGlobal.hxx"
+#include "config/ConfigOption.hxx"
+#include "config/Block.hxx"
+#include "system/FatalError.hxx"
+
+#include <stdlib.h>
+#include <string.h>
+
+static ThreadClass
+ParseThreadClass(const ConfigBlock &block)
+{
+	const char *name = block.GetBlockValue("name");
+	if (name == nullptr)
+		FormatFatalError("Missing \"name\" in thread block at line %d",
+				 block.line);
+
+	for (unsigned i = 0; i < unsigned(ThreadClass::MAX); ++i)
+		if (strcmp(name, GetThreadClassName(ThreadClass(i))) == 0)
+			return ThreadClass(i);
+
+	FormatFatalError("Unknown thread name \"%s\" at line %d",
+			 name, block.line);
+}
+
+#ifdef __linux__
+
+static int
+ParseScheduler(const char *name, int line)
+{
+	if (strcmp(name, "other") == 0)
+		return SCHED_OTHER;
+#ifdef SCHED_BATCH
+	else if (strcmp(name, "batch") == 0)
+		return SCHED_BATCH;
+#endif
+#ifdef SCHED_IDLE
+	else if (strcmp(name, "idle") == 0)
+		return SCHED_IDLE;
+#endif
+	else if (strcmp(name, "fifo") == 0)
+		return SCHED_FIFO;
+	else if (strcmp(name, "rr") == 0)
+		return SCHED_RR;
+	else
+		FormatFatalError("Unknown scheduler \"%s\" at line %d",
+				 name, line);
+}
+
+/**
+ * Parse a list of CPU numbers and ranges, e.g. "0,2-3".
+ */
+static void
+ParseCpuList(const char *s, cpu_set_t &set, int line)
+{
+	CPU_ZERO(&set);
+
+	while (true) {
+		char *endptr;
+		unsigned long first = strtoul(s, &endptr, 10), last = first;
+		if (endptr == s)
+			break;
+
+		if (*endptr == '-') {
+			s = endptr + 1;
+			last = strtoul(s, &endptr, 10);
+			if (endptr == s || last < first)
+				break;
+		}
+
+		if (last >= CPU_SETSIZE)
+			break;
+
+		for (unsigned long i = first; i <= last; ++i)
+			CPU_SET(i, &set);
+
+		if (*endptr == 0)
+			return;
+
+		if (*endptr != ',')
+			break;
+
+		s = endptr + 1;
+	}
+
+	FormatFatalError("Malformed CPU list at line %d", line);
+}
+
+#endif
+
+static ThreadPolicy
+ParseThreadPolicy(const ConfigBlock &block)
+{
+	ThreadPolicy policy;
+
+#ifdef __linux__
+	const char *scheduler = block.GetBlockValue("scheduler");
+	if (scheduler != nullptr) {
+		policy.set_scheduler = true;
+		policy.scheduler = ParseScheduler(scheduler, block.line);
+
+		const int min = sched_get_priority_min(policy.scheduler);
+		const int max = sched_get_priority_max(policy.scheduler);
+		policy.priority = block.GetBlockValue("priority", min);
+		if (policy.priority < min || policy.priority > max)
+			FormatFatalError("Priority must be between %d and %d at line %d",
+					 min, max, block.line);
+	}
+
+	if (block.GetBlockParam("nice") != nullptr) {
+		policy.set_nice = true;
+		policy.nice = block.GetBlockValue("nice", 0);
+		if (policy.nice < -20 || policy.nice > 19)
+			FormatFatalError("Nice value must be between -20 and 19 at line %d",
+					 block.line);
+	}
+
+	const char *cpus = block.GetBlockValue("cpu_affinity");
+	if (cpus != nullptr) {
+		policy.set_affinity = true;
+		ParseCpuList(cpus, policy.affinity, block.line);
+	}
+#else
+	(void)block;
+#endif
+
+	return policy;
+}
+
+void
+thread_config_global_init()
+{
+	for (const auto *block = config_get_block(ConfigBlockOption::THREAD);
+	     block != nullptr; block = block->next) {
+		const ThreadClass c = ParseThreadClass(*block);
+		SetThreadPolicy(c, ParseThreadPolicy(*block));
+	}
+}
@@ -36,6 +36,10 @@
 #include "db/update/Service.hxx"
 #endif
 
+#ifndef WIN32
+#include <sys/resource.h>
+#endif
+
 #define COMMAND_STATUS_STATE            "state"
 #define COMMAND_STATUS_REPEAT           "repeat"
 #define COMMAND_STATUS_SINGLE           "single"
@@ -55,6 +59,7 @@
 #define COMMAND_STATUS_MIXRAMPDELAY	"mixrampdelay"
 #define COMMAND_STATUS_AUDIO		"audio"
 #define COMMAND_STATUS_UPDATING_DB	"updating_db"
+#define COMMAND_STATUS_PAGE_FAULTS	"pagefaults"
 
 CommandResult
 handle_play(Client &client, Request args, gcc_unused Response &r)
@@ -199,6 +204,17 @@ handle_status(Client &client, gcc_unused Request args, Response &r)
 			 COMMAND_STATUS_NEXTSONGID ": %u\n",
 			 song, playlist.PositionToId(song));
 
+#ifndef WIN32
+	/* with locked audio buffers, page faults indicate that
+	   memory pressure may still cause dropouts */
+	struct rusage usage;
+	if (client.player_control.buffer_memory != BufferMemory::DEFAULT &&
+	    getrusage(RUSAGE_SELF, &usage) == 0)
+		r.Format(COMMAND_STATUS_PAGE_FAULTS ": %lu:%lu\n",
+			 (unsigned long)usage.ru_minflt,
+			 (unsigned long)usage.ru_majflt);
+#endif
+
 	return CommandResult::OK;
 }
 
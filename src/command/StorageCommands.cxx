@@ -32,6 +32,7 @@
 #include "Partition.hxx"
 #include "Instance.hxx"
 #include "storage/Registry.hxx"
+#include "storage/Configured.hxx"
 #include "storage/CompositeStorage.hxx"
 #include "storage/FileInfo.hxx"
 #include "db/plugins/simple/SimpleDatabasePlugin.hxx"
@@ -229,6 +230,7 @@ handle_mount(Client &client, Request args, Response &r)
 		return CommandResult::ERROR;
 	}
 
+	storage = CacheConfiguredStorage(storage);
 	composite.Mount(local_uri, storage);
 	idle_add(IDLE_MOUNT);
 
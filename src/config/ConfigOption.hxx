@@ -57,8 +57,13 @@ enum class ConfigOption {
 	REPLAYGAIN_LIMIT,
 	VOLUME_NORMALIZATION,
 	SAMPLERATE_CONVERTER,
+	DSD_TO_PCM_QUALITY,
 	AUDIO_BUFFER_SIZE,
 	BUFFER_BEFORE_PLAY,
+	AUDIO_CHUNK_SIZE,
+	AUDIO_BUFFER_MEMORY,
+	PREFETCH_SONGS,
+	SEEK_INDEX_DIRECTORY,
 	HTTP_PROXY_HOST,
 	HTTP_PROXY_PORT,
 	HTTP_PROXY_USER,
@@ -75,6 +80,7 @@ enum class ConfigOption {
 	GAPLESS_MP3_PLAYBACK,
 	AUTO_UPDATE,
 	AUTO_UPDATE_DEPTH,
+	STORAGE_CACHE_TTL,
 	DESPOTIFY_USER,
 	DESPOTIFY_PASSWORD,
 	DESPOTIFY_HIGH_BITRATE,
@@ -90,6 +96,8 @@ enum class ConfigBlockOption {
 	AUDIO_FILTER,
 	DATABASE,
 	NEIGHBORS,
+	THREAD,
+	DECODER_CACHE,
 	MAX
 };
 
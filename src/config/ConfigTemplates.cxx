@@ -52,8 +52,13 @@ const ConfigTemplate config_param_templates[] = {
 	{ "replaygain_limit" },
 	{ "volume_normalization" },
 	{ "samplerate_converter" },
+	{ "dsd_to_pcm_quality" },
 	{ "audio_buffer_size" },
 	{ "buffer_before_play" },
+	{ "audio_chunk_size" },
+	{ "audio_buffer_memory" },
+	{ "prefetch_songs" },
+	{ "seek_index_directory" },
 	{ "http_proxy_host", false, true },
 	{ "http_proxy_port", false, true },
 	{ "http_proxy_user", false, true },
@@ -70,6 +75,7 @@ const ConfigTemplate config_param_templates[] = {
 	{ "gapless_mp3_playback" },
 	{ "auto_update" },
 	{ "auto_update_depth" },
+	{ "storage_cache_ttl" },
 	{ "despotify_user", false, true },
 	{ "despotify_password", false, true },
 	{ "despotify_high_bitrate", false, true },
@@ -90,6 +96,8 @@ const ConfigTemplate config_block_templates[] = {
 	{ "filter", true },
 	{ "database" },
 	{ "neighbors", true },
+	{ "thread", true },
+	{ "decoder_cache" },
 };
 
 static constexpr unsigned n_config_block_templates =
@@ -184,7 +184,9 @@ SimpleDatabase::Load(Error &error)
 	assert(!path.IsNull());
 	assert(root != nullptr);
 
-	TextFile file(path);
+	/* the database file is written only by MPD itself, and
+	   never while it is being loaded, so it may be mapped */
+	TextFile file(path, true);
 
 	if (!db_load_internal(file, *root, error))
 		return false;
@@ -34,6 +34,7 @@
 #include "thread/Id.hxx"
 #include "thread/Thread.hxx"
 #include "thread/Util.hxx"
+#include "thread/Policy.hxx"
 
 #ifndef NDEBUG
 #include "event/Loop.hxx"
@@ -123,7 +124,11 @@ UpdateService::Task()
 	else
 		LogDebug(update_domain, "starting");
 
-	SetThreadIdlePriority();
+	if (!ApplyThreadPolicy(ThreadClass::UPDATE))
+		SetThreadIdlePriority();
+
+	/* don't trust information cached before this update */
+	next.storage->ClearCache();
 
 	modified = walk->Walk(next.db->GetRoot(), next.path_utf8.c_str(),
 			      next.discard);
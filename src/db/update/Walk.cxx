@@ -80,11 +80,12 @@ UpdateWalk::RemoveExcludedFromDirectory(Directory &directory,
 {
 	const ScopeDatabaseLock protect;
 
-	directory.ForEachChildSafe([&](Directory &child){
-			const auto name_fs =
-				AllocatedPath::FromUTF8(child.GetName());
+	/* one buffer for all names in this directory */
+	auto name_fs = AllocatedPath::Null();
 
-			if (name_fs.IsNull() || exclude_list.Check(name_fs)) {
+	directory.ForEachChildSafe([&](Directory &child){
+			if (!name_fs.SetUTF8(child.GetName()) ||
+			    exclude_list.Check(name_fs)) {
 				editor.DeleteDirectory(&child);
 				modified = true;
 			}
@@ -93,8 +94,8 @@ UpdateWalk::RemoveExcludedFromDirectory(Directory &directory,
 	directory.ForEachSongSafe([&](Song &song){
 			assert(song.parent == &directory);
 
-			const auto name_fs = AllocatedPath::FromUTF8(song.uri);
-			if (name_fs.IsNull() || exclude_list.Check(name_fs)) {
+			if (!name_fs.SetUTF8(song.uri) ||
+			    exclude_list.Check(name_fs)) {
 				editor.DeleteSong(directory, &song);
 				modified = true;
 			}
@@ -266,7 +267,39 @@ UpdateWalk::SkipSymlink(const Directory *directory,
 		/* not a local file: don't skip */
 		return false;
 
-	const auto target = ReadLink(path_fs);
+	return SkipSymlinkTarget(directory, ReadLink(path_fs));
+#else
+	/* no symlink checking on WIN32 */
+
+	(void)directory;
+	(void)utf8_name;
+
+	return false;
+#endif
+}
+
+bool
+UpdateWalk::SkipSymlink(const Directory *directory,
+			StorageDirectoryReader &reader) const
+{
+#ifndef WIN32
+	return SkipSymlinkTarget(directory, reader.ReadLink());
+#else
+	/* no symlink checking on WIN32 */
+
+	(void)directory;
+	(void)reader;
+
+	return false;
+#endif
+}
+
+#ifndef WIN32
+
+bool
+UpdateWalk::SkipSymlinkTarget(const Directory *directory,
+			      const AllocatedPath &target) const
+{
 	if (target.IsNull())
 		/* don't skip if this is not a symlink */
 		return errno != EINVAL;
@@ -318,15 +351,9 @@ UpdateWalk::SkipSymlink(const Directory *directory,
 	   to a song which is already in the database - skip according
 	   to the follow_inside_symlinks param*/
 	return !follow_inside_symlinks;
-#else
-	/* no symlink checking on WIN32 */
-
-	(void)directory;
-	(void)utf8_name;
+}
 
-	return false;
 #endif
-}
 
 bool
 UpdateWalk::UpdateDirectory(Directory &directory,
@@ -358,18 +385,20 @@ UpdateWalk::UpdateDirectory(Directory &directory,
 
 	PurgeDeletedFromDirectory(directory);
 
+	/* the file system name of each entry is converted into this
+	   buffer, which is reused for the whole directory */
+	auto name_fs = AllocatedPath::Null();
+
 	const char *name_utf8;
 	while (!cancel && (name_utf8 = reader->Read()) != nullptr) {
 		if (skip_path(name_utf8))
 			continue;
 
-		{
-			const auto name_fs = AllocatedPath::FromUTF8(name_utf8);
-			if (name_fs.IsNull() || child_exclude_list.Check(name_fs))
-				continue;
-		}
+		if (!name_fs.SetUTF8(name_utf8) ||
+		    child_exclude_list.Check(name_fs))
+			continue;
 
-		if (SkipSymlink(&directory, name_utf8)) {
+		if (SkipSymlink(&directory, *reader)) {
 			modified |= editor.DeleteNameIn(directory, name_utf8);
 			continue;
 		}
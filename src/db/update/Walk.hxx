@@ -31,6 +31,8 @@ struct StorageFileInfo;
 struct Directory;
 struct ArchivePlugin;
 class Storage;
+class StorageDirectoryReader;
+class AllocatedPath;
 class ExcludeList;
 
 class UpdateWalk final {
@@ -82,6 +84,23 @@ private:
 	bool SkipSymlink(const Directory *directory,
 			 const char *utf8_name) const;
 
+	/**
+	 * Like SkipSymlink(), but check the current entry of the
+	 * given #StorageDirectoryReader, which avoids building and
+	 * resolving the full path.
+	 */
+	bool SkipSymlink(const Directory *directory,
+			 StorageDirectoryReader &reader) const;
+
+#ifndef WIN32
+	/**
+	 * @param target the return value of ReadLink()
+	 */
+	gcc_pure
+	bool SkipSymlinkTarget(const Directory *directory,
+			       const AllocatedPath &target) const;
+#endif
+
 	void RemoveExcludedFromDirectory(Directory &directory,
 					 const ExcludeList &exclude_list);
 
@@ -28,16 +28,50 @@
 #include "MusicPipe.hxx"
 #include "DecoderControl.hxx"
 #include "DecoderInternal.hxx"
+#include "DecoderCache.hxx"
 #include "DetachedSong.hxx"
 #include "input/InputStream.hxx"
 #include "util/Error.hxx"
 #include "util/ConstBuffer.hxx"
 #include "Log.hxx"
 
+#include <algorithm>
+
 #include <assert.h>
 #include <string.h>
 #include <math.h>
 
+/**
+ * Allocate the #DecoderCacheEntry being recorded for the expected
+ * length of the song, or give up recording it if it will not fit
+ * into the cache.
+ */
+static void
+decoder_cache_reserve(Decoder &decoder, SignedSongTime duration)
+{
+	const DecoderControl &dc = decoder.dc;
+	DecoderCacheEntry &entry = *decoder.cache_entry;
+
+	SongTime length;
+	if (entry.end_time.IsPositive())
+		length = entry.end_time - entry.start_time;
+	else if (duration.IsPositive() &&
+		 SongTime(duration) > entry.start_time)
+		length = SongTime(duration) - entry.start_time;
+	else
+		/* unknown duration */
+		return;
+
+	const uint64_t expected_size =
+		length.ToScale<uint64_t>(dc.out_audio_format.sample_rate) *
+		dc.out_audio_format.GetFrameSize();
+	if (expected_size > decoder_cache->GetMaxEntrySize())
+		/* too large for the cache */
+		decoder.cache_entry.reset();
+	else
+		entry.Reserve(expected_size);
+}
+
 void
 decoder_initialized(Decoder &decoder,
 		    const AudioFormat audio_format,
@@ -80,6 +114,9 @@ decoder_initialized(Decoder &decoder,
 			decoder.error = std::move(error);
 	}
 
+	if (decoder.cache_entry != nullptr)
+		decoder_cache_reserve(decoder, duration);
+
 	const ScopeLock protect(dc.mutex);
 	dc.state = DecoderState::DECODE;
 	dc.client_cond.signal();
@@ -201,9 +238,15 @@ decoder_command_finished(Decoder &decoder)
 			decoder.chunk = nullptr;
 		}
 
+		/* the player thread is blocked in
+		   DecoderControl::Seek() until we finish this
+		   command, so we may act as the pipe's consumer */
 		dc.pipe->Clear(*dc.buffer);
 
 		decoder.timestamp = dc.seek_time.ToDoubleS();
+
+		/* the recorded PCM data is incomplete now */
+		decoder.cache_entry.reset();
 	}
 
 	dc.command = DecoderCommand::NONE;
@@ -449,6 +492,102 @@ update_stream_tag(Decoder &decoder, InputStream *is)
 	return true;
 }
 
+/**
+ * Send the stream tag to the music pipe if it has changed.
+ */
+static DecoderCommand
+send_stream_tag(Decoder &decoder, InputStream *is)
+{
+	if (!update_stream_tag(decoder, is))
+		return DecoderCommand::NONE;
+
+	if (decoder.decoder_tag != nullptr) {
+		/* merge with tag from decoder plugin */
+		Tag *tag = Tag::Merge(*decoder.decoder_tag,
+				      *decoder.stream_tag);
+		DecoderCommand cmd = do_send_tag(decoder, *tag);
+		delete tag;
+		return cmd;
+	} else
+		/* send only the stream tag */
+		return do_send_tag(decoder, *decoder.stream_tag);
+}
+
+/**
+ * Returns the writable tail of the current chunk (see
+ * MusicChunk::Write()), allocating a new chunk if necessary.
+ *
+ * @param min_size if the tail of a non-empty chunk is smaller than
+ * this, then the chunk is flushed and a new one is allocated
+ * @return the buffer, or an empty buffer if we have received a
+ * decoder command
+ */
+static WritableBuffer<void>
+get_chunk_buffer(Decoder &decoder, uint16_t kbit_rate, size_t min_size=0)
+{
+	const DecoderControl &dc = decoder.dc;
+
+	while (true) {
+		MusicChunk *chunk = decoder.GetChunk();
+		if (chunk == nullptr) {
+			assert(dc.command != DecoderCommand::NONE);
+			return nullptr;
+		}
+
+		const auto dest =
+			chunk->Write(dc.out_audio_format,
+				     SongTime::FromS(decoder.timestamp) -
+				     dc.song->GetStartTime(),
+				     kbit_rate);
+		if (!dest.IsEmpty() &&
+		    (dest.size >= min_size || chunk->IsEmpty()))
+			return dest;
+
+		/* the chunk is full, flush it */
+		decoder.FlushChunk();
+	}
+}
+
+/**
+ * Marks the given number of bytes at the end of the current chunk
+ * as used, and advances the time stamp.
+ *
+ * @return DecoderCommand::STOP if the end of the range has been
+ * reached, DecoderCommand::NONE otherwise
+ */
+static DecoderCommand
+expand_chunk(Decoder &decoder, size_t nbytes)
+{
+	DecoderControl &dc = decoder.dc;
+	MusicChunk *chunk = decoder.chunk;
+	assert(chunk != nullptr);
+
+	if (decoder.cache_entry != nullptr &&
+	    !decoder.cache_entry->Append(chunk->data + chunk->length, nbytes,
+					 decoder_cache->GetMaxEntrySize()))
+		/* too large for the cache */
+		decoder.cache_entry.reset();
+
+	/* expand the music pipe chunk */
+
+	bool full = chunk->Expand(dc.out_audio_format, nbytes);
+	if (full) {
+		/* the chunk is full, flush it */
+		decoder.FlushChunk();
+	}
+
+	decoder.timestamp += (double)nbytes /
+		dc.out_audio_format.GetTimeToSize();
+
+	if (dc.end_time.IsPositive() &&
+	    decoder.timestamp >= dc.end_time.ToDoubleS())
+		/* the end of this range has been reached:
+		   stop decoding */
+		return DecoderCommand::STOP;
+
+	return DecoderCommand::NONE;
+}
+
 DecoderCommand
 decoder_data(Decoder &decoder,
 	     InputStream *is,
@@ -470,22 +609,9 @@ decoder_data(Decoder &decoder,
 	assert(!decoder.initial_seek_pending);
 	assert(!decoder.initial_seek_running);
 
-	/* send stream tags */
-
-	if (update_stream_tag(decoder, is)) {
-		if (decoder.decoder_tag != nullptr) {
-			/* merge with tag from decoder plugin */
-			Tag *tag = Tag::Merge(*decoder.decoder_tag,
-					      *decoder.stream_tag);
-			cmd = do_send_tag(decoder, *tag);
-			delete tag;
-		} else
-			/* send only the stream tag */
-			cmd = do_send_tag(decoder, *decoder.stream_tag);
-
-		if (cmd != DecoderCommand::NONE)
-			return cmd;
-	}
+	cmd = send_stream_tag(decoder, is);
+	if (cmd != DecoderCommand::NONE)
+		return cmd;
 
 	if (decoder.convert != nullptr) {
 		assert(dc.in_audio_format != dc.out_audio_format);
@@ -508,56 +634,101 @@ decoder_data(Decoder &decoder,
 	}
 
 	while (length > 0) {
-		MusicChunk *chunk;
-		bool full;
-
-		chunk = decoder.GetChunk();
-		if (chunk == nullptr) {
+		const auto dest = get_chunk_buffer(decoder, kbit_rate);
+		if (dest.IsNull()) {
 			assert(dc.command != DecoderCommand::NONE);
 			return dc.command;
 		}
 
-		const auto dest =
-			chunk->Write(dc.out_audio_format,
-				     SongTime::FromS(decoder.timestamp) -
-				     dc.song->GetStartTime(),
-				     kbit_rate);
-		if (dest.IsEmpty()) {
-			/* the chunk is full, flush it */
-			decoder.FlushChunk();
-			continue;
-		}
-
 		const size_t nbytes = std::min(dest.size, length);
 
 		/* copy the buffer */
 
 		memcpy(dest.data, data, nbytes);
 
-		/* expand the music pipe chunk */
-
-		full = chunk->Expand(dc.out_audio_format, nbytes);
-		if (full) {
-			/* the chunk is full, flush it */
-			decoder.FlushChunk();
-		}
-
 		data = (const uint8_t *)data + nbytes;
 		length -= nbytes;
 
-		decoder.timestamp += (double)nbytes /
-			dc.out_audio_format.GetTimeToSize();
-
-		if (dc.end_time.IsPositive() &&
-		    decoder.timestamp >= dc.end_time.ToDoubleS())
-			/* the end of this range has been reached:
-			   stop decoding */
-			return DecoderCommand::STOP;
+		cmd = expand_chunk(decoder, nbytes);
+		if (cmd != DecoderCommand::NONE)
+			return cmd;
 	}
 
 	return DecoderCommand::NONE;
 }
 
+WritableBuffer<void>
+decoder_get_buffer(Decoder &decoder, InputStream *is, uint16_t kbit_rate,
+		   size_t min_size)
+{
+	DecoderControl &dc = decoder.dc;
+
+	assert(dc.state == DecoderState::DECODE);
+	assert(dc.pipe != nullptr);
+	assert(decoder.write_buffer == nullptr);
+
+	DecoderCommand cmd = decoder_lock_get_virtual_command(decoder);
+	if (cmd == DecoderCommand::STOP || cmd == DecoderCommand::SEEK)
+		return nullptr;
+
+	assert(!decoder.initial_seek_pending);
+	assert(!decoder.initial_seek_running);
+
+	if (send_stream_tag(decoder, is) != DecoderCommand::NONE)
+		return nullptr;
+
+	WritableBuffer<void> dest;
+	if (decoder.convert != nullptr) {
+		/* the data needs to be converted before it can be
+		   submitted to the music pipe; let the plugin write
+		   to a staging buffer, and let decoder_data() do the
+		   rest in decoder_commit_buffer() */
+		assert(dc.in_audio_format != dc.out_audio_format);
+
+		const size_t chunk_size = std::max(dc.buffer->GetChunkSize(),
+						   min_size);
+		const size_t frame_size = dc.in_audio_format.GetFrameSize();
+		dest.size = chunk_size - chunk_size % frame_size;
+		dest.data = decoder.convert_buffer.Get(dest.size);
+	} else {
+		assert(dc.in_audio_format == dc.out_audio_format);
+
+		dest = get_chunk_buffer(decoder, kbit_rate, min_size);
+		if (dest.IsNull())
+			return nullptr;
+	}
+
+	decoder.write_buffer = dest.data;
+	decoder.write_kbit_rate = kbit_rate;
+	return dest;
+}
+
+DecoderCommand
+decoder_commit_buffer(Decoder &decoder, size_t length)
+{
+	gcc_unused const DecoderControl &dc = decoder.dc;
+
+	assert(decoder.write_buffer != nullptr);
+	assert(length % dc.in_audio_format.GetFrameSize() == 0);
+
+	const void *data = decoder.write_buffer;
+	decoder.write_buffer = nullptr;
+
+	if (decoder.convert != nullptr)
+		/* stream tags have already been sent by
+		   decoder_get_buffer() */
+		return decoder_data(decoder, nullptr, data, length,
+				    decoder.write_kbit_rate);
+
+	if (length == 0)
+		return decoder_lock_get_virtual_command(decoder);
+
+	assert(decoder.chunk != nullptr);
+	assert(data == decoder.chunk->data + decoder.chunk->length);
+
+	return expand_chunk(decoder, length);
+}
+
 DecoderCommand
 decoder_tag(Decoder &decoder, InputStream *is,
 	    Tag &&tag)
@@ -568,6 +739,12 @@ decoder_tag(Decoder &decoder, InputStream *is,
 	assert(dc.state == DecoderState::DECODE);
 	assert(dc.pipe != nullptr);
 
+	/* remember the tag for replaying it from the cache */
+
+	if (decoder.cache_entry != nullptr)
+		decoder.cache_entry->tags.emplace_back(decoder.cache_entry->size,
+						       tag);
+
 	/* save the tag */
 
 	delete decoder.decoder_tag;
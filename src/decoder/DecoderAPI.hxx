@@ -38,6 +38,7 @@
 #include "MixRampInfo.hxx"
 #include "config/Block.hxx"
 #include "Chrono.hxx"
+#include "util/WritableBuffer.hxx"
 
 // IWYU pragma: end_exports
 
@@ -193,6 +194,49 @@ decoder_data(Decoder &decoder, InputStream &is,
 	return decoder_data(decoder, &is, data, length, kbit_rate);
 }
 
+/**
+ * Obtain a buffer which the decoder plugin may fill with decoded
+ * PCM data (in the #AudioFormat passed to decoder_initialized()).
+ * Unless the data needs to be converted, this points directly into
+ * the #MusicChunk, which saves the copy done by decoder_data().
+ *
+ * Each successful call must be followed by decoder_commit_buffer()
+ * before any other function submitting data or tags is called.
+ *
+ * @param decoder the decoder object
+ * @param is an input stream which is buffering while we are waiting
+ * for the player
+ * @param min_size the size the plugin needs to write at once (e.g. a
+ * whole codec packet); if the current #MusicChunk has less space
+ * left, then a new chunk is started.  The returned buffer may still
+ * be smaller if this exceeds the chunk size.
+ * @return a buffer whose size is a multiple of the frame size, or
+ * nullptr if a command is pending (see decoder_get_command())
+ */
+WritableBuffer<void>
+decoder_get_buffer(Decoder &decoder, InputStream *is,
+		   uint16_t kbit_rate, size_t min_size=0);
+
+static inline WritableBuffer<void>
+decoder_get_buffer(Decoder &decoder, InputStream &is,
+		   uint16_t kbit_rate, size_t min_size=0)
+{
+	return decoder_get_buffer(decoder, &is, kbit_rate, min_size);
+}
+
+/**
+ * Submit data which was written to the buffer returned by
+ * decoder_get_buffer().
+ *
+ * @param decoder the decoder object
+ * @param length the number of bytes which were written; must be a
+ * multiple of the frame size, and may be zero
+ * @return the current command, or DecoderCommand::NONE if there is no
+ * command pending
+ */
+DecoderCommand
+decoder_commit_buffer(Decoder &decoder, size_t length);
+
 /**
  * This function is called by the decoder plugin when it has
  * successfully decoded a tag.
@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "DecoderCache.hxx"
+#include "AudioConfig.hxx"
+#include "config/ConfigGlobal.hxx"
+#include "config/ConfigOption.hxx"
+#include "config/Block.hxx"
+#include "system/FatalError.hxx"
+#include "util/Error.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+
+static constexpr Domain decoder_cache_domain("decoder_cache");
+
+DecoderCache *decoder_cache;
+
+DecoderCacheEntry::~DecoderCacheEntry()
+{
+	if (spill_fd.IsDefined())
+		spill_fd.Close();
+}
+
+bool
+DecoderCacheEntry::Append(const void *src, size_t length, size_t max_size)
+{
+	assert(!IsSpilled());
+
+	if (length > max_size - size)
+		return false;
+
+	const uint8_t *p = (const uint8_t *)src;
+	data.insert(data.end(), p, p + length);
+	size += length;
+	return true;
+}
+
+size_t
+DecoderCacheEntry::Read(size_t offset, void *dest, size_t length) const
+{
+	if (offset >= size)
+		return 0;
+
+	if (length > size - offset)
+		length = size - offset;
+
+#ifndef WIN32
+	if (IsSpilled()) {
+		ssize_t nbytes = pread(spill_fd.Get(), dest, length, offset);
+		if (nbytes < 0) {
+			LogErrno(decoder_cache_domain,
+				 "Failed to read from spill file");
+			return 0;
+		}
+
+		return nbytes;
+	}
+#endif
+
+	memcpy(dest, &data[offset], length);
+	return length;
+}
+
+std::shared_ptr<const DecoderCacheEntry>
+DecoderCache::Lookup(const char *uri, SongTime start_time, SongTime end_time,
+		     time_t mtime)
+{
+	const ScopeLock protect(mutex);
+
+	for (auto i = entries.begin(), end = entries.end(); i != end; ++i) {
+		const DecoderCacheEntry &entry = **i;
+		if (entry.uri != uri || entry.start_time != start_time ||
+		    entry.end_time != end_time)
+			continue;
+
+		if (entry.mtime != mtime ||
+		    entry.out_format != getOutputAudioFormat(entry.in_format)) {
+			/* the file or the configured output format
+			   has changed since this entry was
+			   recorded */
+			Remove(entry);
+			entries.erase(i);
+			return nullptr;
+		}
+
+		/* move to the front of the LRU list */
+		entries.splice(entries.begin(), entries, i);
+		return entries.front();
+	}
+
+	return nullptr;
+}
+
+void
+DecoderCache::Remove(const DecoderCacheEntry &entry)
+{
+	if (entry.IsSpilled())
+		spill_size -= entry.size;
+	else
+		memory_size -= entry.size;
+}
+
+void
+DecoderCache::Store(std::unique_ptr<DecoderCacheEntry> &&entry)
+{
+	assert(entry != nullptr);
+	assert(!entry->IsSpilled());
+	assert(entry->size <= max_memory);
+
+	entry->data.shrink_to_fit();
+
+	const ScopeLock protect(mutex);
+
+	for (auto i = entries.begin(), end = entries.end(); i != end; ++i) {
+		const DecoderCacheEntry &old = **i;
+		if (old.uri == entry->uri &&
+		    old.start_time == entry->start_time &&
+		    old.end_time == entry->end_time) {
+			Remove(old);
+			entries.erase(i);
+			break;
+		}
+	}
+
+	FormatDebug(decoder_cache_domain, "caching %s (%lu bytes)",
+		    entry->uri.c_str(), (unsigned long)entry->size);
+
+	memory_size += entry->size;
+	entries.emplace_front(entry.release());
+
+	Shrink();
+}
+
+void
+DecoderCache::Shrink()
+{
+	for (auto i = entries.end(); memory_size > max_memory &&
+		     i != entries.begin();) {
+		--i;
+
+		DecoderCacheEntry &entry = **i;
+		if (entry.IsSpilled())
+			continue;
+
+		if (i->use_count() > 1)
+			/* currently being played; its data must not
+			   be moved now */
+			continue;
+
+		const size_t size = entry.size;
+		if (!spill_directory.IsNull() &&
+		    size <= max_spill && Spill(entry)) {
+			memory_size -= size;
+			spill_size += size;
+		} else {
+			Remove(entry);
+			i = entries.erase(i);
+		}
+	}
+
+	/* drop the least recently used spilled entries if the spill
+	   directory is over its limit */
+	for (auto i = entries.end(); spill_size > max_spill &&
+		     i != entries.begin();) {
+		--i;
+
+		if ((*i)->IsSpilled()) {
+			Remove(**i);
+			i = entries.erase(i);
+		}
+	}
+}
+
+bool
+DecoderCache::Spill(DecoderCacheEntry &entry)
+{
+#ifdef WIN32
+	(void)entry;
+	return false;
+#else
+	const auto path = AllocatedPath::Build(spill_directory,
+					       "mpd-pcm-XXXXXX");
+	std::string name = path.c_str();
+
+	FileDescriptor fd(mkstemp(&name.front()));
+	if (!fd.IsDefined()) {
+		FormatErrno(decoder_cache_domain,
+			    "Failed to create spill file in %s",
+			    spill_directory.c_str());
+		return false;
+	}
+
+	/* the file is not needed by anybody else; it disappears
+	   when it gets closed */
+	unlink(name.c_str());
+
+	const uint8_t *p = &entry.data.front();
+	size_t length = entry.size;
+	while (length > 0) {
+		ssize_t nbytes = fd.Write(p, length);
+		if (nbytes <= 0) {
+			FormatErrno(decoder_cache_domain,
+				    "Failed to write spill file in %s",
+				    spill_directory.c_str());
+			fd.Close();
+			return false;
+		}
+
+		p += nbytes;
+		length -= nbytes;
+	}
+
+	std::vector<uint8_t>().swap(entry.data);
+	entry.spill_fd = fd;
+	return true;
+#endif
+}
+
+void
+decoder_cache_global_init()
+{
+	const ConfigBlock *block =
+		config_get_block(ConfigBlockOption::DECODER_CACHE);
+	if (block == nullptr)
+		return;
+
+	const size_t max_memory =
+		size_t(block->GetBlockValue("size", 65536u)) * 1024;
+	if (max_memory == 0)
+		FormatFatalError("Invalid decoder_cache size at line %d",
+				 block->line);
+
+	Error error;
+	AllocatedPath spill_directory =
+		block->GetBlockPath("spill_directory", error);
+	if (error.IsDefined())
+		FatalError(error);
+
+	const size_t max_spill =
+		size_t(block->GetBlockValue("spill_size", 1048576u)) * 1024;
+
+	decoder_cache = new DecoderCache(max_memory,
+					 std::move(spill_directory),
+					 max_spill);
+}
+
+void
+decoder_cache_global_finish()
+{
+	delete decoder_cache;
+	decoder_cache = nullptr;
+}
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_DECODER_CACHE_HXX
+#define MPD_DECODER_CACHE_HXX
+
+#include "check.h"
+#include "AudioFormat.hxx"
+#include "ReplayGainInfo.hxx"
+#include "MixRampInfo.hxx"
+#include "Chrono.hxx"
+#include "tag/Tag.hxx"
+#include "thread/Mutex.hxx"
+#include "system/FileDescriptor.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "Compiler.h"
+
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stddef.h>
+#include <time.h>
+
+/**
+ * The decoded PCM data of one song (or one range of a song), as it
+ * was submitted to the #MusicPipe.
+ */
+struct DecoderCacheEntry {
+	std::string uri;
+	SongTime start_time, end_time;
+
+	/**
+	 * The modification time of the file; if it changes, this
+	 * entry is stale.
+	 */
+	time_t mtime;
+
+	/**
+	 * The format the decoder plugin has produced; the data in
+	 * this entry has been converted to #out_format already.
+	 */
+	AudioFormat in_format, out_format;
+
+	SignedSongTime duration;
+
+	bool has_replay_gain;
+	ReplayGainInfo replay_gain_info;
+
+	MixRampInfo mix_ramp;
+
+	/**
+	 * The tags submitted by the decoder plugin, each with the
+	 * offset in the PCM data at which it was submitted.
+	 */
+	std::vector<std::pair<size_t, Tag>> tags;
+
+	/**
+	 * The PCM data, unless it has been spilled to #spill_fd.
+	 */
+	std::vector<uint8_t> data;
+
+	/**
+	 * The size of the PCM data in bytes.
+	 */
+	size_t size;
+
+	/**
+	 * An unlinked file which contains the PCM data, if it has
+	 * been moved out of memory.
+	 */
+	FileDescriptor spill_fd;
+
+	DecoderCacheEntry(const char *_uri,
+			  SongTime _start_time, SongTime _end_time,
+			  time_t _mtime)
+		:uri(_uri), start_time(_start_time), end_time(_end_time),
+		 mtime(_mtime), has_replay_gain(false), size(0),
+		 spill_fd(FileDescriptor::Undefined()) {}
+
+	~DecoderCacheEntry();
+
+	DecoderCacheEntry(const DecoderCacheEntry &) = delete;
+	DecoderCacheEntry &operator=(const DecoderCacheEntry &) = delete;
+
+	bool IsSpilled() const {
+		return spill_fd.IsDefined();
+	}
+
+	/**
+	 * Allocate memory for the expected amount of PCM data, to
+	 * avoid reallocations while recording.
+	 */
+	void Reserve(size_t expected_size) {
+		data.reserve(expected_size);
+	}
+
+	/**
+	 * Append PCM data while recording.
+	 *
+	 * @return false if the entry would grow beyond the given
+	 * limit (the data is not appended then)
+	 */
+	bool Append(const void *src, size_t length, size_t max_size);
+
+	/**
+	 * Copy PCM data from the given offset.
+	 *
+	 * @return the number of bytes copied, 0 at the end or on
+	 * I/O error
+	 */
+	size_t Read(size_t offset, void *dest, size_t length) const;
+};
+
+/**
+ * A LRU cache of decoded PCM data.  It is used by the decoder
+ * thread to play songs again without invoking the decoder plugin,
+ * e.g. in "repeat single" mode.  Entries which do not fit into the
+ * configured amount of memory may be spilled to unlinked files in a
+ * configured directory.
+ */
+class DecoderCache {
+	const size_t max_memory;
+
+	/**
+	 * The directory where entries are spilled to.  Null disables
+	 * spilling.
+	 */
+	const AllocatedPath spill_directory;
+
+	const size_t max_spill;
+
+	/**
+	 * Protects #entries and the counters.
+	 */
+	mutable Mutex mutex;
+
+	/**
+	 * The most recently used entry is at the front.
+	 */
+	std::list<std::shared_ptr<DecoderCacheEntry>> entries;
+
+	size_t memory_size, spill_size;
+
+public:
+	DecoderCache(size_t _max_memory,
+		     AllocatedPath &&_spill_directory, size_t _max_spill)
+		:max_memory(_max_memory),
+		 spill_directory(std::move(_spill_directory)),
+		 max_spill(_max_spill),
+		 memory_size(0), spill_size(0) {}
+
+	DecoderCache(const DecoderCache &) = delete;
+	DecoderCache &operator=(const DecoderCache &) = delete;
+
+	/**
+	 * The maximum size of a single entry.  Recording is aborted
+	 * when a song exceeds it.
+	 */
+	size_t GetMaxEntrySize() const {
+		return max_memory;
+	}
+
+	/**
+	 * Look up an entry and mark it as recently used.
+	 *
+	 * @return the entry or nullptr if there is no (valid) entry
+	 */
+	std::shared_ptr<const DecoderCacheEntry> Lookup(const char *uri,
+							SongTime start_time,
+							SongTime end_time,
+							time_t mtime);
+
+	/**
+	 * Add a completely recorded entry, replacing an older one
+	 * with the same key, and evict old entries if necessary.
+	 */
+	void Store(std::unique_ptr<DecoderCacheEntry> &&entry);
+
+private:
+	void Remove(const DecoderCacheEntry &entry);
+
+	/**
+	 * Spill or drop the least recently used entries until the
+	 * memory limit is met.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void Shrink();
+
+	/**
+	 * Move the PCM data of the given entry to a file.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	bool Spill(DecoderCacheEntry &entry);
+};
+
+/**
+ * The global #DecoderCache instance; nullptr if it is disabled.
+ */
+extern DecoderCache *decoder_cache;
+
+/**
+ * Create #decoder_cache according to the "decoder_cache" block in
+ * the configuration file.
+ */
+void
+decoder_cache_global_init();
+
+void
+decoder_cache_global_finish();
+
+#endif
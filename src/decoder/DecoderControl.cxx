@@ -27,6 +27,7 @@
 
 DecoderControl::DecoderControl(Mutex &_mutex, Cond &_client_cond)
 	:mutex(_mutex), client_cond(_client_cond),
+	 prefetch(_mutex, cond),
 	 state(DecoderState::STOP),
 	 command(DecoderCommand::NONE),
 	 client_is_waiting(false),
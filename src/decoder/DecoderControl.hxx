@@ -21,6 +21,7 @@
 #define MPD_DECODER_CONTROL_HXX
 
 #include "DecoderCommand.hxx"
+#include "DecoderPrefetch.hxx"
 #include "AudioFormat.hxx"
 #include "MixRampInfo.hxx"
 #include "thread/Mutex.hxx"
@@ -86,6 +87,13 @@ struct DecoderControl {
 	 */
 	Cond &client_cond;
 
+	/**
+	 * Input streams which were opened in advance for upcoming
+	 * songs.  Managed by the player thread, consumed by the
+	 * decoder thread.
+	 */
+	DecoderPrefetch prefetch;
+
 	DecoderState state;
 	DecoderCommand command;
 
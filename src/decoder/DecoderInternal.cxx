@@ -20,6 +20,7 @@
 #include "config.h"
 #include "DecoderInternal.hxx"
 #include "DecoderControl.hxx"
+#include "DecoderCache.hxx"
 #include "pcm/PcmConvert.hxx"
 #include "MusicPipe.hxx"
 #include "MusicBuffer.hxx"
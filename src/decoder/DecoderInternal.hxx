@@ -21,9 +21,13 @@
 #define MPD_DECODER_INTERNAL_HXX
 
 #include "ReplayGainInfo.hxx"
+#include "pcm/PcmBuffer.hxx"
 #include "util/Error.hxx"
 
+#include <memory>
+
 class PcmConvert;
+struct DecoderCacheEntry;
 struct MusicChunk;
 struct DecoderControl;
 struct Tag;
@@ -79,6 +83,23 @@ struct Decoder {
 	/** the chunk currently being written to */
 	MusicChunk *chunk;
 
+	/**
+	 * The buffer returned by decoder_get_buffer() which has not
+	 * yet been committed, or nullptr.
+	 */
+	void *write_buffer;
+
+	/**
+	 * The bit rate passed to decoder_get_buffer().
+	 */
+	uint16_t write_kbit_rate;
+
+	/**
+	 * The staging buffer returned by decoder_get_buffer() while
+	 * #convert is active.
+	 */
+	PcmBuffer convert_buffer;
+
 	ReplayGainInfo replay_gain_info;
 
 	/**
@@ -87,6 +108,13 @@ struct Decoder {
 	 */
 	unsigned replay_gain_serial;
 
+	/**
+	 * If not nullptr, then the PCM data submitted to the
+	 * #MusicPipe is recorded here, to be added to the
+	 * #DecoderCache after the song has been decoded completely.
+	 */
+	std::unique_ptr<DecoderCacheEntry> cache_entry;
+
 	/**
 	 * An error has occurred (in DecoderAPI.cxx), and the plugin
 	 * will be asked to stop.
@@ -101,7 +129,7 @@ struct Decoder {
 		 initial_seek_running(false),
 		 seeking(false),
 		 song_tag(_tag), stream_tag(nullptr), decoder_tag(nullptr),
-		 chunk(nullptr),
+		 chunk(nullptr), write_buffer(nullptr),
 		 replay_gain_serial(0) {
 	}
 
@@ -71,6 +71,14 @@ struct DecoderPlugin {
 	/**
 	 * Scan metadata of a file.
 	 *
+	 * This is called by the database update for each file, so it
+	 * is a "tags and duration only" probe: it shall read only
+	 * headers (tags, stream parameters, Xing/VBRI headers, seek
+	 * tables) and shall neither initialize the codec nor decode
+	 * audio.  If the duration is not found in the headers, an
+	 * estimate (e.g. from the file size and the bit rate) or no
+	 * duration at all is preferable to decoding the whole file.
+	 *
 	 * @return false if the operation has failed
 	 */
 	bool (*scan_file)(Path path_fs,
@@ -78,7 +86,8 @@ struct DecoderPlugin {
 			  void *handler_ctx);
 
 	/**
-	 * Scan metadata of a file.
+	 * Scan metadata of a stream.  The same rules as for
+	 * scan_file() apply.
 	 *
 	 * @return false if the operation has failed
 	 */
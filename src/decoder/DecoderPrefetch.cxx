@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "DecoderPrefetch.hxx"
+#include "input/InputStream.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Name.hxx"
+#include "thread/Policy.hxx"
+#include "util/UriUtil.hxx"
+#include "util/Error.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+#include <algorithm>
+
+#include <assert.h>
+
+static constexpr Domain prefetch_domain("prefetch");
+
+DecoderPrefetch::Item::Item(const std::string &_uri, InputStream *_is)
+	:uri(_uri), is(_is) {}
+
+DecoderPrefetch::Item::~Item() = default;
+
+DecoderPrefetch::DecoderPrefetch(Mutex &_mutex, Cond &_cond)
+	:mutex(_mutex), cond(_cond), quit(false) {}
+
+DecoderPrefetch::~DecoderPrefetch()
+{
+	assert(!thread.IsDefined());
+}
+
+template<typename L>
+gcc_pure
+static bool
+ContainsUri(const L &list, const std::string &uri)
+{
+	return std::find(list.begin(), list.end(), uri) != list.end();
+}
+
+const std::string *
+DecoderPrefetch::FindPending() const
+{
+	for (const auto &uri : wanted)
+		if (uri_has_scheme(uri.c_str()) && !ContainsUri(handled, uri))
+			return &uri;
+
+	return nullptr;
+}
+
+inline void
+DecoderPrefetch::Task()
+{
+	SetThreadName("prefetch");
+	ApplyThreadPolicy(ThreadClass::IO);
+
+	/* the streams are opened and closed outside of the mutex,
+	   because InputStream::Open() blocks and InputStream
+	   destructors may need to lock it */
+
+	mutex.lock();
+
+	while (!quit) {
+		std::list<Item> obsolete;
+		for (auto i = items.begin(), end = items.end(); i != end;) {
+			auto next = std::next(i);
+			if (!ContainsUri(wanted, i->uri))
+				obsolete.splice(obsolete.end(), items, i);
+			i = next;
+		}
+
+		handled.remove_if([this](const std::string &uri){
+				return !ContainsUri(wanted, uri);
+			});
+
+		if (!obsolete.empty()) {
+			mutex.unlock();
+			obsolete.clear();
+			mutex.lock();
+			continue;
+		}
+
+		const std::string *pending = FindPending();
+		if (pending == nullptr) {
+			wake.wait(mutex);
+			continue;
+		}
+
+		const std::string uri = *pending;
+		handled.push_back(uri);
+		mutex.unlock();
+
+		Error error;
+		std::unique_ptr<InputStream> is(InputStream::Open(uri.c_str(),
+								  mutex, cond,
+								  error));
+		if (is == nullptr)
+			/* not fatal; the decoder thread will try
+			   again and report the error */
+			LogError(error);
+		else
+			FormatDebug(prefetch_domain, "prefetching %s",
+				    uri.c_str());
+
+		mutex.lock();
+
+		if (is != nullptr && ContainsUri(wanted, uri))
+			items.emplace_back(uri, is.release());
+		else if (is != nullptr) {
+			/* the song has been removed from the list
+			   meanwhile */
+			mutex.unlock();
+			is.reset();
+			mutex.lock();
+		}
+	}
+
+	std::list<Item> obsolete;
+	obsolete.swap(items);
+	mutex.unlock();
+}
+
+void
+DecoderPrefetch::Task(void *arg)
+{
+	DecoderPrefetch &prefetch = *(DecoderPrefetch *)arg;
+	prefetch.Task();
+}
+
+void
+DecoderPrefetch::Post(std::list<std::string> &&uris)
+{
+	wanted = std::move(uris);
+
+	if (!thread.IsDefined()) {
+		if (wanted.empty())
+			return;
+
+		Error error;
+		if (!thread.Start(Task, this, error)) {
+			LogError(error);
+			return;
+		}
+	}
+
+	wake.signal();
+}
+
+void
+DecoderPrefetch::Stop()
+{
+	mutex.lock();
+	quit = true;
+	wake.signal();
+	const bool started = thread.IsDefined();
+	mutex.unlock();
+
+	if (started)
+		thread.Join();
+}
+
+std::unique_ptr<InputStream>
+DecoderPrefetch::Take(const char *uri)
+{
+	const ScopeLock protect(mutex);
+
+	for (auto i = items.begin(), end = items.end(); i != end; ++i) {
+		if (i->uri == uri) {
+			std::unique_ptr<InputStream> is(std::move(i->is));
+			items.erase(i);
+			return is;
+		}
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_DECODER_PREFETCH_HXX
+#define MPD_DECODER_PREFETCH_HXX
+
+#include "check.h"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+#include "Compiler.h"
+
+#include <list>
+#include <memory>
+#include <string>
+
+class Mutex;
+class InputStream;
+
+/**
+ * Opens #InputStream objects for upcoming songs in advance, so their
+ * connection is established and their buffer is filled while the
+ * previous song is still being decoded.  The decoder thread takes
+ * the stream over when it starts decoding the song.
+ *
+ * The streams are opened and closed by a worker thread, which is
+ * started by the first Post() call; neither the caller of Post()
+ * nor the decoder thread ever blocks on a connection.
+ *
+ * Only remote URIs are prefetched; opening a local file is cheap.
+ */
+class DecoderPrefetch {
+	/**
+	 * The mutex and the condition passed to InputStream::Open().
+	 * These are the ones of #DecoderControl, because that is
+	 * where the decoder thread expects them.  The mutex protects
+	 * all attributes of this object, too.
+	 */
+	Mutex &mutex;
+	Cond &cond;
+
+	/**
+	 * Wakes up the worker thread after #wanted or #quit has been
+	 * modified.
+	 */
+	Cond wake;
+
+	Thread thread;
+
+	struct Item {
+		std::string uri;
+
+		std::unique_ptr<InputStream> is;
+
+		Item(const std::string &_uri, InputStream *_is);
+		~Item();
+	};
+
+	std::list<Item> items;
+
+	/**
+	 * The URIs passed to the last Post() call.
+	 */
+	std::list<std::string> wanted;
+
+	/**
+	 * The URIs of #wanted which the worker thread has already
+	 * handled: it has opened them (they may have been taken by
+	 * the decoder thread meanwhile), or opening has failed.
+	 * These are not opened again until they drop out of
+	 * #wanted.
+	 */
+	std::list<std::string> handled;
+
+	/**
+	 * Shall the worker thread exit?
+	 */
+	bool quit;
+
+public:
+	DecoderPrefetch(Mutex &_mutex, Cond &_cond);
+	~DecoderPrefetch();
+
+	DecoderPrefetch(const DecoderPrefetch &) = delete;
+	DecoderPrefetch &operator=(const DecoderPrefetch &) = delete;
+
+	/**
+	 * Ask the worker thread to open streams for the given URIs
+	 * and to close all streams which are not in the list
+	 * anymore.  This does not block.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void Post(std::list<std::string> &&uris);
+
+	/**
+	 * Stop the worker thread (if it was started) and close all
+	 * streams.
+	 *
+	 * Caller must not lock the mutex.
+	 */
+	void Stop();
+
+	/**
+	 * Remove the stream for the given URI from this object and
+	 * return it.
+	 *
+	 * Caller must not lock the mutex.
+	 *
+	 * @return the stream or nullptr if this URI was not
+	 * prefetched (yet)
+	 */
+	std::unique_ptr<InputStream> Take(const char *uri);
+
+private:
+	/**
+	 * Find the next URI which shall be opened.
+	 *
+	 * Caller must lock the mutex.
+	 *
+	 * @return the URI or nullptr if there is none
+	 */
+	gcc_pure
+	const std::string *FindPending() const;
+
+	void Task();
+	static void Task(void *arg);
+};
+
+#endif
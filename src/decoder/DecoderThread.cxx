@@ -22,12 +22,15 @@
 #include "DecoderControl.hxx"
 #include "DecoderInternal.hxx"
 #include "DecoderError.hxx"
+#include "DecoderCache.hxx"
 #include "DecoderPlugin.hxx"
 #include "DetachedSong.hxx"
 #include "system/FatalError.hxx"
 #include "MusicPipe.hxx"
+#include "MusicBuffer.hxx"
 #include "fs/Traits.hxx"
 #include "fs/AllocatedPath.hxx"
+#include "fs/FileInfo.hxx"
 #include "DecoderAPI.hxx"
 #include "input/InputStream.hxx"
 #include "input/LocalOpen.hxx"
@@ -36,6 +39,7 @@
 #include "util/Error.hxx"
 #include "util/Domain.hxx"
 #include "thread/Name.hxx"
+#include "thread/Policy.hxx"
 #include "tag/ApeReplayGain.hxx"
 #include "Log.hxx"
 
@@ -58,8 +62,28 @@ static constexpr Domain decoder_thread_domain("decoder_thread");
 static std::unique_ptr<InputStream>
 decoder_input_stream_open(DecoderControl &dc, const char *uri, Error &error)
 {
-	std::unique_ptr<InputStream> is(InputStream::Open(uri, dc.mutex,
-							  dc.cond, error));
+	std::unique_ptr<InputStream> is(dc.prefetch.Take(uri));
+	if (is != nullptr) {
+		FormatDebug(decoder_thread_domain,
+			    "using prefetched stream %s", uri);
+
+		Error prefetch_error;
+		dc.Lock();
+		is->Update();
+		const bool ok = is->Check(prefetch_error);
+		dc.Unlock();
+
+		if (!ok) {
+			/* the prefetched stream has failed meanwhile
+			   (e.g. the server has closed the idle
+			   connection); try again with a new one */
+			LogError(prefetch_error);
+			is.reset();
+		}
+	}
+
+	if (is == nullptr)
+		is.reset(InputStream::Open(uri, dc.mutex, dc.cond, error));
 	if (is == nullptr)
 		return nullptr;
 
@@ -334,6 +358,145 @@ decoder_run_file(Decoder &decoder, const char *uri_utf8, Path path_fs)
 				   });
 }
 
+/**
+ * Look up the song in the #DecoderCache.  If it is not there,
+ * prepare recording its PCM data.
+ */
+static std::shared_ptr<const DecoderCacheEntry>
+decoder_cache_lookup(Decoder &decoder, const DetachedSong &song,
+		     const char *uri, Path path_fs)
+{
+	if (decoder_cache == nullptr || path_fs.IsNull())
+		/* only local files are cached; remote streams may
+		   change or may be infinite */
+		return nullptr;
+
+	FileInfo info;
+	if (!GetFileInfo(path_fs, info))
+		return nullptr;
+
+	/* the key is the song's range; the decoder may start in the
+	   middle of it after seeking */
+	const SongTime start_time = song.GetStartTime();
+	const SongTime end_time = song.GetEndTime();
+
+	auto entry = decoder_cache->Lookup(uri, start_time, end_time,
+					   info.GetModificationTime());
+	if (entry == nullptr && decoder.dc.start_time == start_time)
+		decoder.cache_entry.reset(new DecoderCacheEntry(uri,
+								start_time,
+								end_time,
+								info.GetModificationTime()));
+
+	return entry;
+}
+
+/**
+ * Add the recorded PCM data to the #DecoderCache if the song has
+ * been decoded completely.
+ */
+static void
+decoder_cache_store(Decoder &decoder)
+{
+	DecoderControl &dc = decoder.dc;
+	auto &entry = decoder.cache_entry;
+	assert(entry != nullptr);
+
+	dc.Lock();
+	const bool complete = dc.command == DecoderCommand::NONE;
+	entry->in_format = dc.in_audio_format;
+	entry->out_format = dc.out_audio_format;
+	entry->duration = dc.total_time;
+	entry->mix_ramp = dc.mix_ramp;
+	dc.Unlock();
+
+	if (!complete || decoder.error.IsDefined() || entry->size == 0) {
+		entry.reset();
+		return;
+	}
+
+	if (decoder.replay_gain_serial != 0) {
+		entry->has_replay_gain = true;
+		entry->replay_gain_info = decoder.replay_gain_info;
+	}
+
+	decoder_cache->Store(std::move(entry));
+}
+
+/**
+ * Submit the PCM data of a #DecoderCacheEntry instead of invoking a
+ * decoder plugin.
+ */
+static void
+decoder_run_cached(Decoder &decoder, const DecoderCacheEntry &entry)
+{
+	FormatDebug(decoder_thread_domain, "playing %s from the cache",
+		    entry.uri.c_str());
+
+	/* the cached data has been converted already, so this is
+	   the "input" format now */
+	decoder_initialized(decoder, entry.out_format, true, entry.duration);
+
+	if (entry.has_replay_gain)
+		decoder_replay_gain(decoder, &entry.replay_gain_info);
+
+	if (entry.mix_ramp.IsDefined())
+		decoder_mixramp(decoder, MixRampInfo(entry.mix_ramp));
+
+	const size_t frame_size = entry.out_format.GetFrameSize();
+	const size_t buffer_size = decoder.dc.buffer->GetChunkSize();
+	void *buffer = decoder.convert_buffer.Get(buffer_size);
+	size_t offset = 0;
+	auto tag = entry.tags.begin();
+
+	DecoderCommand cmd;
+	do {
+		if (tag != entry.tags.end() && tag->first <= offset) {
+			/* submit the tags at the position where the
+			   decoder plugin has submitted them */
+			cmd = decoder_tag(decoder, nullptr, Tag(tag->second));
+			++tag;
+		} else {
+			size_t length = buffer_size - buffer_size % frame_size;
+			if (tag != entry.tags.end() &&
+			    length > tag->first - offset)
+				length = tag->first - offset;
+
+			size_t nbytes = entry.Read(offset, buffer, length);
+			nbytes -= nbytes % frame_size;
+			if (nbytes == 0)
+				break;
+
+			offset += nbytes;
+
+			cmd = decoder_data(decoder, nullptr, buffer, nbytes, 0);
+		}
+
+		if (cmd == DecoderCommand::SEEK) {
+			const unsigned sample_rate =
+				entry.out_format.sample_rate;
+			const uint64_t frame =
+				decoder_seek_time(decoder).ToScale<uint64_t>(sample_rate) -
+				entry.start_time.ToScale<uint64_t>(sample_rate);
+
+			if (frame * frame_size > entry.size)
+				decoder_seek_error(decoder);
+			else {
+				offset = frame * frame_size;
+				decoder_command_finished(decoder);
+
+				/* skip the tags before the new position */
+				tag = entry.tags.begin();
+				while (tag != entry.tags.end() &&
+				       tag->first < offset)
+					++tag;
+			}
+
+			cmd = DecoderCommand::NONE;
+		}
+	} while (cmd != DecoderCommand::STOP);
+}
+
 /**
  * Decode a song addressed by a #DetachedSong.
  *
@@ -357,14 +520,27 @@ decoder_run_song(DecoderControl &dc,
 	{
 		const ScopeUnlock unlock(dc.mutex);
 
-		success = !path_fs.IsNull()
-			? decoder_run_file(decoder, uri, path_fs)
-			: decoder_run_stream(decoder, uri);
+		const auto cached = decoder_cache_lookup(decoder, song,
+							 uri, path_fs);
+		if (cached != nullptr) {
+			decoder_run_cached(decoder, *cached);
+			success = true;
+		} else
+			success = !path_fs.IsNull()
+				? decoder_run_file(decoder, uri, path_fs)
+				: decoder_run_stream(decoder, uri);
 
 		/* flush the last chunk */
 
 		if (decoder.chunk != nullptr)
 			decoder.FlushChunk();
+
+		if (decoder.cache_entry != nullptr) {
+			if (success)
+				decoder_cache_store(decoder);
+			else
+				decoder.cache_entry.reset();
+		}
 	}
 
 	if (decoder.error.IsDefined()) {
@@ -426,6 +602,7 @@ decoder_task(void *arg)
 	DecoderControl &dc = *(DecoderControl *)arg;
 
 	SetThreadName("decoder");
+	ApplyThreadPolicy(ThreadClass::DECODER);
 
 	const ScopeLock protect(dc.mutex);
 
@@ -452,7 +629,10 @@ decoder_task(void *arg)
 
 			/* we need to clear the pipe here; usually the
 			   PlayerThread is responsible, but it is not
-			   aware that the decoder has finished */
+			   aware that the decoder has finished; it is
+			   blocked in DecoderControl::Seek() until we
+			   finish this command, so we may act as the
+			   pipe's consumer (see #MusicPipe) */
 			dc.pipe->Clear(*dc.buffer);
 
 			decoder_run(dc);
@@ -0,0 +1,372 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "SeekIndex.hxx"
+#include "input/InputStream.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/FileInfo.hxx"
+#include "fs/FileSystem.hxx"
+#include "fs/DirectoryReader.hxx"
+#include "fs/Traits.hxx"
+#include "fs/io/FileReader.hxx"
+#include "fs/io/FileOutputStream.hxx"
+#include "util/Error.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+static constexpr Domain seek_index_domain("seek_index");
+
+/**
+ * The number of bytes at the beginning of a stream which are used
+ * for the fingerprint.
+ */
+static constexpr size_t FINGERPRINT_SIZE = 64 * 1024;
+
+/**
+ * Refuse to load tables larger than this; it protects from corrupt
+ * files.
+ */
+static constexpr uint64_t MAX_POINTS = 16 * 1024 * 1024;
+
+/**
+ * When the tables in the cache directory occupy more than this, the
+ * oldest ones are deleted.
+ */
+static constexpr uint64_t MAX_CACHE_SIZE = 256 * 1024 * 1024;
+
+static constexpr char SEEK_INDEX_MAGIC[8] = {
+	'M', 'P', 'D', 'S', 'E', 'E', 'K', '1'
+};
+
+struct SeekIndexHeader {
+	char magic[sizeof(SEEK_INDEX_MAGIC)];
+	uint64_t fingerprint;
+	uint64_t n_points;
+};
+
+static AllocatedPath *seek_index_directory;
+
+void
+seek_index_global_init(AllocatedPath &&directory)
+{
+	assert(seek_index_directory == nullptr);
+
+	seek_index_directory = new AllocatedPath(std::move(directory));
+}
+
+void
+seek_index_global_finish()
+{
+	delete seek_index_directory;
+	seek_index_directory = nullptr;
+}
+
+/**
+ * Feed data into a 64 bit FNV-1a hash.
+ */
+static uint64_t
+fnv1a(uint64_t hash, const void *_data, size_t size)
+{
+	const uint8_t *data = (const uint8_t *)_data;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= data[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+static AllocatedPath
+GetCachePath(uint64_t fingerprint)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx",
+		 (unsigned long long)fingerprint);
+
+	return AllocatedPath::Build(*seek_index_directory,
+				    AllocatedPath::FromUTF8(name));
+}
+
+/**
+ * Is this the name of a file created by GetCachePath()?
+ */
+gcc_pure
+static bool
+IsCacheFileName(Path name)
+{
+	const std::string s = name.ToUTF8();
+	return s.length() == 16 &&
+		s.find_first_not_of("0123456789abcdef") == std::string::npos;
+}
+
+/**
+ * Delete the oldest tables until the cache directory is not larger
+ * than #MAX_CACHE_SIZE.
+ */
+static void
+PruneCache()
+{
+	struct Entry {
+		AllocatedPath path;
+		time_t mtime;
+		uint64_t size;
+	};
+
+	std::vector<Entry> entries;
+	uint64_t total_size = 0;
+
+	try {
+		DirectoryReader reader(*seek_index_directory);
+		while (reader.ReadEntry()) {
+			const Path name = reader.GetEntry();
+			if (!IsCacheFileName(name))
+				continue;
+
+			auto path = AllocatedPath::Build(*seek_index_directory,
+							 name);
+			FileInfo info;
+			if (!GetFileInfo(path, info, false) ||
+			    !info.IsRegular())
+				continue;
+
+			total_size += info.GetSize();
+			entries.push_back(Entry{std::move(path),
+						info.GetModificationTime(),
+						info.GetSize()});
+		}
+	} catch (const std::exception &e) {
+		LogError(e);
+		return;
+	}
+
+	if (total_size <= MAX_CACHE_SIZE)
+		return;
+
+	std::sort(entries.begin(), entries.end(),
+		  [](const Entry &a, const Entry &b){
+			  return a.mtime < b.mtime;
+		  });
+
+	for (const auto &entry : entries) {
+		if (total_size <= MAX_CACHE_SIZE)
+			break;
+
+		if (RemoveFile(entry.path)) {
+			FormatDebug(seek_index_domain, "deleted %s",
+				    entry.path.ToUTF8().c_str());
+			total_size -= entry.size;
+		}
+	}
+}
+
+const SeekIndex::Point *
+SeekIndex::Find(uint64_t frame) const
+{
+	auto i = std::upper_bound(points.begin(), points.end(), frame,
+				  [](uint64_t f, const Point &p){
+					  return f < p.frame;
+				  });
+	if (i == points.begin())
+		return nullptr;
+
+	return &*std::prev(i);
+}
+
+bool
+SeekIndex::Open(InputStream &is, const char *plugin_name)
+{
+	fingerprint = 0;
+
+	/* only local files: reading the beginning of a remote
+	   stream again would be too expensive, and it may change
+	   anyway */
+	if (seek_index_directory == nullptr ||
+	    !is.IsSeekable() || !is.KnownSize() || !is.CheapSeeking())
+		return false;
+
+	const auto old_offset = is.GetOffset();
+	const auto size = is.GetSize();
+
+	Error error;
+	if (old_offset != 0 && !is.LockSeek(0, error)) {
+		LogError(error);
+		return false;
+	}
+
+	uint64_t hash = 0xcbf29ce484222325ull;
+	hash = fnv1a(hash, plugin_name, strlen(plugin_name));
+	hash = fnv1a(hash, &size, sizeof(size));
+
+	/* the modification time catches files which were modified
+	   in place without changing the size or the beginning,
+	   e.g. a rewritten ID3v1 tag; this is only available if the
+	   URI is a local path */
+	const char *uri = is.GetURI();
+	FileInfo info;
+	if (PathTraitsUTF8::IsAbsolute(uri) &&
+	    GetFileInfo(AllocatedPath::FromUTF8(uri), info)) {
+		const int64_t mtime = info.GetModificationTime();
+		hash = fnv1a(hash, &mtime, sizeof(mtime));
+	}
+
+	std::unique_ptr<uint8_t[]> buffer(new uint8_t[FINGERPRINT_SIZE]);
+	const size_t length = std::min<uint64_t>(size, FINGERPRINT_SIZE);
+	if (!is.LockReadFull(buffer.get(), length, error)) {
+		LogError(error);
+		is.LockSeek(old_offset, IgnoreError());
+		return false;
+	}
+
+	hash = fnv1a(hash, buffer.get(), length);
+
+	if (!is.LockSeek(old_offset, error)) {
+		LogError(error);
+		return false;
+	}
+
+	/* 0 is reserved for "no fingerprint" */
+	fingerprint = hash != 0 ? hash : 1;
+	stream_size = size;
+	return true;
+}
+
+bool
+SeekIndex::IsValid() const
+{
+	assert(!points.empty());
+
+	/* the last point may be at the end of the stream; the FAAD
+	   plugin marks the end of the last packet this way */
+	if (points.back().offset > stream_size)
+		return false;
+
+	for (size_t i = 1; i < points.size(); ++i)
+		if (points[i].frame < points[i - 1].frame ||
+		    points[i].offset <= points[i - 1].offset)
+			return false;
+
+	return true;
+}
+
+static bool
+ReadFull(FileReader &reader, void *_dest, size_t size)
+{
+	uint8_t *dest = (uint8_t *)_dest;
+	while (size > 0) {
+		size_t nbytes = reader.Read(dest, size);
+		if (nbytes == 0)
+			return false;
+
+		dest += nbytes;
+		size -= nbytes;
+	}
+
+	return true;
+}
+
+bool
+SeekIndex::Load()
+{
+	if (fingerprint == 0)
+		return false;
+
+	const auto path = GetCachePath(fingerprint);
+
+	try {
+		FileReader reader(path);
+		const uint64_t file_size = reader.GetFileInfo().GetSize();
+
+		SeekIndexHeader header;
+		if (!ReadFull(reader, &header, sizeof(header)) ||
+		    memcmp(header.magic, SEEK_INDEX_MAGIC,
+			   sizeof(header.magic)) != 0 ||
+		    header.fingerprint != fingerprint ||
+		    header.n_points == 0 || header.n_points > MAX_POINTS ||
+		    /* check the size before allocating the table */
+		    file_size != sizeof(header) +
+		    header.n_points * sizeof(Point)) {
+			FormatWarning(seek_index_domain,
+				      "Malformed seek index: %s",
+				      path.ToUTF8().c_str());
+			return false;
+		}
+
+		points.resize(header.n_points);
+		if (!ReadFull(reader, &points.front(),
+			      points.size() * sizeof(points.front()))) {
+			points.clear();
+			return false;
+		}
+
+		if (!IsValid()) {
+			/* Find() and the decoder plugins rely on
+			   this */
+			FormatWarning(seek_index_domain,
+				      "Malformed seek index: %s",
+				      path.ToUTF8().c_str());
+			points.clear();
+			return false;
+		}
+	} catch (const std::exception &) {
+		/* no cached table yet */
+		return false;
+	}
+
+	FormatDebug(seek_index_domain, "loaded %s", path.ToUTF8().c_str());
+	return true;
+}
+
+void
+SeekIndex::Save() const
+{
+	if (fingerprint == 0 || points.empty())
+		return;
+
+	const auto path = GetCachePath(fingerprint);
+
+	SeekIndexHeader header;
+	memcpy(header.magic, SEEK_INDEX_MAGIC, sizeof(header.magic));
+	header.fingerprint = fingerprint;
+	header.n_points = points.size();
+
+	try {
+		FileOutputStream fos(path);
+		fos.Write(&header, sizeof(header));
+		fos.Write(&points.front(),
+			  points.size() * sizeof(points.front()));
+		fos.Commit();
+	} catch (const std::exception &e) {
+		LogError(e);
+		return;
+	}
+
+	FormatDebug(seek_index_domain, "saved %s", path.ToUTF8().c_str());
+
+	PruneCache();
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_DECODER_SEEK_INDEX_HXX
+#define MPD_DECODER_SEEK_INDEX_HXX
+
+#include "check.h"
+#include "Compiler.h"
+
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+
+class AllocatedPath;
+class InputStream;
+
+/**
+ * A table which maps PCM frame numbers to byte offsets in a stream.
+ * Decoder plugins for formats without a (precise) index build it
+ * while decoding, and use it for seeking.
+ *
+ * The table may be stored in the seek index cache directory (see
+ * seek_index_global_init()), keyed by a fingerprint of the file
+ * contents, so it needs to be built only on the first playback.
+ */
+class SeekIndex {
+public:
+	struct Point {
+		/**
+		 * The number of the first PCM frame of the packet at
+		 * #offset.
+		 */
+		uint64_t frame;
+
+		/**
+		 * The byte offset of the packet in the stream.
+		 */
+		uint64_t offset;
+	};
+
+private:
+	std::vector<Point> points;
+
+	/**
+	 * A hash of the stream contents, calculated by Open().  0
+	 * means the cache is not available for this stream.
+	 */
+	uint64_t fingerprint;
+
+	/**
+	 * The size of the stream passed to Open().  Load() rejects
+	 * tables which point beyond it.
+	 */
+	uint64_t stream_size;
+
+public:
+	SeekIndex():fingerprint(0), stream_size(0) {}
+
+	bool empty() const {
+		return points.empty();
+	}
+
+	size_t size() const {
+		return points.size();
+	}
+
+	const Point &operator[](size_t i) const {
+		return points[i];
+	}
+
+	const Point &back() const {
+		return points.back();
+	}
+
+	void clear() {
+		points.clear();
+	}
+
+	void reserve(size_t n) {
+		points.reserve(n);
+	}
+
+	void push_back(uint64_t frame, uint64_t offset) {
+		points.push_back(Point{frame, offset});
+	}
+
+	/**
+	 * Find the last point which starts at or before the given
+	 * PCM frame.
+	 *
+	 * @return the point or nullptr if the table is empty or if
+	 * the frame is before the first point
+	 */
+	gcc_pure
+	const Point *Find(uint64_t frame) const;
+
+	/**
+	 * Calculate the fingerprint of the stream, which is needed
+	 * for Load() and Save().  This reads the beginning of the
+	 * stream and seeks back to the current offset.
+	 *
+	 * @param plugin_name the name of the decoder plugin; each
+	 * plugin has its own table format
+	 * @return false if the seek index cache is disabled or not
+	 * applicable to this stream
+	 */
+	bool Open(InputStream &is, const char *plugin_name);
+
+	/**
+	 * Load the table from the cache.
+	 *
+	 * @return true if a table was found
+	 */
+	bool Load();
+
+	/**
+	 * Store the table in the cache.  Errors are logged.
+	 */
+	void Save() const;
+
+private:
+	/**
+	 * Check whether the table is sorted by frame, whether the
+	 * offsets are increasing and whether they are within the
+	 * stream.
+	 */
+	gcc_pure
+	bool IsValid() const;
+};
+
+/**
+ * Enable the seek index cache.
+ *
+ * @param directory the directory where tables are stored
+ */
+void
+seek_index_global_init(AllocatedPath &&directory);
+
+void
+seek_index_global_finish();
+
+#endif
@@ -21,6 +21,7 @@
 #include "FaadDecoderPlugin.hxx"
 #include "../DecoderAPI.hxx"
 #include "../DecoderBuffer.hxx"
+#include "../SeekIndex.hxx"
 #include "input/InputStream.hxx"
 #include "CheckAudioFormat.hxx"
 #include "tag/TagHandler.hxx"
@@ -31,6 +32,8 @@
 
 #include <neaacdec.h>
 
+#include <algorithm>
+
 #include <assert.h>
 #include <string.h>
 #include <unistd.h>
@@ -58,6 +61,16 @@ adts_check_frame(const unsigned char *data)
 		(data[5] >> 5);
 }
 
+/**
+ * Parse the sample rate from an ADTS frame header.  Returns 0 if the
+ * value is invalid.
+ */
+static unsigned
+adts_get_sample_rate(const unsigned char *data)
+{
+	return adts_sample_rates[(data[2] & 0x3c) >> 2];
+}
+
 /**
  * Find the next AAC frame in the buffer.  Returns 0 if no frame is
  * found or if not enough data is available.
@@ -107,14 +120,24 @@ adts_find_frame(DecoderBuffer &buffer)
 	}
 }
 
+/**
+ * Determine the duration of an ADTS stream by reading all frames.
+ *
+ * @param seek_index if not nullptr, then the offsets of all frames
+ * are recorded in this table (plus one point marking the end of the
+ * last frame); it is left empty if the duration is only estimated
+ */
 static SignedSongTime
-adts_song_duration(DecoderBuffer &buffer)
+adts_song_duration(DecoderBuffer &buffer, SeekIndex *seek_index)
 {
 	const InputStream &is = buffer.GetStream();
 	const bool estimate = !is.CheapSeeking();
 	if (estimate && !is.KnownSize())
 		return SignedSongTime::Negative();
 
+	if (estimate)
+		seek_index = nullptr;
+
 	unsigned sample_rate = 0;
 
 	/* Read all frames to ensure correct time and bitrate */
@@ -124,12 +147,17 @@ adts_song_duration(DecoderBuffer &buffer)
 		if (frame_length == 0)
 			break;
 
+		if (seek_index != nullptr)
+			seek_index->push_back(frames * uint64_t(1024),
+					      is.GetOffset() -
+					      buffer.GetAvailable());
+
 		if (frames == 0) {
 			auto data = ConstBuffer<uint8_t>::FromVoid(buffer.Read());
 			assert(!data.IsEmpty());
 			assert(frame_length <= data.size);
 
-			sample_rate = adts_sample_rates[(data.data[2] & 0x3c) >> 2];
+			sample_rate = adts_get_sample_rate(data.data);
 			if (sample_rate == 0)
 				break;
 		}
@@ -154,15 +182,28 @@ adts_song_duration(DecoderBuffer &buffer)
 		}
 	}
 
-	if (sample_rate == 0)
+	if (sample_rate == 0) {
+		if (seek_index != nullptr)
+			seek_index->clear();
 		return SignedSongTime::Negative();
+	}
+
+	if (seek_index != nullptr)
+		seek_index->push_back(frames * uint64_t(1024),
+				      is.GetOffset() - buffer.GetAvailable());
 
 	return SignedSongTime::FromScale<uint64_t>(frames * uint64_t(1024),
 						   sample_rate);
 }
 
+/**
+ * @param seek_index if not nullptr, then the frame table of an ADTS
+ * stream is stored here; if it is not empty already (loaded from
+ * the seek index cache), the stream is not scanned
+ */
 static SignedSongTime
-faad_song_duration(DecoderBuffer &buffer, InputStream &is)
+faad_song_duration(DecoderBuffer &buffer, InputStream &is,
+		   SeekIndex *seek_index=nullptr)
 {
 	auto data = ConstBuffer<uint8_t>::FromVoid(buffer.Need(5));
 	if (data.IsNull())
@@ -191,7 +232,19 @@ faad_song_duration(DecoderBuffer &buffer, InputStream &is)
 		if (!is.IsSeekable())
 			return SignedSongTime::Negative();
 
-		auto song_length = adts_song_duration(buffer);
+		if (seek_index != nullptr && !seek_index->empty()) {
+			/* the frame table is already known; no need
+			   to scan the stream */
+			const unsigned sample_rate =
+				adts_get_sample_rate(data.data);
+			if (sample_rate == 0)
+				return SignedSongTime::Negative();
+
+			return SignedSongTime::FromScale<uint64_t>(seek_index->back().frame,
+								   sample_rate);
+		}
+
+		auto song_length = adts_song_duration(buffer, seek_index);
 
 		is.LockSeek(tagsize, IgnoreError());
 
@@ -320,15 +373,63 @@ faad_get_file_time(InputStream &is)
 	return std::make_pair(recognized, duration);
 }
 
+/**
+ * Seek to the given time using the ADTS frame table.
+ *
+ * @param index_rate the sample rate of the ADTS headers, which is
+ * the unit of the #SeekIndex
+ * @param sample_rate the sample rate of the decoded PCM data, which
+ * may be higher because of SBR
+ * @param skip_frames receives the number of PCM frames which must be
+ * discarded after seeking
+ */
+static bool
+faad_seek(InputStream &is, DecoderBuffer &buffer,
+	  const NeAACDecHandle decoder, const SeekIndex &seek_index,
+	  unsigned index_rate, unsigned sample_rate,
+	  SongTime t, uint64_t &skip_frames)
+{
+	const SeekIndex::Point *point =
+		seek_index.Find(t.ToScale<uint64_t>(index_rate));
+	if (point == nullptr)
+		return false;
+
+	/* start one frame earlier, because the first frame decoded
+	   after seeking lacks the overlap with its predecessor */
+	if (point != &seek_index[0])
+		--point;
+
+	Error error;
+	if (!is.LockSeek(point->offset, error)) {
+		LogError(error);
+		return false;
+	}
+
+	buffer.Clear();
+	NeAACDecPostSeekReset(decoder, point->frame / 1024);
+	skip_frames = t.ToScale<uint64_t>(sample_rate) -
+		point->frame * sample_rate / index_rate;
+	return true;
+}
+
 static void
 faad_stream_decode(Decoder &mpd_decoder, InputStream &is,
 		   DecoderBuffer &buffer, const NeAACDecHandle decoder)
 {
-	const auto total_time = faad_song_duration(buffer, is);
+	SeekIndex seek_index;
+	const bool use_seek_index = seek_index.Open(is, "faad");
+	const bool seek_index_loaded = use_seek_index && seek_index.Load();
+
+	const auto total_time = faad_song_duration(buffer, is, &seek_index);
 
 	if (adts_find_frame(buffer) == 0)
 		return;
 
+	const unsigned adts_sample_rate =
+		adts_get_sample_rate(ConstBuffer<uint8_t>::FromVoid(buffer.Read()).data);
+	if (adts_sample_rate == 0)
+		seek_index.clear();
+
 	/* initialize it */
 
 	Error error;
@@ -340,19 +441,25 @@ faad_stream_decode(Decoder &mpd_decoder, InputStream &is,
 
 	/* initialize the MPD core */
 
-	decoder_initialized(mpd_decoder, audio_format, false, total_time);
+	decoder_initialized(mpd_decoder, audio_format,
+			    !seek_index.empty(), total_time);
 
 	/* the decoder loop */
 
 	DecoderCommand cmd;
 	unsigned bit_rate = 0;
+	uint64_t skip_frames = 0;
 	do {
 		/* find the next frame */
 
 		const size_t frame_size = adts_find_frame(buffer);
-		if (frame_size == 0)
-			/* end of file */
+		if (frame_size == 0) {
+			/* end of file; the song has been decoded
+			   completely, so the table can be trusted */
+			if (use_seek_index && !seek_index_loaded)
+				seek_index.Save();
 			break;
+		}
 
 		/* decode it */
 
@@ -392,11 +499,33 @@ faad_stream_decode(Decoder &mpd_decoder, InputStream &is,
 			    frame_info.samples / 1000 + 0.5;
 		}
 
+		/* discard samples before the seek position */
+
+		const uint8_t *pcm = (const uint8_t *)decoded;
+		size_t n_frames = frame_info.samples / frame_info.channels;
+		if (skip_frames > 0) {
+			const size_t n = std::min<uint64_t>(skip_frames,
+							    n_frames);
+			skip_frames -= n;
+			n_frames -= n;
+			pcm += n * audio_format.GetFrameSize();
+		}
+
 		/* send PCM samples to MPD */
 
-		cmd = decoder_data(mpd_decoder, is, decoded,
-				   (size_t)frame_info.samples * 2,
+		cmd = decoder_data(mpd_decoder, is, pcm,
+				   n_frames * audio_format.GetFrameSize(),
 				   bit_rate);
+		if (cmd == DecoderCommand::SEEK) {
+			if (faad_seek(is, buffer, decoder, seek_index,
+				      adts_sample_rate,
+				      audio_format.sample_rate,
+				      decoder_seek_time(mpd_decoder),
+				      skip_frames))
+				decoder_command_finished(mpd_decoder);
+			else
+				decoder_seek_error(mpd_decoder);
+		}
 	} while (cmd != DecoderCommand::STOP);
 }
 
@@ -29,6 +29,7 @@
 #include "lib/ffmpeg/Init.hxx"
 #include "lib/ffmpeg/Buffer.hxx"
 #include "../DecoderAPI.hxx"
+#include "../SeekIndex.hxx"
 #include "FfmpegMetaData.hxx"
 #include "FfmpegIo.hxx"
 #include "pcm/Interleave.hxx"
@@ -440,6 +441,73 @@ FfmpegCheckTag(Decoder &decoder, InputStream &is,
 
 #endif
 
+/**
+ * Seed the stream's index with the points of a #SeekIndex loaded
+ * from the cache, so av_seek_frame() does not need to read up to
+ * the seek position.
+ */
+static void
+FfmpegLoadSeekIndex(AVStream &stream, const SeekIndex &seek_index,
+		    unsigned sample_rate)
+{
+	const AVRational pcm_time_base = { 1, int(sample_rate) };
+
+	for (size_t i = 0; i < seek_index.size(); ++i) {
+		const auto &point = seek_index[i];
+		av_add_index_entry(&stream, point.offset,
+				   av_rescale_q(point.frame, pcm_time_base,
+						stream.time_base),
+				   0, 0, AVINDEX_KEYFRAME);
+	}
+}
+
+/**
+ * Copy the index which was built by FFmpeg's generic indexer
+ * while the stream was played to the end into the #SeekIndex.
+ */
+static void
+FfmpegSaveSeekIndex(const AVStream &stream, SeekIndex &seek_index,
+		    unsigned sample_rate)
+{
+	const AVRational pcm_time_base = { 1, int(sample_rate) };
+
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(58, 78, 100)
+	const int n = avformat_index_get_entries_count(&stream);
+#else
+	const int n = stream.nb_index_entries;
+#endif
+
+	seek_index.clear();
+	seek_index.reserve(n);
+
+	for (int i = 0; i < n; ++i) {
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(58, 78, 100)
+		const AVIndexEntry &entry =
+			*avformat_index_get_entry(const_cast<AVStream *>(&stream), i);
+#else
+		const AVIndexEntry &entry = stream.index_entries[i];
+#endif
+		if ((entry.flags & AVINDEX_KEYFRAME) == 0 ||
+		    entry.timestamp < 0 || entry.pos < 0)
+			continue;
+
+		const uint64_t frame = av_rescale_q(entry.timestamp,
+						    stream.time_base,
+						    pcm_time_base);
+		/* SeekIndex::Load() rejects tables which are not
+		   sorted by both frame and offset */
+		if (!seek_index.empty() &&
+		    (frame <= seek_index.back().frame ||
+		     uint64_t(entry.pos) <= seek_index.back().offset))
+			continue;
+
+		seek_index.push_back(frame, entry.pos);
+	}
+
+	if (!seek_index.empty())
+		seek_index.Save();
+}
+
 static void
 FfmpegDecode(Decoder &decoder, InputStream &input,
 	     AVFormatContext &format_context)
@@ -511,6 +579,17 @@ FfmpegDecode(Decoder &decoder, InputStream &input,
 	const SignedSongTime total_time =
 		FromFfmpegTimeChecked(av_stream.duration, av_stream.time_base);
 
+	/* only formats which rely on FFmpeg's generic index (raw
+	   streams without a seek table) benefit from the cache */
+	SeekIndex seek_index;
+	const bool use_seek_index =
+		(format_context.iformat->flags & AVFMT_GENERIC_INDEX) != 0 &&
+		seek_index.Open(input, "ffmpeg");
+	const bool seek_index_loaded = use_seek_index && seek_index.Load();
+	if (seek_index_loaded)
+		FfmpegLoadSeekIndex(av_stream, seek_index,
+				    audio_format.sample_rate);
+
 	decoder_initialized(decoder, audio_format,
 			    input.IsSeekable(), total_time);
 
@@ -529,6 +608,7 @@ FfmpegDecode(Decoder &decoder, InputStream &input,
 	FfmpegBuffer interleaved_buffer;
 
 	uint64_t min_frame = 0;
+	bool end_of_file = false;
 
 	DecoderCommand cmd = decoder_get_command(decoder);
 	while (cmd != DecoderCommand::STOP) {
@@ -552,9 +632,11 @@ FfmpegDecode(Decoder &decoder, InputStream &input,
 		}
 
 		AVPacket packet;
-		if (av_read_frame(&format_context, &packet) < 0)
+		if (av_read_frame(&format_context, &packet) < 0) {
 			/* end of file */
+			end_of_file = true;
 			break;
+		}
 
 #if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(56, 1, 0)
 		FfmpegCheckTag(decoder, input, format_context, audio_stream);
@@ -574,6 +656,10 @@ FfmpegDecode(Decoder &decoder, InputStream &input,
 		av_free_packet(&packet);
 	}
 
+	if (use_seek_index && !seek_index_loaded && end_of_file)
+		FfmpegSaveSeekIndex(av_stream, seek_index,
+				    audio_format.sample_rate);
+
 #if LIBAVUTIL_VERSION_MAJOR >= 53
 	av_frame_free(&frame);
 #elif LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(54, 28, 0)
@@ -612,14 +698,31 @@ ffmpeg_decode(Decoder &decoder, InputStream &input)
 	avformat_close_input(&format_context);
 }
 
+/**
+ * Has avformat_open_input() already obtained all information needed
+ * by FfmpegScanStream() from the container header?  Then the
+ * expensive avformat_find_stream_info() call, which may open the
+ * codec and decode a number of frames, can be omitted.
+ */
+gcc_pure
+static bool
+FfmpegHasScanInfo(const AVFormatContext &format_context)
+{
+	const int audio_stream = ffmpeg_find_audio_stream(format_context);
+	return audio_stream >= 0 &&
+		format_context.streams[audio_stream]->duration != (int64_t)AV_NOPTS_VALUE;
+}
+
 static bool
 FfmpegScanStream(AVFormatContext &format_context,
 		 const struct tag_handler &handler, void *handler_ctx)
 {
-	const int find_result =
-		avformat_find_stream_info(&format_context, nullptr);
-	if (find_result < 0)
-		return false;
+	if (!FfmpegHasScanInfo(format_context)) {
+		const int find_result =
+			avformat_find_stream_info(&format_context, nullptr);
+		if (find_result < 0)
+			return false;
+	}
 
 	const int audio_stream = ffmpeg_find_audio_stream(format_context);
 	if (audio_stream < 0)
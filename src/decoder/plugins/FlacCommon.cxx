@@ -154,28 +154,44 @@ flac_common_write(struct flac_data *data, const FLAC__Frame * frame,
 		  const FLAC__int32 *const buf[],
 		  FLAC__uint64 nbytes)
 {
-	void *buffer;
 	unsigned bit_rate;
 
 	if (!data->initialized && !flac_got_first_frame(data, &frame->header))
 		return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
 
-	size_t buffer_size = frame->header.blocksize * data->frame_size;
-	buffer = data->buffer.Get(buffer_size);
-
-	flac_convert(buffer, frame->header.channels,
-		     data->audio_format.format, buf,
-		     0, frame->header.blocksize);
-
 	if (nbytes > 0)
 		bit_rate = nbytes * 8 * frame->header.sample_rate /
 			(1000 * frame->header.blocksize);
 	else
 		bit_rate = 0;
 
-	auto cmd = decoder_data(data->decoder, data->input_stream,
-				buffer, buffer_size,
-				bit_rate);
+	/* convert straight into the music pipe, which may take
+	   several chunks for one FLAC block */
+	DecoderCommand cmd = DecoderCommand::NONE;
+	for (unsigned position = 0; position < frame->header.blocksize;) {
+		const auto dest = decoder_get_buffer(data->decoder,
+						     data->input_stream,
+						     bit_rate);
+		if (dest.IsNull()) {
+			cmd = decoder_get_command(data->decoder);
+			break;
+		}
+
+		unsigned end = position + dest.size / data->frame_size;
+		if (end > frame->header.blocksize)
+			end = frame->header.blocksize;
+
+		flac_convert(dest.data, frame->header.channels,
+			     data->audio_format.format, buf,
+			     position, end);
+
+		cmd = decoder_commit_buffer(data->decoder,
+					    (end - position) * data->frame_size);
+		position = end;
+		if (cmd != DecoderCommand::NONE)
+			break;
+	}
+
 	data->next_frame += frame->header.blocksize;
 	switch (cmd) {
 	case DecoderCommand::NONE:
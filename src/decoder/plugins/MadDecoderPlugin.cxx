@@ -20,6 +20,7 @@
 #include "config.h"
 #include "MadDecoderPlugin.hxx"
 #include "../DecoderAPI.hxx"
+#include "../SeekIndex.hxx"
 #include "input/InputStream.hxx"
 #include "config/ConfigGlobal.hxx"
 #include "tag/TagId3.hxx"
@@ -40,6 +41,8 @@
 #include <id3tag.h>
 #endif
 
+#include <algorithm>
+
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -133,6 +136,19 @@ struct MadDecoder {
 	unsigned long highest_frame;
 	unsigned long max_frames;
 	unsigned long current_frame;
+
+	/**
+	 * Has #current_frame been capped at #max_frames, i.e. are
+	 * #frame_offsets and #times incomplete?
+	 */
+	bool frames_capped;
+
+	/**
+	 * Was the frame table loaded from the seek index cache?
+	 */
+	bool seek_index_loaded;
+
+	SeekIndex seek_index;
 	unsigned int drop_start_frames;
 	unsigned int drop_end_frames;
 	unsigned int drop_start_samples;
@@ -176,6 +192,18 @@ struct MadDecoder {
 		times = new mad_timer_t[max_frames];
 	}
 
+	/**
+	 * Fill #frame_offsets and #times from the seek index cache.
+	 * Call after AllocateBuffers().
+	 */
+	void LoadSeekIndex();
+
+	/**
+	 * Store #frame_offsets and #times in the seek index cache.
+	 * Call after the whole stream has been decoded.
+	 */
+	void SaveSeekIndex();
+
 	gcc_pure
 	long TimeToFrame(SongTime t) const;
 
@@ -201,6 +229,7 @@ MadDecoder::MadDecoder(Decoder *_decoder,
 	 frame_offsets(nullptr),
 	 times(nullptr),
 	 highest_frame(0), max_frames(0), current_frame(0),
+	 frames_capped(false), seek_index_loaded(false),
 	 drop_start_frames(0), drop_end_frames(0),
 	 drop_start_samples(0), drop_end_samples(0),
 	 found_replay_gain(false),
@@ -709,6 +738,34 @@ parse_lame(struct lame *lame, struct mad_bitptr *ptr, int *bitlen)
 	return true;
 }
 
+/**
+ * Parse the Fraunhofer "VBRI" header, which some VBR encoders write
+ * into the first frame instead of a Xing header.  It is located 32
+ * bytes after the frame header.
+ *
+ * @return the number of frames, or 0 if there is no VBRI header
+ */
+gcc_pure
+static unsigned long
+parse_vbri(const unsigned char *frame_start, const unsigned char *end)
+{
+	constexpr size_t VBRI_OFFSET = 4 + 32;
+	constexpr size_t VBRI_MIN_SIZE = 18;
+
+	if (frame_start == nullptr ||
+	    size_t(end - frame_start) < VBRI_OFFSET + VBRI_MIN_SIZE)
+		return 0;
+
+	const unsigned char *p = frame_start + VBRI_OFFSET;
+	if (memcmp(p, "VBRI", 4) != 0)
+		return 0;
+
+	/* skip magic, version, delay, quality and byte count */
+	p += 14;
+	return ((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16) |
+		((unsigned long)p[2] << 8) | (unsigned long)p[3];
+}
+
 static inline SongTime
 mp3_frame_duration(const struct mad_frame *frame)
 {
@@ -794,7 +851,11 @@ MadDecoder::DecodeFirstFrame(Tag **tag)
 			mad_timer_t duration = frame.header.duration;
 			mad_timer_multiply(&duration, xing.frames);
 			total_time = ToSongTime(duration);
-			max_frames = xing.frames;
+
+			/* the frame count in the header may be
+			   inaccurate; leave room for a few more
+			   frames in the seek table */
+			max_frames = xing.frames + FRAMES_CUSHION;
 		}
 
 		struct lame lame;
@@ -816,6 +877,19 @@ MadDecoder::DecodeFirstFrame(Tag **tag)
 				decoder_replay_gain(*decoder, &rgi);
 			}
 		}
+	} else {
+		/* no Xing header; try VBRI, so VBR files get an
+		   exact duration without scanning all frames */
+		const unsigned long vbri_frames =
+			parse_vbri(stream.this_frame, stream.bufend);
+		if (vbri_frames > 0) {
+			mute_frame = MUTEFRAME_SKIP;
+
+			mad_timer_t duration = frame.header.duration;
+			mad_timer_multiply(&duration, vbri_frames);
+			total_time = ToSongTime(duration);
+			max_frames = vbri_frames + FRAMES_CUSHION;
+		}
 	}
 
 	if (!max_frames)
@@ -851,18 +925,65 @@ mad_decoder_total_file_time(InputStream &is)
 		: std::make_pair(false, SignedSongTime::Negative());
 }
 
-long
-MadDecoder::TimeToFrame(SongTime t) const
+void
+MadDecoder::LoadSeekIndex()
 {
-	unsigned long i;
+	/* the table contains one point per MPEG frame plus one which
+	   marks the end of the last frame */
+	if (!seek_index.Load() || seek_index.size() < 2 ||
+	    seek_index.size() - 1 > max_frames)
+		return;
+
+	const unsigned sample_rate = frame.header.samplerate;
+	const unsigned long n = seek_index.size() - 1;
 
-	for (i = 0; i < highest_frame; ++i) {
-		auto frame_time = ToSongTime(times[i]);
-		if (frame_time >= t)
-			break;
+	for (unsigned long i = 0; i < n; ++i) {
+		frame_offsets[i] = seek_index[i].offset;
+		mad_timer_set(&times[i], 0, seek_index[i + 1].frame,
+			      sample_rate);
 	}
 
-	return i;
+	highest_frame = n;
+	seek_index_loaded = true;
+
+	/* the table covers the whole file; this is more precise
+	   than the estimate from the file size */
+	total_time = ToSongTime(times[n - 1]);
+
+	seek_index.clear();
+}
+
+void
+MadDecoder::SaveSeekIndex()
+{
+	if (seek_index_loaded || frames_capped || highest_frame == 0 ||
+	    !input_stream.KnownSize())
+		return;
+
+	const enum mad_units units = mad_units(frame.header.samplerate);
+
+	seek_index.clear();
+	seek_index.reserve(highest_frame + 1);
+	seek_index.push_back(0, frame_offsets[0]);
+
+	for (unsigned long i = 0; i < highest_frame; ++i)
+		seek_index.push_back(mad_timer_count(times[i], units),
+				     i + 1 < highest_frame
+				     ? frame_offsets[i + 1]
+				     : input_stream.GetSize());
+
+	seek_index.Save();
+}
+
+long
+MadDecoder::TimeToFrame(SongTime t) const
+{
+	/* binary search for the first frame which ends at or after
+	   the given time */
+	return std::lower_bound(times, times + highest_frame, t,
+				[](const mad_timer_t &a, SongTime b){
+					return ToSongTime(a) < b;
+				}) - times;
 }
 
 void
@@ -873,10 +994,11 @@ MadDecoder::UpdateTimerNextFrame()
 		   (for seeking) and times */
 		bit_rate = frame.header.bitrate;
 
-		if (current_frame >= max_frames)
+		if (current_frame >= max_frames) {
 			/* cap current_frame */
 			current_frame = max_frames - 1;
-		else
+			frames_capped = true;
+		} else
 			highest_frame++;
 
 		frame_offsets[current_frame] = ThisFrameOffset();
@@ -1045,6 +1167,9 @@ mp3_decode(Decoder &decoder, InputStream &input_stream)
 {
 	MadDecoder data(&decoder, input_stream);
 
+	const bool use_seek_index =
+		data.seek_index.Open(input_stream, "mad");
+
 	Tag *tag = nullptr;
 	if (!data.DecodeFirstFrame(&tag)) {
 		delete tag;
@@ -1057,6 +1182,9 @@ mp3_decode(Decoder &decoder, InputStream &input_stream)
 
 	data.AllocateBuffers();
 
+	if (use_seek_index)
+		data.LoadSeekIndex();
+
 	Error error;
 	AudioFormat audio_format;
 	if (!audio_format_init_checked(audio_format,
@@ -1079,6 +1207,11 @@ mp3_decode(Decoder &decoder, InputStream &input_stream)
 	}
 
 	while (data.Read()) {}
+
+	if (use_seek_index &&
+	    decoder_get_command(decoder) == DecoderCommand::NONE &&
+	    input_stream.LockIsEOF())
+		data.SaveSeekIndex();
 }
 
 static bool
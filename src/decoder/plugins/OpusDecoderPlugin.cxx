@@ -349,30 +349,60 @@ MPDOpusDecoder::HandleAudio(const ogg_packet &packet)
 {
 	assert(opus_decoder != nullptr);
 
+	/* a packet cannot be decoded partially; ask for a buffer
+	   which is large enough for all of it */
+	const int packet_frames =
+		opus_packet_get_nb_samples((const unsigned char*)packet.packet,
+					   packet.bytes, opus_sample_rate);
+	const size_t packet_size = packet_frames > 0
+		? packet_frames * frame_size
+		: 0;
+
+	const auto dest = decoder_get_buffer(decoder, input_stream, 0,
+					     packet_size);
+	if (dest.IsNull())
+		return decoder_get_command(decoder);
+
+	/* decode straight into the music pipe, unless the packet is
+	   larger than a whole chunk (or its size is unknown); then
+	   decoder_data() has to split it */
+	const bool direct = packet_size > 0 && dest.size >= packet_size;
+	if (!direct) {
+		auto cmd = decoder_commit_buffer(decoder, 0);
+		if (cmd != DecoderCommand::NONE)
+			return cmd;
+	}
+
 	int nframes = opus_decode(opus_decoder,
 				  (const unsigned char*)packet.packet,
 				  packet.bytes,
-				  output_buffer, opus_output_buffer_frames,
+				  direct ? (opus_int16 *)dest.data : output_buffer,
+				  direct ? packet_frames : opus_output_buffer_frames,
 				  0);
 	if (nframes < 0) {
+		if (direct)
+			decoder_commit_buffer(decoder, 0);
+
 		FormatError(opus_domain, "libopus error: %s",
 			    opus_strerror(nframes));
 		return DecoderCommand::STOP;
 	}
 
-	if (nframes > 0) {
-		const size_t nbytes = nframes * frame_size;
-		auto cmd = decoder_data(decoder, input_stream,
-					output_buffer, nbytes,
-					0);
-		if (cmd != DecoderCommand::NONE)
-			return cmd;
-
-		if (packet.granulepos > 0)
-			decoder_timestamp(decoder,
-					  double(packet.granulepos)
-					  / opus_sample_rate);
-	}
+	const size_t nbytes = nframes * frame_size;
+	DecoderCommand cmd = DecoderCommand::NONE;
+	if (direct)
+		cmd = decoder_commit_buffer(decoder, nbytes);
+	else if (nframes > 0)
+		cmd = decoder_data(decoder, input_stream,
+				   output_buffer, nbytes,
+				   0);
+	if (cmd != DecoderCommand::NONE)
+		return cmd;
+
+	if (nframes > 0 && packet.granulepos > 0)
+		decoder_timestamp(decoder,
+				  double(packet.granulepos)
+				  / opus_sample_rate);
 
 	return DecoderCommand::NONE;
 }
@@ -52,24 +52,38 @@ pcm_stream_decode(Decoder &decoder, InputStream &is)
 
 	DecoderCommand cmd;
 	do {
-		char buffer[4096];
-
-		size_t nbytes = decoder_read(decoder, is,
-					     buffer, sizeof(buffer));
-
-		if (nbytes == 0 && is.LockIsEOF())
-			break;
-
-		if (reverse_endian)
-			/* make sure we deliver samples in host byte order */
-			reverse_bytes_16((uint16_t *)buffer,
-					 (uint16_t *)buffer,
-					 (uint16_t *)(buffer + nbytes));
+		/* read straight into the music pipe chunk */
+		const auto dest = decoder_get_buffer(decoder, is, 0);
+		if (dest.IsNull()) {
+			cmd = decoder_get_command(decoder);
+		} else {
+			uint8_t *buffer = (uint8_t *)dest.data;
+
+			size_t nbytes = decoder_read(decoder, is,
+						     buffer, dest.size);
+
+			/* complete a partial frame */
+			const size_t partial = nbytes % frame_size;
+			if (partial > 0 &&
+			    decoder_read_full(&decoder, is, buffer + nbytes,
+					      frame_size - partial))
+				nbytes += frame_size - partial;
+			else
+				nbytes -= partial;
+
+			if (reverse_endian)
+				/* make sure we deliver samples in host
+				   byte order */
+				reverse_bytes_16((uint16_t *)buffer,
+						 (uint16_t *)buffer,
+						 (uint16_t *)(buffer + nbytes));
+
+			cmd = decoder_commit_buffer(decoder, nbytes);
+
+			if (nbytes == 0 && is.LockIsEOF())
+				break;
+		}
 
-		cmd = nbytes > 0
-			? decoder_data(decoder, is,
-				       buffer, nbytes, 0)
-			: decoder_get_command(decoder);
 		if (cmd == DecoderCommand::SEEK) {
 			uint64_t frame = decoder_seek_where_frame(decoder);
 			offset_type offset = frame * frame_size;
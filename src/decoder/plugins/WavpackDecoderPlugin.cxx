@@ -41,10 +41,15 @@
 
 static constexpr Domain wavpack_domain("wavpack");
 
-/** A pointer type for format converter function. */
+/**
+ * A pointer type for format converter function.  It converts the
+ * samples unpacked by libwavpack at "src" to "dest".  If the output
+ * samples are 32 bits wide, then libwavpack has unpacked them to
+ * "dest" already, and "src" equals "dest".
+ */
 typedef void (*format_samples_t)(
 	int bytes_per_sample,
-	void *buffer, uint32_t count
+	const int32_t *src, void *dest, uint32_t count
 );
 
 /*
@@ -53,20 +58,12 @@ typedef void (*format_samples_t)(
  * max 24-bit samples.
  */
 static void
-format_samples_int(int bytes_per_sample, void *buffer, uint32_t count)
+format_samples_int(int bytes_per_sample, const int32_t *src, void *dest,
+		   uint32_t count)
 {
-	int32_t *src = (int32_t *)buffer;
-
 	switch (bytes_per_sample) {
 	case 1: {
-		int8_t *dst = (int8_t *)buffer;
-		/*
-		 * The asserts like the following one are because we do the
-		 * formatting of samples within a single buffer. The size
-		 * of the output samples never can be greater than the size
-		 * of the input ones. Otherwise we would have an overflow.
-		 */
-		static_assert(sizeof(*dst) <= sizeof(*src), "Wrong size");
+		int8_t *dst = (int8_t *)dest;
 
 		/* pass through and align 8-bit samples */
 		while (count--) {
@@ -75,8 +72,7 @@ format_samples_int(int bytes_per_sample, void *buffer, uint32_t count)
 		break;
 	}
 	case 2: {
-		uint16_t *dst = (uint16_t *)buffer;
-		static_assert(sizeof(*dst) <= sizeof(*src), "Wrong size");
+		uint16_t *dst = (uint16_t *)dest;
 
 		/* pass through and align 16-bit samples */
 		while (count--) {
@@ -87,7 +83,8 @@ format_samples_int(int bytes_per_sample, void *buffer, uint32_t count)
 
 	case 3:
 	case 4:
-		/* do nothing */
+		/* already unpacked to the destination buffer */
+		assert(dest == src);
 		break;
 	}
 }
@@ -96,10 +93,13 @@ format_samples_int(int bytes_per_sample, void *buffer, uint32_t count)
  * This function converts floating point sample data to 24-bit integer.
  */
 static void
-format_samples_float(gcc_unused int bytes_per_sample, void *buffer,
+format_samples_float(gcc_unused int bytes_per_sample,
+		     gcc_unused const int32_t *src, void *dest,
 		     uint32_t count)
 {
-	float *p = (float *)buffer;
+	assert(dest == src);
+
+	float *p = (float *)dest;
 
 	while (count--) {
 		*p /= (1 << 23);
@@ -167,10 +167,12 @@ wavpack_decode(Decoder &decoder, WavpackContext *wpc, bool can_seek)
 	const int bytes_per_sample = WavpackGetBytesPerSample(wpc);
 	const int output_sample_size = audio_format.GetFrameSize();
 
-	/* wavpack gives us all kind of samples in a 32-bit space */
+	/* wavpack gives us all kind of samples in a 32-bit space;
+	   they are unpacked straight into the music pipe if the
+	   output samples are 32 bits wide, and to this buffer
+	   otherwise */
+	const bool unpack_direct = audio_format.GetSampleSize() == 4;
 	int32_t chunk[1024];
-	const uint32_t samples_requested = ARRAY_SIZE(chunk) /
-		audio_format.channels;
 
 	decoder_initialized(decoder, audio_format, can_seek, total_time);
 
@@ -190,19 +192,33 @@ wavpack_decode(Decoder &decoder, WavpackContext *wpc, bool can_seek)
 			}
 		}
 
-		uint32_t samples_got = WavpackUnpackSamples(wpc, chunk,
-							    samples_requested);
-		if (samples_got == 0)
-			break;
-
 		int bitrate = (int)(WavpackGetInstantBitrate(wpc) / 1000 +
 				    0.5);
-		format_samples(bytes_per_sample, chunk,
+		const auto dest = decoder_get_buffer(decoder, nullptr,
+						     bitrate);
+		if (dest.IsNull()) {
+			cmd = decoder_get_command(decoder);
+			continue;
+		}
+
+		int32_t *const src = unpack_direct
+			? (int32_t *)dest.data
+			: chunk;
+		uint32_t samples_requested = dest.size / output_sample_size;
+		if (!unpack_direct &&
+		    samples_requested > ARRAY_SIZE(chunk) / audio_format.channels)
+			samples_requested = ARRAY_SIZE(chunk) /
+				audio_format.channels;
+
+		uint32_t samples_got = WavpackUnpackSamples(wpc, src,
+							    samples_requested);
+		format_samples(bytes_per_sample, src, dest.data,
 			       samples_got * audio_format.channels);
 
-		cmd = decoder_data(decoder, nullptr, chunk,
-				   samples_got * output_sample_size,
-				   bitrate);
+		cmd = decoder_commit_buffer(decoder,
+					    samples_got * output_sample_size);
+		if (samples_got == 0)
+			break;
 	}
 }
 
@@ -25,11 +25,14 @@
 #ifndef MPD_FILTER_INTERNAL_HXX
 #define MPD_FILTER_INTERNAL_HXX
 
+#include "util/ConstBuffer.hxx"
+#include "Compiler.h"
+
+#include <assert.h>
 #include <stddef.h>
 
 struct AudioFormat;
 class Error;
-template<typename T> struct ConstBuffer;
 
 class Filter {
 public:
@@ -62,6 +65,38 @@ public:
 	 * error
 	 */
 	virtual ConstBuffer<void> FilterPCM(ConstBuffer<void> src, Error &error) = 0;
+
+	/**
+	 * Shall the next block of PCM data be passed to
+	 * FilterInPlace() instead of FilterPCM()?  This is only
+	 * possible if the filter produces exactly as many bytes as
+	 * it consumes.  The answer may change at any time (e.g. when
+	 * the volume is changed), and it is asked again before each
+	 * block.
+	 */
+	gcc_pure
+	virtual bool IsInPlace() const {
+		return false;
+	}
+
+	/**
+	 * Filters a block of PCM data into a buffer owned by the
+	 * caller, which saves the copy into a buffer owned by the
+	 * filter.  May only be called if IsInPlace() has returned
+	 * true.
+	 *
+	 * @param src the input buffer
+	 * @param dest the output buffer with src.size bytes; may be
+	 * equal to src.data, which modifies the data in place
+	 * @param error location to store the error occurring
+	 * @return true on success
+	 */
+	virtual bool FilterInPlace(gcc_unused ConstBuffer<void> src,
+				   gcc_unused void *dest,
+				   gcc_unused Error &error) {
+		assert(false);
+		gcc_unreachable();
+	}
 };
 
 #endif
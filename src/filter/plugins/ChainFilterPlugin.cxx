@@ -23,6 +23,7 @@
 #include "filter/FilterInternal.hxx"
 #include "filter/FilterRegistry.hxx"
 #include "AudioFormat.hxx"
+#include "pcm/PcmBuffer.hxx"
 #include "util/Error.hxx"
 #include "util/Domain.hxx"
 #include "util/ConstBuffer.hxx"
@@ -48,6 +49,12 @@ class ChainFilter final : public Filter {
 
 	std::list<Child> children;
 
+	/**
+	 * The working buffer which is modified in place by all
+	 * consecutive filters which support Filter::FilterInPlace().
+	 */
+	PcmBuffer buffer;
+
 public:
 	void Append(const char *name, Filter *filter) {
 		children.emplace_back(name, filter);
@@ -143,17 +150,58 @@ ChainFilter::Close()
 {
 	for (auto &child : children)
 		child.filter->Close();
+
+	buffer.Clear();
 }
 
 ConstBuffer<void>
 ChainFilter::FilterPCM(ConstBuffer<void> src, Error &error)
 {
+	/* does "src" point to #buffer, i.e. may it be modified in
+	   place? */
+	bool in_buffer = false;
+
+	/* the part of #buffer which holds data; a filter which
+	   returns (a part of) its input may return a pointer into
+	   it */
+	const uint8_t *buffer_begin = nullptr, *buffer_end = nullptr;
+
 	for (auto &child : children) {
 		/* feed the output of the previous filter as input
 		   into the current one */
+
+		if (child.filter->IsInPlace()) {
+			/* the first of consecutive in-place filters
+			   copies the data into #buffer, all others
+			   modify it there */
+			void *dest;
+			if (in_buffer)
+				dest = const_cast<void *>(src.data);
+			else {
+				dest = buffer.Get(src.size);
+				buffer_begin = (const uint8_t *)dest;
+				buffer_end = buffer_begin + src.size;
+			}
+
+			if (!child.filter->FilterInPlace(src, dest, error))
+				return nullptr;
+
+			src.data = dest;
+			in_buffer = true;
+			continue;
+		}
+
 		src = child.filter->FilterPCM(src, error);
 		if (src.IsNull())
 			return nullptr;
+
+		/* if the filter has returned its input, the data is
+		   still in #buffer; it must be modified where it is,
+		   because copying it to the beginning of #buffer
+		   would overlap */
+		const uint8_t *p = (const uint8_t *)src.data;
+		in_buffer = buffer_begin != nullptr &&
+			p >= buffer_begin && p + src.size <= buffer_end;
 	}
 
 	/* return the output of the last filter */
@@ -39,6 +39,13 @@ public:
 	void Close() override;
 	ConstBuffer<void> FilterPCM(ConstBuffer<void> src,
 				    Error &error) override;
+
+	bool IsInPlace() const override {
+		return true;
+	}
+
+	bool FilterInPlace(ConstBuffer<void> src, void *dest,
+			   Error &error) override;
 };
 
 static Filter *
@@ -75,6 +82,17 @@ NormalizeFilter::FilterPCM(ConstBuffer<void> src, gcc_unused Error &error)
 	return { (const void *)dest, src.size };
 }
 
+bool
+NormalizeFilter::FilterInPlace(ConstBuffer<void> src, void *dest,
+			       gcc_unused Error &error)
+{
+	if (dest != src.data)
+		memcpy(dest, src.data, src.size);
+
+	Compressor_Process_int16(compressor, (int16_t *)dest, src.size / 2);
+	return true;
+}
+
 const struct filter_plugin normalize_filter_plugin = {
 	"normalize",
 	normalize_filter_init,
@@ -107,6 +107,10 @@ public:
 		Update();
 	}
 
+	unsigned GetVolume() const {
+		return pv.GetVolume();
+	}
+
 	/**
 	 * Recalculates the new volume after a property was changed.
 	 */
@@ -117,6 +121,14 @@ public:
 	void Close() override;
 	ConstBuffer<void> FilterPCM(ConstBuffer<void> src,
 				    Error &error) override;
+
+	bool IsInPlace() const override {
+		/* at unity gain, FilterPCM() returns the input as-is */
+		return pv.GetVolume() != PCM_VOLUME_1;
+	}
+
+	bool FilterInPlace(ConstBuffer<void> src, void *dest,
+			   Error &error) override;
 };
 
 void
@@ -177,6 +189,14 @@ ReplayGainFilter::FilterPCM(ConstBuffer<void> src, gcc_unused Error &error)
 	return pv.Apply(src);
 }
 
+bool
+ReplayGainFilter::FilterInPlace(ConstBuffer<void> src, void *dest,
+				gcc_unused Error &error)
+{
+	pv.ApplyTo(src, dest);
+	return true;
+}
+
 const struct filter_plugin replay_gain_filter_plugin = {
 	"replay_gain",
 	replay_gain_filter_init,
@@ -206,3 +226,11 @@ replay_gain_filter_set_mode(Filter *_filter, ReplayGainMode mode)
 
 	filter->SetMode(mode);
 }
+
+unsigned
+replay_gain_filter_get_volume(const Filter *_filter)
+{
+	const ReplayGainFilter *filter = (const ReplayGainFilter *)_filter;
+
+	return filter->GetVolume();
+}
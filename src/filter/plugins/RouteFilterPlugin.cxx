@@ -37,6 +37,16 @@
  *
  * If multiple sources are copied to the same destination channel, only
  * one of them takes effect.
+ *
+ * Instead of "routes", a "matrix" may be given, which mixes each
+ * output channel from the input channels.  It is either the name of
+ * a speaker layout ("mono", "stereo", "3.0", "quad", "5.0", "5.1",
+ * "6.1" or "7.1"), which selects the standard (ITU-R BS.775) downmix
+ * from the input layout, or a list of rows (one per output channel)
+ * separated by semicolons, each containing one gain per input
+ * channel:
+ * matrix "1 0 0.7071 0 0.7071 0; 0 1 0.7071 0 0 0.7071" \
+ * downmixes 5.1 to stereo without normalization.
  */
 
 #include "config.h"
@@ -47,6 +57,13 @@
 #include "filter/FilterInternal.hxx"
 #include "filter/FilterRegistry.hxx"
 #include "pcm/PcmBuffer.hxx"
+#include "pcm/ChannelMatrix.hxx"
+#include "pcm/Domain.hxx"
+
+#ifdef ENABLE_DSD
+#include "pcm/PcmDsd.hxx"
+#endif
+
 #include "util/StringUtil.hxx"
 #include "util/Error.hxx"
 #include "util/ConstBuffer.hxx"
@@ -103,6 +120,44 @@ class RouteFilter final : public Filter {
 	 */
 	size_t output_frame_size;
 
+	/**
+	 * The number of output channels of the standard downmix
+	 * selected with the "matrix" setting, or 0 if the setting is
+	 * a custom matrix (or if it is not used).
+	 */
+	unsigned matrix_preset;
+
+	/**
+	 * Mix the channels with #matrix instead of copying them
+	 * according to #sources?
+	 */
+	bool use_matrix;
+
+	/**
+	 * The custom matrix from the "matrix" setting, with
+	 * #MAX_CHANNELS columns.
+	 */
+	PcmChannelMatrix custom_matrix;
+
+	/**
+	 * The matrix for the current input format, once opened.
+	 */
+	PcmChannelMatrix matrix;
+
+	/**
+	 * The sample format passed to PcmChannelMatrix::Apply(); this
+	 * differs from the input format only for DSD, which is
+	 * converted to floating point first.
+	 */
+	SampleFormat matrix_format;
+
+#ifdef ENABLE_DSD
+	/**
+	 * Converts DSD input to floating point for #matrix.
+	 */
+	PcmDsd dsd;
+#endif
+
 	/**
 	 * The output buffer used last time around, can be reused if the size doesn't differ.
 	 */
@@ -120,11 +175,30 @@ public:
 	 */
 	bool Configure(const ConfigBlock &block, Error &error);
 
+	/**
+	 * Parse the "matrix" setting.
+	 */
+	bool ConfigureMatrix(const char *value, Error &error);
+
 	/* virtual methods from class Filter */
 	AudioFormat Open(AudioFormat &af, Error &error) override;
 	void Close() override;
 	ConstBuffer<void> FilterPCM(ConstBuffer<void> src,
 				    Error &error) override;
+
+	bool IsInPlace() const override {
+		return !use_matrix && input_frame_size == output_frame_size;
+	}
+
+	bool FilterInPlace(ConstBuffer<void> src, void *dest,
+			   Error &error) override;
+
+private:
+	/**
+	 * Perform the copy operations for one frame.  #dest and #src
+	 * must not overlap.
+	 */
+	void RouteFrame(uint8_t *dest, const uint8_t *src) const;
 };
 
 bool
@@ -141,6 +215,18 @@ RouteFilter::Configure(const ConfigBlock &block, Error &error) {
 	min_input_channels = 0;
 	min_output_channels = 0;
 
+	const char *matrix_value = block.GetBlockValue("matrix");
+	use_matrix = matrix_value != nullptr;
+	if (use_matrix) {
+		if (block.GetBlockValue("routes") != nullptr) {
+			error.Set(config_domain,
+				  "Cannot use both 'routes' and 'matrix'");
+			return false;
+		}
+
+		return ConfigureMatrix(matrix_value, error);
+	}
+
 	// A cowardly default, just passthrough stereo
 	const char *routes = block.GetBlockValue("routes", "0>0, 1>1");
 	while (true) {
@@ -204,6 +290,86 @@ RouteFilter::Configure(const ConfigBlock &block, Error &error) {
 	return true;
 }
 
+static constexpr struct {
+	const char *name;
+	unsigned channels;
+} matrix_presets[] = {
+	{ "mono", 1 },
+	{ "stereo", 2 },
+	{ "3.0", 3 },
+	{ "quad", 4 },
+	{ "5.0", 5 },
+	{ "5.1", 6 },
+	{ "6.1", 7 },
+	{ "7.1", 8 },
+};
+
+bool
+RouteFilter::ConfigureMatrix(const char *value, Error &error)
+{
+	for (const auto &i : matrix_presets) {
+		if (strcmp(value, i.name) == 0) {
+			matrix_preset = min_output_channels = i.channels;
+			return true;
+		}
+	}
+
+	matrix_preset = 0;
+
+	/* parse the rows of a custom matrix */
+	custom_matrix.Clear(MAX_CHANNELS, MAX_CHANNELS);
+
+	unsigned row = 0, column = 0;
+	while (true) {
+		value = StripLeft(value);
+
+		if (*value == ';' || *value == 0) {
+			if (column == 0) {
+				error.Set(config_domain,
+					  "Empty row in 'matrix'");
+				return false;
+			}
+
+			++row;
+			column = 0;
+
+			if (*value == 0)
+				break;
+
+			++value;
+			continue;
+		}
+
+		if (*value == ',') {
+			++value;
+			continue;
+		}
+
+		char *endptr;
+		const float gain = strtof(value, &endptr);
+		if (endptr == value) {
+			error.Set(config_domain,
+				  "Malformed 'matrix' specification");
+			return false;
+		}
+
+		if (row >= MAX_CHANNELS || column >= MAX_CHANNELS) {
+			error.Format(config_domain,
+				     "Too many channels in 'matrix'; the maximum is %u",
+				     MAX_CHANNELS);
+			return false;
+		}
+
+		custom_matrix.Set(row, column, gain);
+		++column;
+
+		value = endptr;
+	}
+
+	min_output_channels = row;
+	return true;
+}
+
 static Filter *
 route_filter_init(const ConfigBlock &block, Error &error)
 {
@@ -228,6 +394,41 @@ RouteFilter::Open(AudioFormat &audio_format, gcc_unused Error &error)
 	output_format = audio_format;
 	output_format.channels = min_output_channels;
 
+	if (use_matrix) {
+		matrix_format = audio_format.format;
+
+		if (matrix_format == SampleFormat::DSD) {
+			/* DSD cannot be mixed; convert it to
+			   floating point PCM */
+#ifdef ENABLE_DSD
+			matrix_format = SampleFormat::FLOAT;
+			output_format.format = matrix_format;
+			output_format.sample_rate =
+				dsd.Open(audio_format.channels,
+					 audio_format.sample_rate);
+#else
+			error.Set(pcm_domain,
+				  "DSD is not supported by the channel matrix");
+			return AudioFormat::Undefined();
+#endif
+		}
+
+		if (matrix_preset > 0)
+			matrix.SetDefault(audio_format.channels,
+					  matrix_preset);
+		else {
+			/* input channels without a column are
+			   ignored; columns without an input
+			   channel are ignored */
+			matrix.Clear(audio_format.channels,
+				     min_output_channels);
+			for (unsigned i = 0; i < min_output_channels; ++i)
+				for (unsigned j = 0; j < audio_format.channels; ++j)
+					matrix.Set(i, j,
+						   custom_matrix.Get(i, j));
+		}
+	}
+
 	// Precalculate this simple value, to speed up allocation later
 	output_frame_size = output_format.GetFrameSize();
 
@@ -237,15 +438,64 @@ RouteFilter::Open(AudioFormat &audio_format, gcc_unused Error &error)
 void
 RouteFilter::Close()
 {
+#ifdef ENABLE_DSD
+	if (use_matrix && input_format.format == SampleFormat::DSD)
+		dsd.Reset();
+#endif
+
 	output_buffer.Clear();
 }
 
+inline void
+RouteFilter::RouteFrame(uint8_t *chan_destination,
+			const uint8_t *base_source) const
+{
+	const size_t bytes_per_frame_per_channel = input_format.GetSampleSize();
+
+	// Need to perform one copy per output channel
+	for (unsigned int c=0; c<min_output_channels; ++c) {
+		if (sources[c] == -1 ||
+		    (unsigned)sources[c] >= input_format.channels) {
+			// No source for this destination output,
+			// give it zeroes as input
+			memset(chan_destination,
+				0x00,
+				bytes_per_frame_per_channel);
+		} else {
+			// Get the data from channel sources[c]
+			// and copy it to the output
+			const uint8_t *data = base_source +
+				(sources[c] * bytes_per_frame_per_channel);
+			memcpy(chan_destination,
+				  data,
+				  bytes_per_frame_per_channel);
+		}
+		// Move on to the next output channel
+		chan_destination += bytes_per_frame_per_channel;
+	}
+}
+
 ConstBuffer<void>
 RouteFilter::FilterPCM(ConstBuffer<void> src, gcc_unused Error &error)
 {
-	size_t number_of_frames = src.size / input_frame_size;
+	if (use_matrix) {
+#ifdef ENABLE_DSD
+		if (input_format.format == SampleFormat::DSD) {
+			auto f = dsd.ToFloat(ConstBuffer<uint8_t>::FromVoid(src));
+			if (f.IsNull()) {
+				error.Set(pcm_domain,
+					  "DSD to PCM conversion failed");
+				return nullptr;
+			}
 
-	const size_t bytes_per_frame_per_channel = input_format.GetSampleSize();
+			src = f.ToVoid();
+		}
+#endif
+
+		return matrix.Apply(output_buffer, matrix_format, src);
+	}
+
+	size_t number_of_frames = src.size / input_frame_size;
 
 	// A moving pointer that always refers to channel 0 in the input, at the currently handled frame
 	const uint8_t *base_source = (const uint8_t *)src.data;
@@ -259,38 +509,43 @@ RouteFilter::FilterPCM(ConstBuffer<void> src, gcc_unused Error &error)
 
 	// Perform our copy operations, with N input channels and M output channels
 	for (unsigned int s=0; s<number_of_frames; ++s) {
-
-		// Need to perform one copy per output channel
-		for (unsigned int c=0; c<min_output_channels; ++c) {
-			if (sources[c] == -1 ||
-			    (unsigned)sources[c] >= input_format.channels) {
-				// No source for this destination output,
-				// give it zeroes as input
-				memset(chan_destination,
-					0x00,
-					bytes_per_frame_per_channel);
-			} else {
-				// Get the data from channel sources[c]
-				// and copy it to the output
-				const uint8_t *data = base_source +
-					(sources[c] * bytes_per_frame_per_channel);
-				memcpy(chan_destination,
-					  data,
-					  bytes_per_frame_per_channel);
-			}
-			// Move on to the next output channel
-			chan_destination += bytes_per_frame_per_channel;
-		}
-
+		RouteFrame(chan_destination, base_source);
 
 		// Go on to the next N input samples
 		base_source += input_frame_size;
+		chan_destination += output_frame_size;
 	}
 
 	// Here it is, ladies and gentlemen! Rerouted data!
 	return { result, result_size };
 }
 
+bool
+RouteFilter::FilterInPlace(ConstBuffer<void> src, void *dest,
+			   gcc_unused Error &error)
+{
+	assert(IsInPlace());
+
+	const size_t number_of_frames = src.size / input_frame_size;
+	const uint8_t *base_source = (const uint8_t *)src.data;
+	uint8_t *chan_destination = (uint8_t *)dest;
+
+	/* the output frame may overwrite the input frame it is
+	   copied from, so each input frame is copied aside first */
+	uint8_t frame[MAX_CHANNELS * sizeof(int32_t)];
+	assert(input_frame_size <= sizeof(frame));
+
+	for (size_t s = 0; s < number_of_frames; ++s) {
+		memcpy(frame, base_source, input_frame_size);
+		RouteFrame(chan_destination, frame);
+
+		base_source += input_frame_size;
+		chan_destination += output_frame_size;
+	}
+
+	return true;
+}
+
 const struct filter_plugin route_filter_plugin = {
 	"route",
 	route_filter_init,
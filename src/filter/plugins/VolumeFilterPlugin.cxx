@@ -47,6 +47,14 @@ public:
 	void Close() override;
 	ConstBuffer<void> FilterPCM(ConstBuffer<void> src,
 				    Error &error) override;
+
+	bool IsInPlace() const override {
+		/* at 100%, FilterPCM() returns the input as-is */
+		return pv.GetVolume() != PCM_VOLUME_1;
+	}
+
+	bool FilterInPlace(ConstBuffer<void> src, void *dest,
+			   Error &error) override;
 };
 
 static Filter *
@@ -77,6 +85,14 @@ VolumeFilter::FilterPCM(ConstBuffer<void> src, gcc_unused Error &error)
 	return pv.Apply(src);
 }
 
+bool
+VolumeFilter::FilterInPlace(ConstBuffer<void> src, void *dest,
+			    gcc_unused Error &error)
+{
+	pv.ApplyTo(src, dest);
+	return true;
+}
+
 const struct filter_plugin volume_filter_plugin = {
 	"volume",
 	volume_filter_init,
@@ -49,6 +49,17 @@ AllocatedPath::FromUTF8(const char *path_utf8, Error &error)
 	return path;
 }
 
+bool
+AllocatedPath::SetUTF8(const char *path_utf8)
+{
+#if defined(HAVE_FS_CHARSET) || defined(WIN32)
+	return ::PathFromUTF8(path_utf8, value);
+#else
+	value.assign(path_utf8);
+	return !IsNull();
+#endif
+}
+
 AllocatedPath
 AllocatedPath::GetDirectoryName() const
 {
@@ -151,6 +151,16 @@ public:
 	gcc_pure gcc_nonnull_all
 	static AllocatedPath FromUTF8(const char *path_utf8, Error &error);
 
+	/**
+	 * Convert a UTF-8 C string and store it in this object.
+	 * Unlike FromUTF8(), this reuses the existing buffer, which
+	 * makes it cheap to call repeatedly on the same object.
+	 *
+	 * @return false on error (and the object is "nulled")
+	 */
+	gcc_nonnull_all
+	bool SetUTF8(const char *path_utf8);
+
 	/**
 	 * Copy an #AllocatedPath object.
 	 */
@@ -21,6 +21,7 @@
 #include "Charset.hxx"
 #include "Domain.hxx"
 #include "Limits.hxx"
+#include "CharsetCache.hxx"
 #include "Log.hxx"
 #include "lib/icu/Converter.hxx"
 #include "util/Error.hxx"
@@ -42,6 +43,55 @@ static std::string fs_charset;
 
 static IcuConverter *fs_converter;
 
+static CharsetCache to_utf8_cache, from_utf8_cache;
+
+/**
+ * May paths be converted one component at a time, using the
+ * #CharsetCache?  See IsComponentSafe().
+ */
+static bool fs_charset_cacheable;
+
+/**
+ * Check whether converting a path one component at a time gives
+ * the same result as converting it at once.  This requires an
+ * ASCII compatible charset without shift states.  In a stateful
+ * charset like ISO-2022-JP, a '/' byte may be part of a multi-byte
+ * character, and each component depends on the state left by the
+ * previous one.
+ *
+ * Non-ASCII characters are converted as a probe: stateless ASCII
+ * compatible charsets never encode them with ASCII bytes, but
+ * escape and shift sequences consist of ASCII bytes.
+ */
+gcc_pure
+static bool
+IsComponentSafe(const IcuConverter &converter)
+{
+	const auto separator = converter.FromUTF8("/");
+	if (separator.IsNull() || strcmp(separator.c_str(), "/") != 0)
+		return false;
+
+	static constexpr const char *probes[] = {
+		"\xc3\xa9", /* U+00E9 LATIN SMALL LETTER E WITH ACUTE */
+		"\xd0\x96", /* U+0416 CYRILLIC CAPITAL LETTER ZHE */
+		"\xe4\xb8\x91", /* U+4E11 CJK UNIFIED IDEOGRAPH */
+		"\xed\x95\x9c", /* U+D55C HANGUL SYLLABLE HAN */
+	};
+
+	for (const char *probe : probes) {
+		const auto s = converter.FromUTF8(probe);
+		if (s.IsNull())
+			/* not in this charset */
+			continue;
+
+		for (const char *p = s.c_str(); *p != 0; ++p)
+			if ((unsigned char)*p < 0x80)
+				return false;
+	}
+
+	return true;
+}
+
 bool
 SetFSCharset(const char *charset, Error &error)
 {
@@ -52,6 +102,12 @@ SetFSCharset(const char *charset, Error &error)
 	if (fs_converter == nullptr)
 		return false;
 
+	fs_charset_cacheable = IsComponentSafe(*fs_converter);
+	if (!fs_charset_cacheable)
+		FormatDebug(path_domain,
+			    "SetFSCharset: not caching conversions of %s",
+			    charset);
+
 	FormatDebug(path_domain,
 		    "SetFSCharset: fs charset is: %s", fs_charset.c_str());
 	return true;
@@ -66,6 +122,11 @@ DeinitFSCharset()
 	delete fs_converter;
 	fs_converter = nullptr;
 #endif
+
+#ifdef HAVE_FS_CHARSET
+	to_utf8_cache.Clear();
+	from_utf8_cache.Clear();
+#endif
 }
 
 const char *
@@ -95,6 +156,55 @@ FixSeparators(PathTraitsUTF8::string &&s)
 	return std::move(s);
 }
 
+#ifdef HAVE_FS_CHARSET
+
+/**
+ * Convert a path one component at a time, looking up the converted
+ * parent directory in the #CharsetCache.  This is equivalent to
+ * converting the whole string at once if the path separator is
+ * invariant and the charset has no shift states; for other
+ * charsets (see IsComponentSafe()), the whole string is converted.
+ *
+ * @return the converted path or an empty string on error
+ */
+template<typename C>
+static std::string
+ConvertPathCached(CharsetCache &cache, const char *src, C &&convert)
+{
+	static_assert(PathTraitsFS::SEPARATOR == PathTraitsUTF8::SEPARATOR,
+		      "Path separator mismatch");
+	constexpr char separator = PathTraitsFS::SEPARATOR;
+
+	const char *slash = strrchr(src, separator);
+	if (slash == nullptr || slash == src || !fs_charset_cacheable)
+		return convert(src);
+
+	std::string directory(src, slash);
+	std::string result;
+	if (!cache.Lookup(directory, result)) {
+		result = ConvertPathCached(cache, directory.c_str(), convert);
+		if (result.empty())
+			return result;
+
+		cache.Insert(std::move(directory), result);
+	}
+
+	result.push_back(separator);
+
+	const char *name = slash + 1;
+	if (*name != 0) {
+		const auto name_converted = convert(name);
+		if (name_converted.empty())
+			return std::string();
+
+		result.append(name_converted);
+	}
+
+	return result;
+}
+
+#endif
+
 PathTraitsUTF8::string
 PathToUTF8(PathTraitsFS::const_pointer path_fs)
 {
@@ -116,12 +226,32 @@ PathToUTF8(PathTraitsFS::const_pointer path_fs)
 		return FixSeparators(path_fs);
 #ifdef HAVE_FS_CHARSET
 
-	const auto buffer = fs_converter->ToUTF8(path_fs);
-	if (buffer.IsNull())
-		return PathTraitsUTF8::string();
+	return ConvertPathCached(to_utf8_cache, path_fs, [](const char *s){
+			const auto buffer = fs_converter->ToUTF8(s);
+			return buffer.IsNull()
+				? PathTraitsUTF8::string()
+				: PathTraitsUTF8::string(buffer.c_str());
+		});
+#endif
+#endif
+}
 
-	return FixSeparators(PathTraitsUTF8::string(buffer.c_str()));
+bool
+PathToUTF8(PathTraitsFS::const_pointer path_fs, PathTraitsUTF8::string &dest)
+{
+#ifndef WIN32
+#ifdef HAVE_FS_CHARSET
+	if (fs_converter == nullptr)
 #endif
+	{
+		dest.assign(path_fs);
+		return !dest.empty();
+	}
+#endif
+
+#if defined(HAVE_FS_CHARSET) || defined(WIN32)
+	dest = PathToUTF8(path_fs);
+	return !dest.empty();
 #endif
 }
 
@@ -145,12 +275,28 @@ PathFromUTF8(PathTraitsUTF8::const_pointer path_utf8)
 	if (fs_converter == nullptr)
 		return path_utf8;
 
-	const auto buffer = fs_converter->FromUTF8(path_utf8);
-	if (buffer.IsNull())
-		return PathTraitsFS::string();
+	return ConvertPathCached(from_utf8_cache, path_utf8, [](const char *s){
+			const auto buffer = fs_converter->FromUTF8(s);
+			return buffer.IsNull()
+				? PathTraitsFS::string()
+				: PathTraitsFS::string(buffer.c_str());
+		});
+#endif
+}
 
-	return PathTraitsFS::string(buffer.c_str());
+bool
+PathFromUTF8(PathTraitsUTF8::const_pointer path_utf8,
+	     PathTraitsFS::string &dest)
+{
+#ifndef WIN32
+	if (fs_converter == nullptr) {
+		dest.assign(path_utf8);
+		return !dest.empty();
+	}
 #endif
+
+	dest = PathFromUTF8(path_utf8);
+	return !dest.empty();
 }
 
 #endif
@@ -51,6 +51,16 @@ gcc_pure gcc_nonnull_all
 PathTraitsUTF8::string
 PathToUTF8(PathTraitsFS::const_pointer path_fs);
 
+/**
+ * Like PathToUTF8(), but store the result in an existing string,
+ * reusing its buffer if no conversion is necessary.
+ *
+ * @return false on error
+ */
+gcc_nonnull_all
+bool
+PathToUTF8(PathTraitsFS::const_pointer path_fs, PathTraitsUTF8::string &dest);
+
 /**
  * Convert the path from UTF-8.
  * Returns empty string on error.
@@ -59,4 +69,15 @@ gcc_pure gcc_nonnull_all
 PathTraitsFS::string
 PathFromUTF8(PathTraitsUTF8::const_pointer path_utf8);
 
+/**
+ * Like PathFromUTF8(), but store the result in an existing string,
+ * reusing its buffer if no conversion is necessary.
+ *
+ * @return false on error
+ */
+gcc_nonnull_all
+bool
+PathFromUTF8(PathTraitsUTF8::const_pointer path_utf8,
+	     PathTraitsFS::string &dest);
+
 #endif
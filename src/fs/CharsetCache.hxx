@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_FS_CHARSET_CACHE_HXX
+#define MPD_FS_CHARSET_CACHE_HXX
+
+#include "check.h"
+#include "thread/Mutex.hxx"
+
+#include <string>
+#include <unordered_map>
+
+/**
+ * Remembers the results of converting directory names between the
+ * file system character set and UTF-8.  Paths are converted one
+ * component at a time, and the conversion of the parent directory
+ * is looked up here, so walking a deep directory tree does not
+ * convert the same prefix again for each file.
+ *
+ * This class is thread-safe.
+ */
+class CharsetCache {
+	/**
+	 * The maximum number of directories.  When this is exceeded,
+	 * the whole cache is flushed; this is cheaper than LRU
+	 * bookkeeping, and a directory tree walk refills it quickly.
+	 */
+	static constexpr size_t MAX_SIZE = 16384;
+
+	mutable Mutex mutex;
+
+	std::unordered_map<std::string, std::string> map;
+
+public:
+	/**
+	 * Look up the conversion of a directory.
+	 *
+	 * @return true if the directory was found; its conversion
+	 * was copied to #value
+	 */
+	bool Lookup(const std::string &key, std::string &value) const {
+		const ScopeLock protect(mutex);
+		auto i = map.find(key);
+		if (i == map.end())
+			return false;
+
+		value = i->second;
+		return true;
+	}
+
+	void Insert(std::string &&key, const std::string &value) {
+		const ScopeLock protect(mutex);
+		if (map.size() >= MAX_SIZE)
+			map.clear();
+
+		map.emplace(std::move(key), value);
+	}
+
+	void Clear() {
+		const ScopeLock protect(mutex);
+		map.clear();
+	}
+};
+
+#endif
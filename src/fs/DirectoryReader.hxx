@@ -147,6 +147,26 @@ public:
 		assert(HasEntry());
 		return Path::FromFS(ent->d_name);
 	}
+
+	/**
+	 * Returns the file descriptor of the directory, to be used
+	 * with the *at() system calls.
+	 */
+	int GetFD() const {
+		return dirfd(dirp);
+	}
+
+#ifdef _DIRENT_HAVE_D_TYPE
+	/**
+	 * Is the current entry definitely not a symbolic link?  This
+	 * uses the file type returned by readdir(), if the file
+	 * system provides it, and avoids a system call.
+	 */
+	bool IsEntryNoSymlink() const {
+		assert(HasEntry());
+		return ent->d_type != DT_UNKNOWN && ent->d_type != DT_LNK;
+	}
+#endif
 };
 
 #endif
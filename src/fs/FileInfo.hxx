@@ -31,6 +31,7 @@
 #include <fileapi.h>
 #else
 #include <sys/stat.h>
+#include <fcntl.h>
 #endif
 
 #ifdef WIN32
@@ -55,6 +56,10 @@ class FileInfo {
 				bool follow_symlinks);
 	friend bool GetFileInfo(Path path, FileInfo &info,
 				Error &error);
+#ifndef WIN32
+	friend bool GetFileInfoAt(int directory_fd, Path name,
+				  FileInfo &info, bool follow_symlinks);
+#endif
 	friend class FileReader;
 
 #ifdef WIN32
@@ -145,6 +150,23 @@ GetFileInfo(Path path, FileInfo &info, bool follow_symlinks=true)
 #endif
 }
 
+#ifndef WIN32
+
+/**
+ * Wrapper for fstatat().  The name is relative to the given
+ * directory file descriptor, which saves the kernel from resolving
+ * the whole path again.
+ */
+inline bool
+GetFileInfoAt(int directory_fd, Path name, FileInfo &info,
+	      bool follow_symlinks=true)
+{
+	return fstatat(directory_fd, name.c_str(), &info.st,
+		       follow_symlinks ? 0 : AT_SYMLINK_NOFOLLOW) == 0;
+}
+
+#endif
+
 inline bool
 GetFileInfo(Path path, FileInfo &info, bool follow_symlinks, Error &error)
 {
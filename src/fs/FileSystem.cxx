@@ -44,3 +44,23 @@ ReadLink(Path path)
 	return AllocatedPath::FromFS(buffer);
 #endif
 }
+
+#ifndef WIN32
+
+AllocatedPath
+ReadLinkAt(int directory_fd, Path name)
+{
+	char buffer[MPD_PATH_MAX];
+	ssize_t size = readlinkat(directory_fd, name.c_str(),
+				  buffer, MPD_PATH_MAX);
+	if (size < 0)
+		return AllocatedPath::Null();
+	if (size_t(size) >= MPD_PATH_MAX) {
+		errno = ENOMEM;
+		return AllocatedPath::Null();
+	}
+	buffer[size] = '\0';
+	return AllocatedPath::FromFS(buffer);
+}
+
+#endif
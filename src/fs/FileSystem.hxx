@@ -125,6 +125,13 @@ ReadLink(Path path);
 
 #ifndef WIN32
 
+/**
+ * Wrapper for readlinkat() that uses #Path names.  The name is
+ * relative to the given directory file descriptor.
+ */
+AllocatedPath
+ReadLinkAt(int directory_fd, Path name);
+
 static inline bool
 MakeFifo(Path path, mode_t mode)
 {
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "MappedLineReader.hxx"
+#include "system/FileDescriptor.hxx"
+
+#include <assert.h>
+#include <string.h>
+#include <sys/mman.h>
+
+MappedLineReader *
+MappedLineReader::Open(FileDescriptor fd, uint64_t size)
+{
+	if (size < MIN_SIZE || size > SIZE_MAX)
+		return nullptr;
+
+	void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd.Get(), 0);
+	if (p == MAP_FAILED)
+		return nullptr;
+
+#ifdef MADV_SEQUENTIAL
+	/* enable aggressive read-ahead */
+	madvise(p, size, MADV_SEQUENTIAL);
+#endif
+
+	return new MappedLineReader((const char *)p, size);
+}
+
+MappedLineReader::~MappedLineReader()
+{
+	munmap(const_cast<char *>(data), size);
+	delete[] line_buffer;
+}
+
+char *
+MappedLineReader::ReadLine()
+{
+	if (position >= size)
+		return nullptr;
+
+	const char *line = data + position;
+	const size_t remaining = size - position;
+	const size_t max_length = remaining < MAX_LINE_LENGTH
+		? remaining
+		: MAX_LINE_LENGTH;
+
+	const char *newline = (const char *)memchr(line, '\n', max_length);
+	size_t length;
+	if (newline != nullptr) {
+		position = newline + 1 - data;
+
+		if (newline > line && newline[-1] == '\r')
+			--newline;
+		length = newline - line;
+	} else if (remaining <= MAX_LINE_LENGTH) {
+		/* the last line is not terminated */
+		position = size;
+		length = remaining;
+	} else {
+		/* line too long */
+		position = size;
+		return nullptr;
+	}
+
+	if (length >= line_buffer_size) {
+		size_t new_size = line_buffer_size > 0
+			? line_buffer_size * 2
+			: 4096;
+		while (new_size <= length)
+			new_size *= 2;
+
+		delete[] line_buffer;
+		line_buffer = new char[new_size];
+		line_buffer_size = new_size;
+	}
+
+	memcpy(line_buffer, line, length);
+	line_buffer[length] = 0;
+	return line_buffer;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_MAPPED_LINE_READER_HXX
+#define MPD_MAPPED_LINE_READER_HXX
+
+#include "check.h"
+#include "Compiler.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+class FileDescriptor;
+
+/**
+ * Reads lines from a read-only memory mapping of a regular file.
+ * The newline search runs over the mapping, and each line is copied
+ * once to a line buffer, where it is null-terminated.
+ *
+ * If the file is truncated while it is mapped, accessing the pages
+ * beyond the new end raises SIGBUS.  Therefore, this must only be
+ * used for files which are never modified in place, only replaced
+ * (e.g. the database file, see FileOutputStream).
+ */
+class MappedLineReader {
+	/**
+	 * Longer lines are refused, just like #BufferedReader does,
+	 * to protect from denial of service.
+	 */
+	static constexpr size_t MAX_LINE_LENGTH = 512 * 1024;
+
+	const char *const data;
+	const size_t size;
+
+	size_t position;
+
+	/**
+	 * The copy of the current line.
+	 */
+	char *line_buffer;
+	size_t line_buffer_size;
+
+	MappedLineReader(const char *_data, size_t _size)
+		:data(_data), size(_size), position(0),
+		 line_buffer(nullptr), line_buffer_size(0) {}
+
+public:
+	/**
+	 * Files smaller than this are not worth the mmap() overhead.
+	 */
+	static constexpr uint64_t MIN_SIZE = 64 * 1024;
+
+	MappedLineReader(const MappedLineReader &) = delete;
+
+	~MappedLineReader();
+
+	/**
+	 * Map the specified file.
+	 *
+	 * @param size the size of the file
+	 * @return a new object or nullptr if the file cannot (or
+	 * should not) be mapped; the caller shall fall back to
+	 * #BufferedReader then
+	 */
+	static MappedLineReader *Open(FileDescriptor fd, uint64_t size);
+
+	/**
+	 * Does the mapped data start with the gzip magic?
+	 */
+	gcc_pure
+	bool IsGzip() const {
+		return size >= 2 && (uint8_t)data[0] == 0x1f &&
+			(uint8_t)data[1] == 0x8b;
+	}
+
+	/**
+	 * @return a pointer to the line, or nullptr on end-of-file
+	 * or if the line is too long
+	 */
+	char *ReadLine();
+};
+
+#endif
@@ -23,36 +23,66 @@
 #include "AutoGunzipReader.hxx"
 #include "BufferedReader.hxx"
 #include "fs/Path.hxx"
+#include "fs/FileInfo.hxx"
+
+#ifndef WIN32
+#include "MappedLineReader.hxx"
+#endif
 
 #include <assert.h>
 
-TextFile::TextFile(Path path_fs)
+TextFile::TextFile(Path path_fs, gcc_unused bool allow_mmap)
 	:file_reader(new FileReader(path_fs)),
+#ifndef WIN32
+	 mapped_reader(nullptr),
+#endif
 #ifdef ENABLE_ZLIB
-	 gunzip_reader(new AutoGunzipReader(*file_reader)),
+	 gunzip_reader(nullptr),
+#endif
+	 buffered_reader(nullptr)
+{
+#ifndef WIN32
+	const FileInfo info = file_reader->GetFileInfo();
+	if (allow_mmap && info.IsRegular()) {
+		mapped_reader = MappedLineReader::Open(file_reader->GetFD(),
+						       info.GetSize());
+		if (mapped_reader != nullptr) {
+			if (!mapped_reader->IsGzip())
+				return;
+
+			delete mapped_reader;
+			mapped_reader = nullptr;
+		}
+	}
 #endif
-	 buffered_reader(new BufferedReader(*
+
 #ifdef ENABLE_ZLIB
-					    gunzip_reader
+	gunzip_reader = new AutoGunzipReader(*file_reader);
+	buffered_reader = new BufferedReader(*gunzip_reader);
 #else
-					    file_reader
+	buffered_reader = new BufferedReader(*file_reader);
 #endif
-					    ))
-{
 }
 
 TextFile::~TextFile()
 {
+#ifndef WIN32
+	delete mapped_reader;
+#endif
 	delete buffered_reader;
 #ifdef ENABLE_ZLIB
 	delete gunzip_reader;
 #endif
-	delete file_reader;
 }
 
 char *
 TextFile::ReadLine()
 {
+#ifndef WIN32
+	if (mapped_reader != nullptr)
+		return mapped_reader->ReadLine();
+#endif
+
 	assert(buffered_reader != nullptr);
 
 	return buffered_reader->ReadLine();
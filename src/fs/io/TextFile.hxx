@@ -23,22 +23,41 @@
 #include "check.h"
 #include "Compiler.h"
 
+#include <memory>
+
 class Path;
 class FileReader;
 class AutoGunzipReader;
 class BufferedReader;
+class MappedLineReader;
 
 class TextFile {
-	FileReader *const file_reader;
+	const std::unique_ptr<FileReader> file_reader;
+
+#ifndef WIN32
+	/**
+	 * If this is not nullptr, then the file is read directly from
+	 * a memory mapping, and the other readers are not used.
+	 */
+	MappedLineReader *mapped_reader;
+#endif
 
 #ifdef ENABLE_ZLIB
-	AutoGunzipReader *const gunzip_reader;
+	AutoGunzipReader *gunzip_reader;
 #endif
 
-	BufferedReader *const buffered_reader;
+	BufferedReader *buffered_reader;
 
 public:
-	TextFile(Path path_fs);
+	/**
+	 * Throws std::system_error on error.
+	 *
+	 * @param allow_mmap read the file through a memory mapping
+	 * if it is large enough; only allowed for files which are
+	 * never truncated or modified in place, because that would
+	 * crash MPD with SIGBUS (see #MappedLineReader)
+	 */
+	explicit TextFile(Path path_fs, bool allow_mmap=false);
 
 	TextFile(const TextFile &other) = delete;
 
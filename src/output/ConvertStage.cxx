@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "ConvertStage.hxx"
+#include "Domain.hxx"
+#include "util/Error.hxx"
+#include "Log.hxx"
+
+#include <assert.h>
+#include <string.h>
+
+SharedConverter *
+ConvertStage::Acquire(AudioFormat in_format, AudioFormat out_format,
+		      bool replay_gain, Error &error)
+{
+	assert(in_format.IsValid());
+	assert(out_format.IsValid());
+
+	const ScopeLock protect(mutex);
+
+	for (auto &converter : converters) {
+		if (converter.in_format == in_format &&
+		    converter.out_format == out_format &&
+		    converter.replay_gain == replay_gain) {
+			++converter.refs;
+
+			struct audio_format_string a, b;
+			FormatDebug(output_domain,
+				    "sharing conversion %s -> %s",
+				    audio_format_to_string(in_format, &a),
+				    audio_format_to_string(out_format, &b));
+			return &converter;
+		}
+	}
+
+	converters.emplace_front(in_format, out_format, replay_gain);
+	SharedConverter &converter = converters.front();
+	if (!converter.convert.Open(in_format, out_format, error)) {
+		converters.pop_front();
+		return nullptr;
+	}
+
+	return &converter;
+}
+
+void
+ConvertStage::Release(SharedConverter &converter)
+{
+	const ScopeLock protect(mutex);
+
+	assert(converter.refs > 0);
+
+	if (--converter.refs > 0)
+		return;
+
+	/* no output uses it anymore; nobody else can be inside
+	   Convert() now */
+	converter.convert.Close();
+	converters.remove_if([&converter](const SharedConverter &i){
+			return &i == &converter;
+		});
+}
+
+ConstBuffer<void>
+ConvertStage::Convert(SharedConverter &converter, const MusicChunk &chunk,
+		      ConstBuffer<void> src)
+{
+	const ScopeLock protect(converter.mutex);
+
+	/* the most recent chunks are at the end of the list */
+	for (auto i = converter.results.rbegin(),
+		     end = converter.results.rend(); i != end; ++i)
+		if (i->chunk == &chunk)
+			return i->data;
+
+	if (converter.unused.empty())
+		converter.unused.emplace_back();
+	converter.results.splice(converter.results.end(),
+				 converter.unused, converter.unused.begin());
+
+	SharedConverter::Result &result = converter.results.back();
+	result.chunk = &chunk;
+
+	Error error;
+	ConstBuffer<void> data = converter.convert.Convert(src, error);
+	if (data.IsNull()) {
+		LogError(error);
+		result.data = nullptr;
+		return nullptr;
+	}
+
+	/* the PcmConvert buffer will be reused for the next chunk;
+	   copy the result */
+	void *dest = result.buffer.Get(data.size);
+	memcpy(dest, data.data, data.size);
+	result.data = { dest, data.size };
+	return result.data;
+}
+
+void
+SharedConverter::Forget(const MusicChunk &chunk)
+{
+	const ScopeLock protect(mutex);
+
+	for (auto i = results.begin(), end = results.end(); i != end;) {
+		auto next = std::next(i);
+		if (i->chunk == &chunk)
+			unused.splice(unused.end(), results, i);
+		i = next;
+	}
+}
+
+void
+SharedConverter::Clear()
+{
+	const ScopeLock protect(mutex);
+
+	unused.splice(unused.end(), results);
+}
+
+void
+ConvertStage::Forget(const MusicChunk &chunk)
+{
+	const ScopeLock protect(mutex);
+
+	for (auto &converter : converters)
+		converter.Forget(chunk);
+}
+
+void
+ConvertStage::Clear()
+{
+	const ScopeLock protect(mutex);
+
+	for (auto &converter : converters)
+		converter.Clear();
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_OUTPUT_CONVERT_STAGE_HXX
+#define MPD_OUTPUT_CONVERT_STAGE_HXX
+
+#include "check.h"
+#include "AudioFormat.hxx"
+#include "pcm/PcmConvert.hxx"
+#include "pcm/PcmBuffer.hxx"
+#include "thread/Mutex.hxx"
+#include "util/ConstBuffer.hxx"
+
+#include <list>
+
+class Error;
+struct MusicChunk;
+
+/**
+ * One PCM conversion which is shared by all audio outputs that need
+ * it.  Managed by #ConvertStage.
+ */
+class SharedConverter {
+	friend class ConvertStage;
+
+	struct Result {
+		const MusicChunk *chunk;
+
+		PcmBuffer buffer;
+
+		/**
+		 * The converted PCM data; nullptr on error.
+		 */
+		ConstBuffer<void> data;
+	};
+
+	const AudioFormat in_format, out_format;
+
+	/**
+	 * The #CrossFadeStage variant which feeds this converter.
+	 */
+	const bool replay_gain;
+
+	/**
+	 * The number of audio outputs which use this object.
+	 * Protected by ConvertStage::mutex.
+	 */
+	unsigned refs = 1;
+
+	/**
+	 * Protects #convert and the result lists.
+	 */
+	Mutex mutex;
+
+	PcmConvert convert;
+
+	std::list<Result> results;
+
+	/**
+	 * #Result objects which are not in use.  They are kept around
+	 * to reuse their buffers.
+	 */
+	std::list<Result> unused;
+
+public:
+	SharedConverter(AudioFormat _in_format, AudioFormat _out_format,
+			bool _replay_gain)
+		:in_format(_in_format), out_format(_out_format),
+		 replay_gain(_replay_gain) {}
+
+	SharedConverter(const SharedConverter &) = delete;
+	SharedConverter &operator=(const SharedConverter &) = delete;
+
+private:
+	void Forget(const MusicChunk &chunk);
+	void Clear();
+};
+
+/**
+ * Converts the #MusicChunk objects in the #MusicPipe once for all
+ * audio outputs which need the same conversion.  Only outputs whose
+ * filter chain consists of nothing but the "convert" filter are
+ * eligible (see AudioOutput::convert_only), because any other
+ * filter before it may modify the PCM data differently for each
+ * output.
+ */
+class ConvertStage {
+private:
+	/**
+	 * Protects #converters and SharedConverter::refs.
+	 */
+	Mutex mutex;
+
+	std::list<SharedConverter> converters;
+
+public:
+	/**
+	 * Obtain a reference to a #SharedConverter for the given formats;
+	 * it is shared with all other outputs which need the same
+	 * conversion.  Call Release() when done.
+	 *
+	 * @param replay_gain does the source data come from the
+	 * replay gain variant of the #CrossFadeStage?
+	 * @return the #SharedConverter, or nullptr on error
+	 */
+	SharedConverter *Acquire(AudioFormat in_format, AudioFormat out_format,
+			   bool replay_gain, Error &error);
+
+	void Release(SharedConverter &converter);
+
+	/**
+	 * Returns the converted PCM data of the chunk.  The first
+	 * output to get here converts it, and all others get the
+	 * same buffer, which remains valid until Forget() or Clear()
+	 * is called.
+	 *
+	 * @param src the chunk's data after the #CrossFadeStage
+	 * @return the converted data, or nullptr on error
+	 */
+	ConstBuffer<void> Convert(SharedConverter &converter,
+				  const MusicChunk &chunk,
+				  ConstBuffer<void> src);
+
+	/**
+	 * The chunk has been consumed by all audio outputs and is
+	 * about to be returned to the #MusicBuffer.
+	 */
+	void Forget(const MusicChunk &chunk);
+
+	/**
+	 * Forget all results, e.g. after the #MusicPipe has been
+	 * cleared.
+	 */
+	void Clear();
+};
+
+#endif
@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "CrossFadeStage.hxx"
+#include "Domain.hxx"
+#include "MusicChunk.hxx"
+#include "pcm/PcmMix.hxx"
+#include "filter/FilterPlugin.hxx"
+#include "filter/FilterRegistry.hxx"
+#include "filter/FilterInternal.hxx"
+#include "filter/plugins/ReplayGainFilterPlugin.hxx"
+#include "config/Block.hxx"
+#include "util/Error.hxx"
+#include "Log.hxx"
+
+#include <assert.h>
+#include <string.h>
+
+static Filter *
+NewReplayGainFilter()
+{
+	Filter *filter = filter_new(&replay_gain_filter_plugin,
+				    ConfigBlock(), IgnoreError());
+	assert(filter != nullptr);
+	return filter;
+}
+
+CrossFadeStage::CrossFadeStage()
+	:audio_format(AudioFormat::Undefined())
+{
+	Variant &variant = variants[true];
+	variant.replay_gain_filter = NewReplayGainFilter();
+	variant.other_replay_gain_filter = NewReplayGainFilter();
+}
+
+CrossFadeStage::~CrossFadeStage()
+{
+	Close();
+
+	for (auto &variant : variants) {
+		delete variant.replay_gain_filter;
+		delete variant.other_replay_gain_filter;
+	}
+}
+
+void
+CrossFadeStage::SetReplayGainMode(ReplayGainMode mode)
+{
+	const ScopeLock protect(mutex);
+
+	for (auto &variant : variants) {
+		if (variant.replay_gain_filter != nullptr)
+			replay_gain_filter_set_mode(variant.replay_gain_filter,
+						    mode);
+		if (variant.other_replay_gain_filter != nullptr)
+			replay_gain_filter_set_mode(variant.other_replay_gain_filter,
+						    mode);
+	}
+}
+
+void
+CrossFadeStage::CloseVariant(Variant &variant)
+{
+	if (variant.replay_gain_filter != nullptr)
+		variant.replay_gain_filter->Close();
+	if (variant.other_replay_gain_filter != nullptr)
+		variant.other_replay_gain_filter->Close();
+}
+
+bool
+CrossFadeStage::OpenVariant(Variant &variant, AudioFormat _audio_format,
+			    Error &error)
+{
+	if (variant.replay_gain_filter != nullptr &&
+	    !variant.replay_gain_filter->Open(_audio_format, error).IsDefined())
+		return false;
+
+	if (variant.other_replay_gain_filter != nullptr &&
+	    !variant.other_replay_gain_filter->Open(_audio_format, error).IsDefined()) {
+		if (variant.replay_gain_filter != nullptr)
+			variant.replay_gain_filter->Close();
+		return false;
+	}
+
+	variant.replay_gain_serial = 0;
+	variant.other_replay_gain_serial = 0;
+	return true;
+}
+
+bool
+CrossFadeStage::Open(const AudioFormat _audio_format, Error &error)
+{
+	assert(_audio_format.IsValid());
+
+	if (_audio_format == audio_format)
+		return true;
+
+	Close();
+
+	const ScopeLock protect(mutex);
+
+	for (auto &variant : variants) {
+		if (!OpenVariant(variant, _audio_format, error)) {
+			for (auto *i = variants; i != &variant; ++i)
+				CloseVariant(*i);
+			return false;
+		}
+	}
+
+	audio_format = _audio_format;
+	return true;
+}
+
+void
+CrossFadeStage::Close()
+{
+	Clear();
+
+	const ScopeLock protect(mutex);
+
+	if (!audio_format.IsDefined())
+		return;
+
+	for (auto &variant : variants)
+		CloseVariant(variant);
+
+	audio_format.Clear();
+}
+
+static ConstBuffer<void>
+ApplyReplayGain(const MusicChunk &chunk, Filter *replay_gain_filter,
+		unsigned &replay_gain_serial)
+{
+	ConstBuffer<void> data(chunk.data, chunk.length);
+
+	if (!data.IsEmpty() && replay_gain_filter != nullptr) {
+		if (chunk.replay_gain_serial != replay_gain_serial) {
+			replay_gain_filter_set_info(replay_gain_filter,
+						    chunk.replay_gain_serial != 0
+						    ? &chunk.replay_gain_info
+						    : nullptr);
+			replay_gain_serial = chunk.replay_gain_serial;
+		}
+
+		Error error;
+		data = replay_gain_filter->FilterPCM(data, error);
+		if (data.IsNull())
+			LogError(error, "Failed to apply replay gain");
+	}
+
+	return data;
+}
+
+inline ConstBuffer<void>
+CrossFadeStage::Calculate(Variant &variant, const MusicChunk &chunk,
+			  PcmBuffer &buffer)
+{
+	assert(!chunk.IsEmpty());
+	assert(chunk.CheckFormat(audio_format));
+
+	ConstBuffer<void> data =
+		ApplyReplayGain(chunk, variant.replay_gain_filter,
+				variant.replay_gain_serial);
+	if (data.IsEmpty())
+		return data;
+
+	/* cross-fade */
+
+	if (chunk.other != nullptr) {
+		ConstBuffer<void> other_data =
+			ApplyReplayGain(*chunk.other,
+					variant.other_replay_gain_filter,
+					variant.other_replay_gain_serial);
+		if (other_data.IsNull())
+			return nullptr;
+
+		if (!other_data.IsEmpty()) {
+			/* if the "other" chunk is longer, then that
+			   trailer is used as-is, without mixing; it
+			   is part of the "next" song being faded in,
+			   and if there's a rest, it means
+			   cross-fading ends here */
+
+			if (data.size > other_data.size)
+				data.size = other_data.size;
+
+			float mix_ratio = chunk.mix_ratio;
+			if (mix_ratio >= 0)
+				/* reverse the mix ratio (because the
+				   arguments to pcm_mix() are
+				   reversed), but only if the mix ratio
+				   is non-negative; a negative mix
+				   ratio is a MixRamp special case */
+				mix_ratio = 1.0 - mix_ratio;
+
+			void *dest = buffer.Get(other_data.size);
+			memcpy(dest, other_data.data, other_data.size);
+			if (!pcm_mix(variant.dither, dest,
+				     data.data, data.size,
+				     audio_format.format,
+				     mix_ratio)) {
+				FormatError(output_domain,
+					    "Cannot cross-fade format %s",
+					    sample_format_to_string(audio_format.format));
+				return nullptr;
+			}
+
+			return { dest, other_data.size };
+		}
+	}
+
+	if (data.data != chunk.data) {
+		/* the replay gain filter's buffer will be reused for
+		   the next chunk; copy the result */
+		void *dest = buffer.Get(data.size);
+		memcpy(dest, data.data, data.size);
+		data.data = dest;
+	}
+
+	return data;
+}
+
+ConstBuffer<void>
+CrossFadeStage::Get(const MusicChunk &chunk, bool replay_gain)
+{
+	const ScopeLock protect(mutex);
+
+	assert(audio_format.IsDefined());
+
+	/* the most recent chunks are at the end of the list */
+	for (auto i = results.rbegin(), end = results.rend(); i != end; ++i)
+		if (i->chunk == &chunk && i->replay_gain == replay_gain)
+			return i->data;
+
+	if (unused.empty())
+		unused.emplace_back();
+	results.splice(results.end(), unused, unused.begin());
+
+	Result &result = results.back();
+	result.chunk = &chunk;
+	result.replay_gain = replay_gain;
+	result.data = Calculate(variants[replay_gain], chunk, result.buffer);
+	return result.data;
+}
+
+void
+CrossFadeStage::Forget(const MusicChunk &chunk)
+{
+	const ScopeLock protect(mutex);
+
+	for (auto i = results.begin(), end = results.end(); i != end;) {
+		auto next = std::next(i);
+		if (i->chunk == &chunk)
+			unused.splice(unused.end(), results, i);
+		i = next;
+	}
+}
+
+void
+CrossFadeStage::Clear()
+{
+	const ScopeLock protect(mutex);
+
+	unused.splice(unused.end(), results);
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_OUTPUT_CROSS_FADE_STAGE_HXX
+#define MPD_OUTPUT_CROSS_FADE_STAGE_HXX
+
+#include "check.h"
+#include "AudioFormat.hxx"
+#include "ReplayGainInfo.hxx"
+#include "pcm/PcmBuffer.hxx"
+#include "pcm/PcmDither.hxx"
+#include "thread/Mutex.hxx"
+#include "util/ConstBuffer.hxx"
+
+#include <list>
+
+class Error;
+class Filter;
+struct MusicChunk;
+
+/**
+ * Applies replay gain and cross-fading to the #MusicChunk objects
+ * in the #MusicPipe once for all audio outputs.  The first output
+ * thread which gets to a chunk calculates the result, and all
+ * others reuse it, until MultipleOutputs::Check() returns the chunk
+ * to the #MusicBuffer.
+ */
+class CrossFadeStage {
+	/**
+	 * The state for one class of audio outputs: those which
+	 * apply replay gain (#replay_gain_filter is set) and those
+	 * which do not ("replay_gain_handler" is "none").
+	 */
+	struct Variant {
+		/**
+		 * The replay_gain_filter_plugin instance for the
+		 * current chunk.
+		 */
+		Filter *replay_gain_filter = nullptr;
+
+		/**
+		 * The serial number of the last replay gain info.
+		 * 0 means no replay gain info was available.
+		 */
+		unsigned replay_gain_serial = 0;
+
+		/**
+		 * The replay_gain_filter_plugin instance for the
+		 * "other" chunk during cross-fading.
+		 */
+		Filter *other_replay_gain_filter = nullptr;
+
+		unsigned other_replay_gain_serial = 0;
+
+		/**
+		 * The dithering state for cross-fading two streams.
+		 */
+		PcmDither dither;
+	};
+
+	struct Result {
+		const MusicChunk *chunk;
+
+		bool replay_gain;
+
+		/**
+		 * The buffer for the cross-fading result.
+		 */
+		PcmBuffer buffer;
+
+		/**
+		 * The PCM data to be passed to the output's filter
+		 * chain; nullptr on error.
+		 */
+		ConstBuffer<void> data;
+	};
+
+	Mutex mutex;
+
+	/**
+	 * The audio format of all chunks in the #MusicPipe, or
+	 * undefined if this object is closed.
+	 */
+	AudioFormat audio_format;
+
+	/**
+	 * Indexed by the "replay_gain" parameter of Get().
+	 */
+	Variant variants[2];
+
+	std::list<Result> results;
+
+	/**
+	 * #Result objects which are not in use.  They are kept
+	 * around to reuse their buffers.
+	 */
+	std::list<Result> unused;
+
+public:
+	CrossFadeStage();
+	~CrossFadeStage();
+
+	CrossFadeStage(const CrossFadeStage &) = delete;
+	CrossFadeStage &operator=(const CrossFadeStage &) = delete;
+
+	void SetReplayGainMode(ReplayGainMode mode);
+
+	/**
+	 * Prepare for chunks in the specified audio format.  If the
+	 * object is already open with this format, this is a no-op.
+	 */
+	bool Open(AudioFormat _audio_format, Error &error);
+
+	void Close();
+
+	/**
+	 * Returns the PCM data of the chunk with replay gain applied
+	 * and the "other" chunk mixed in.  The returned buffer remains
+	 * valid until Forget() or Clear() is called.
+	 *
+	 * @param replay_gain apply replay gain?
+	 * @return the PCM data, or nullptr on error
+	 */
+	ConstBuffer<void> Get(const MusicChunk &chunk, bool replay_gain);
+
+	/**
+	 * The chunk has been consumed by all audio outputs and is
+	 * about to be returned to the #MusicBuffer.
+	 */
+	void Forget(const MusicChunk &chunk);
+
+	/**
+	 * Forget all results, e.g. after the #MusicPipe has been
+	 * cleared.
+	 */
+	void Clear();
+
+private:
+	static bool OpenVariant(Variant &variant, AudioFormat _audio_format,
+				Error &error);
+	static void CloseVariant(Variant &variant);
+
+	ConstBuffer<void> Calculate(Variant &variant, const MusicChunk &chunk,
+				    PcmBuffer &buffer);
+};
+
+#endif
@@ -35,7 +35,6 @@ AudioOutput::~AudioOutput()
 		mixer_free(mixer);
 
 	delete replay_gain_filter;
-	delete other_replay_gain_filter;
 	delete filter;
 }
 
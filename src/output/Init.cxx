@@ -56,9 +56,11 @@ AudioOutput::AudioOutput(const AudioOutputPlugin &_plugin)
 	 allow_play(true),
 	 in_playback_loop(false),
 	 woken_for_play(false),
+	 cross_fade_stage(nullptr), convert_stage(nullptr),
+	 shared_converter(nullptr),
 	 filter(nullptr),
 	 replay_gain_filter(nullptr),
-	 other_replay_gain_filter(nullptr),
+	 volume_filter(nullptr),
 	 command(Command::NONE)
 {
 	assert(plugin.finish != nullptr);
@@ -148,6 +150,12 @@ audio_output_load_mixer(EventLoop &event_loop, AudioOutput &ao,
 
 		filter_chain_append(filter_chain, "software_mixer",
 				    software_mixer_get_filter(mixer));
+		if (ao.convert_only)
+			/* nothing but this volume filter and the
+			   "convert" filter: both may be replaced by
+			   PcmFusedGain */
+			ao.volume_filter = software_mixer_get_filter(mixer);
+		ao.convert_only = false;
 		return mixer;
 	}
 
@@ -192,7 +200,9 @@ AudioOutput::Configure(const ConfigBlock &block, Error &error)
 
 	/* create the normalization filter (if configured) */
 
-	if (config_get_bool(ConfigOption::VOLUME_NORMALIZATION, false)) {
+	const bool normalize =
+		config_get_bool(ConfigOption::VOLUME_NORMALIZATION, false);
+	if (normalize) {
 		Filter *normalize_filter =
 			filter_new(&normalize_filter_plugin, ConfigBlock(),
 				   IgnoreError());
@@ -202,10 +212,10 @@ AudioOutput::Configure(const ConfigBlock &block, Error &error)
 				    autoconvert_filter_new(normalize_filter));
 	}
 
+	const char *filters = block.GetBlockValue(AUDIO_FILTERS, "");
+
 	Error filter_error;
-	filter_chain_parse(*filter,
-			   block.GetBlockValue(AUDIO_FILTERS, ""),
-			   filter_error);
+	filter_chain_parse(*filter, filters, filter_error);
 
 	// It's not really fatal - Part of the filter chain has been set up already
 	// and even an empty one will work (if only with unexpected behaviour)
@@ -214,6 +224,10 @@ AudioOutput::Configure(const ConfigBlock &block, Error &error)
 			    "Failed to initialize filter chain for '%s'",
 			    name);
 
+	/* the "software" mixer may append another filter, see
+	   audio_output_load_mixer() */
+	convert_only = !normalize && *filters == 0;
+
 	/* done */
 
 	return true;
@@ -237,17 +251,8 @@ audio_output_setup(EventLoop &event_loop, AudioOutput &ao,
 		assert(ao.replay_gain_filter != nullptr);
 
 		ao.replay_gain_serial = 0;
-
-		ao.other_replay_gain_filter = filter_new(&replay_gain_filter_plugin,
-							 block,
-							 IgnoreError());
-		assert(ao.other_replay_gain_filter != nullptr);
-
-		ao.other_replay_gain_serial = 0;
-	} else {
+	} else
 		ao.replay_gain_filter = nullptr;
-		ao.other_replay_gain_filter = nullptr;
-	}
 
 	/* set up the mixer */
 
@@ -21,9 +21,8 @@
 #define MPD_OUTPUT_INTERNAL_HXX
 
 #include "AudioFormat.hxx"
-#include "pcm/PcmBuffer.hxx"
-#include "pcm/PcmDither.hxx"
 #include "ReplayGainInfo.hxx"
+#include "pcm/FusedGain.hxx"
 #include "thread/Mutex.hxx"
 #include "thread/Cond.hxx"
 #include "thread/Thread.hxx"
@@ -31,6 +30,9 @@
 
 class Error;
 class Filter;
+class CrossFadeStage;
+class ConvertStage;
+class SharedConverter;
 class MusicPipe;
 class EventLoop;
 class Mixer;
@@ -96,6 +98,13 @@ struct AudioOutput {
 	 */
 	bool always_on;
 
+	/**
+	 * Does #filter consist of nothing but #convert_filter?  Then
+	 * the conversion may be shared with other outputs which
+	 * need the same conversion, see #ConvertStage.
+	 */
+	bool convert_only;
+
 	/**
 	 * Has the user enabled this device?
 	 */
@@ -174,14 +183,24 @@ struct AudioOutput {
 	AudioFormat out_audio_format;
 
 	/**
-	 * The buffer used to allocate the cross-fading result.
+	 * Applies replay gain and cross-fading before the chunk is
+	 * passed to #filter.  It is shared by all outputs of the
+	 * #MultipleOutputs object.
+	 */
+	CrossFadeStage *cross_fade_stage;
+
+	/**
+	 * Performs the conversion for this output if #convert_only
+	 * is set.  It is shared by all outputs of the
+	 * #MultipleOutputs object.
 	 */
-	PcmBuffer cross_fade_buffer;
+	ConvertStage *convert_stage;
 
 	/**
-	 * The dithering state for cross-fading two streams.
+	 * The shared converter obtained from #convert_stage, or
+	 * nullptr if #filter is used for the conversion.
 	 */
-	PcmDither cross_fade_dither;
+	SharedConverter *shared_converter;
 
 	/**
 	 * The filter object of this audio output.  This is an
@@ -191,28 +210,34 @@ struct AudioOutput {
 
 	/**
 	 * The replay_gain_filter_plugin instance of this audio
-	 * output.
+	 * output.  The PCM data is processed by #cross_fade_stage;
+	 * this instance only drives the hardware mixer if
+	 * "replay_gain_handler" is "mixer".  nullptr if
+	 * "replay_gain_handler" is "none".
 	 */
 	Filter *replay_gain_filter;
 
 	/**
-	 * The serial number of the last replay gain info.  0 means no
-	 * replay gain info was available.
+	 * The volume filter of the "software" mixer, if the filter
+	 * chain consists of nothing else but it and #convert_filter;
+	 * nullptr otherwise.  See #fused_gain.
 	 */
-	unsigned replay_gain_serial;
+	Filter *volume_filter;
 
 	/**
-	 * The replay_gain_filter_plugin instance of this audio
-	 * output, to be applied to the second chunk during
-	 * cross-fading.
+	 * Applies replay gain, the software volume and the sample
+	 * format conversion in one pass, bypassing #cross_fade_stage
+	 * and #filter.  It is only open if #volume_filter is set and
+	 * the conversion does not change the sample rate or the
+	 * channels.
 	 */
-	Filter *other_replay_gain_filter;
+	PcmFusedGain fused_gain;
 
 	/**
-	 * The serial number of the last replay gain info by the
-	 * "other" chunk during cross-fading.
+	 * The serial number of the last replay gain info.  0 means no
+	 * replay gain info was available.
 	 */
-	unsigned other_replay_gain_serial;
+	unsigned replay_gain_serial;
 
 	/**
 	 * The convert_filter_plugin instance of this audio output.
@@ -398,6 +423,21 @@ private:
 
 	void ReopenFilter();
 
+	/**
+	 * Attempt to obtain a #shared_converter from #convert_stage
+	 * after #convert_filter has been set up.  On failure, #filter
+	 * is used.
+	 */
+	void OpenSharedConverter();
+
+	void CloseSharedConverter();
+
+	/**
+	 * Open #fused_gain after #convert_filter has been set up, if
+	 * the filter chain allows it.
+	 */
+	void OpenFusedGain();
+
 	/**
 	 * Wait until the output's delay reaches zero.
 	 *
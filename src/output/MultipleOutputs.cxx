@@ -82,6 +82,8 @@ MultipleOutputs::Configure(EventLoop &event_loop, PlayerControl &pc)
 			FormatFatalError("output devices with identical "
 					 "names: %s", output->name);
 
+		output->cross_fade_stage = &cross_fade_stage;
+		output->convert_stage = &convert_stage;
 		outputs.push_back(output);
 	}
 
@@ -90,6 +92,8 @@ MultipleOutputs::Configure(EventLoop &event_loop, PlayerControl &pc)
 		const ConfigBlock empty;
 		auto output = LoadOutput(event_loop, mixer_listener,
 					 pc, empty);
+		output->cross_fade_stage = &cross_fade_stage;
+		output->convert_stage = &convert_stage;
 		outputs.push_back(output);
 	}
 }
@@ -184,6 +188,8 @@ MultipleOutputs::SetReplayGainMode(ReplayGainMode mode)
 {
 	for (auto ao : outputs)
 		ao->SetReplayGainMode(mode);
+
+	cross_fade_stage.SetReplayGainMode(mode);
 }
 
 bool
@@ -233,6 +239,11 @@ MultipleOutputs::Open(const AudioFormat audio_format,
 
 	input_audio_format = audio_format;
 
+	if (!cross_fade_stage.Open(audio_format, error)) {
+		Close();
+		return false;
+	}
+
 	ResetReopen();
 	EnableDisable();
 	Update();
@@ -356,6 +367,9 @@ MultipleOutputs::Check()
 		shifted = pipe->Shift();
 		assert(shifted == chunk);
 
+		convert_stage.Forget(*shifted);
+		cross_fade_stage.Forget(*shifted);
+
 		if (is_tail)
 			/* unlock all audio outputs which were locked
 			   by clear_tail_chunk() */
@@ -421,6 +435,9 @@ MultipleOutputs::Cancel()
 	if (pipe != nullptr)
 		pipe->Clear(*buffer);
 
+	convert_stage.Clear();
+	cross_fade_stage.Clear();
+
 	/* the audio outputs are now waiting for a signal, to
 	   synchronize the cleared music pipe */
 
@@ -447,6 +464,8 @@ MultipleOutputs::Close()
 
 	buffer = nullptr;
 
+	convert_stage.Clear();
+	cross_fade_stage.Close();
 	input_audio_format.Clear();
 
 	elapsed_time = SignedSongTime::Negative();
@@ -468,6 +487,8 @@ MultipleOutputs::Release()
 
 	buffer = nullptr;
 
+	convert_stage.Clear();
+	cross_fade_stage.Close();
 	input_audio_format.Clear();
 
 	elapsed_time = SignedSongTime::Negative();
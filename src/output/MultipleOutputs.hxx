@@ -27,6 +27,8 @@
 #define OUTPUT_ALL_H
 
 #include "AudioFormat.hxx"
+#include "CrossFadeStage.hxx"
+#include "ConvertStage.hxx"
 #include "ReplayGainInfo.hxx"
 #include "Chrono.hxx"
 #include "Compiler.h"
@@ -63,6 +65,18 @@ class MultipleOutputs {
 	 */
 	MusicPipe *pipe;
 
+	/**
+	 * Applies replay gain and cross-fading to the chunks in
+	 * #pipe once for all outputs.
+	 */
+	CrossFadeStage cross_fade_stage;
+
+	/**
+	 * Converts the chunks in #pipe once for all outputs which
+	 * need the same conversion.
+	 */
+	ConvertStage convert_stage;
+
 	/**
 	 * The "elapsed_time" stamp of the most recently finished
 	 * chunk.
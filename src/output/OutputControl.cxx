@@ -73,8 +73,6 @@ AudioOutput::SetReplayGainMode(ReplayGainMode mode)
 {
 	if (replay_gain_filter != nullptr)
 		replay_gain_filter_set_mode(replay_gain_filter, mode);
-	if (other_replay_gain_filter != nullptr)
-		replay_gain_filter_set_mode(other_replay_gain_filter, mode);
 }
 
 void
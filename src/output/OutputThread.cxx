@@ -21,18 +21,22 @@
 #include "Internal.hxx"
 #include "OutputAPI.hxx"
 #include "Domain.hxx"
-#include "pcm/PcmMix.hxx"
+#include "CrossFadeStage.hxx"
+#include "ConvertStage.hxx"
 #include "pcm/Domain.hxx"
+#include "pcm/Volume.hxx"
 #include "notify.hxx"
 #include "filter/FilterInternal.hxx"
 #include "filter/plugins/ConvertFilterPlugin.hxx"
 #include "filter/plugins/ReplayGainFilterPlugin.hxx"
+#include "filter/plugins/VolumeFilterPlugin.hxx"
 #include "player/Control.hxx"
 #include "MusicPipe.hxx"
 #include "MusicChunk.hxx"
 #include "thread/Util.hxx"
 #include "thread/Slack.hxx"
 #include "thread/Name.hxx"
+#include "thread/Policy.hxx"
 #include "system/FatalError.hxx"
 #include "util/Error.hxx"
 #include "util/ConstBuffer.hxx"
@@ -94,38 +98,66 @@ AudioOutput::OpenFilter(AudioFormat &format, Error &error_r)
 {
 	assert(format.IsValid());
 
-	/* the replay_gain filter cannot fail here */
-	if (replay_gain_filter != nullptr &&
-	    !replay_gain_filter->Open(format, error_r).IsDefined())
-		return AudioFormat::Undefined();
+	return filter->Open(format, error_r);
+}
 
-	if (other_replay_gain_filter != nullptr &&
-	    !other_replay_gain_filter->Open(format, error_r).IsDefined()) {
-		if (replay_gain_filter != nullptr)
-			replay_gain_filter->Close();
-		return AudioFormat::Undefined();
-	}
+void
+AudioOutput::CloseFilter()
+{
+	CloseSharedConverter();
+	fused_gain.Close();
 
-	const AudioFormat af = filter->Open(format, error_r);
-	if (!af.IsDefined()) {
-		if (replay_gain_filter != nullptr)
-			replay_gain_filter->Close();
-		if (other_replay_gain_filter != nullptr)
-			other_replay_gain_filter->Close();
-	}
+	filter->Close();
+}
+
+void
+AudioOutput::OpenSharedConverter()
+{
+	assert(shared_converter == nullptr);
 
-	return af;
+	if (!convert_only || convert_stage == nullptr ||
+	    in_audio_format == out_audio_format)
+		/* nothing to share */
+		return;
+
+	Error error;
+	shared_converter =
+		convert_stage->Acquire(in_audio_format, out_audio_format,
+				       replay_gain_filter != nullptr,
+				       error);
+	if (shared_converter == nullptr)
+		/* not fatal: the "convert" filter of this output
+		   will do the work */
+		FormatError(error,
+			    "Failed to share the conversion of \"%s\" [%s]",
+			    name, plugin.name);
 }
 
 void
-AudioOutput::CloseFilter()
+AudioOutput::OpenFusedGain()
 {
-	if (replay_gain_filter != nullptr)
-		replay_gain_filter->Close();
-	if (other_replay_gain_filter != nullptr)
-		other_replay_gain_filter->Close();
+	assert(!fused_gain.IsOpen());
 
-	filter->Close();
+	if (volume_filter == nullptr ||
+	    in_audio_format.sample_rate != out_audio_format.sample_rate ||
+	    in_audio_format.channels != out_audio_format.channels)
+		/* PcmFusedGain cannot do this */
+		return;
+
+	Error error;
+	if (!fused_gain.Open(in_audio_format.format, out_audio_format.format,
+			     error))
+		/* not fatal: the filter chain will do the work */
+		FormatDebug(output_domain, "%s", error.GetMessage());
+}
+
+void
+AudioOutput::CloseSharedConverter()
+{
+	if (shared_converter != nullptr) {
+		convert_stage->Release(*shared_converter);
+		shared_converter = nullptr;
+	}
 }
 
 inline void
@@ -226,6 +258,9 @@ AudioOutput::Open()
 		return;
 	}
 
+	OpenSharedConverter();
+	OpenFusedGain();
+
 	open = true;
 
 	FormatDebug(output_domain,
@@ -305,6 +340,9 @@ AudioOutput::ReopenFilter()
 
 		return;
 	}
+
+	OpenSharedConverter();
+	OpenFusedGain();
 }
 
 void
@@ -354,91 +392,66 @@ AudioOutput::WaitForDelay()
 }
 
 static ConstBuffer<void>
-ao_chunk_data(AudioOutput *ao, const MusicChunk *chunk,
-	      Filter *replay_gain_filter,
-	      unsigned *replay_gain_serial_p)
+ao_filter_chunk(AudioOutput *ao, const MusicChunk *chunk)
 {
 	assert(chunk != nullptr);
 	assert(!chunk->IsEmpty());
 	assert(chunk->CheckFormat(ao->in_audio_format));
+	assert(ao->cross_fade_stage != nullptr);
+
+	if (ao->replay_gain_filter != nullptr &&
+	    chunk->replay_gain_serial != ao->replay_gain_serial) {
+		/* the PCM data is handled by the CrossFadeStage; this
+		   only updates the hardware mixer (if
+		   "replay_gain_handler" is "mixer") */
+		replay_gain_filter_set_info(ao->replay_gain_filter,
+					    chunk->replay_gain_serial != 0
+					    ? &chunk->replay_gain_info
+					    : nullptr);
+		ao->replay_gain_serial = chunk->replay_gain_serial;
+	}
 
-	ConstBuffer<void> data(chunk->data, chunk->length);
-
-	(void)ao;
-
-	assert(data.size % ao->in_audio_format.GetFrameSize() == 0);
-
-	if (!data.IsEmpty() && replay_gain_filter != nullptr) {
-		if (chunk->replay_gain_serial != *replay_gain_serial_p) {
-			replay_gain_filter_set_info(replay_gain_filter,
-						    chunk->replay_gain_serial != 0
-						    ? &chunk->replay_gain_info
-						    : nullptr);
-			*replay_gain_serial_p = chunk->replay_gain_serial;
+	if (ao->fused_gain.IsOpen() && chunk->other == nullptr) {
+		const unsigned replay_gain_volume =
+			ao->replay_gain_filter != nullptr
+			? replay_gain_filter_get_volume(ao->replay_gain_filter)
+			: PCM_VOLUME_1;
+		const unsigned volume = volume_filter_get(ao->volume_filter);
+
+		if (replay_gain_volume != PCM_VOLUME_1 ||
+		    volume != PCM_VOLUME_1) {
+			/* replay gain, software volume and conversion
+			   in one pass */
+			const float gain = float(replay_gain_volume) * volume
+				/ (float(PCM_VOLUME_1) * PCM_VOLUME_1);
+			return ao->fused_gain.Apply({chunk->data,
+						     chunk->length},
+						    gain);
 		}
 
-		Error error;
-		data = replay_gain_filter->FilterPCM(data, error);
-		if (data.IsNull())
-			FormatError(error, "\"%s\" [%s] failed to filter",
-				    ao->name, ao->plugin.name);
+		/* no gain: the filter chain only needs to convert,
+		   which is exact, and without dither */
 	}
 
-	return data;
-}
+	/* replay gain and cross-fade */
 
-static ConstBuffer<void>
-ao_filter_chunk(AudioOutput *ao, const MusicChunk *chunk)
-{
 	ConstBuffer<void> data =
-		ao_chunk_data(ao, chunk, ao->replay_gain_filter,
-			      &ao->replay_gain_serial);
+		ao->cross_fade_stage->Get(*chunk,
+					  ao->replay_gain_filter != nullptr);
 	if (data.IsEmpty())
 		return data;
 
-	/* cross-fade */
-
-	if (chunk->other != nullptr) {
-		ConstBuffer<void> other_data =
-			ao_chunk_data(ao, chunk->other,
-				      ao->other_replay_gain_filter,
-				      &ao->other_replay_gain_serial);
-		if (other_data.IsNull())
-			return nullptr;
-
-		if (other_data.IsEmpty())
-			return data;
-
-		/* if the "other" chunk is longer, then that trailer
-		   is used as-is, without mixing; it is part of the
-		   "next" song being faded in, and if there's a rest,
-		   it means cross-fading ends here */
-
-		if (data.size > other_data.size)
-			data.size = other_data.size;
-
-		float mix_ratio = chunk->mix_ratio;
-		if (mix_ratio >= 0)
-			/* reverse the mix ratio (because the
-			   arguments to pcm_mix() are reversed), but
-			   only if the mix ratio is non-negative; a
-			   negative mix ratio is a MixRamp special
-			   case */
-			mix_ratio = 1.0 - mix_ratio;
-
-		void *dest = ao->cross_fade_buffer.Get(other_data.size);
-		memcpy(dest, other_data.data, other_data.size);
-		if (!pcm_mix(ao->cross_fade_dither, dest, data.data, data.size,
-			     ao->in_audio_format.format,
-			     mix_ratio)) {
+	if (ao->shared_converter != nullptr) {
+		/* the filter chain consists only of the "convert"
+		   filter, and another output may have done this
+		   conversion already */
+		data = ao->convert_stage->Convert(*ao->shared_converter,
+						  *chunk, data);
+		if (data.IsNull())
 			FormatError(output_domain,
-				    "Cannot cross-fade format %s",
-				    sample_format_to_string(ao->in_audio_format.format));
-			return nullptr;
-		}
-
-		data.data = dest;
-		data.size = other_data.size;
+				    "\"%s\" [%s] failed to convert",
+				    ao->name, ao->plugin.name);
+		return data;
 	}
 
 	/* apply filter chain */
@@ -593,7 +606,9 @@ AudioOutput::Task()
 {
 	FormatThreadName("output:%s", name);
 
-	SetThreadRealtime();
+	if (!ApplyThreadPolicy(ThreadClass::OUTPUT))
+		SetThreadRealtime();
+
 	SetThreadTimerSlackUS(100);
 
 	mutex.lock();
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_AVX2_HXX
+#define MPD_PCM_AVX2_HXX
+
+#include "Traits.hxx"
+
+#include <immintrin.h>
+
+#include <stddef.h>
+
+/*
+ * Sample format conversion kernels using AVX2.  They are compiled
+ * for AVX2 regardless of the compiler flags and must only be called
+ * if CpuHasAvx2() returns true.  Like the SSE2 kernels in Sse2.hxx,
+ * they process whole blocks only, and they are bit-exact with the
+ * portable implementations.
+ */
+
+#define gcc_target_avx2 __attribute__((target("avx2")))
+
+gcc_target_avx2
+static inline void
+Avx2Load32(__m256i v[4], const int8_t *src)
+{
+	for (unsigned i = 0; i < 4; ++i)
+		v[i] = _mm256_cvtepi8_epi32(
+			_mm_loadl_epi64((const __m128i *)(src + 8 * i)));
+}
+
+gcc_target_avx2
+static inline void
+Avx2Load32(__m256i v[4], const int16_t *src)
+{
+	for (unsigned i = 0; i < 4; ++i)
+		v[i] = _mm256_cvtepi16_epi32(
+			_mm_loadu_si128((const __m128i *)(src + 8 * i)));
+}
+
+gcc_target_avx2
+static inline void
+Avx2Load32(__m256i v[4], const int32_t *src)
+{
+	for (unsigned i = 0; i < 4; ++i)
+		v[i] = _mm256_loadu_si256((const __m256i *)(src + 8 * i));
+}
+
+/**
+ * Store 32 samples, clipping them to the range of the destination
+ * type (the pack instructions saturate).
+ */
+gcc_target_avx2
+static inline void
+Avx2Store32(int8_t *dest, const __m256i v[4])
+{
+	const __m256i a = _mm256_packs_epi32(v[0], v[1]);
+	const __m256i b = _mm256_packs_epi32(v[2], v[3]);
+
+	/* both pack instructions work on each 128 bit lane
+	   separately; restore the order of the 32 bit groups */
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	const __m256i x = _mm256_packs_epi16(a, b);
+	_mm256_storeu_si256((__m256i *)dest,
+			    _mm256_permutevar8x32_epi32(x, order));
+}
+
+gcc_target_avx2
+static inline void
+Avx2Store32(int16_t *dest, const __m256i v[4])
+{
+	for (unsigned i = 0; i < 2; ++i) {
+		/* _mm256_packs_epi32() works on each 128 bit lane
+		   separately; restore the order of the 64 bit
+		   quarters */
+		__m256i x = _mm256_packs_epi32(v[2 * i], v[2 * i + 1]);
+		x = _mm256_permute4x64_epi64(x, 0xd8);
+		_mm256_storeu_si256((__m256i *)(dest + 16 * i), x);
+	}
+}
+
+gcc_target_avx2
+static inline void
+Avx2Store32(int32_t *dest, const __m256i v[4])
+{
+	for (unsigned i = 0; i < 4; ++i)
+		_mm256_storeu_si256((__m256i *)(dest + 8 * i), v[i]);
+}
+
+/**
+ * See #Sse2LeftShift.
+ */
+template<class ST, class DT>
+struct Avx2LeftShift {
+	typedef ST SrcTraits;
+	typedef DT DstTraits;
+
+	static constexpr size_t BLOCK_SIZE = 32;
+
+	gcc_target_avx2
+	void Convert(typename DT::pointer_type dest,
+		     typename ST::const_pointer_type src, size_t n) const {
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, src += BLOCK_SIZE, dest += BLOCK_SIZE) {
+			__m256i v[4];
+			Avx2Load32(v, src);
+			for (auto &x : v)
+				x = _mm256_slli_epi32(x, DT::BITS - ST::BITS);
+			Avx2Store32(dest, v);
+		}
+	}
+};
+
+/**
+ * See #Sse2RightShift.
+ */
+template<class ST, class DT>
+struct Avx2RightShift {
+	typedef ST SrcTraits;
+	typedef DT DstTraits;
+
+	static constexpr size_t BLOCK_SIZE = 32;
+
+	gcc_target_avx2
+	void Convert(typename DT::pointer_type dest,
+		     typename ST::const_pointer_type src, size_t n) const {
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, src += BLOCK_SIZE, dest += BLOCK_SIZE) {
+			__m256i v[4];
+			Avx2Load32(v, src);
+			for (auto &x : v)
+				x = _mm256_srai_epi32(x, ST::BITS - DT::BITS);
+			Avx2Store32(dest, v);
+		}
+	}
+};
+
+/**
+ * See #Sse2IntegerToFloat.
+ */
+template<class ST>
+struct Avx2IntegerToFloat {
+	typedef ST SrcTraits;
+	typedef SampleTraits<SampleFormat::FLOAT> DstTraits;
+
+	static constexpr size_t BLOCK_SIZE = 32;
+
+	gcc_target_avx2
+	void Convert(float *dest, typename ST::const_pointer_type src,
+		     size_t n) const {
+		const __m256 factor =
+			_mm256_set1_ps(0.5 / (1 << (ST::BITS - 2)));
+
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, src += BLOCK_SIZE, dest += BLOCK_SIZE) {
+			__m256i v[4];
+			Avx2Load32(v, src);
+			for (unsigned j = 0; j < 4; ++j)
+				_mm256_storeu_ps(dest + 8 * j,
+						 _mm256_mul_ps(_mm256_cvtepi32_ps(v[j]),
+							       factor));
+		}
+	}
+};
+
+/**
+ * See #Sse2FloatToInteger.
+ */
+template<class DT>
+struct Avx2FloatToInteger {
+	typedef SampleTraits<SampleFormat::FLOAT> SrcTraits;
+	typedef DT DstTraits;
+
+	static constexpr size_t BLOCK_SIZE = 32;
+
+	gcc_target_avx2
+	static __m256i Convert8(__m256 x, __m256 factor) {
+		x = _mm256_mul_ps(x, factor);
+		x = _mm256_max_ps(x, _mm256_set1_ps(float(DT::MIN)));
+
+		if (DT::BITS < 32) {
+			x = _mm256_min_ps(x, _mm256_set1_ps(float(DT::MAX)));
+			return _mm256_cvttps_epi32(x);
+		}
+
+		/* see Sse2FloatToInteger::Convert4() */
+		const __m256 limit = _mm256_set1_ps(2147483648.f);
+		const __m256i overflow =
+			_mm256_castps_si256(_mm256_cmp_ps(x, limit,
+							  _CMP_GE_OQ));
+		return _mm256_xor_si256(_mm256_cvttps_epi32(x), overflow);
+	}
+
+	gcc_target_avx2
+	void Convert(typename DT::pointer_type dest, const float *src,
+		     size_t n) const {
+		const __m256 factor =
+			_mm256_set1_ps(float(uint64_t(1) << (DT::BITS - 1)));
+
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, src += BLOCK_SIZE, dest += BLOCK_SIZE) {
+			__m256i v[4];
+			for (unsigned j = 0; j < 4; ++j)
+				v[j] = Convert8(_mm256_loadu_ps(src + 8 * j),
+						factor);
+			Avx2Store32(dest, v);
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_AVX2_VOLUME_HXX
+#define MPD_PCM_AVX2_VOLUME_HXX
+
+#include "Avx2.hxx"
+#include "Volume.hxx"
+#include "VectorDither.hxx"
+#include "Compiler.h"
+
+/*
+ * Software volume and mixing kernels using AVX2.  They must only be
+ * called if CpuHasAvx2() returns true.  See Sse2Volume.hxx.
+ */
+
+/**
+ * Advance the random number generators of all lanes and return their
+ * dither values plus the rounding offset.  See
+ * PcmVectorDither::Next().
+ */
+template<unsigned scale_bits>
+gcc_target_avx2
+static inline __m256i
+Avx2NextDither(__m256i &state)
+{
+	const __m256i rnd =
+		_mm256_add_epi32(_mm256_mullo_epi32(state,
+						    _mm256_set1_epi32(PCM_PRNG_MULTIPLIER)),
+				 _mm256_set1_epi32(PCM_PRNG_INCREMENT));
+	const __m256i d =
+		_mm256_sub_epi32(_mm256_srli_epi32(rnd, 32 - scale_bits),
+				 _mm256_srli_epi32(state, 32 - scale_bits));
+	state = rnd;
+
+	return _mm256_add_epi32(d, _mm256_set1_epi32(1 << (scale_bits - 1)));
+}
+
+/**
+ * Round, dither and shift eight 32 bit values.  Clipping is left to
+ * the saturating Avx2Store32().
+ */
+template<unsigned scale_bits>
+gcc_target_avx2
+static inline __m256i
+Avx2DitherShift(__m256i v, __m256i &state)
+{
+	v = _mm256_add_epi32(v, Avx2NextDither<scale_bits>(state));
+	return _mm256_srai_epi32(v, scale_bits);
+}
+
+/**
+ * Convert eight 32 bit integers to double.
+ */
+gcc_target_avx2
+static inline void
+Avx2ToDouble(__m256d d[2], __m256i v)
+{
+	d[0] = _mm256_cvtepi32_pd(_mm256_castsi256_si128(v));
+	d[1] = _mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1));
+}
+
+/**
+ * See Sse2ShiftClip().
+ */
+template<class Traits, unsigned scale_bits>
+gcc_target_avx2
+static inline __m128i
+Avx2ShiftClip(__m256d x)
+{
+	x = _mm256_mul_pd(x, _mm256_set1_pd(1.0 / (1 << scale_bits)));
+	x = _mm256_max_pd(x, _mm256_set1_pd(Traits::MIN));
+	x = _mm256_min_pd(x, _mm256_set1_pd(Traits::MAX));
+	return _mm256_cvttpd_epi32(_mm256_floor_pd(x));
+}
+
+/**
+ * See Sse2DitherShiftWide().
+ */
+template<class Traits, unsigned scale_bits>
+gcc_target_avx2
+static inline __m256i
+Avx2DitherShiftWide(__m256d x[2], __m256i &state)
+{
+	__m256d d[2];
+	Avx2ToDouble(d, Avx2NextDither<scale_bits>(state));
+
+	const __m128i lo =
+		Avx2ShiftClip<Traits, scale_bits>(_mm256_add_pd(x[0], d[0]));
+	const __m128i hi =
+		Avx2ShiftClip<Traits, scale_bits>(_mm256_add_pd(x[1], d[1]));
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+/**
+ * See #Sse2NarrowVolumeKernel.
+ */
+template<SampleFormat F, class Traits=SampleTraits<F>>
+struct Avx2NarrowVolumeKernel {
+	static_assert(sizeof(typename Traits::long_type) == 4,
+		      "32 bit products expected");
+
+	typedef typename Traits::pointer_type pointer_type;
+	typedef typename Traits::const_pointer_type const_pointer_type;
+
+	static constexpr size_t BLOCK_SIZE = 32;
+
+	gcc_target_avx2
+	static void Volume(PcmVectorDither &dither,
+			   pointer_type dest, const_pointer_type src,
+			   size_t n, int volume) {
+		const __m256i v1 = _mm256_set1_epi32(volume);
+		__m256i state = _mm256_loadu_si256((const __m256i *)dither.random);
+
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, src += BLOCK_SIZE, dest += BLOCK_SIZE) {
+			__m256i v[4];
+			Avx2Load32(v, src);
+
+			for (auto &x : v)
+				x = Avx2DitherShift<PCM_VOLUME_BITS>(_mm256_mullo_epi32(x, v1),
+								     state);
+
+			Avx2Store32(dest, v);
+		}
+
+		_mm256_storeu_si256((__m256i *)dither.random, state);
+	}
+
+	gcc_target_avx2
+	static void AddVolume(PcmVectorDither &dither,
+			      pointer_type a, const_pointer_type b,
+			      size_t n, int volume1, int volume2) {
+		const __m256i v1 = _mm256_set1_epi32(volume1);
+		const __m256i v2 = _mm256_set1_epi32(volume2);
+		__m256i state = _mm256_loadu_si256((const __m256i *)dither.random);
+
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, a += BLOCK_SIZE, b += BLOCK_SIZE) {
+			__m256i va[4], vb[4];
+			Avx2Load32(va, a);
+			Avx2Load32(vb, b);
+
+			for (unsigned j = 0; j < 4; ++j) {
+				const __m256i c =
+					_mm256_add_epi32(_mm256_mullo_epi32(va[j], v1),
+							 _mm256_mullo_epi32(vb[j], v2));
+				va[j] = Avx2DitherShift<PCM_VOLUME_BITS>(c, state);
+			}
+
+			Avx2Store32(a, va);
+		}
+
+		_mm256_storeu_si256((__m256i *)dither.random, state);
+	}
+};
+
+/**
+ * See #Sse2WideVolumeKernel.
+ */
+template<SampleFormat F, class Traits=SampleTraits<F>>
+struct Avx2WideVolumeKernel {
+	typedef typename Traits::pointer_type pointer_type;
+	typedef typename Traits::const_pointer_type const_pointer_type;
+
+	static constexpr size_t BLOCK_SIZE = 32;
+
+	gcc_target_avx2
+	static void Volume(PcmVectorDither &dither,
+			   pointer_type dest, const_pointer_type src,
+			   size_t n, int volume) {
+		const __m256d v1 = _mm256_set1_pd(volume);
+		__m256i state = _mm256_loadu_si256((const __m256i *)dither.random);
+
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, src += BLOCK_SIZE, dest += BLOCK_SIZE) {
+			__m256i v[4];
+			Avx2Load32(v, src);
+
+			for (auto &y : v) {
+				__m256d x[2];
+				Avx2ToDouble(x, y);
+				x[0] = _mm256_mul_pd(x[0], v1);
+				x[1] = _mm256_mul_pd(x[1], v1);
+
+				y = Avx2DitherShiftWide<Traits, PCM_VOLUME_BITS>(x, state);
+			}
+
+			Avx2Store32(dest, v);
+		}
+
+		_mm256_storeu_si256((__m256i *)dither.random, state);
+	}
+
+	gcc_target_avx2
+	static void AddVolume(PcmVectorDither &dither,
+			      pointer_type a, const_pointer_type b,
+			      size_t n, int volume1, int volume2) {
+		const __m256d v1 = _mm256_set1_pd(volume1);
+		const __m256d v2 = _mm256_set1_pd(volume2);
+		__m256i state = _mm256_loadu_si256((const __m256i *)dither.random);
+
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, a += BLOCK_SIZE, b += BLOCK_SIZE) {
+			__m256i va[4], vb[4];
+			Avx2Load32(va, a);
+			Avx2Load32(vb, b);
+
+			for (unsigned j = 0; j < 4; ++j) {
+				__m256d x[2], y[2];
+				Avx2ToDouble(x, va[j]);
+				Avx2ToDouble(y, vb[j]);
+				x[0] = _mm256_add_pd(_mm256_mul_pd(x[0], v1),
+						     _mm256_mul_pd(y[0], v2));
+				x[1] = _mm256_add_pd(_mm256_mul_pd(x[1], v1),
+						     _mm256_mul_pd(y[1], v2));
+
+				va[j] = Avx2DitherShiftWide<Traits, PCM_VOLUME_BITS>(x, state);
+			}
+
+			Avx2Store32(a, va);
+		}
+
+		_mm256_storeu_si256((__m256i *)dither.random, state);
+	}
+};
+
+struct Avx2FloatVolumeKernel {
+	static constexpr size_t BLOCK_SIZE = 32;
+
+	gcc_target_avx2
+	static void Volume(gcc_unused PcmVectorDither &dither,
+			   float *dest, const float *src,
+			   size_t n, int volume) {
+		const __m256 v1 = _mm256_set1_ps(pcm_volume_to_float(volume));
+
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, src += BLOCK_SIZE, dest += BLOCK_SIZE)
+			for (unsigned j = 0; j < BLOCK_SIZE; j += 8)
+				_mm256_storeu_ps(dest + j,
+						 _mm256_mul_ps(_mm256_loadu_ps(src + j),
+							       v1));
+	}
+
+	gcc_target_avx2
+	static void AddVolume(gcc_unused PcmVectorDither &dither,
+			      float *a, const float *b,
+			      size_t n, int volume1, int volume2) {
+		const __m256 v1 = _mm256_set1_ps(pcm_volume_to_float(volume1));
+		const __m256 v2 = _mm256_set1_ps(pcm_volume_to_float(volume2));
+
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, a += BLOCK_SIZE, b += BLOCK_SIZE) {
+			for (unsigned j = 0; j < BLOCK_SIZE; j += 8) {
+				const __m256 x = _mm256_loadu_ps(a + j);
+				const __m256 y = _mm256_loadu_ps(b + j);
+				_mm256_storeu_ps(a + j,
+						 _mm256_add_ps(_mm256_mul_ps(x, v1),
+							       _mm256_mul_ps(y, v2)));
+			}
+		}
+	}
+};
+
+template<SampleFormat F>
+struct Avx2VolumeKernel;
+
+template<>
+struct Avx2VolumeKernel<SampleFormat::S8>
+	: Avx2NarrowVolumeKernel<SampleFormat::S8> {};
+
+template<>
+struct Avx2VolumeKernel<SampleFormat::S16>
+	: Avx2NarrowVolumeKernel<SampleFormat::S16> {};
+
+template<>
+struct Avx2VolumeKernel<SampleFormat::S24_P32>
+	: Avx2WideVolumeKernel<SampleFormat::S24_P32> {};
+
+template<>
+struct Avx2VolumeKernel<SampleFormat::S32>
+	: Avx2WideVolumeKernel<SampleFormat::S32> {};
+
+template<>
+struct Avx2VolumeKernel<SampleFormat::FLOAT> : Avx2FloatVolumeKernel {};
+
+#endif
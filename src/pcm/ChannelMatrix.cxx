@@ -0,0 +1,502 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "ChannelMatrix.hxx"
+#include "CpuFeatures.hxx"
+#include "PcmBuffer.hxx"
+#include "Traits.hxx"
+#include "util/ConstBuffer.hxx"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef HAVE_AVX2_DISPATCH
+#include "Avx2.hxx"
+#endif
+
+#include <algorithm>
+
+#include <math.h>
+
+void
+PcmChannelMatrix::Clear(unsigned _src_channels, unsigned _dest_channels)
+{
+	assert(audio_valid_channel_count(_src_channels));
+	assert(audio_valid_channel_count(_dest_channels));
+
+	src_channels = _src_channels;
+	dest_channels = _dest_channels;
+
+	for (auto &row : coefficients)
+		std::fill_n(row, MAX_CHANNELS, 0.0f);
+}
+
+enum class Speaker : uint8_t {
+	NONE,
+	FRONT_LEFT,
+	FRONT_RIGHT,
+	FRONT_CENTER,
+	LFE,
+	BACK_LEFT,
+	BACK_RIGHT,
+	BACK_CENTER,
+	SIDE_LEFT,
+	SIDE_RIGHT,
+};
+
+/**
+ * The speaker layouts for each channel count (FLAC/WAVE order).
+ */
+static constexpr Speaker speaker_layouts[MAX_CHANNELS + 1][MAX_CHANNELS] = {
+	{},
+	{ Speaker::FRONT_CENTER },
+	{ Speaker::FRONT_LEFT, Speaker::FRONT_RIGHT },
+	{ Speaker::FRONT_LEFT, Speaker::FRONT_RIGHT, Speaker::FRONT_CENTER },
+	{ Speaker::FRONT_LEFT, Speaker::FRONT_RIGHT,
+	  Speaker::BACK_LEFT, Speaker::BACK_RIGHT },
+	{ Speaker::FRONT_LEFT, Speaker::FRONT_RIGHT, Speaker::FRONT_CENTER,
+	  Speaker::BACK_LEFT, Speaker::BACK_RIGHT },
+	{ Speaker::FRONT_LEFT, Speaker::FRONT_RIGHT, Speaker::FRONT_CENTER,
+	  Speaker::LFE, Speaker::BACK_LEFT, Speaker::BACK_RIGHT },
+	{ Speaker::FRONT_LEFT, Speaker::FRONT_RIGHT, Speaker::FRONT_CENTER,
+	  Speaker::LFE, Speaker::BACK_CENTER,
+	  Speaker::SIDE_LEFT, Speaker::SIDE_RIGHT },
+	{ Speaker::FRONT_LEFT, Speaker::FRONT_RIGHT, Speaker::FRONT_CENTER,
+	  Speaker::LFE, Speaker::BACK_LEFT, Speaker::BACK_RIGHT,
+	  Speaker::SIDE_LEFT, Speaker::SIDE_RIGHT },
+};
+
+/**
+ * -3 dB
+ */
+static constexpr float ITU_SURROUND = 0.70710678f;
+
+/**
+ * Returns the index of the given speaker in the layout, or -1 if it
+ * does not exist there.
+ */
+gcc_pure
+static int
+FindSpeaker(const Speaker *layout, unsigned channels, Speaker speaker)
+{
+	for (unsigned i = 0; i < channels; ++i)
+		if (layout[i] == speaker)
+			return i;
+
+	return -1;
+}
+
+/**
+ * Determine where one input channel goes in the output layout.
+ *
+ * @param targets receives up to two (output channel, factor) pairs
+ * @return the number of targets
+ */
+static unsigned
+FoldSpeaker(const Speaker *layout, unsigned channels, Speaker speaker,
+	    int targets[2], float factors[2])
+{
+	int i = FindSpeaker(layout, channels, speaker);
+	if (i >= 0) {
+		targets[0] = i;
+		factors[0] = 1;
+		return 1;
+	}
+
+	Speaker alternative[2] = { Speaker::NONE, Speaker::NONE };
+	float factor = ITU_SURROUND;
+
+	switch (speaker) {
+	case Speaker::NONE:
+	case Speaker::LFE:
+		return 0;
+
+	case Speaker::FRONT_LEFT:
+	case Speaker::FRONT_RIGHT:
+		/* all layouts with more than one channel have
+		   them */
+		return 0;
+
+	case Speaker::FRONT_CENTER:
+		alternative[0] = Speaker::FRONT_LEFT;
+		alternative[1] = Speaker::FRONT_RIGHT;
+		break;
+
+	case Speaker::BACK_LEFT:
+		i = FindSpeaker(layout, channels, Speaker::SIDE_LEFT);
+		alternative[0] = i >= 0 ? Speaker::SIDE_LEFT : Speaker::FRONT_LEFT;
+		factor = i >= 0 ? 1 : ITU_SURROUND;
+		break;
+
+	case Speaker::BACK_RIGHT:
+		i = FindSpeaker(layout, channels, Speaker::SIDE_RIGHT);
+		alternative[0] = i >= 0 ? Speaker::SIDE_RIGHT : Speaker::FRONT_RIGHT;
+		factor = i >= 0 ? 1 : ITU_SURROUND;
+		break;
+
+	case Speaker::SIDE_LEFT:
+		i = FindSpeaker(layout, channels, Speaker::BACK_LEFT);
+		alternative[0] = i >= 0 ? Speaker::BACK_LEFT : Speaker::FRONT_LEFT;
+		factor = i >= 0 ? 1 : ITU_SURROUND;
+		break;
+
+	case Speaker::SIDE_RIGHT:
+		i = FindSpeaker(layout, channels, Speaker::BACK_RIGHT);
+		alternative[0] = i >= 0 ? Speaker::BACK_RIGHT : Speaker::FRONT_RIGHT;
+		factor = i >= 0 ? 1 : ITU_SURROUND;
+		break;
+
+	case Speaker::BACK_CENTER:
+		if (FindSpeaker(layout, channels, Speaker::BACK_LEFT) >= 0) {
+			alternative[0] = Speaker::BACK_LEFT;
+			alternative[1] = Speaker::BACK_RIGHT;
+		} else if (FindSpeaker(layout, channels, Speaker::SIDE_LEFT) >= 0) {
+			alternative[0] = Speaker::SIDE_LEFT;
+			alternative[1] = Speaker::SIDE_RIGHT;
+		} else {
+			alternative[0] = Speaker::FRONT_LEFT;
+			alternative[1] = Speaker::FRONT_RIGHT;
+		}
+
+		break;
+	}
+
+	unsigned n = 0;
+	for (const Speaker a : alternative) {
+		if (a == Speaker::NONE)
+			continue;
+
+		i = FindSpeaker(layout, channels, a);
+		if (i >= 0) {
+			targets[n] = i;
+			factors[n] = factor;
+			++n;
+		}
+	}
+
+	return n;
+}
+
+void
+PcmChannelMatrix::SetDefault(unsigned _src_channels, unsigned _dest_channels)
+{
+	Clear(_src_channels, _dest_channels);
+
+	if (src_channels == 1) {
+		/* mono goes to both front speakers */
+		if (dest_channels == 1)
+			coefficients[0][0] = 1;
+		else
+			coefficients[0][0] = coefficients[1][0] = 1;
+		return;
+	}
+
+	if (dest_channels == 1) {
+		/* downmix to stereo, then average both channels */
+		PcmChannelMatrix stereo;
+		stereo.SetDefault(src_channels, 2);
+		for (unsigned i = 0; i < src_channels; ++i)
+			coefficients[0][i] = (stereo.coefficients[0][i] +
+					      stereo.coefficients[1][i]) / 2;
+		return;
+	}
+
+	const Speaker *src_layout = speaker_layouts[src_channels];
+	const Speaker *dest_layout = speaker_layouts[dest_channels];
+
+	for (unsigned i = 0; i < src_channels; ++i) {
+		int targets[2];
+		float factors[2];
+		const unsigned n = FoldSpeaker(dest_layout, dest_channels,
+					       src_layout[i],
+					       targets, factors);
+		for (unsigned j = 0; j < n; ++j)
+			coefficients[targets[j]][i] += factors[j];
+	}
+
+	if (src_channels > dest_channels)
+		Normalize();
+}
+
+void
+PcmChannelMatrix::Normalize()
+{
+	float max = 0;
+	for (unsigned i = 0; i < dest_channels; ++i) {
+		float sum = 0;
+		for (unsigned j = 0; j < src_channels; ++j)
+			sum += fabsf(coefficients[i][j]);
+		max = std::max(max, sum);
+	}
+
+	if (max <= 1)
+		return;
+
+	for (unsigned i = 0; i < dest_channels; ++i)
+		for (unsigned j = 0; j < src_channels; ++j)
+			coefficients[i][j] /= max;
+}
+
+/**
+ * The number of frames processed in one pass; a multiple of 8.
+ */
+static constexpr unsigned MATRIX_BLOCK = 256;
+
+typedef float MatrixPlanes[MAX_CHANNELS][MATRIX_BLOCK];
+
+/**
+ * dest[i] = src[i] * factor (if add is false) or dest[i] += src[i] *
+ * factor; n is a multiple of 8.
+ */
+typedef void (*MatrixMulFunction)(float *dest, const float *src,
+				   float factor, unsigned n, bool add);
+
+#ifdef __SSE2__
+
+static void
+MatrixMulSse2(float *dest, const float *src, float factor, unsigned n,
+	      bool add)
+{
+	const __m128 f = _mm_set1_ps(factor);
+
+	if (add)
+		for (unsigned i = 0; i < n; i += 4)
+			_mm_store_ps(dest + i,
+				     _mm_add_ps(_mm_load_ps(dest + i),
+						_mm_mul_ps(_mm_load_ps(src + i), f)));
+	else
+		for (unsigned i = 0; i < n; i += 4)
+			_mm_store_ps(dest + i,
+				     _mm_mul_ps(_mm_load_ps(src + i), f));
+}
+
+#else
+
+static void
+MatrixMulPortable(float *dest, const float *src, float factor, unsigned n,
+		  bool add)
+{
+	if (add)
+		for (unsigned i = 0; i < n; ++i)
+			dest[i] += src[i] * factor;
+	else
+		for (unsigned i = 0; i < n; ++i)
+			dest[i] = src[i] * factor;
+}
+
+#endif
+
+#ifdef HAVE_AVX2_DISPATCH
+
+gcc_target_avx2
+static void
+MatrixMulAvx2(float *dest, const float *src, float factor, unsigned n,
+	      bool add)
+{
+	const __m256 f = _mm256_set1_ps(factor);
+
+	if (add)
+		for (unsigned i = 0; i < n; i += 8)
+			_mm256_store_ps(dest + i,
+					_mm256_add_ps(_mm256_load_ps(dest + i),
+						      _mm256_mul_ps(_mm256_load_ps(src + i), f)));
+	else
+		for (unsigned i = 0; i < n; i += 8)
+			_mm256_store_ps(dest + i,
+					_mm256_mul_ps(_mm256_load_ps(src + i), f));
+}
+
+#endif
+
+gcc_pure
+static MatrixMulFunction
+GetMatrixMulFunction()
+{
+#ifdef HAVE_AVX2_DISPATCH
+	if (CpuHasAvx2())
+		return MatrixMulAvx2;
+#endif
+
+#ifdef __SSE2__
+	return MatrixMulSse2;
+#else
+	return MatrixMulPortable;
+#endif
+}
+
+template<typename T>
+static void
+Deinterleave(MatrixPlanes &planes, const T *src, unsigned channels,
+	     unsigned n)
+{
+	for (unsigned i = 0; i < n; ++i)
+		for (unsigned c = 0; c < channels; ++c)
+			planes[c][i] = *src++;
+}
+
+template<SampleFormat F, class Traits=SampleTraits<F>>
+static typename Traits::value_type
+FromFloat(float value)
+{
+	if (value >= float(Traits::MAX))
+		return Traits::MAX;
+	if (value <= float(Traits::MIN))
+		return Traits::MIN;
+
+	return typename Traits::value_type(lrintf(value));
+}
+
+template<>
+inline float
+FromFloat<SampleFormat::FLOAT, SampleTraits<SampleFormat::FLOAT>>(float value)
+{
+	return value;
+}
+
+template<SampleFormat F, class Traits=SampleTraits<F>>
+static void
+Interleave(typename Traits::pointer_type dest, const MatrixPlanes &planes,
+	   unsigned channels, unsigned n)
+{
+	for (unsigned i = 0; i < n; ++i)
+		for (unsigned c = 0; c < channels; ++c)
+			*dest++ = FromFloat<F, Traits>(planes[c][i]);
+}
+
+template<SampleFormat F, class Traits=SampleTraits<F>>
+static ConstBuffer<typename Traits::value_type>
+ApplyMatrix(PcmBuffer &buffer,
+	    const float (&coefficients)[MAX_CHANNELS][MAX_CHANNELS],
+	    unsigned src_channels, unsigned dest_channels,
+	    ConstBuffer<typename Traits::value_type> src)
+{
+	assert(src.size % src_channels == 0);
+
+	const size_t n_frames = src.size / src_channels;
+	const size_t dest_size = n_frames * dest_channels;
+	auto dest = buffer.GetT<typename Traits::value_type>(dest_size);
+
+	/* collect the non-zero coefficients of each row */
+	unsigned n_terms[MAX_CHANNELS];
+	unsigned term_channels[MAX_CHANNELS][MAX_CHANNELS];
+	float term_factors[MAX_CHANNELS][MAX_CHANNELS];
+	for (unsigned i = 0; i < dest_channels; ++i) {
+		n_terms[i] = 0;
+		for (unsigned j = 0; j < src_channels; ++j) {
+			if (coefficients[i][j] != 0) {
+				term_channels[i][n_terms[i]] = j;
+				term_factors[i][n_terms[i]] = coefficients[i][j];
+				++n_terms[i];
+			}
+		}
+	}
+
+	const MatrixMulFunction mul = GetMatrixMulFunction();
+
+	alignas(32) MatrixPlanes in, out;
+
+	const auto *s = src.data;
+	auto *d = dest;
+	for (size_t position = 0; position < n_frames;) {
+		const unsigned n = std::min<size_t>(n_frames - position,
+						    MATRIX_BLOCK);
+
+		/* the kernels work on multiples of 8; the padding is
+		   never stored */
+		const unsigned n_padded = (n + 7) & ~7u;
+		if (n < n_padded)
+			for (unsigned c = 0; c < src_channels; ++c)
+				std::fill(in[c] + n, in[c] + n_padded, 0.0f);
+
+		Deinterleave(in, s, src_channels, n);
+
+		for (unsigned i = 0; i < dest_channels; ++i) {
+			if (n_terms[i] == 0) {
+				std::fill_n(out[i], n, 0.0f);
+				continue;
+			}
+
+			for (unsigned t = 0; t < n_terms[i]; ++t)
+				mul(out[i], in[term_channels[i][t]],
+				    term_factors[i][t], n_padded, t > 0);
+		}
+
+		Interleave<F, Traits>(d, out, dest_channels, n);
+
+		s += n * src_channels;
+		d += n * dest_channels;
+		position += n;
+	}
+
+	return { dest, dest_size };
+}
+
+template<SampleFormat F, class Traits=SampleTraits<F>>
+static ConstBuffer<void>
+ApplyMatrixVoid(PcmBuffer &buffer,
+		const float (&coefficients)[MAX_CHANNELS][MAX_CHANNELS],
+		unsigned src_channels, unsigned dest_channels,
+		ConstBuffer<void> src)
+{
+	return ApplyMatrix<F, Traits>(buffer, coefficients,
+				      src_channels, dest_channels,
+				      ConstBuffer<typename Traits::value_type>::FromVoid(src)).ToVoid();
+}
+
+ConstBuffer<void>
+PcmChannelMatrix::Apply(PcmBuffer &buffer, SampleFormat format,
+			ConstBuffer<void> src) const
+{
+	switch (format) {
+	case SampleFormat::UNDEFINED:
+	case SampleFormat::DSD:
+		assert(false);
+		gcc_unreachable();
+
+	case SampleFormat::S8:
+		return ApplyMatrixVoid<SampleFormat::S8>(buffer, coefficients,
+							 src_channels,
+							 dest_channels, src);
+
+	case SampleFormat::S16:
+		return ApplyMatrixVoid<SampleFormat::S16>(buffer, coefficients,
+							  src_channels,
+							  dest_channels, src);
+
+	case SampleFormat::S24_P32:
+		return ApplyMatrixVoid<SampleFormat::S24_P32>(buffer, coefficients,
+							      src_channels,
+							      dest_channels, src);
+
+	case SampleFormat::S32:
+		return ApplyMatrixVoid<SampleFormat::S32>(buffer, coefficients,
+							  src_channels,
+							  dest_channels, src);
+
+	case SampleFormat::FLOAT:
+		return ApplyMatrixVoid<SampleFormat::FLOAT>(buffer, coefficients,
+							    src_channels,
+							    dest_channels, src);
+	}
+
+	assert(false);
+	gcc_unreachable();
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_CHANNEL_MATRIX_HXX
+#define MPD_PCM_CHANNEL_MATRIX_HXX
+
+#include "AudioFormat.hxx"
+#include "Compiler.h"
+
+#include <assert.h>
+
+class PcmBuffer;
+template<typename T> struct ConstBuffer;
+
+/**
+ * A matrix which calculates each output channel as a weighted sum of
+ * the input channels.  This is used for downmixing surround sound to
+ * stereo, and for custom matrices in the "route" filter.
+ *
+ * The calculation is done in single precision floating point, with
+ * SIMD multiply-accumulate kernels; integer samples are rounded and
+ * clipped.
+ */
+class PcmChannelMatrix {
+	unsigned src_channels, dest_channels;
+
+	/**
+	 * One row per output channel, one column per input channel.
+	 */
+	float coefficients[MAX_CHANNELS][MAX_CHANNELS];
+
+public:
+	/**
+	 * Reset to a matrix of the given dimensions which has only
+	 * zero coefficients.
+	 */
+	void Clear(unsigned _src_channels, unsigned _dest_channels);
+
+	/**
+	 * Build the default matrix for converting between two
+	 * channel counts, assuming the FLAC/WAVE channel order.
+	 * Surround channels which are missing in the output are
+	 * folded into the remaining ones with the ITU-R BS.775
+	 * coefficients (center and surround at -3 dB, LFE dropped),
+	 * and the result is scaled so it cannot clip.  Upmixing
+	 * copies each channel to its counterpart and leaves the
+	 * other ones silent; a mono source goes to both front
+	 * channels.
+	 */
+	void SetDefault(unsigned _src_channels, unsigned _dest_channels);
+
+	unsigned GetSourceChannels() const {
+		return src_channels;
+	}
+
+	unsigned GetDestChannels() const {
+		return dest_channels;
+	}
+
+	float Get(unsigned dest, unsigned src) const {
+		assert(dest < dest_channels);
+		assert(src < src_channels);
+
+		return coefficients[dest][src];
+	}
+
+	void Set(unsigned dest, unsigned src, float value) {
+		assert(dest < dest_channels);
+		assert(src < src_channels);
+
+		coefficients[dest][src] = value;
+	}
+
+	/**
+	 * Scale all coefficients so that the sum of absolute
+	 * coefficients of each row is at most 1, i.e. no output can
+	 * clip.
+	 */
+	void Normalize();
+
+	/**
+	 * Apply the matrix.
+	 *
+	 * @param format the sample format; must not be
+	 * #SampleFormat::DSD
+	 * @return the destination buffer (allocated from #buffer)
+	 */
+	ConstBuffer<void> Apply(PcmBuffer &buffer, SampleFormat format,
+				ConstBuffer<void> src) const;
+};
+
+#endif
@@ -50,6 +50,12 @@ PcmChannelsConverter::Open(SampleFormat _format,
 	format = _format;
 	src_channels = _src_channels;
 	dest_channels = _dest_channels;
+
+	use_matrix = !(src_channels == 1 && dest_channels == 2) &&
+		!(src_channels == 2 && dest_channels == 1);
+	if (use_matrix)
+		matrix.SetDefault(src_channels, dest_channels);
+
 	return true;
 }
 
@@ -64,6 +70,9 @@ PcmChannelsConverter::Close()
 ConstBuffer<void>
 PcmChannelsConverter::Convert(ConstBuffer<void> src, gcc_unused Error &error)
 {
+	if (use_matrix)
+		return matrix.Apply(buffer, format, src);
+
 	switch (format) {
 	case SampleFormat::UNDEFINED:
 	case SampleFormat::S8:
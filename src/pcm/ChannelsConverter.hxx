@@ -23,6 +23,7 @@
 #include "check.h"
 #include "AudioFormat.hxx"
 #include "PcmBuffer.hxx"
+#include "ChannelMatrix.hxx"
 
 #ifndef NDEBUG
 #include <assert.h>
@@ -38,6 +39,18 @@ class PcmChannelsConverter {
 	SampleFormat format;
 	unsigned src_channels, dest_channels;
 
+	/**
+	 * Convert with #matrix instead of the simple mono/stereo
+	 * functions?
+	 */
+	bool use_matrix;
+
+	/**
+	 * The default matrix for this conversion, built once by
+	 * Open().
+	 */
+	PcmChannelMatrix matrix;
+
 	PcmBuffer buffer;
 
 public:
@@ -20,6 +20,8 @@
 #include "config.h"
 #include "ConfiguredResampler.hxx"
 #include "FallbackResampler.hxx"
+#include "SincResampler.hxx"
+#include "ThreadedResampler.hxx"
 #include "config/ConfigGlobal.hxx"
 #include "config/ConfigOption.hxx"
 #include "config/ConfigError.hxx"
@@ -35,10 +37,14 @@
 #include "SoxrResampler.hxx"
 #endif
 
+#include <algorithm>
+#include <thread>
+
 #include <string.h>
 
 enum class SelectedResampler {
 	FALLBACK,
+	SINC,
 
 #ifdef ENABLE_LIBSAMPLERATE
 	LIBSAMPLERATE,
@@ -49,7 +55,13 @@ enum class SelectedResampler {
 #endif
 };
 
-static SelectedResampler selected_resampler = SelectedResampler::FALLBACK;
+static SelectedResampler selected_resampler = SelectedResampler::SINC;
+
+/**
+ * The number of threads which split the channels among themselves;
+ * see #ThreadedPcmResampler.
+ */
+static unsigned resampler_threads = 1;
 
 static const ConfigBlock *
 MakeResamplerDefaultConfig(ConfigBlock &block)
@@ -130,33 +142,41 @@ GetResamplerConfig(ConfigBlock &buffer, Error &error)
 	return block;
 }
 
-bool
-pcm_resampler_global_init(Error &error)
+static bool
+SelectResampler(const ConfigBlock &block, Error &error)
 {
-	ConfigBlock buffer;
-	const auto *block = GetResamplerConfig(buffer, error);
-	if (block == nullptr)
-		return false;
-
-	const char *plugin_name = block->GetBlockValue("plugin");
+	const char *plugin_name = block.GetBlockValue("plugin");
 	if (plugin_name == nullptr) {
 		error.Format(config_domain,
-			     "'plugin' missing in line %d", block->line);
+			     "'plugin' missing in line %d", block.line);
 		return false;
 	}
 
 	if (strcmp(plugin_name, "internal") == 0) {
+		selected_resampler = SelectedResampler::SINC;
+
+		const char *quality = block.GetBlockValue("quality");
+		if (quality != nullptr &&
+		    !pcm_resample_sinc_set_quality(quality)) {
+			error.Format(config_domain,
+				     "unknown quality setting '%s' in line %d",
+				     quality, block.line);
+			return false;
+		}
+
+		return true;
+	} else if (strcmp(plugin_name, "fallback") == 0) {
 		selected_resampler = SelectedResampler::FALLBACK;
 		return true;
 #ifdef ENABLE_SOXR
 	} else if (strcmp(plugin_name, "soxr") == 0) {
 		selected_resampler = SelectedResampler::SOXR;
-		return pcm_resample_soxr_global_init(*block, error);
+		return pcm_resample_soxr_global_init(block, error);
 #endif
 #ifdef ENABLE_LIBSAMPLERATE
 	} else if (strcmp(plugin_name, "libsamplerate") == 0) {
 		selected_resampler = SelectedResampler::LIBSAMPLERATE;
-		return pcm_resample_lsr_global_init(*block, error);
+		return pcm_resample_lsr_global_init(block, error);
 #endif
 	} else {
 		error.Format(config_domain,
@@ -166,13 +186,41 @@ pcm_resampler_global_init(Error &error)
 	}
 }
 
-PcmResampler *
-pcm_resampler_create()
+bool
+pcm_resampler_global_init(Error &error)
+{
+	ConfigBlock buffer;
+	const auto *block = GetResamplerConfig(buffer, error);
+	if (block == nullptr)
+		return false;
+
+	if (!SelectResampler(*block, error))
+		return false;
+
+#ifdef ENABLE_SOXR
+	/* libsoxr interprets the "threads" setting itself */
+	if (selected_resampler == SelectedResampler::SOXR)
+		return true;
+#endif
+
+	resampler_threads = block->GetBlockValue("threads", 1u);
+	if (resampler_threads == 0)
+		resampler_threads =
+			std::max(std::thread::hardware_concurrency(), 1u);
+
+	return true;
+}
+
+static PcmResampler *
+CreateResampler()
 {
 	switch (selected_resampler) {
 	case SelectedResampler::FALLBACK:
 		return new FallbackPcmResampler();
 
+	case SelectedResampler::SINC:
+		return new SincPcmResampler();
+
 #ifdef ENABLE_LIBSAMPLERATE
 	case SelectedResampler::LIBSAMPLERATE:
 		return new LibsampleratePcmResampler();
@@ -186,3 +234,13 @@ pcm_resampler_create()
 
 	gcc_unreachable();
 }
+
+PcmResampler *
+pcm_resampler_create()
+{
+	if (resampler_threads > 1)
+		return new ThreadedPcmResampler(CreateResampler,
+						resampler_threads);
+
+	return CreateResampler();
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_CPU_FEATURES_HXX
+#define MPD_PCM_CPU_FEATURES_HXX
+
+#include "Compiler.h"
+
+/**
+ * Defined if the compiler can build AVX2 functions (with
+ * __attribute__((target("avx2")))) and dispatch to them at runtime.
+ */
+#if defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__)) && \
+	CLANG_OR_GCC_VERSION(4,9)
+#define HAVE_AVX2_DISPATCH
+#endif
+
+#ifdef HAVE_AVX2_DISPATCH
+
+/**
+ * Does the CPU this process runs on support AVX2?  The result is
+ * determined only once.
+ */
+gcc_pure
+bool
+CpuHasAvx2();
+
+#endif
+
+#endif
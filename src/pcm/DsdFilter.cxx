@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "DsdFilter.hxx"
+#include "Kaiser.hxx"
+#include "thread/Mutex.hxx"
+#include "util/bit_reverse.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef HAVE_AVX2_DISPATCH
+#include "Avx2.hxx"
+#endif
+
+#include <memory>
+
+#include <assert.h>
+
+/**
+ * The second half of the symmetric 96 tap lowpass filter of the
+ * dsd2pcm library.
+ */
+static constexpr double standard_taps[48] = {
+	0.09950731974056658,
+	0.09562845727714668,
+	0.08819647126516944,
+	0.07782552527068175,
+	0.06534876523171299,
+	0.05172629311427257,
+	0.0379429484910187,
+	0.02490921351762261,
+	0.0133774746265897,
+	0.003883043418804416,
+	-0.003284703416210726,
+	-0.008080250212687497,
+	-0.01067241812471033,
+	-0.01139427235000863,
+	-0.0106813877974587,
+	-0.009007905078766049,
+	-0.006828859761015335,
+	-0.004535184322001496,
+	-0.002425035959059578,
+	-0.0006922187080790708,
+	0.0005700762133516592,
+	0.001353838005269448,
+	0.001713709169690937,
+	0.001742046839472948,
+	0.001545601648013235,
+	0.001226696225277855,
+	0.0008704322683580222,
+	0.0005381636200535649,
+	0.000266446345425276,
+	7.002968738383528e-05,
+	-5.279407053811266e-05,
+	-0.0001140625650874684,
+	-0.0001304796361231895,
+	-0.0001189970287491285,
+	-9.396247155265073e-05,
+	-6.577634378272832e-05,
+	-4.07492895872535e-05,
+	-2.17407957554587e-05,
+	-9.163058931391722e-06,
+	-2.017460145032201e-06,
+	1.249721855219005e-06,
+	2.166655190537392e-06,
+	1.930520892991082e-06,
+	1.319400334374195e-06,
+	7.410039764949091e-07,
+	3.423230509967409e-07,
+	1.244182214744588e-07,
+	3.130441005359396e-08,
+};
+
+static constexpr unsigned STANDARD_TABLES = 6;
+
+/**
+ * Lookup tables for the standard filter.  #newer applies to the
+ * newer half of the filter (the last 6 bytes); #older to the older
+ * half, where dsd2pcm looks up bit-reversed bytes in the same tables;
+ * here, the reversal is part of the table.
+ */
+struct StandardTables {
+	float newer[STANDARD_TABLES][256];
+	float older[STANDARD_TABLES][256];
+
+	StandardTables() {
+		for (unsigned t = 0; t < STANDARD_TABLES; ++t) {
+			for (unsigned e = 0; e < 256; ++e) {
+				/* same order of operations as
+				   dsd2pcm's precalc() */
+				double acc = 0.0;
+				for (unsigned m = 0; m < 8; ++m)
+					acc += ((((e >> (7 - m)) & 1) * 2) - 1.) *
+						standard_taps[t * 8 + m];
+
+				newer[STANDARD_TABLES - 1 - t][e] = (float)acc;
+			}
+		}
+
+		for (unsigned t = 0; t < STANDARD_TABLES; ++t)
+			for (unsigned e = 0; e < 256; ++e)
+				older[t][e] = newer[t][bit_reverse(e)];
+	}
+};
+
+static const StandardTables &
+GetStandardTables()
+{
+	static const StandardTables tables;
+	return tables;
+}
+
+void
+DsdStandardFilterPortable(const uint8_t *src, unsigned channels, size_t n,
+			  float *dest)
+{
+	const auto &t = GetStandardTables();
+
+	for (size_t k = 0; k < n; ++k) {
+		/* the newest byte of this sample is at src[k +
+		   DSD_STANDARD_HISTORY * channels] */
+		double acc = 0;
+		for (unsigned i = 0; i < STANDARD_TABLES; ++i)
+			acc += t.newer[i][src[k + (DSD_STANDARD_HISTORY - i) * channels]] +
+				t.older[i][src[k + i * channels]];
+
+		dest[k] = (float)acc;
+	}
+}
+
+#ifdef __SSE2__
+
+void
+DsdStandardFilterSse2(const uint8_t *src, unsigned channels, size_t n,
+		      float *dest)
+{
+	const auto &t = GetStandardTables();
+
+	size_t k = 0;
+	for (; k + 4 <= n; k += 4) {
+		/* the pairs of table values are added in single
+		   precision and then accumulated in double precision,
+		   just like the portable implementation */
+		__m128d lo = _mm_setzero_pd(), hi = _mm_setzero_pd();
+
+		for (unsigned i = 0; i < STANDARD_TABLES; ++i) {
+			const uint8_t *a = src + k + (DSD_STANDARD_HISTORY - i) * channels;
+			const uint8_t *b = src + k + i * channels;
+			const float *ta = t.newer[i], *tb = t.older[i];
+
+			const __m128 s =
+				_mm_add_ps(_mm_setr_ps(ta[a[0]], ta[a[1]],
+						       ta[a[2]], ta[a[3]]),
+					   _mm_setr_ps(tb[b[0]], tb[b[1]],
+						       tb[b[2]], tb[b[3]]));
+			lo = _mm_add_pd(lo, _mm_cvtps_pd(s));
+			hi = _mm_add_pd(hi, _mm_cvtps_pd(_mm_movehl_ps(s, s)));
+		}
+
+		_mm_storeu_ps(dest + k, _mm_movelh_ps(_mm_cvtpd_ps(lo),
+						      _mm_cvtpd_ps(hi)));
+	}
+
+	DsdStandardFilterPortable(src + k, channels, n - k, dest + k);
+}
+
+#endif
+
+#ifdef HAVE_AVX2_DISPATCH
+
+gcc_target_avx2
+void
+DsdStandardFilterAvx2(const uint8_t *src, unsigned channels, size_t n,
+		      float *dest)
+{
+	const auto &t = GetStandardTables();
+
+	size_t k = 0;
+	for (; k + 8 <= n; k += 8) {
+		/* see DsdStandardFilterSse2() */
+		__m256d lo = _mm256_setzero_pd(), hi = _mm256_setzero_pd();
+
+		for (unsigned i = 0; i < STANDARD_TABLES; ++i) {
+			const uint8_t *a = src + k + (DSD_STANDARD_HISTORY - i) * channels;
+			const uint8_t *b = src + k + i * channels;
+
+			const __m256i ia =
+				_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)a));
+			const __m256i ib =
+				_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)b));
+
+			const __m256 s =
+				_mm256_add_ps(_mm256_i32gather_ps(t.newer[i], ia, 4),
+					      _mm256_i32gather_ps(t.older[i], ib, 4));
+			lo = _mm256_add_pd(lo, _mm256_cvtps_pd(_mm256_castps256_ps128(s)));
+			hi = _mm256_add_pd(hi, _mm256_cvtps_pd(_mm256_extractf128_ps(s, 1)));
+		}
+
+		_mm_storeu_ps(dest + k, _mm256_cvtpd_ps(lo));
+		_mm_storeu_ps(dest + k + 4, _mm256_cvtpd_ps(hi));
+	}
+
+	DsdStandardFilterPortable(src + k, channels, n - k, dest + k);
+}
+
+#endif
+
+void
+DsdStandardFilter(const uint8_t *src, unsigned channels, size_t n,
+		  float *dest)
+{
+#ifdef HAVE_AVX2_DISPATCH
+	if (CpuHasAvx2()) {
+		DsdStandardFilterAvx2(src, channels, n, dest);
+		return;
+	}
+#endif
+
+#ifdef __SSE2__
+	DsdStandardFilterSse2(src, channels, n, dest);
+#else
+	DsdStandardFilterPortable(src, channels, n, dest);
+#endif
+}
+
+/**
+ * Calculate the tables for #DsdHighQualityFilter.
+ */
+static std::unique_ptr<float[]>
+MakeHighQualityTables(unsigned decimation)
+{
+	/* Kaiser window parameter for about 120 dB */
+	constexpr double beta = 12;
+
+	const unsigned n_bytes = DsdHighQualityFilter::LENGTH * decimation;
+	const unsigned n_taps = n_bytes * 8;
+
+	/* the cutoff frequency is a quarter of the output sample
+	   rate; normalized to the DSD bit rate */
+	const double cutoff = 0.25 / (8 * decimation);
+
+	std::unique_ptr<double[]> taps(new double[n_taps]);
+	double sum = 0;
+	for (unsigned i = 0; i < n_taps; ++i) {
+		const double x = i - (n_taps - 1) / 2.;
+		taps[i] = KaiserSinc(x, (n_taps - 1) / 2., cutoff, beta);
+		sum += taps[i];
+	}
+
+	/* normalize the DC gain to 1 */
+	for (unsigned i = 0; i < n_taps; ++i)
+		taps[i] /= sum;
+
+	std::unique_ptr<float[]> tables(new float[n_bytes * 256]);
+	for (unsigned b = 0; b < n_bytes; ++b) {
+		for (unsigned e = 0; e < 256; ++e) {
+			/* the most significant bit is the oldest one */
+			double acc = 0;
+			for (unsigned m = 0; m < 8; ++m)
+				acc += ((e >> (7 - m)) & 1 ? 1. : -1.) *
+					taps[b * 8 + m];
+
+			tables[b * 256 + e] = (float)acc;
+		}
+	}
+
+	return tables;
+}
+
+/**
+ * Returns the (lazily calculated) tables for the given decimation
+ * factor.  They are never freed.
+ */
+static const float *
+GetHighQualityTables(unsigned decimation)
+{
+	static Mutex mutex;
+	static std::unique_ptr<float[]> cache[DsdHighQualityFilter::MAX_DECIMATION + 1];
+
+	assert(decimation > 0);
+	assert(decimation <= DsdHighQualityFilter::MAX_DECIMATION);
+
+	const ScopeLock protect(mutex);
+
+	auto &tables = cache[decimation];
+	if (!tables)
+		tables = MakeHighQualityTables(decimation);
+
+	return tables.get();
+}
+
+DsdHighQualityFilter::DsdHighQualityFilter(unsigned _decimation)
+	:tables(GetHighQualityTables(_decimation)),
+	 decimation(_decimation) {}
+
+unsigned
+DsdHighQualityFilter::GetDecimation(unsigned sample_rate)
+{
+	unsigned decimation = 1;
+	while (decimation < MAX_DECIMATION &&
+	       sample_rate % (2 * decimation) == 0 &&
+	       sample_rate / (2 * decimation) >= 352800)
+		decimation *= 2;
+
+	return decimation;
+}
+
+void
+DsdHighQualityFilter::Apply(const uint8_t *src, unsigned channels, size_t n,
+			    float *dest) const
+{
+	const unsigned n_bytes = LENGTH * decimation;
+	const size_t step = size_t(decimation) * channels;
+
+	for (size_t i = 0; i < n; ++i, src += step) {
+		for (unsigned c = 0; c < channels; ++c) {
+			const uint8_t *p = src + c;
+			const float *t = tables;
+
+			/* four independent sums to hide the latency
+			   of the additions */
+			float acc[4] = {0, 0, 0, 0};
+			for (unsigned b = 0; b < n_bytes; b += 4,
+				     p += 4 * channels, t += 4 * 256) {
+				acc[0] += t[p[0]];
+				acc[1] += t[256 + p[channels]];
+				acc[2] += t[512 + p[2 * channels]];
+				acc[3] += t[768 + p[3 * channels]];
+			}
+
+			*dest++ = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+		}
+	}
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_DSD_FILTER_HXX
+#define MPD_PCM_DSD_FILTER_HXX
+
+#include "CpuFeatures.hxx"
+#include "Compiler.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Table-driven FIR filters which convert DSD to PCM.  They operate
+ * on interleaved DSD bytes (most significant bit first) which are
+ * preceded by a number of "history" frames from the previous buffer,
+ * and they calculate all channels in one pass.
+ */
+
+/**
+ * The number of history frames needed by DsdStandardFilter().
+ */
+static constexpr unsigned DSD_STANDARD_HISTORY = 11;
+
+/**
+ * The filter of the dsd2pcm library: a 96 tap lowpass which is
+ * evaluated for every DSD byte, i.e. it decimates by 8.  The results
+ * are bit-exact with dsd2pcm_translate().  This chooses the fastest
+ * implementation this CPU supports.
+ *
+ * @param src #DSD_STANDARD_HISTORY frames of history followed by
+ * the input frames
+ * @param channels the number of interleaved channels
+ * @param n the number of output samples (input frames * channels)
+ * @param dest the destination buffer
+ */
+void
+DsdStandardFilter(const uint8_t *src, unsigned channels, size_t n,
+		  float *dest);
+
+void
+DsdStandardFilterPortable(const uint8_t *src, unsigned channels, size_t n,
+			  float *dest);
+
+#ifdef __SSE2__
+
+void
+DsdStandardFilterSse2(const uint8_t *src, unsigned channels, size_t n,
+		      float *dest);
+
+#endif
+
+#ifdef HAVE_AVX2_DISPATCH
+
+/**
+ * Must only be called if CpuHasAvx2() returns true.
+ */
+void
+DsdStandardFilterAvx2(const uint8_t *src, unsigned channels, size_t n,
+		      float *dest);
+
+#endif
+
+/**
+ * A Kaiser windowed sinc lowpass which decimates directly to 352.8
+ * or 384 kHz.  It spans #LENGTH output sample periods and has more
+ * than 100 dB stopband rejection above 3/8 of the output sample rate.
+ *
+ * Only one output sample is calculated per #decimation DSD bytes,
+ * which leaves less work for the resampler which follows it.
+ */
+class DsdHighQualityFilter {
+	/**
+	 * One table of 256 partial sums for each DSD byte within the
+	 * filter, the oldest one first.  They are shared by all
+	 * instances with the same #decimation.
+	 */
+	const float *tables;
+
+	unsigned decimation;
+
+public:
+	/**
+	 * The filter length in output sample periods.
+	 */
+	static constexpr unsigned LENGTH = 32;
+
+	static constexpr unsigned MAX_DECIMATION = 16;
+
+	explicit DsdHighQualityFilter(unsigned _decimation);
+
+	/**
+	 * Determine the decimation factor (in DSD bytes) for the
+	 * given DSD sample rate (in bytes per second), which results
+	 * in an output sample rate of 352.8 or 384 kHz.  Returns 1 for
+	 * DSD64 and unusual sample rates.
+	 */
+	gcc_const
+	static unsigned GetDecimation(unsigned sample_rate);
+
+	unsigned GetDecimation() const {
+		return decimation;
+	}
+
+	/**
+	 * The number of history frames needed by Apply().
+	 */
+	unsigned GetHistory() const {
+		return LENGTH * decimation - 1;
+	}
+
+	/**
+	 * @param src the history and input frames; the first output
+	 * sample is calculated from the first GetHistory()+1 frames,
+	 * the next one starts #decimation frames later
+	 * @param channels the number of interleaved channels
+	 * @param n the number of output frames
+	 * @param dest the destination buffer (n * channels samples)
+	 */
+	void Apply(const uint8_t *src, unsigned channels, size_t n,
+		   float *dest) const;
+};
+
+#endif
@@ -0,0 +1,392 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "ExportKernels.hxx"
+#include "CpuFeatures.hxx"
+#include "system/ByteOrder.hxx"
+#include "util/ConstBuffer.hxx"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef HAVE_AVX2_DISPATCH
+#include "Avx2.hxx"
+#endif
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * DoP markers; they alternate from frame to frame.
+ */
+static constexpr uint32_t DOP_MARKER1 = 0xff050000;
+static constexpr uint32_t DOP_MARKER2 = 0xfffa0000;
+
+/**
+ * Store one 32 bit sample after applying the shift8, pack24 and
+ * reverse_endian options.
+ */
+template<bool Shift8, bool Pack24, bool Reverse>
+static inline uint8_t *
+StoreSample32(uint8_t *dest, uint32_t value)
+{
+	if (Shift8)
+		value <<= 8;
+
+	if (Pack24) {
+		if (IsLittleEndian() != Reverse) {
+			dest[0] = value;
+			dest[1] = value >> 8;
+			dest[2] = value >> 16;
+		} else {
+			dest[0] = value >> 16;
+			dest[1] = value >> 8;
+			dest[2] = value;
+		}
+
+		return dest + 3;
+	}
+
+	if (Reverse)
+		value = ByteSwap32(value);
+
+	memcpy(dest, &value, sizeof(value));
+	return dest + sizeof(value);
+}
+
+/**
+ * The portable implementation.  It specifies the results of the SIMD
+ * kernels and processes the remainder of the buffer.
+ *
+ * @param n the number of samples, or the number of destination
+ * frames for DoP
+ * @param dop_odd is the first DoP frame an odd frame?
+ */
+template<bool Dop, bool Shift8, bool Pack24, bool Reverse>
+static uint8_t *
+PortableExport32(uint8_t *dest, const uint8_t *src, size_t n,
+		 unsigned channels, bool dop_odd)
+{
+	if (Dop) {
+		for (size_t i = 0; i != n; ++i) {
+			const uint32_t marker = (i % 2 == 0) != dop_odd
+				? DOP_MARKER1
+				: DOP_MARKER2;
+
+			/* each 24 bit sample has 16 DSD sample bits
+			   plus the marker */
+			for (unsigned c = 0; c != channels; ++c) {
+				const uint32_t value = marker |
+					(src[c] << 8) | src[channels + c];
+				dest = StoreSample32<Shift8, Pack24,
+						     Reverse>(dest, value);
+			}
+
+			src += 2 * channels;
+		}
+	} else {
+		const uint32_t *src32 = (const uint32_t *)src;
+		for (size_t i = 0; i != n; ++i)
+			dest = StoreSample32<Shift8, Pack24, Reverse>(dest,
+								      src32[i]);
+	}
+
+	return dest;
+}
+
+#ifdef __SSE2__
+
+static inline __m128i
+Sse2ByteSwap16(__m128i v)
+{
+	return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+static inline __m128i
+Sse2ByteSwap32(__m128i v)
+{
+	/* swap the bytes in each 16 bit word, then the words */
+	v = Sse2ByteSwap16(v);
+	return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1);
+}
+
+/**
+ * SSE2 has no byte shuffle, therefore this kernel only implements
+ * shift8 and reverse_endian on 32 bit samples.
+ *
+ * @param n the number of samples; must be a multiple of 4
+ */
+template<bool Shift8, bool Reverse>
+static void
+Sse2Export32(uint8_t *dest, const uint8_t *src, size_t n)
+{
+	for (size_t i = 0; i != n; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(src + 4 * i));
+		if (Shift8)
+			v = _mm_slli_epi32(v, 8);
+		if (Reverse)
+			v = Sse2ByteSwap32(v);
+		_mm_storeu_si128((__m128i *)(dest + 4 * i), v);
+	}
+}
+
+#endif
+
+#ifdef HAVE_AVX2_DISPATCH
+
+/**
+ * The byte shuffle which implements pack24 and reverse_endian on
+ * eight 32 bit samples (within each 128 bit lane).
+ */
+template<bool Pack24, bool Reverse>
+gcc_target_avx2
+static inline __m256i
+Avx2ExportShuffle()
+{
+	if (Pack24 && Reverse)
+		return _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+					14, 13, 12, -1, -1, -1, -1,
+					2, 1, 0, 6, 5, 4, 10, 9, 8,
+					14, 13, 12, -1, -1, -1, -1);
+	else if (Pack24)
+		return _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10,
+					12, 13, 14, -1, -1, -1, -1,
+					0, 1, 2, 4, 5, 6, 8, 9, 10,
+					12, 13, 14, -1, -1, -1, -1);
+	else
+		return _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+					11, 10, 9, 8, 15, 14, 13, 12,
+					3, 2, 1, 0, 7, 6, 5, 4,
+					11, 10, 9, 8, 15, 14, 13, 12);
+}
+
+/**
+ * Store eight 32 bit samples.  With pack24, this writes 4 bytes of
+ * garbage after the 24 bytes of output.
+ */
+template<bool Shift8, bool Pack24, bool Reverse>
+gcc_target_avx2
+static inline uint8_t *
+Avx2Store8(uint8_t *dest, __m256i v)
+{
+	if (Shift8)
+		v = _mm256_slli_epi32(v, 8);
+
+	if (Pack24 || Reverse)
+		v = _mm256_shuffle_epi8(v,
+					Avx2ExportShuffle<Pack24, Reverse>());
+
+	if (Pack24) {
+		_mm_storeu_si128((__m128i *)dest,
+				 _mm256_castsi256_si128(v));
+		_mm_storeu_si128((__m128i *)(dest + 12),
+				 _mm256_extracti128_si256(v, 1));
+		return dest + 24;
+	}
+
+	_mm256_storeu_si256((__m256i *)dest, v);
+	return dest + 32;
+}
+
+/**
+ * @param n the number of samples (a multiple of 8), or the number of
+ * stereo destination frames for DoP (a multiple of 4)
+ * @param dop_odd is the first DoP frame an odd frame?
+ */
+template<bool Dop, bool Shift8, bool Pack24, bool Reverse>
+gcc_target_avx2
+static uint8_t *
+Avx2Export32(uint8_t *dest, const uint8_t *src, size_t n, bool dop_odd)
+{
+	if (Dop) {
+		/* 16 bytes of stereo DSD become 4 DoP frames; move
+		   the two bytes of each sample to bits 8-15 and
+		   0-7 */
+		const __m256i order =
+			_mm256_setr_epi8(2, 0, -1, -1, 3, 1, -1, -1,
+					 6, 4, -1, -1, 7, 5, -1, -1,
+					 10, 8, -1, -1, 11, 9, -1, -1,
+					 14, 12, -1, -1, 15, 13, -1, -1);
+		const uint32_t m1 = dop_odd ? DOP_MARKER2 : DOP_MARKER1;
+		const uint32_t m2 = dop_odd ? DOP_MARKER1 : DOP_MARKER2;
+		const __m256i markers =
+			_mm256_setr_epi32(m1, m1, m2, m2, m1, m1, m2, m2);
+
+		for (size_t i = 0; i != n; i += 4, src += 16) {
+			const __m256i x = _mm256_broadcastsi128_si256(
+				_mm_loadu_si128((const __m128i *)src));
+			const __m256i v =
+				_mm256_or_si256(_mm256_shuffle_epi8(x, order),
+						markers);
+			dest = Avx2Store8<Shift8, Pack24, Reverse>(dest, v);
+		}
+	} else {
+		for (size_t i = 0; i != n; i += 8, src += 32) {
+			const __m256i v =
+				_mm256_loadu_si256((const __m256i *)src);
+			dest = Avx2Store8<Shift8, Pack24, Reverse>(dest, v);
+		}
+	}
+
+	return dest;
+}
+
+gcc_target_avx2
+static void
+Avx2ByteSwap16(uint16_t *dest, const uint16_t *src, size_t n)
+{
+	for (size_t i = 0; i != n; i += 16) {
+		const __m256i v =
+			_mm256_loadu_si256((const __m256i *)(src + i));
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_or_si256(_mm256_slli_epi16(v, 8),
+						    _mm256_srli_epi16(v, 8)));
+	}
+}
+
+#endif
+
+template<bool Dop, bool Shift8, bool Pack24, bool Reverse>
+static size_t
+Export32(void *_dest, ConstBuffer<void> _src, unsigned channels,
+	 bool &dop_odd)
+{
+	const auto src = ConstBuffer<uint8_t>::FromVoid(_src);
+	uint8_t *const dest0 = (uint8_t *)_dest, *dest = dest0;
+	const uint8_t *s = src.data;
+
+	size_t n;
+	if (Dop) {
+		assert(src.size % channels == 0);
+
+		/* this rounds down and discards the last odd DSD
+		   frame */
+		n = src.size / channels / 2;
+	} else {
+		assert(src.size % 4 == 0);
+
+		n = src.size / 4;
+	}
+
+#ifdef HAVE_AVX2_DISPATCH
+	if (CpuHasAvx2()) {
+		const size_t n1 = Dop
+			? (channels == 2 ? n - n % 4 : 0)
+			: n - n % 8;
+		/* n1 is even, which keeps the DoP marker phase */
+		dest = Avx2Export32<Dop, Shift8, Pack24, Reverse>(dest, s, n1,
+								  dop_odd);
+		s += Dop ? n1 * 2 * channels : n1 * 4;
+		n -= n1;
+	}
+#endif
+
+#ifdef __SSE2__
+	if (!Dop && !Pack24) {
+		const size_t n1 = n - n % 4;
+		Sse2Export32<Shift8, Reverse>(dest, s, n1);
+		dest += n1 * 4;
+		s += n1 * 4;
+		n -= n1;
+	}
+#endif
+
+	dest = PortableExport32<Dop, Shift8, Pack24, Reverse>(dest, s, n,
+							      channels,
+							      dop_odd);
+	if (Dop && n % 2 != 0)
+		dop_odd = !dop_odd;
+
+	return dest - dest0;
+}
+
+static size_t
+ExportReverse16(void *_dest, ConstBuffer<void> _src,
+		gcc_unused unsigned channels, gcc_unused bool &dop_odd)
+{
+	const auto src = ConstBuffer<uint16_t>::FromVoid(_src);
+	uint16_t *dest = (uint16_t *)_dest;
+	const size_t n = src.size;
+	size_t i = 0;
+
+#ifdef HAVE_AVX2_DISPATCH
+	if (CpuHasAvx2()) {
+		i = n - n % 16;
+		Avx2ByteSwap16(dest, src.data, i);
+	}
+#endif
+
+#ifdef __SSE2__
+	for (; i + 8 <= n; i += 8) {
+		const __m128i v =
+			_mm_loadu_si128((const __m128i *)(src.data + i));
+		_mm_storeu_si128((__m128i *)(dest + i), Sse2ByteSwap16(v));
+	}
+#endif
+
+	for (; i != n; ++i)
+		dest[i] = ByteSwap16(src[i]);
+
+	return n * sizeof(*dest);
+}
+
+template<bool Dop, bool Shift8, bool Pack24>
+static PcmExportKernel
+SelectExport32(bool reverse)
+{
+	return reverse
+		? Export32<Dop, Shift8, Pack24, true>
+		: Export32<Dop, Shift8, Pack24, false>;
+}
+
+template<bool Dop>
+static PcmExportKernel
+SelectExport32(bool shift8, bool pack24, bool reverse)
+{
+	if (pack24)
+		return SelectExport32<Dop, false, true>(reverse);
+	else if (shift8)
+		return SelectExport32<Dop, true, false>(reverse);
+	else
+		return SelectExport32<Dop, false, false>(reverse);
+}
+
+PcmExportKernel
+PcmSelectExportKernel(bool dop, bool shift8, bool pack24,
+		      unsigned reverse_endian)
+{
+	assert(!shift8 || !pack24);
+
+	if (dop)
+		return SelectExport32<true>(shift8, pack24,
+					    reverse_endian > 0);
+
+	if (shift8 || pack24 || reverse_endian == 4)
+		return SelectExport32<false>(shift8, pack24,
+					     reverse_endian > 0);
+
+	if (reverse_endian == 2)
+		return ExportReverse16;
+
+	assert(reverse_endian == 0);
+	return nullptr;
+}
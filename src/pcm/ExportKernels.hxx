@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_EXPORT_KERNELS_HXX
+#define MPD_PCM_EXPORT_KERNELS_HXX
+
+#include "Compiler.h"
+
+#include <stddef.h>
+
+template<typename T> struct ConstBuffer;
+
+/**
+ * The number of bytes a #PcmExportKernel may write past the end of
+ * its output.  The SIMD kernels store whole vectors even when
+ * packing 24 bit samples; the caller must allocate this much extra
+ * space.
+ */
+static constexpr size_t PCM_EXPORT_KERNEL_PADDING = 32;
+
+/**
+ * A function which applies all enabled #PcmExport options (DoP,
+ * shift8, pack24 and reverse_endian) in one pass.
+ *
+ * @param dest the destination buffer; it must be large enough for
+ * the output plus #PCM_EXPORT_KERNEL_PADDING
+ * @param src the source buffer (DSD bytes if DoP is enabled,
+ * otherwise 16 or 32 bit samples)
+ * @param channels the number of channels; only used for DoP
+ * @param dop_odd is the next DoP frame an odd frame (i.e. does it
+ * get the second marker)?  DoP kernels update it, so the markers
+ * alternate across calls.
+ * @return the number of bytes written to #dest
+ */
+typedef size_t (*PcmExportKernel)(void *dest, ConstBuffer<void> src,
+				  unsigned channels, bool &dop_odd);
+
+/**
+ * Choose the kernel for the given combination of options.  Each
+ * combination is a separate template instance, so the per-sample
+ * loop contains no run-time option checks.
+ *
+ * @param dop convert DSD to DoP
+ * @param shift8 shift 24 bit samples 8 bits to the left
+ * @param pack24 pack 24 bit samples to 3 bytes
+ * @param reverse_endian the sample size if the byte order shall be
+ * reversed (2, 3 or 4), 0 otherwise
+ * @return the kernel, or nullptr if there is nothing to do
+ */
+gcc_const
+PcmExportKernel
+PcmSelectExportKernel(bool dop, bool shift8, bool pack24,
+		      unsigned reverse_endian);
+
+#endif
@@ -0,0 +1,467 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "FusedGain.hxx"
+#include "Domain.hxx"
+#include "Traits.hxx"
+#include "util/ConstBuffer.hxx"
+#include "util/Error.hxx"
+
+#ifdef __SSE2__
+#include "Sse2Volume.hxx"
+#include "CpuFeatures.hxx"
+#ifdef HAVE_AVX2_DISPATCH
+#include "Avx2Volume.hxx"
+#endif
+#endif
+
+#include <algorithm>
+
+#include <assert.h>
+#include <math.h>
+
+/**
+ * How a sample format is handled by the fused kernels.
+ */
+template<SampleFormat F, class Traits=SampleTraits<F>>
+struct FusedFormat {
+	typedef typename Traits::value_type value_type;
+
+	static constexpr bool IS_FLOAT = false;
+
+	/**
+	 * Dither the output?  Samples with more bits are beyond the
+	 * precision of the float calculation.
+	 */
+	static constexpr bool DITHER = Traits::BITS <= 24;
+
+	static constexpr float MIN = Traits::MIN;
+
+	/**
+	 * The largest float which can be converted to this format;
+	 * float(INT32_MAX) would round up and overflow.
+	 */
+	static constexpr float MAX = Traits::BITS < 32
+		? float(Traits::MAX)
+		: 2147483520.f;
+};
+
+template<>
+struct FusedFormat<SampleFormat::FLOAT> {
+	typedef float value_type;
+
+	static constexpr bool IS_FLOAT = true;
+	static constexpr bool DITHER = false;
+};
+
+/**
+ * The sample value which represents full scale.
+ */
+gcc_const
+static float
+GetFullScale(SampleFormat format)
+{
+	switch (format) {
+	case SampleFormat::UNDEFINED:
+	case SampleFormat::DSD:
+		break;
+
+	case SampleFormat::S8:
+		return SampleTraits<SampleFormat::S8>::MAX + 1;
+
+	case SampleFormat::S16:
+		return SampleTraits<SampleFormat::S16>::MAX + 1;
+
+	case SampleFormat::S24_P32:
+		return SampleTraits<SampleFormat::S24_P32>::MAX + 1;
+
+	case SampleFormat::S32:
+		return SampleTraits<SampleFormat::S32>::MAX + 1.f;
+
+	case SampleFormat::FLOAT:
+		return 1;
+	}
+
+	assert(false);
+	gcc_unreachable();
+}
+
+/**
+ * Return the next dither value of the given lane: triangular noise
+ * between -1 and +1 LSB.  The SIMD kernels use the same bits of the
+ * same random number generator.
+ */
+static inline float
+NextDither(PcmVectorDither &dither, unsigned lane)
+{
+	return float(dither.Next<16>(lane)) * (1.0f / 65536);
+}
+
+template<SampleFormat F, bool IS_FLOAT=FusedFormat<F>::IS_FLOAT>
+struct PortableFusedStore {
+	typedef FusedFormat<F> Format;
+
+	static typename Format::value_type Store(PcmVectorDither &dither,
+						 float x, unsigned lane) {
+		if (Format::DITHER)
+			x += NextDither(dither, lane);
+
+		const float min = Format::MIN, max = Format::MAX;
+		return lrintf(std::min(std::max(x, min), max));
+	}
+};
+
+template<SampleFormat F>
+struct PortableFusedStore<F, true> {
+	static float Store(PcmVectorDither &, float x, unsigned) {
+		return x;
+	}
+};
+
+/**
+ * The portable implementation.  It processes the remainder of a
+ * buffer which is not a multiple of the SIMD block size, and it
+ * specifies the results of the SIMD kernels.
+ */
+template<SampleFormat SF, SampleFormat DF>
+static void
+PortableFusedGain(PcmVectorDither &dither,
+		  typename FusedFormat<DF>::value_type *dest,
+		  const typename FusedFormat<SF>::value_type *src,
+		  size_t n, float factor)
+{
+	for (size_t i = 0; i != n; ++i)
+		dest[i] = PortableFusedStore<DF>::Store(dither,
+							float(src[i]) * factor,
+							i % PcmVectorDither::LANES);
+}
+
+#ifdef __SSE2__
+
+template<typename T>
+static inline void
+Sse2LoadFloat16(__m128 x[4], const T *src)
+{
+	__m128i v[4];
+	Sse2Load16(v, src);
+
+	for (unsigned i = 0; i < 4; ++i)
+		x[i] = _mm_cvtepi32_ps(v[i]);
+}
+
+static inline void
+Sse2LoadFloat16(__m128 x[4], const float *src)
+{
+	for (unsigned i = 0; i < 4; ++i)
+		x[i] = _mm_loadu_ps(src + 4 * i);
+}
+
+/**
+ * The dither values of four lanes; see NextDither().
+ */
+static inline __m128
+Sse2NextFloatDither(__m128i &state)
+{
+	/* Sse2NextDither() includes a rounding offset, which is not
+	   needed here because the conversion rounds */
+	const __m128i d = _mm_sub_epi32(Sse2NextDither<16>(state),
+					_mm_set1_epi32(1 << 15));
+	return _mm_mul_ps(_mm_cvtepi32_ps(d), _mm_set1_ps(1.0f / 65536));
+}
+
+template<SampleFormat F, bool IS_FLOAT=FusedFormat<F>::IS_FLOAT>
+struct Sse2FusedStore {
+	typedef FusedFormat<F> Format;
+
+	static void Store(typename Format::value_type *dest, __m128 x[4],
+			  __m128i state[2]) {
+		const __m128 min = _mm_set1_ps(Format::MIN);
+		const __m128 max = _mm_set1_ps(Format::MAX);
+
+		__m128i v[4];
+		for (unsigned i = 0; i < 4; ++i) {
+			/* samples 0-3 and 8-11 are in lanes 0-3,
+			   samples 4-7 and 12-15 in lanes 4-7 */
+			if (Format::DITHER)
+				x[i] = _mm_add_ps(x[i],
+						  Sse2NextFloatDither(state[i % 2]));
+
+			x[i] = _mm_min_ps(_mm_max_ps(x[i], min), max);
+			v[i] = _mm_cvtps_epi32(x[i]);
+		}
+
+		Sse2Store16(dest, v);
+	}
+};
+
+template<SampleFormat F>
+struct Sse2FusedStore<F, true> {
+	static void Store(float *dest, __m128 x[4], __m128i *) {
+		for (unsigned i = 0; i < 4; ++i)
+			_mm_storeu_ps(dest + 4 * i, x[i]);
+	}
+};
+
+/**
+ * @param n the number of samples; must be a multiple of 16
+ */
+template<SampleFormat SF, SampleFormat DF>
+static void
+Sse2FusedGain(PcmVectorDither &dither,
+	      typename FusedFormat<DF>::value_type *dest,
+	      const typename FusedFormat<SF>::value_type *src,
+	      size_t n, float factor)
+{
+	const __m128 f = _mm_set1_ps(factor);
+
+	__m128i state[2];
+	Sse2LoadDither(state, dither);
+
+	for (size_t i = 0; i != n; i += 16) {
+		__m128 x[4];
+		Sse2LoadFloat16(x, src + i);
+
+		for (unsigned j = 0; j < 4; ++j)
+			x[j] = _mm_mul_ps(x[j], f);
+
+		Sse2FusedStore<DF>::Store(dest + i, x, state);
+	}
+
+	Sse2StoreDither(dither, state);
+}
+
+#ifdef HAVE_AVX2_DISPATCH
+
+template<typename T>
+gcc_target_avx2
+static inline void
+Avx2LoadFloat32(__m256 x[4], const T *src)
+{
+	__m256i v[4];
+	Avx2Load32(v, src);
+
+	for (unsigned i = 0; i < 4; ++i)
+		x[i] = _mm256_cvtepi32_ps(v[i]);
+}
+
+gcc_target_avx2
+static inline void
+Avx2LoadFloat32(__m256 x[4], const float *src)
+{
+	for (unsigned i = 0; i < 4; ++i)
+		x[i] = _mm256_loadu_ps(src + 8 * i);
+}
+
+gcc_target_avx2
+static inline __m256
+Avx2NextFloatDither(__m256i &state)
+{
+	const __m256i d = _mm256_sub_epi32(Avx2NextDither<16>(state),
+					   _mm256_set1_epi32(1 << 15));
+	return _mm256_mul_ps(_mm256_cvtepi32_ps(d),
+			     _mm256_set1_ps(1.0f / 65536));
+}
+
+template<SampleFormat F, bool IS_FLOAT=FusedFormat<F>::IS_FLOAT>
+struct Avx2FusedStore {
+	typedef FusedFormat<F> Format;
+
+	gcc_target_avx2
+	static void Store(typename Format::value_type *dest, __m256 x[4],
+			  __m256i &state) {
+		const __m256 min = _mm256_set1_ps(Format::MIN);
+		const __m256 max = _mm256_set1_ps(Format::MAX);
+
+		__m256i v[4];
+		for (unsigned i = 0; i < 4; ++i) {
+			if (Format::DITHER)
+				x[i] = _mm256_add_ps(x[i],
+						     Avx2NextFloatDither(state));
+
+			x[i] = _mm256_min_ps(_mm256_max_ps(x[i], min), max);
+			v[i] = _mm256_cvtps_epi32(x[i]);
+		}
+
+		Avx2Store32(dest, v);
+	}
+};
+
+template<SampleFormat F>
+struct Avx2FusedStore<F, true> {
+	gcc_target_avx2
+	static void Store(float *dest, __m256 x[4], __m256i &) {
+		for (unsigned i = 0; i < 4; ++i)
+			_mm256_storeu_ps(dest + 8 * i, x[i]);
+	}
+};
+
+/**
+ * @param n the number of samples; must be a multiple of 32
+ */
+template<SampleFormat SF, SampleFormat DF>
+gcc_target_avx2
+static void
+Avx2FusedGain(PcmVectorDither &dither,
+	      typename FusedFormat<DF>::value_type *dest,
+	      const typename FusedFormat<SF>::value_type *src,
+	      size_t n, float factor)
+{
+	const __m256 f = _mm256_set1_ps(factor);
+
+	__m256i state = _mm256_loadu_si256((const __m256i *)dither.random);
+
+	for (size_t i = 0; i != n; i += 32) {
+		__m256 x[4];
+		Avx2LoadFloat32(x, src + i);
+
+		for (unsigned j = 0; j < 4; ++j)
+			x[j] = _mm256_mul_ps(x[j], f);
+
+		Avx2FusedStore<DF>::Store(dest + i, x, state);
+	}
+
+	_mm256_storeu_si256((__m256i *)dither.random, state);
+}
+
+#endif
+
+#endif
+
+/**
+ * Run the best SIMD kernel this CPU supports on all whole blocks,
+ * and the portable implementation on the rest.
+ */
+template<SampleFormat SF, SampleFormat DF>
+static void
+FusedGainKernel(PcmVectorDither &dither, void *_dest, const void *_src,
+		size_t n, float factor)
+{
+	auto *dest = (typename FusedFormat<DF>::value_type *)_dest;
+	auto *src = (const typename FusedFormat<SF>::value_type *)_src;
+
+#ifdef __SSE2__
+#ifdef HAVE_AVX2_DISPATCH
+	if (CpuHasAvx2()) {
+		const size_t n1 = n - n % 32;
+		Avx2FusedGain<SF, DF>(dither, dest, src, n1, factor);
+		dest += n1;
+		src += n1;
+		n -= n1;
+	}
+#endif
+
+	const size_t n1 = n - n % 16;
+	Sse2FusedGain<SF, DF>(dither, dest, src, n1, factor);
+	dest += n1;
+	src += n1;
+	n -= n1;
+#endif
+
+	PortableFusedGain<SF, DF>(dither, dest, src, n, factor);
+}
+
+template<SampleFormat SF>
+static PcmFusedGain::Kernel
+SelectKernel(SampleFormat dest_format)
+{
+	switch (dest_format) {
+	case SampleFormat::UNDEFINED:
+	case SampleFormat::DSD:
+		break;
+
+	case SampleFormat::S8:
+		return FusedGainKernel<SF, SampleFormat::S8>;
+
+	case SampleFormat::S16:
+		return FusedGainKernel<SF, SampleFormat::S16>;
+
+	case SampleFormat::S24_P32:
+		return FusedGainKernel<SF, SampleFormat::S24_P32>;
+
+	case SampleFormat::S32:
+		return FusedGainKernel<SF, SampleFormat::S32>;
+
+	case SampleFormat::FLOAT:
+		return FusedGainKernel<SF, SampleFormat::FLOAT>;
+	}
+
+	return nullptr;
+}
+
+static PcmFusedGain::Kernel
+SelectKernel(SampleFormat src_format, SampleFormat dest_format)
+{
+	switch (src_format) {
+	case SampleFormat::UNDEFINED:
+	case SampleFormat::DSD:
+		break;
+
+	case SampleFormat::S8:
+		return SelectKernel<SampleFormat::S8>(dest_format);
+
+	case SampleFormat::S16:
+		return SelectKernel<SampleFormat::S16>(dest_format);
+
+	case SampleFormat::S24_P32:
+		return SelectKernel<SampleFormat::S24_P32>(dest_format);
+
+	case SampleFormat::S32:
+		return SelectKernel<SampleFormat::S32>(dest_format);
+
+	case SampleFormat::FLOAT:
+		return SelectKernel<SampleFormat::FLOAT>(dest_format);
+	}
+
+	return nullptr;
+}
+
+bool
+PcmFusedGain::Open(SampleFormat _src_format, SampleFormat _dest_format,
+		   Error &error)
+{
+	assert(!IsOpen());
+
+	kernel = SelectKernel(_src_format, _dest_format);
+	if (kernel == nullptr) {
+		error.Format(pcm_domain,
+			     "Software gain from %s to %s is not implemented",
+			     sample_format_to_string(_src_format),
+			     sample_format_to_string(_dest_format));
+		return false;
+	}
+
+	src_format = _src_format;
+	dest_format = _dest_format;
+	format_factor = GetFullScale(dest_format) / GetFullScale(src_format);
+	return true;
+}
+
+ConstBuffer<void>
+PcmFusedGain::Apply(ConstBuffer<void> src, float gain)
+{
+	assert(IsOpen());
+
+	const size_t n = src.size / sample_format_size(src_format);
+	const size_t dest_size = n * sample_format_size(dest_format);
+	void *dest = buffer.Get(dest_size);
+
+	kernel(dither, dest, src.data, n, gain * format_factor);
+	return { dest, dest_size };
+}
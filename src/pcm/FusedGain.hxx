@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_FUSED_GAIN_HXX
+#define MPD_PCM_FUSED_GAIN_HXX
+
+#include "AudioFormat.hxx"
+#include "PcmBuffer.hxx"
+#include "VectorDither.hxx"
+
+#include <stddef.h>
+
+class Error;
+template<typename T> struct ConstBuffer;
+
+/**
+ * Applies a gain and converts to another sample format in one pass.
+ * This replaces a chain of #PcmVolume instances (e.g. replay gain and
+ * software volume) followed by a sample format conversion, each of
+ * which would round and dither on its own.
+ *
+ * Samples are multiplied in single precision floating point, and
+ * they are rounded only once, when they are stored in the
+ * destination format.  Integer formats up to 24 bit are dithered
+ * with triangular noise of one LSB (#PcmVectorDither), and the
+ * result is clipped.
+ */
+class PcmFusedGain {
+public:
+	typedef void (*Kernel)(PcmVectorDither &dither,
+			       void *dest, const void *src, size_t n,
+			       float factor);
+
+private:
+	SampleFormat src_format, dest_format;
+
+	Kernel kernel;
+
+	/**
+	 * The factor which converts a sample value of #src_format to
+	 * a sample value of #dest_format.
+	 */
+	float format_factor;
+
+	PcmBuffer buffer;
+	PcmVectorDither dither;
+
+public:
+	PcmFusedGain()
+		:src_format(SampleFormat::UNDEFINED) {}
+
+	bool IsOpen() const {
+		return src_format != SampleFormat::UNDEFINED;
+	}
+
+	/**
+	 * Opens the object, prepare for Apply().
+	 *
+	 * @param src_format the sample format of the input
+	 * @param dest_format the sample format of the output
+	 * @param error location to store the error
+	 * @return true on success
+	 */
+	bool Open(SampleFormat src_format, SampleFormat dest_format,
+		  Error &error);
+
+	/**
+	 * Closes the object.  After that, you may call Open() again.
+	 */
+	void Close() {
+		src_format = SampleFormat::UNDEFINED;
+	}
+
+	/**
+	 * Multiply all samples by the given gain and convert them to
+	 * the destination format.
+	 *
+	 * @param gain the linear gain (1.0 = unchanged)
+	 * @return the destination buffer (allocated from an internal
+	 * #PcmBuffer)
+	 */
+	ConstBuffer<void> Apply(ConstBuffer<void> src, float gain);
+};
+
+#endif
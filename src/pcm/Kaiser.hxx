@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_KAISER_HXX
+#define MPD_PCM_KAISER_HXX
+
+#include "Compiler.h"
+
+#include <math.h>
+
+/**
+ * The modified Bessel function of the first kind, order 0, for the
+ * Kaiser window.
+ */
+gcc_const
+static inline double
+BesselI0(double x)
+{
+	double sum = 1, term = 1;
+	for (unsigned k = 1; term > sum * 1e-12; ++k) {
+		term *= (x / (2 * k)) * (x / (2 * k));
+		sum += term;
+	}
+
+	return sum;
+}
+
+/**
+ * Calculate one coefficient of a Kaiser windowed sinc lowpass
+ * filter (not normalized).
+ *
+ * @param x the distance from the center of the filter (in samples)
+ * @param half_length half the length of the window (in samples)
+ * @param cutoff the cutoff frequency relative to the sample rate
+ * @param beta the Kaiser window parameter
+ */
+gcc_const
+static inline double
+KaiserSinc(double x, double half_length, double cutoff, double beta)
+{
+	const double r = x / half_length;
+	if (r < -1 || r > 1)
+		return 0;
+
+	const double window = BesselI0(beta * sqrt(1 - r * r)) /
+		BesselI0(beta);
+	const double sinc = x == 0
+		? 2 * cutoff
+		: sin(2 * M_PI * cutoff * x) / (M_PI * x);
+
+	return sinc * window;
+}
+
+#endif
@@ -19,6 +19,22 @@
 
 #include "config.h"
 #include "PcmBuffer.hxx"
+#include "util/HugeAllocator.hxx"
+
+bool PcmBuffer::lock_memory;
+
+void
+PcmBuffer::Clear()
+{
+	if (locked)
+		HugeFree(buffer, capacity);
+	else
+		delete[] buffer;
+
+	buffer = nullptr;
+	capacity = 0;
+	locked = false;
+}
 
 void *
 PcmBuffer::Get(size_t new_size)
@@ -28,5 +44,26 @@ PcmBuffer::Get(size_t new_size)
 		   assumed to be an error condition */
 		new_size = 1;
 
-	return buffer.Get(new_size);
+	if (gcc_likely(new_size <= capacity))
+		return buffer;
+
+	/* too small: grow */
+	Clear();
+
+	/* always allocate multiples of 8 kB */
+	capacity = ((new_size - 1) | (8192 - 1)) + 1;
+
+	if (lock_memory) {
+		buffer = (uint8_t *)HugeAllocate(capacity);
+		if (buffer != nullptr) {
+			/* if locking fails, the buffer is still
+			   usable */
+			HugeLock(buffer, capacity);
+			locked = true;
+			return buffer;
+		}
+	}
+
+	buffer = new uint8_t[capacity];
+	return buffer;
 }
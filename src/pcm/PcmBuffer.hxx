@@ -20,10 +20,10 @@
 #ifndef PCM_BUFFER_HXX
 #define PCM_BUFFER_HXX
 
-#include "util/ReusableArray.hxx"
 #include "Compiler.h"
 
 #include <stdint.h>
+#include <stddef.h>
 
 /**
  * Manager for a temporary buffer which grows as needed.  We could
@@ -31,13 +31,41 @@
  * would put too much stress on the allocator.
  */
 class PcmBuffer {
-	ReusableArray<uint8_t, 8192> buffer;
+	/**
+	 * Allocate new buffers from pages which are locked into RAM?
+	 * See SetLocked().
+	 */
+	static bool lock_memory;
+
+	uint8_t *buffer;
+	size_t capacity;
+
+	/**
+	 * Was #buffer allocated with HugeAllocate() (and locked)?
+	 */
+	bool locked;
 
 public:
-	void Clear() {
-		buffer.Clear();
+	PcmBuffer():buffer(nullptr), capacity(0), locked(false) {}
+
+	~PcmBuffer() {
+		Clear();
 	}
 
+	PcmBuffer(const PcmBuffer &other) = delete;
+	PcmBuffer &operator=(const PcmBuffer &other) = delete;
+
+	/**
+	 * Lock all buffers which are allocated from now on into RAM,
+	 * so they cannot be paged out during playback.  This must be
+	 * called during startup, before any other thread runs.
+	 */
+	static void SetLocked(bool _lock_memory) {
+		lock_memory = _lock_memory;
+	}
+
+	void Clear();
+
 	/**
 	 * Get the buffer, and guarantee a minimum size.  This buffer becomes
 	 * invalid with the next pcm_buffer_get() call.
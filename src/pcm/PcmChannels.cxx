@@ -19,6 +19,7 @@
 
 #include "config.h"
 #include "PcmChannels.hxx"
+#include "ChannelMatrix.hxx"
 #include "PcmBuffer.hxx"
 #include "Traits.hxx"
 #include "AudioFormat.hxx"
@@ -66,55 +67,6 @@ StereoToMono(typename Traits::pointer_type dest,
 	return dest;
 }
 
-template<SampleFormat F, class Traits=SampleTraits<F>>
-static typename Traits::pointer_type
-NToStereo(typename Traits::pointer_type dest,
-	  unsigned src_channels,
-	  typename Traits::const_pointer_type src,
-	  typename Traits::const_pointer_type end)
-{
-	assert((end - src) % src_channels == 0);
-
-	while (src != end) {
-		typename Traits::sum_type sum = *src++;
-		for (unsigned c = 1; c < src_channels; ++c)
-			sum += *src++;
-
-		typename Traits::value_type value(sum / int(src_channels));
-
-		/* TODO: this is actually only mono ... */
-		*dest++ = value;
-		*dest++ = value;
-	}
-
-	return dest;
-}
-
-template<SampleFormat F, class Traits=SampleTraits<F>>
-static typename Traits::pointer_type
-NToM(typename Traits::pointer_type dest,
-     unsigned dest_channels,
-     unsigned src_channels,
-     typename Traits::const_pointer_type src,
-     typename Traits::const_pointer_type end)
-{
-	assert((end - src) % src_channels == 0);
-
-	while (src != end) {
-		typename Traits::sum_type sum = *src++;
-		for (unsigned c = 1; c < src_channels; ++c)
-			sum += *src++;
-
-		typename Traits::value_type value(sum / int(src_channels));
-
-		/* TODO: this is actually only mono ... */
-		for (unsigned c = 0; c < dest_channels; ++c)
-			*dest++ = value;
-	}
-
-	return dest;
-}
-
 template<SampleFormat F, class Traits=SampleTraits<F>>
 static ConstBuffer<typename Traits::value_type>
 ConvertChannels(PcmBuffer &buffer,
@@ -124,20 +76,25 @@ ConvertChannels(PcmBuffer &buffer,
 {
 	assert(src.size % src_channels == 0);
 
-	const size_t dest_size = src.size / src_channels * dest_channels;
-	auto dest = buffer.GetT<typename Traits::value_type>(dest_size);
+	if ((src_channels == 1 && dest_channels == 2) ||
+	    (src_channels == 2 && dest_channels == 1)) {
+		const size_t dest_size = src.size / src_channels * dest_channels;
+		auto dest = buffer.GetT<typename Traits::value_type>(dest_size);
+
+		if (src_channels == 1)
+			MonoToStereo(dest, src.begin(), src.end());
+		else
+			StereoToMono<F>(dest, src.begin(), src.end());
+
+		return { dest, dest_size };
+	}
 
-	if (src_channels == 1 && dest_channels == 2)
-		MonoToStereo(dest, src.begin(), src.end());
-	else if (src_channels == 2 && dest_channels == 1)
-		StereoToMono<F>(dest, src.begin(), src.end());
-	else if (dest_channels == 2)
-		NToStereo<F>(dest, src_channels, src.begin(), src.end());
-	else
-		NToM<F>(dest, dest_channels,
-			src_channels, src.begin(), src.end());
+	PcmChannelMatrix matrix;
+	matrix.SetDefault(src_channels, dest_channels);
 
-	return { dest, dest_size };
+	typedef typename Traits::value_type value_type;
+	return ConstBuffer<value_type>::FromVoid(matrix.Apply(buffer, F,
+							       src.ToVoid()));
 }
 
 ConstBuffer<int16_t>
@@ -27,12 +27,51 @@
 #include "util/Domain.hxx"
 #include "util/ConstBuffer.hxx"
 
+#ifdef ENABLE_DSD
+#include "config/ConfigGlobal.hxx"
+#include "config/ConfigOption.hxx"
+#include "config/ConfigError.hxx"
+#include "config/Param.hxx"
+#endif
+
 #include <assert.h>
 #include <math.h>
+#include <string.h>
+
+#ifdef ENABLE_DSD
+
+static bool
+pcm_dsd_global_init(Error &error)
+{
+	const auto *param = config_get_param(ConfigOption::DSD_TO_PCM_QUALITY);
+	if (param == nullptr)
+		return true;
+
+	const char *value = param->value.c_str();
+	if (strcmp(value, "normal") == 0)
+		PcmDsd::SetHighQuality(false);
+	else if (strcmp(value, "high") == 0)
+		PcmDsd::SetHighQuality(true);
+	else {
+		error.Format(config_domain,
+			     "Invalid DSD to PCM quality \"%s\" in line %d",
+			     value, param->line);
+		return false;
+	}
+
+	return true;
+}
+
+#endif
 
 bool
 pcm_convert_global_init(Error &error)
 {
+#ifdef ENABLE_DSD
+	if (!pcm_dsd_global_init(error))
+		return false;
+#endif
+
 	return pcm_resampler_global_init(error);
 }
 
@@ -60,8 +99,13 @@ PcmConvert::Open(const AudioFormat _src_format, const AudioFormat _dest_format,
 	assert(_dest_format.IsValid());
 
 	AudioFormat format = _src_format;
-	if (format.format == SampleFormat::DSD)
+	if (format.format == SampleFormat::DSD) {
+#ifdef ENABLE_DSD
+		format.sample_rate = dsd.Open(format.channels,
+					      format.sample_rate);
+#endif
 		format.format = SampleFormat::FLOAT;
+	}
 
 	enable_resampler = format.sample_rate != _dest_format.sample_rate;
 	if (enable_resampler) {
@@ -126,7 +170,7 @@ PcmConvert::Convert(ConstBuffer<void> buffer, Error &error)
 #ifdef ENABLE_DSD
 	if (src_format.format == SampleFormat::DSD) {
 		auto s = ConstBuffer<uint8_t>::FromVoid(buffer);
-		auto d = dsd.ToFloat(src_format.channels, s);
+		auto d = dsd.ToFloat(s);
 		if (d.IsNull()) {
 			error.Set(pcm_domain,
 				  "DSD to PCM conversion failed");
@@ -20,6 +20,8 @@
 #ifndef MPD_PCM_DITHER_HXX
 #define MPD_PCM_DITHER_HXX
 
+#include "VectorDither.hxx"
+
 #include <stdint.h>
 
 enum class SampleFormat : uint8_t;
@@ -28,10 +30,20 @@ class PcmDither {
 	int32_t error[3];
 	int32_t random;
 
+	PcmVectorDither vector;
+
 public:
 	constexpr PcmDither()
 		:error{0, 0, 0}, random(0) {}
 
+	/**
+	 * Returns the state used by the vectorized volume and mixing
+	 * kernels instead of this object's noise shaping.
+	 */
+	PcmVectorDither &GetVector() {
+		return vector;
+	}
+
 	/**
 	 * Shift the given sample by #SBITS-#DBITS to the right, and
 	 * apply dithering.
@@ -19,60 +19,101 @@
 
 #include "config.h"
 #include "PcmDsd.hxx"
-#include "dsd2pcm/dsd2pcm.h"
-#include "util/Macros.hxx"
+#include "DsdFilter.hxx"
 #include "util/ConstBuffer.hxx"
 
 #include <algorithm>
 
 #include <assert.h>
 
+bool PcmDsd::high_quality_enabled = false;
+
 PcmDsd::PcmDsd()
-{
-	std::fill_n(dsd2pcm, ARRAY_SIZE(dsd2pcm), nullptr);
-}
+	:channels(0), history_frames(0), skip(0) {}
+
+PcmDsd::~PcmDsd() {}
 
-PcmDsd::~PcmDsd()
+unsigned
+PcmDsd::Open(unsigned _channels, unsigned sample_rate)
 {
-	for (unsigned i = 0; i < ARRAY_SIZE(dsd2pcm); ++i)
-		if (dsd2pcm[i] != nullptr)
-			dsd2pcm_destroy(dsd2pcm[i]);
+	assert(_channels > 0);
+
+	channels = _channels;
+
+	if (high_quality_enabled) {
+		const unsigned decimation =
+			DsdHighQualityFilter::GetDecimation(sample_rate);
+		high_quality.reset(new DsdHighQualityFilter(decimation));
+		history_frames = high_quality->GetHistory();
+		sample_rate /= decimation;
+	} else {
+		high_quality.reset();
+		history_frames = DSD_STANDARD_HISTORY;
+	}
+
+	history.reset(new uint8_t[history_frames * channels]);
+	Reset();
+
+	return sample_rate;
 }
 
 void
 PcmDsd::Reset()
 {
-	for (unsigned i = 0; i < ARRAY_SIZE(dsd2pcm); ++i)
-		if (dsd2pcm[i] != nullptr)
-			dsd2pcm_reset(dsd2pcm[i]);
+	if (!history)
+		return;
+
+	uint8_t *p = history.get();
+	if (high_quality) {
+		/* DSD silence */
+		std::fill_n(p, history_frames * channels, 0x69);
+	} else {
+		/* the initial state of dsd2pcm, which has a 0x69 FIFO
+		   but looks up the older half of its filter
+		   bit-reversed */
+		std::fill_n(p, 5 * channels, 0x96);
+		std::fill_n(p + 5 * channels, 6 * channels, 0x69);
+	}
+
+	skip = 0;
 }
 
 ConstBuffer<float>
-PcmDsd::ToFloat(unsigned channels, ConstBuffer<uint8_t> src)
+PcmDsd::ToFloat(ConstBuffer<uint8_t> src)
 {
+	assert(history);
 	assert(!src.IsNull());
 	assert(!src.IsEmpty());
 	assert(src.size % channels == 0);
-	assert(channels <= ARRAY_SIZE(dsd2pcm));
 
-	const unsigned num_samples = src.size;
-	const unsigned num_frames = src.size / channels;
+	const size_t num_frames = src.size / channels;
+	const size_t history_size = history_frames * channels;
+
+	uint8_t *input = (uint8_t *)
+		input_buffer.Get(history_size + src.size);
+	std::copy_n(history.get(), history_size, input);
+	std::copy_n(src.data, src.size, input + history_size);
 
 	float *dest;
-	const size_t dest_size = num_samples * sizeof(*dest);
-	dest = (float *)buffer.Get(dest_size);
-
-	for (unsigned c = 0; c < channels; ++c) {
-		if (dsd2pcm[c] == nullptr) {
-			dsd2pcm[c] = dsd2pcm_init();
-			if (dsd2pcm[c] == nullptr)
-				return nullptr;
-		}
-
-		dsd2pcm_translate(dsd2pcm[c], num_frames,
-				  src.data + c, channels,
-				  false, dest + c, channels);
+	size_t num_samples;
+	if (high_quality) {
+		const unsigned decimation = high_quality->GetDecimation();
+		const size_t n = skip < num_frames
+			? (num_frames - 1 - skip) / decimation + 1
+			: 0;
+
+		num_samples = n * channels;
+		dest = (float *)buffer.Get(num_samples * sizeof(*dest));
+		high_quality->Apply(input + skip * channels, channels, n, dest);
+
+		skip = skip + n * decimation - num_frames;
+	} else {
+		num_samples = src.size;
+		dest = (float *)buffer.Get(num_samples * sizeof(*dest));
+		DsdStandardFilter(input, channels, num_samples, dest);
 	}
 
+	std::copy_n(input + src.size, history_size, history.get());
+
 	return { dest, num_samples };
 }
@@ -23,26 +23,77 @@
 #include "check.h"
 #include "PcmBuffer.hxx"
 
+#include <memory>
+
 #include <stdint.h>
 
 template<typename T> struct ConstBuffer;
+class DsdHighQualityFilter;
 
 /**
- * Wrapper for the dsd2pcm library.
+ * Convert DSD to floating point PCM.  By default, this uses the
+ * filter of the dsd2pcm library (with table driven multi-channel
+ * SIMD code, see DsdStandardFilter()), which keeps the DSD byte
+ * rate as PCM sample rate.  After SetHighQuality(true), it uses
+ * #DsdHighQualityFilter, which also decimates.
  */
 class PcmDsd {
+	/**
+	 * Use #DsdHighQualityFilter?  See SetHighQuality().
+	 */
+	static bool high_quality_enabled;
+
 	PcmBuffer buffer;
 
-	struct dsd2pcm_ctx_s *dsd2pcm[32];
+	/**
+	 * The last frames of the previous input buffer followed by
+	 * the current one; this is the input for the filter.
+	 */
+	PcmBuffer input_buffer;
+
+	/**
+	 * The last #history_frames frames of input.
+	 */
+	std::unique_ptr<uint8_t[]> history;
+
+	/**
+	 * If this is nullptr, then the standard filter is used.
+	 */
+	std::unique_ptr<DsdHighQualityFilter> high_quality;
+
+	unsigned channels, history_frames;
+
+	/**
+	 * The number of frames (of #input_buffer) to skip before the
+	 * next output sample of #high_quality is calculated.
+	 */
+	unsigned skip;
 
 public:
 	PcmDsd();
 	~PcmDsd();
 
+	/**
+	 * Select the filter for all PcmDsd::Open() calls from now on
+	 * (the "dsd_to_pcm_quality" setting).  This must be called
+	 * during startup, before any other thread runs.
+	 */
+	static void SetHighQuality(bool _high_quality) {
+		high_quality_enabled = _high_quality;
+	}
+
+	/**
+	 * Prepare the conversion of the given DSD stream.
+	 *
+	 * @param sample_rate the DSD sample rate in bytes per second
+	 * (i.e. 1/8 of the DSD bit rate)
+	 * @return the sample rate of the PCM output
+	 */
+	unsigned Open(unsigned channels, unsigned sample_rate);
+
 	void Reset();
 
-	ConstBuffer<float> ToFloat(unsigned channels,
-				   ConstBuffer<uint8_t> src);
+	ConstBuffer<float> ToFloat(ConstBuffer<uint8_t> src);
 };
 
 #endif
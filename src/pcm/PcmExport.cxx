@@ -20,9 +20,6 @@
 #include "config.h"
 #include "PcmExport.hxx"
 #include "Order.hxx"
-#include "PcmDop.hxx"
-#include "PcmPack.hxx"
-#include "util/ByteReverse.hxx"
 #include "util/ConstBuffer.hxx"
 
 #include <iterator>
@@ -40,6 +37,7 @@ PcmExport::Open(SampleFormat sample_format, unsigned _channels,
 		? sample_format
 		: SampleFormat::UNDEFINED;
 	dop = _dop && sample_format == SampleFormat::DSD;
+	dop_odd = false;
 	if (dop)
 		/* after the conversion to DoP, the DSD
 		   samples are stuffed inside fake 24 bit samples */
@@ -60,6 +58,8 @@ PcmExport::Open(SampleFormat sample_format, unsigned _channels,
 		if (sample_size > 1)
 			reverse_endian = sample_size;
 	}
+
+	kernel = PcmSelectExportKernel(dop, shift8, pack24, reverse_endian);
 }
 
 size_t
@@ -86,42 +86,15 @@ PcmExport::Export(ConstBuffer<void> data)
 		data = ToAlsaChannelOrder(order_buffer, data,
 					  alsa_channel_order, channels);
 
-	if (dop)
-		data = pcm_dsd_to_dop(dop_buffer, channels,
-				      ConstBuffer<uint8_t>::FromVoid(data))
-			.ToVoid();
-
-	if (pack24) {
-		const auto src = ConstBuffer<int32_t>::FromVoid(data);
-		const size_t num_samples = src.size;
-		const size_t dest_size = num_samples * 3;
-		uint8_t *dest = (uint8_t *)pack_buffer.Get(dest_size);
+	if (kernel != nullptr) {
+		/* DoP doubles the size; all other options keep or
+		   reduce it */
+		const size_t max_size = dop ? data.size * 2 : data.size;
+		void *dest = buffer.Get(max_size + PCM_EXPORT_KERNEL_PADDING);
 		assert(dest != nullptr);
 
-		pcm_pack_24(dest, src.begin(), src.end());
-
+		data.size = kernel(dest, data, channels, dop_odd);
 		data.data = dest;
-		data.size = dest_size;
-	} else if (shift8) {
-		const auto src = ConstBuffer<int32_t>::FromVoid(data);
-
-		uint32_t *dest = (uint32_t *)pack_buffer.Get(data.size);
-		data.data = dest;
-
-		for (auto i : src)
-			*dest++ = i << 8;
-	}
-
-	if (reverse_endian > 0) {
-		assert(reverse_endian >= 2);
-
-		const auto src = ConstBuffer<uint8_t>::FromVoid(data);
-
-		uint8_t *dest = (uint8_t *)reverse_buffer.Get(data.size);
-		assert(dest != nullptr);
-		data.data = dest;
-
-		reverse_bytes(dest, src.begin(), src.end(), reverse_endian);
 	}
 
 	return data;
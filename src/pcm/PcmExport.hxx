@@ -22,6 +22,7 @@
 
 #include "check.h"
 #include "PcmBuffer.hxx"
+#include "ExportKernels.hxx"
 #include "AudioFormat.hxx"
 
 struct AudioFormat;
@@ -41,26 +42,16 @@ struct PcmExport {
 	PcmBuffer order_buffer;
 
 	/**
-	 * The buffer is used to convert DSD samples to the
-	 * DoP format.
-	 *
-	 * @see #dop
+	 * The destination buffer of #kernel.
 	 */
-	PcmBuffer dop_buffer;
+	PcmBuffer buffer;
 
 	/**
-	 * The buffer is used to pack samples, removing padding.
-	 *
-	 * @see #pack24
+	 * The kernel which applies the #dop, #shift8, #pack24 and
+	 * #reverse_endian options in one pass; nullptr if none of
+	 * them is enabled.
 	 */
-	PcmBuffer pack_buffer;
-
-	/**
-	 * The buffer is used to reverse the byte order.
-	 *
-	 * @see #reverse_endian
-	 */
-	PcmBuffer reverse_buffer;
+	PcmExportKernel kernel;
 
 	/**
 	 * The number of channels.
@@ -84,6 +75,13 @@ struct PcmExport {
 	 */
 	bool dop;
 
+	/**
+	 * Is the next DoP frame an odd frame?  The DoP markers
+	 * alternate from frame to frame, even if a buffer contains an
+	 * odd number of frames.
+	 */
+	bool dop_odd;
+
 	/**
 	 * Convert (padded) 24 bit samples to 32 bit by shifting 8
 	 * bits to the left?
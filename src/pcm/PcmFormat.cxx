@@ -28,6 +28,14 @@
 
 #include "PcmDither.cxx" // including the .cxx file to get inlined templates
 
+#ifdef __SSE2__
+#include "Sse2.hxx"
+#include "CpuFeatures.hxx"
+#ifdef HAVE_AVX2_DISPATCH
+#include "Avx2.hxx"
+#endif
+#endif
+
 /**
  * Wrapper for a class that converts one sample at a time into one
  * that converts a buffer at a time.
@@ -45,8 +53,106 @@ struct PerSampleConvert : C {
 	}
 };
 
+/**
+ * A template class that attempts to use the "optimized" algorithm for
+ * large portions of the buffer, and calls the "portable" algorithm"
+ * for the rest when the last block is not full.
+ */
+template<typename Optimized, typename Portable>
+class GlueOptimizedConvert : Optimized, Portable {
+public:
+	typedef typename Portable::SrcTraits SrcTraits;
+	typedef typename Portable::DstTraits DstTraits;
+
+	void Convert(typename DstTraits::pointer_type out,
+		     typename SrcTraits::const_pointer_type in,
+		     size_t n) const {
+		Optimized::Convert(out, in, n);
+
+		/* use the "portable" algorithm for the trailing
+		   samples */
+		size_t remaining = n % Optimized::BLOCK_SIZE;
+		size_t done = n - remaining;
+		Portable::Convert(out + done, in + done, remaining);
+	}
+};
+
+#ifdef __SSE2__
+
+/**
+ * Maps a per-sample conversion class to the x86 SIMD kernels which
+ * implement it.
+ */
+template<typename C>
+struct X86Kernels;
+
+template<SampleFormat SF, SampleFormat DF, class ST, class DT>
+struct X86Kernels<LeftShiftSampleConvert<SF, DF, ST, DT>> {
+	typedef Sse2LeftShift<ST, DT> Sse2;
+#ifdef HAVE_AVX2_DISPATCH
+	typedef Avx2LeftShift<ST, DT> Avx2;
+#endif
+};
+
+template<SampleFormat SF, SampleFormat DF, class ST, class DT>
+struct X86Kernels<RightShiftSampleConvert<SF, DF, ST, DT>> {
+	typedef Sse2RightShift<ST, DT> Sse2;
+#ifdef HAVE_AVX2_DISPATCH
+	typedef Avx2RightShift<ST, DT> Avx2;
+#endif
+};
+
+template<SampleFormat F, class Traits>
+struct X86Kernels<IntegerToFloatSampleConvert<F, Traits>> {
+	typedef Sse2IntegerToFloat<Traits> Sse2;
+#ifdef HAVE_AVX2_DISPATCH
+	typedef Avx2IntegerToFloat<Traits> Avx2;
+#endif
+};
+
+template<SampleFormat F, class Traits>
+struct X86Kernels<FloatToIntegerSampleConvert<F, Traits>> {
+	typedef Sse2FloatToInteger<Traits> Sse2;
+#ifdef HAVE_AVX2_DISPATCH
+	typedef Avx2FloatToInteger<Traits> Avx2;
+#endif
+};
+
+#endif
+
+/**
+ * Converts a buffer with the fastest implementation of the
+ * per-sample conversion #C which is available on this CPU: AVX2 (if
+ * detected at runtime) or SSE2 on x86, and #PerSampleConvert
+ * everywhere else.
+ */
+template<typename C>
+struct OptimizedConvert : PerSampleConvert<C> {
+#ifdef __SSE2__
+	typedef typename C::SrcTraits SrcTraits;
+	typedef typename C::DstTraits DstTraits;
+
+	void Convert(typename DstTraits::pointer_type gcc_restrict out,
+		     typename SrcTraits::const_pointer_type gcc_restrict in,
+		     size_t n) const {
+		typedef X86Kernels<C> K;
+
+#ifdef HAVE_AVX2_DISPATCH
+		if (CpuHasAvx2()) {
+			GlueOptimizedConvert<typename K::Avx2,
+					     PerSampleConvert<C>>().Convert(out, in, n);
+			return;
+		}
+#endif
+
+		GlueOptimizedConvert<typename K::Sse2,
+				     PerSampleConvert<C>>().Convert(out, in, n);
+	}
+#endif
+};
+
 struct Convert8To16
-	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S8,
+	: OptimizedConvert<LeftShiftSampleConvert<SampleFormat::S8,
 						  SampleFormat::S16>> {};
 
 struct Convert24To16 {
@@ -80,31 +186,8 @@ struct PortableFloatToInteger
 	: PerSampleConvert<FloatToIntegerSampleConvert<F, Traits>> {};
 
 template<SampleFormat F, class Traits=SampleTraits<F>>
-struct FloatToInteger : PortableFloatToInteger<F, Traits> {};
-
-/**
- * A template class that attempts to use the "optimized" algorithm for
- * large portions of the buffer, and calls the "portable" algorithm"
- * for the rest when the last block is not full.
- */
-template<typename Optimized, typename Portable>
-class GlueOptimizedConvert : Optimized, Portable {
-public:
-	typedef typename Portable::SrcTraits SrcTraits;
-	typedef typename Portable::DstTraits DstTraits;
-
-	void Convert(typename DstTraits::pointer_type out,
-		     typename SrcTraits::const_pointer_type in,
-		     size_t n) const {
-		Optimized::Convert(out, in, n);
-
-		/* use the "portable" algorithm for the trailing
-		   samples */
-		size_t remaining = n % Optimized::BLOCK_SIZE;
-		size_t done = n - remaining;
-		Portable::Convert(out + done, in + done, remaining);
-	}
-};
+struct FloatToInteger
+	: OptimizedConvert<FloatToIntegerSampleConvert<F, Traits>> {};
 
 #ifdef __ARM_NEON__
 #include "Neon.hxx"
@@ -192,11 +275,11 @@ pcm_convert_to_16(PcmBuffer &buffer, PcmDither &dither,
 }
 
 struct Convert8To24
-	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S8,
+	: OptimizedConvert<LeftShiftSampleConvert<SampleFormat::S8,
 						  SampleFormat::S24_P32>> {};
 
 struct Convert16To24
-	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S16,
+	: OptimizedConvert<LeftShiftSampleConvert<SampleFormat::S16,
 						  SampleFormat::S24_P32>> {};
 
 static ConstBuffer<int32_t>
@@ -212,7 +295,7 @@ pcm_allocate_16_to_24(PcmBuffer &buffer, ConstBuffer<int16_t> src)
 }
 
 struct Convert32To24
-	: PerSampleConvert<RightShiftSampleConvert<SampleFormat::S32,
+	: OptimizedConvert<RightShiftSampleConvert<SampleFormat::S32,
 						   SampleFormat::S24_P32>> {};
 
 static ConstBuffer<int32_t>
@@ -260,15 +343,15 @@ pcm_convert_to_24(PcmBuffer &buffer,
 }
 
 struct Convert8To32
-	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S8,
+	: OptimizedConvert<LeftShiftSampleConvert<SampleFormat::S8,
 						  SampleFormat::S32>> {};
 
 struct Convert16To32
-	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S16,
+	: OptimizedConvert<LeftShiftSampleConvert<SampleFormat::S16,
 						  SampleFormat::S32>> {};
 
 struct Convert24To32
-	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S24_P32,
+	: OptimizedConvert<LeftShiftSampleConvert<SampleFormat::S24_P32,
 						  SampleFormat::S32>> {};
 
 static ConstBuffer<int32_t>
@@ -328,16 +411,16 @@ pcm_convert_to_32(PcmBuffer &buffer,
 }
 
 struct Convert8ToFloat
-	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S8>> {};
+	: OptimizedConvert<IntegerToFloatSampleConvert<SampleFormat::S8>> {};
 
 struct Convert16ToFloat
-	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S16>> {};
+	: OptimizedConvert<IntegerToFloatSampleConvert<SampleFormat::S16>> {};
 
 struct Convert24ToFloat
-	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S24_P32>> {};
+	: OptimizedConvert<IntegerToFloatSampleConvert<SampleFormat::S24_P32>> {};
 
 struct Convert32ToFloat
-	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S32>> {};
+	: OptimizedConvert<IntegerToFloatSampleConvert<SampleFormat::S32>> {};
 
 static ConstBuffer<float>
 pcm_allocate_8_to_float(PcmBuffer &buffer, ConstBuffer<int8_t> src)
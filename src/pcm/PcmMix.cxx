@@ -20,6 +20,7 @@
 #include "config.h"
 #include "PcmMix.hxx"
 #include "Volume.hxx"
+#include "VolumeKernels.hxx"
 #include "PcmUtils.hxx"
 #include "AudioFormat.hxx"
 #include "Traits.hxx"
@@ -64,13 +65,23 @@ PcmAddVolumeVoid(PcmDither &dither,
 	constexpr size_t sample_size = Traits::SAMPLE_SIZE;
 	assert(size % sample_size == 0);
 
+#ifdef HAVE_PCM_VECTOR_VOLUME
+	PcmVectorAddVolume<F, Traits>(dither.GetVector(),
+				      typename Traits::pointer_type(a),
+				      typename Traits::const_pointer_type(b),
+				      size / sample_size,
+				      volume1, volume2);
+#else
 	PcmAddVolume<F, Traits>(dither,
 				typename Traits::pointer_type(a),
 				typename Traits::const_pointer_type(b),
 				size / sample_size,
 				volume1, volume2);
+#endif
 }
 
+#ifndef HAVE_PCM_VECTOR_VOLUME
+
 static void
 pcm_add_vol_float(float *buffer1, const float *buffer2,
 		  unsigned num_samples, float volume1, float volume2)
@@ -85,6 +96,8 @@ pcm_add_vol_float(float *buffer1, const float *buffer2,
 	}
 }
 
+#endif
+
 static bool
 pcm_add_vol(PcmDither &dither, void *buffer1, const void *buffer2, size_t size,
 	    int vol1, int vol2,
@@ -121,10 +134,16 @@ pcm_add_vol(PcmDither &dither, void *buffer1, const void *buffer2, size_t size,
 		return true;
 
 	case SampleFormat::FLOAT:
+#ifdef HAVE_PCM_VECTOR_VOLUME
+		PcmAddVolumeVoid<SampleFormat::FLOAT>(dither,
+						      buffer1, buffer2, size,
+						      vol1, vol2);
+#else
 		pcm_add_vol_float((float *)buffer1, (const float *)buffer2,
 				  size / 4,
 				  pcm_volume_to_float(vol1),
 				  pcm_volume_to_float(vol2));
+#endif
 		return true;
 	}
 
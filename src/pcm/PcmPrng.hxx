@@ -20,6 +20,9 @@
 #ifndef MPD_PCM_PRNG_HXX
 #define MPD_PCM_PRNG_HXX
 
+static constexpr unsigned long PCM_PRNG_MULTIPLIER = 0x0019660dL;
+static constexpr unsigned long PCM_PRNG_INCREMENT = 0x3c6ef35fL;
+
 /**
  * A very simple linear congruential PRNG.  It's good enough for PCM
  * dithering.
@@ -27,7 +30,7 @@
 constexpr static inline unsigned long
 pcm_prng(unsigned long state)
 {
-	return (state * 0x0019660dL + 0x3c6ef35fL) & 0xffffffffL;
+	return (state * PCM_PRNG_MULTIPLIER + PCM_PRNG_INCREMENT) & 0xffffffffL;
 }
 
 #endif
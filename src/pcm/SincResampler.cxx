@@ -0,0 +1,368 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "SincResampler.hxx"
+#include "Kaiser.hxx"
+#include "CpuFeatures.hxx"
+#include "AudioFormat.hxx"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef HAVE_AVX2_DISPATCH
+#include "Avx2.hxx"
+#endif
+
+#include <algorithm>
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+struct SincQuality {
+	const char *name;
+
+	/**
+	 * Half the number of filter taps (for a conversion ratio of 1
+	 * or higher); a multiple of 4.
+	 */
+	unsigned half_taps;
+
+	/**
+	 * The Kaiser window parameter, which determines the stopband
+	 * attenuation.
+	 */
+	double beta;
+
+	/**
+	 * The cutoff frequency relative to the lower of both sample
+	 * rates; the transition band is centered around this
+	 * frequency.
+	 */
+	double cutoff;
+};
+
+static constexpr SincQuality sinc_quality_table[] = {
+	/* about 120 dB, passband up to 0.45 */
+	{ "very high", 64, 12.5, 0.48 },
+
+	/* about 100 dB, passband up to 0.42 */
+	{ "high", 32, 10, 0.47 },
+
+	/* about 70 dB, passband up to 0.39 */
+	{ "medium", 16, 7, 0.46 },
+
+	/* about 55 dB, passband up to 0.33 */
+	{ "low", 8, 5, 0.44 },
+
+	{ nullptr, 0, 0, 0 }
+};
+
+static const SincQuality *sinc_quality = &sinc_quality_table[1];
+
+/**
+ * Up to this number of coefficients, there is one set of
+ * coefficients for each phase.
+ */
+static constexpr unsigned MAX_COEFFICIENTS = 1 << 20;
+
+gcc_pure
+static const SincQuality *
+sinc_parse_quality(const char *name)
+{
+	for (const auto *i = sinc_quality_table; i->name != nullptr; ++i)
+		if (strcmp(i->name, name) == 0)
+			return i;
+
+	return nullptr;
+}
+
+bool
+pcm_resample_sinc_set_quality(const char *name)
+{
+	const auto *quality = sinc_parse_quality(name);
+	if (quality == nullptr)
+		return false;
+
+	sinc_quality = quality;
+	return true;
+}
+
+#ifdef __SSE2__
+
+static float
+SincDotSse2(const float *a, const float *b, unsigned n)
+{
+	__m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+	for (unsigned i = 0; i < n; i += 8) {
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i),
+						   _mm_loadu_ps(b + i)));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4),
+						   _mm_loadu_ps(b + i + 4)));
+	}
+
+	__m128 sum = _mm_add_ps(sum0, sum1);
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+	return _mm_cvtss_f32(sum);
+}
+
+#else
+
+static float
+SincDotPortable(const float *a, const float *b, unsigned n)
+{
+	/* four independent sums to hide the latency of the
+	   additions */
+	float sum[4] = {0, 0, 0, 0};
+	for (unsigned i = 0; i < n; i += 4) {
+		sum[0] += a[i] * b[i];
+		sum[1] += a[i + 1] * b[i + 1];
+		sum[2] += a[i + 2] * b[i + 2];
+		sum[3] += a[i + 3] * b[i + 3];
+	}
+
+	return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+#endif
+
+#ifdef HAVE_AVX2_DISPATCH
+
+gcc_target_avx2
+static float
+SincDotAvx2(const float *a, const float *b, unsigned n)
+{
+	__m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+	unsigned i = 0;
+	for (; i + 16 <= n; i += 16) {
+		sum0 = _mm256_add_ps(sum0,
+				     _mm256_mul_ps(_mm256_loadu_ps(a + i),
+						   _mm256_loadu_ps(b + i)));
+		sum1 = _mm256_add_ps(sum1,
+				     _mm256_mul_ps(_mm256_loadu_ps(a + i + 8),
+						   _mm256_loadu_ps(b + i + 8)));
+	}
+
+	if (i < n)
+		sum0 = _mm256_add_ps(sum0,
+				     _mm256_mul_ps(_mm256_loadu_ps(a + i),
+						   _mm256_loadu_ps(b + i)));
+
+	const __m256 sum8 = _mm256_add_ps(sum0, sum1);
+	__m128 sum = _mm_add_ps(_mm256_castps256_ps128(sum8),
+				_mm256_extractf128_ps(sum8, 1));
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+	return _mm_cvtss_f32(sum);
+}
+
+#endif
+
+gcc_const
+static unsigned
+Gcd(unsigned a, unsigned b)
+{
+	while (b != 0) {
+		const unsigned t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+/**
+ * Calculate one set of coefficients, normalized to a DC gain of 1.
+ *
+ * @param offset the fractional position of the output sample
+ * between two input samples (0 to 1)
+ */
+static void
+MakeCoefficients(float *dest, unsigned n_taps, double offset,
+		 double cutoff, double beta)
+{
+	/* the center of the filter is between tap (n_taps/2-1) and
+	   tap (n_taps/2) */
+	const double center = n_taps / 2 - 1 + offset;
+
+	double sum = 0;
+	for (unsigned i = 0; i < n_taps; ++i)
+		sum += KaiserSinc(i - center, n_taps / 2, cutoff, beta);
+
+	for (unsigned i = 0; i < n_taps; ++i)
+		dest[i] = KaiserSinc(i - center, n_taps / 2, cutoff, beta) / sum;
+}
+
+AudioFormat
+SincPcmResampler::Open(AudioFormat &af, unsigned new_sample_rate,
+		       gcc_unused Error &error)
+{
+	assert(af.IsValid());
+	assert(audio_valid_sample_rate(new_sample_rate));
+
+	channels = af.channels;
+
+	const unsigned gcd = Gcd(af.sample_rate, new_sample_rate);
+	up = new_sample_rate / gcd;
+	down = af.sample_rate / gcd;
+
+	/* when downsampling, the filter must be longer (in input
+	   samples) and its cutoff frequency lower */
+	unsigned half_taps = sinc_quality->half_taps;
+	double cutoff = sinc_quality->cutoff;
+	if (down > up) {
+		half_taps = (uint64_t(half_taps) * down + up - 1) / up;
+		half_taps = (half_taps + 3) & ~3u;
+		cutoff = cutoff * up / down;
+	}
+
+	n_taps = half_taps * 2;
+
+	interpolate = uint64_t(up) * n_taps > MAX_COEFFICIENTS;
+	if (interpolate) {
+		n_phases = std::max(MAX_COEFFICIENTS / n_taps, 64u);
+		interpolated.reset(new float[n_taps]);
+	} else
+		n_phases = up;
+
+	const unsigned n_sets = n_phases + interpolate;
+	coefficients.reset(new float[size_t(n_sets) * n_taps]);
+	for (unsigned i = 0; i < n_sets; ++i)
+		MakeCoefficients(coefficients.get() + size_t(i) * n_taps,
+				 n_taps, double(i) / n_phases,
+				 cutoff, sinc_quality->beta);
+
+	/* start with silence */
+	const size_t history_frames = n_taps - 1;
+	history.reset(new float[history_frames * channels]);
+	std::fill_n(history.get(), history_frames * channels, 0.0f);
+
+	/* the first output frame corresponds to the first input
+	   frame (which will follow the history) */
+	position = history_frames - (n_taps / 2 - 1);
+	phase = 0;
+
+#ifdef __SSE2__
+	dot = SincDotSse2;
+#else
+	dot = SincDotPortable;
+#endif
+
+#ifdef HAVE_AVX2_DISPATCH
+	if (CpuHasAvx2())
+		dot = SincDotAvx2;
+#endif
+
+	/* the filter works with floating point samples */
+	af.format = SampleFormat::FLOAT;
+
+	AudioFormat result = af;
+	result.sample_rate = new_sample_rate;
+	return result;
+}
+
+void
+SincPcmResampler::Close()
+{
+	coefficients.reset();
+	interpolated.reset();
+	history.reset();
+}
+
+inline const float *
+SincPcmResampler::GetCoefficients(unsigned _phase)
+{
+	if (!interpolate)
+		return coefficients.get() + size_t(_phase) * n_taps;
+
+	const uint64_t x = uint64_t(_phase) * n_phases;
+	const unsigned i = x / up;
+	const float fraction = float(x % up) / up;
+
+	const float *a = coefficients.get() + size_t(i) * n_taps;
+	const float *b = a + n_taps;
+	float *dest = interpolated.get();
+	for (unsigned j = 0; j < n_taps; ++j)
+		dest[j] = a[j] + fraction * (b[j] - a[j]);
+
+	return dest;
+}
+
+ConstBuffer<void>
+SincPcmResampler::Resample(ConstBuffer<void> _src, gcc_unused Error &error)
+{
+	const auto src = ConstBuffer<float>::FromVoid(_src);
+	assert(src.size % channels == 0);
+
+	const size_t n_frames = src.size / channels;
+	const size_t history_frames = n_taps - 1;
+	const size_t n_input = history_frames + n_frames;
+
+	/* deinterleave history and input, so the filter can work on
+	   consecutive samples */
+	float *input = (float *)
+		input_buffer.Get(n_input * channels * sizeof(float));
+	for (unsigned c = 0; c < channels; ++c) {
+		float *p = input + c * n_input;
+		p = std::copy_n(history.get() + c * history_frames,
+				history_frames, p);
+		for (size_t i = 0; i < n_frames; ++i)
+			p[i] = src.data[i * channels + c];
+	}
+
+	/* calculate the number of output frames: all positions whose
+	   filter window fits into the input */
+	size_t n_output = 0;
+	if (position + n_taps <= n_input) {
+		const uint64_t last = n_input - n_taps - position;
+		n_output = ((last + 1) * up - phase + down - 1) / down;
+	}
+
+	float *dest = (float *)
+		output_buffer.Get(n_output * channels * sizeof(float));
+
+	const unsigned step = down / up, step_phase = down % up;
+	for (size_t i = 0; i < n_output; ++i) {
+		const float *h = GetCoefficients(phase);
+		for (unsigned c = 0; c < channels; ++c)
+			dest[i * channels + c] =
+				dot(input + c * n_input + position, h, n_taps);
+
+		position += step;
+		phase += step_phase;
+		if (phase >= up) {
+			phase -= up;
+			++position;
+		}
+	}
+
+	assert(position + n_taps > n_input);
+	assert(position >= n_frames);
+
+	for (unsigned c = 0; c < channels; ++c)
+		std::copy_n(input + c * n_input + n_frames, history_frames,
+			    history.get() + c * history_frames);
+
+	position -= n_frames;
+
+	return ConstBuffer<float>(dest, n_output * channels).ToVoid();
+}
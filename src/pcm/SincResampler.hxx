@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_SINC_RESAMPLER_HXX
+#define MPD_PCM_SINC_RESAMPLER_HXX
+
+#include "Resampler.hxx"
+#include "PcmBuffer.hxx"
+#include "Compiler.h"
+
+#include <memory>
+
+#include <stddef.h>
+
+struct AudioFormat;
+
+/**
+ * A polyphase resampler with a Kaiser windowed sinc filter.  This is
+ * the "internal" resampler plugin; it does not need any external
+ * library.
+ *
+ * The conversion ratio is reduced to a fraction up/down.  If "up"
+ * is small enough (which is the case for conversions within and
+ * between the 44.1 kHz and 48 kHz families), there is a precomputed
+ * set of coefficients for each phase; for odd ratios, the
+ * coefficients are interpolated linearly from a smaller table.
+ */
+class SincPcmResampler final : public PcmResampler {
+	unsigned channels;
+
+	/**
+	 * The conversion ratio: for each "down" input frames, "up"
+	 * output frames are generated.
+	 */
+	unsigned up, down;
+
+	/**
+	 * The number of filter taps; a multiple of 8.
+	 */
+	unsigned n_taps;
+
+	/**
+	 * The number of coefficient sets in #coefficients, minus one
+	 * if #interpolate is set.
+	 */
+	unsigned n_phases;
+
+	/**
+	 * Interpolate between two sets of #coefficients instead of
+	 * having one for each of the #up phases?
+	 */
+	bool interpolate;
+
+	/**
+	 * The filter coefficients, #n_taps for each phase.
+	 */
+	std::unique_ptr<float[]> coefficients;
+
+	/**
+	 * Temporary buffer for interpolated coefficients.
+	 */
+	std::unique_ptr<float[]> interpolated;
+
+	/**
+	 * The last (#n_taps - 1) input frames of each channel.
+	 */
+	std::unique_ptr<float[]> history;
+
+	/**
+	 * The position of the next output frame: the index of the
+	 * first input frame (including the history) of the filter
+	 * window, and the phase (0 to up-1) within that frame.
+	 */
+	size_t position;
+	unsigned phase;
+
+	/**
+	 * The non-interleaved history and input samples.
+	 */
+	PcmBuffer input_buffer;
+
+	PcmBuffer output_buffer;
+
+	float (*dot)(const float *a, const float *b, unsigned n);
+
+public:
+	virtual AudioFormat Open(AudioFormat &af, unsigned new_sample_rate,
+				 Error &error) override;
+	virtual void Close() override;
+	virtual ConstBuffer<void> Resample(ConstBuffer<void> src,
+					   Error &error) override;
+
+private:
+	/**
+	 * Returns the coefficients for the given phase.  The pointer
+	 * may refer to #interpolated, and is only valid until the
+	 * next call.
+	 */
+	const float *GetCoefficients(unsigned _phase);
+};
+
+/**
+ * Select the quality of all #SincPcmResampler instances which are
+ * opened from now on: "very high", "high" (the default), "medium" or
+ * "low".
+ *
+ * @return false if the name is not known
+ */
+bool
+pcm_resample_sinc_set_quality(const char *name);
+
+#endif
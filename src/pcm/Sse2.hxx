@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_SSE2_HXX
+#define MPD_PCM_SSE2_HXX
+
+#include "Traits.hxx"
+
+#include <emmintrin.h>
+
+#include <stddef.h>
+
+/*
+ * Sample format conversion kernels using SSE2.  They process whole
+ * blocks of #BLOCK_SIZE samples only; the caller is responsible for
+ * the rest (see GlueOptimizedConvert).  The results are bit-exact
+ * with the portable per-sample implementations in ShiftConvert.hxx
+ * and FloatConvert.hxx.
+ */
+
+/**
+ * Load 16 samples and sign-extend them to 32 bit.
+ */
+static inline void
+Sse2Load16(__m128i v[4], const int8_t *src)
+{
+	const __m128i x = _mm_loadu_si128((const __m128i *)src);
+
+	/* place each byte in the upper half of a 16 bit word and
+	   shift it back, replicating the sign bit */
+	const __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(x, x), 8);
+	const __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(x, x), 8);
+
+	v[0] = _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16);
+	v[1] = _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16);
+	v[2] = _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16);
+	v[3] = _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16);
+}
+
+static inline void
+Sse2Load16(__m128i v[4], const int16_t *src)
+{
+	const __m128i a = _mm_loadu_si128((const __m128i *)src);
+	const __m128i b = _mm_loadu_si128((const __m128i *)(src + 8));
+
+	v[0] = _mm_srai_epi32(_mm_unpacklo_epi16(a, a), 16);
+	v[1] = _mm_srai_epi32(_mm_unpackhi_epi16(a, a), 16);
+	v[2] = _mm_srai_epi32(_mm_unpacklo_epi16(b, b), 16);
+	v[3] = _mm_srai_epi32(_mm_unpackhi_epi16(b, b), 16);
+}
+
+static inline void
+Sse2Load16(__m128i v[4], const int32_t *src)
+{
+	for (unsigned i = 0; i < 4; ++i)
+		v[i] = _mm_loadu_si128((const __m128i *)(src + 4 * i));
+}
+
+/**
+ * Store 16 samples, clipping them to the range of the destination
+ * type (the pack instructions saturate).
+ */
+static inline void
+Sse2Store16(int8_t *dest, const __m128i v[4])
+{
+	const __m128i a = _mm_packs_epi32(v[0], v[1]);
+	const __m128i b = _mm_packs_epi32(v[2], v[3]);
+	_mm_storeu_si128((__m128i *)dest, _mm_packs_epi16(a, b));
+}
+
+static inline void
+Sse2Store16(int16_t *dest, const __m128i v[4])
+{
+	_mm_storeu_si128((__m128i *)dest, _mm_packs_epi32(v[0], v[1]));
+	_mm_storeu_si128((__m128i *)(dest + 8), _mm_packs_epi32(v[2], v[3]));
+}
+
+static inline void
+Sse2Store16(int32_t *dest, const __m128i v[4])
+{
+	for (unsigned i = 0; i < 4; ++i)
+		_mm_storeu_si128((__m128i *)(dest + 4 * i), v[i]);
+}
+
+/**
+ * Convert from one integer sample format to another by shifting bits
+ * to the left.  See #LeftShiftSampleConvert.
+ */
+template<class ST, class DT>
+struct Sse2LeftShift {
+	typedef ST SrcTraits;
+	typedef DT DstTraits;
+
+	static constexpr size_t BLOCK_SIZE = 16;
+
+	void Convert(typename DT::pointer_type dest,
+		     typename ST::const_pointer_type src, size_t n) const {
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, src += BLOCK_SIZE, dest += BLOCK_SIZE) {
+			__m128i v[4];
+			Sse2Load16(v, src);
+			for (auto &x : v)
+				x = _mm_slli_epi32(x, DT::BITS - ST::BITS);
+			Sse2Store16(dest, v);
+		}
+	}
+};
+
+/**
+ * Convert from one integer sample format to another by shifting bits
+ * to the right.  See #RightShiftSampleConvert.
+ */
+template<class ST, class DT>
+struct Sse2RightShift {
+	typedef ST SrcTraits;
+	typedef DT DstTraits;
+
+	static constexpr size_t BLOCK_SIZE = 16;
+
+	void Convert(typename DT::pointer_type dest,
+		     typename ST::const_pointer_type src, size_t n) const {
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, src += BLOCK_SIZE, dest += BLOCK_SIZE) {
+			__m128i v[4];
+			Sse2Load16(v, src);
+			for (auto &x : v)
+				x = _mm_srai_epi32(x, ST::BITS - DT::BITS);
+			Sse2Store16(dest, v);
+		}
+	}
+};
+
+/**
+ * Convert from an integer sample format to float.  See
+ * #IntegerToFloatSampleConvert.
+ */
+template<class ST>
+struct Sse2IntegerToFloat {
+	typedef ST SrcTraits;
+	typedef SampleTraits<SampleFormat::FLOAT> DstTraits;
+
+	static constexpr size_t BLOCK_SIZE = 16;
+
+	void Convert(float *dest, typename ST::const_pointer_type src,
+		     size_t n) const {
+		const __m128 factor =
+			_mm_set1_ps(0.5 / (1 << (ST::BITS - 2)));
+
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, src += BLOCK_SIZE, dest += BLOCK_SIZE) {
+			__m128i v[4];
+			Sse2Load16(v, src);
+			for (unsigned j = 0; j < 4; ++j)
+				_mm_storeu_ps(dest + 4 * j,
+					      _mm_mul_ps(_mm_cvtepi32_ps(v[j]),
+							 factor));
+		}
+	}
+};
+
+/**
+ * Convert from float to an integer sample format.  See
+ * #FloatToIntegerSampleConvert.
+ *
+ * Instead of truncating first and clamping the integer, this clamps
+ * the float value to the (integral) limits first, which gives the
+ * same result and avoids overflowing the 32 bit conversion.
+ */
+template<class DT>
+struct Sse2FloatToInteger {
+	typedef SampleTraits<SampleFormat::FLOAT> SrcTraits;
+	typedef DT DstTraits;
+
+	static constexpr size_t BLOCK_SIZE = 16;
+
+	static __m128i Convert4(__m128 x, __m128 factor) {
+		x = _mm_mul_ps(x, factor);
+		x = _mm_max_ps(x, _mm_set1_ps(float(DT::MIN)));
+
+		if (DT::BITS < 32) {
+			x = _mm_min_ps(x, _mm_set1_ps(float(DT::MAX)));
+			return _mm_cvttps_epi32(x);
+		}
+
+		/* 2^31 cannot be represented as int32_t, and the
+		   conversion yields 0x80000000 for it; flip those
+		   to 0x7fffffff */
+		const __m128 limit = _mm_set1_ps(2147483648.f);
+		const __m128i overflow =
+			_mm_castps_si128(_mm_cmpge_ps(x, limit));
+		return _mm_xor_si128(_mm_cvttps_epi32(x), overflow);
+	}
+
+	void Convert(typename DT::pointer_type dest, const float *src,
+		     size_t n) const {
+		const __m128 factor =
+			_mm_set1_ps(float(uint64_t(1) << (DT::BITS - 1)));
+
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, src += BLOCK_SIZE, dest += BLOCK_SIZE) {
+			__m128i v[4];
+			for (unsigned j = 0; j < 4; ++j)
+				v[j] = Convert4(_mm_loadu_ps(src + 4 * j),
+						factor);
+			Sse2Store16(dest, v);
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,342 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_SSE2_VOLUME_HXX
+#define MPD_PCM_SSE2_VOLUME_HXX
+
+#include "Sse2.hxx"
+#include "Volume.hxx"
+#include "VectorDither.hxx"
+#include "Compiler.h"
+
+/*
+ * Software volume and mixing kernels using SSE2.  Like the
+ * conversion kernels in Sse2.hxx, they process whole blocks of
+ * #BLOCK_SIZE samples only; the caller is responsible for the rest
+ * (see GlueVolumeKernel).  The results are bit-exact with
+ * #PortableVolumeKernel.
+ */
+
+/**
+ * Multiply packed 32 bit integers, keeping the lower 32 bits of each
+ * product.  SSE2 has no _mm_mullo_epi32().
+ */
+static inline __m128i
+Sse2MulLo32(__m128i a, __m128i b)
+{
+	const __m128i even = _mm_mul_epu32(a, b);
+	const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32),
+					  _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, 0x08),
+				  _mm_shuffle_epi32(odd, 0x08));
+}
+
+static inline void
+Sse2LoadDither(__m128i state[2], const PcmVectorDither &dither)
+{
+	state[0] = _mm_loadu_si128((const __m128i *)dither.random);
+	state[1] = _mm_loadu_si128((const __m128i *)(dither.random + 4));
+}
+
+static inline void
+Sse2StoreDither(PcmVectorDither &dither, const __m128i state[2])
+{
+	_mm_storeu_si128((__m128i *)dither.random, state[0]);
+	_mm_storeu_si128((__m128i *)(dither.random + 4), state[1]);
+}
+
+/**
+ * Advance the random number generators of four lanes and return
+ * their dither values plus the rounding offset.  See
+ * PcmVectorDither::Next().
+ */
+template<unsigned scale_bits>
+static inline __m128i
+Sse2NextDither(__m128i &state)
+{
+	const __m128i rnd =
+		_mm_add_epi32(Sse2MulLo32(state,
+					  _mm_set1_epi32(PCM_PRNG_MULTIPLIER)),
+			      _mm_set1_epi32(PCM_PRNG_INCREMENT));
+	const __m128i d = _mm_sub_epi32(_mm_srli_epi32(rnd, 32 - scale_bits),
+					_mm_srli_epi32(state, 32 - scale_bits));
+	state = rnd;
+
+	return _mm_add_epi32(d, _mm_set1_epi32(1 << (scale_bits - 1)));
+}
+
+/**
+ * Round, dither and shift four 32 bit values.  Clipping is left to
+ * the saturating Sse2Store16().
+ */
+template<unsigned scale_bits>
+static inline __m128i
+Sse2DitherShift(__m128i v, __m128i &state)
+{
+	v = _mm_add_epi32(v, Sse2NextDither<scale_bits>(state));
+	return _mm_srai_epi32(v, scale_bits);
+}
+
+/**
+ * Convert four 32 bit integers to double.
+ */
+static inline void
+Sse2ToDouble(__m128d d[2], __m128i v)
+{
+	d[0] = _mm_cvtepi32_pd(v);
+	d[1] = _mm_cvtepi32_pd(_mm_unpackhi_epi64(v, v));
+}
+
+/**
+ * Divide two integral double values by 2^scale_bits, rounding
+ * towards negative infinity like an arithmetic right shift does, and
+ * clip them to the range of the destination format.  The result is
+ * in the lower half of the return value.
+ */
+template<class Traits, unsigned scale_bits>
+static inline __m128i
+Sse2ShiftClip(__m128d x)
+{
+	x = _mm_mul_pd(x, _mm_set1_pd(1.0 / (1 << scale_bits)));
+	x = _mm_max_pd(x, _mm_set1_pd(Traits::MIN));
+	x = _mm_min_pd(x, _mm_set1_pd(Traits::MAX));
+
+	/* truncate towards zero, and subtract one where that has
+	   rounded a negative value up; this must not rely on
+	   floating point tricks which -ffast-math may optimize
+	   away */
+	const __m128i t = _mm_cvttpd_epi32(x);
+	__m128d r = _mm_cvtepi32_pd(t);
+	r = _mm_sub_pd(r, _mm_and_pd(_mm_cmpgt_pd(r, x), _mm_set1_pd(1)));
+	return _mm_cvttpd_epi32(r);
+}
+
+/**
+ * Round, dither, shift and clip four values which are too large for
+ * 32 bit integers and are therefore passed as (exact) double values.
+ */
+template<class Traits, unsigned scale_bits>
+static inline __m128i
+Sse2DitherShiftWide(__m128d x[2], __m128i &state)
+{
+	__m128d d[2];
+	Sse2ToDouble(d, Sse2NextDither<scale_bits>(state));
+
+	const __m128i lo =
+		Sse2ShiftClip<Traits, scale_bits>(_mm_add_pd(x[0], d[0]));
+	const __m128i hi =
+		Sse2ShiftClip<Traits, scale_bits>(_mm_add_pd(x[1], d[1]));
+	return _mm_unpacklo_epi64(lo, hi);
+}
+
+/**
+ * Kernels for formats whose products fit into 32 bit (S8 and S16).
+ */
+template<SampleFormat F, class Traits=SampleTraits<F>>
+struct Sse2NarrowVolumeKernel {
+	static_assert(sizeof(typename Traits::long_type) == 4,
+		      "32 bit products expected");
+
+	typedef typename Traits::pointer_type pointer_type;
+	typedef typename Traits::const_pointer_type const_pointer_type;
+
+	static constexpr size_t BLOCK_SIZE = 16;
+
+	static void Volume(PcmVectorDither &dither,
+			   pointer_type dest, const_pointer_type src,
+			   size_t n, int volume) {
+		const __m128i v1 = _mm_set1_epi32(volume);
+
+		__m128i state[2];
+		Sse2LoadDither(state, dither);
+
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, src += BLOCK_SIZE, dest += BLOCK_SIZE) {
+			__m128i v[4];
+			Sse2Load16(v, src);
+
+			for (unsigned j = 0; j < 4; ++j)
+				v[j] = Sse2DitherShift<PCM_VOLUME_BITS>(Sse2MulLo32(v[j], v1),
+									state[j & 1]);
+
+			Sse2Store16(dest, v);
+		}
+
+		Sse2StoreDither(dither, state);
+	}
+
+	static void AddVolume(PcmVectorDither &dither,
+			      pointer_type a, const_pointer_type b,
+			      size_t n, int volume1, int volume2) {
+		const __m128i v1 = _mm_set1_epi32(volume1);
+		const __m128i v2 = _mm_set1_epi32(volume2);
+
+		__m128i state[2];
+		Sse2LoadDither(state, dither);
+
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, a += BLOCK_SIZE, b += BLOCK_SIZE) {
+			__m128i va[4], vb[4];
+			Sse2Load16(va, a);
+			Sse2Load16(vb, b);
+
+			for (unsigned j = 0; j < 4; ++j) {
+				const __m128i c =
+					_mm_add_epi32(Sse2MulLo32(va[j], v1),
+						      Sse2MulLo32(vb[j], v2));
+				va[j] = Sse2DitherShift<PCM_VOLUME_BITS>(c,
+									 state[j & 1]);
+			}
+
+			Sse2Store16(a, va);
+		}
+
+		Sse2StoreDither(dither, state);
+	}
+};
+
+/**
+ * Kernels for formats whose products need more than 32 bit (S24_P32
+ * and S32).  SSE2 has neither a signed 32x32->64 bit multiplication
+ * nor 64 bit comparisons, so this calculates with double, which
+ * represents all products exactly.
+ */
+template<SampleFormat F, class Traits=SampleTraits<F>>
+struct Sse2WideVolumeKernel {
+	typedef typename Traits::pointer_type pointer_type;
+	typedef typename Traits::const_pointer_type const_pointer_type;
+
+	static constexpr size_t BLOCK_SIZE = 16;
+
+	static void Volume(PcmVectorDither &dither,
+			   pointer_type dest, const_pointer_type src,
+			   size_t n, int volume) {
+		const __m128d v1 = _mm_set1_pd(volume);
+
+		__m128i state[2];
+		Sse2LoadDither(state, dither);
+
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, src += BLOCK_SIZE, dest += BLOCK_SIZE) {
+			__m128i v[4];
+			Sse2Load16(v, src);
+
+			for (unsigned j = 0; j < 4; ++j) {
+				__m128d x[2];
+				Sse2ToDouble(x, v[j]);
+				x[0] = _mm_mul_pd(x[0], v1);
+				x[1] = _mm_mul_pd(x[1], v1);
+
+				v[j] = Sse2DitherShiftWide<Traits, PCM_VOLUME_BITS>(x, state[j & 1]);
+			}
+
+			Sse2Store16(dest, v);
+		}
+
+		Sse2StoreDither(dither, state);
+	}
+
+	static void AddVolume(PcmVectorDither &dither,
+			      pointer_type a, const_pointer_type b,
+			      size_t n, int volume1, int volume2) {
+		const __m128d v1 = _mm_set1_pd(volume1);
+		const __m128d v2 = _mm_set1_pd(volume2);
+
+		__m128i state[2];
+		Sse2LoadDither(state, dither);
+
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, a += BLOCK_SIZE, b += BLOCK_SIZE) {
+			__m128i va[4], vb[4];
+			Sse2Load16(va, a);
+			Sse2Load16(vb, b);
+
+			for (unsigned j = 0; j < 4; ++j) {
+				__m128d x[2], y[2];
+				Sse2ToDouble(x, va[j]);
+				Sse2ToDouble(y, vb[j]);
+				x[0] = _mm_add_pd(_mm_mul_pd(x[0], v1),
+						  _mm_mul_pd(y[0], v2));
+				x[1] = _mm_add_pd(_mm_mul_pd(x[1], v1),
+						  _mm_mul_pd(y[1], v2));
+
+				va[j] = Sse2DitherShiftWide<Traits, PCM_VOLUME_BITS>(x, state[j & 1]);
+			}
+
+			Sse2Store16(a, va);
+		}
+
+		Sse2StoreDither(dither, state);
+	}
+};
+
+struct Sse2FloatVolumeKernel {
+	static constexpr size_t BLOCK_SIZE = 16;
+
+	static void Volume(gcc_unused PcmVectorDither &dither,
+			   float *dest, const float *src,
+			   size_t n, int volume) {
+		const __m128 v1 = _mm_set1_ps(pcm_volume_to_float(volume));
+
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, src += BLOCK_SIZE, dest += BLOCK_SIZE)
+			for (unsigned j = 0; j < BLOCK_SIZE; j += 4)
+				_mm_storeu_ps(dest + j,
+					      _mm_mul_ps(_mm_loadu_ps(src + j),
+							 v1));
+	}
+
+	static void AddVolume(gcc_unused PcmVectorDither &dither,
+			      float *a, const float *b,
+			      size_t n, int volume1, int volume2) {
+		const __m128 v1 = _mm_set1_ps(pcm_volume_to_float(volume1));
+		const __m128 v2 = _mm_set1_ps(pcm_volume_to_float(volume2));
+
+		for (size_t i = 0; i < n / BLOCK_SIZE;
+		     ++i, a += BLOCK_SIZE, b += BLOCK_SIZE)
+			for (unsigned j = 0; j < BLOCK_SIZE; j += 4)
+				_mm_storeu_ps(a + j,
+					      _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a + j), v1),
+							 _mm_mul_ps(_mm_loadu_ps(b + j), v2)));
+	}
+};
+
+template<SampleFormat F>
+struct Sse2VolumeKernel;
+
+template<>
+struct Sse2VolumeKernel<SampleFormat::S8>
+	: Sse2NarrowVolumeKernel<SampleFormat::S8> {};
+
+template<>
+struct Sse2VolumeKernel<SampleFormat::S16>
+	: Sse2NarrowVolumeKernel<SampleFormat::S16> {};
+
+template<>
+struct Sse2VolumeKernel<SampleFormat::S24_P32>
+	: Sse2WideVolumeKernel<SampleFormat::S24_P32> {};
+
+template<>
+struct Sse2VolumeKernel<SampleFormat::S32>
+	: Sse2WideVolumeKernel<SampleFormat::S32> {};
+
+template<>
+struct Sse2VolumeKernel<SampleFormat::FLOAT> : Sse2FloatVolumeKernel {};
+
+#endif
@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "ThreadedResampler.hxx"
+#include "AudioFormat.hxx"
+#include "Domain.hxx"
+#include "thread/Name.hxx"
+#include "thread/Util.hxx"
+#include "thread/Policy.hxx"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <string.h>
+
+AudioFormat
+ThreadedPcmResampler::Open(AudioFormat &af, unsigned new_sample_rate,
+			   Error &error)
+{
+	assert(af.IsValid());
+	assert(n_groups == 0);
+
+	channels = af.channels;
+	n_groups = std::max(std::min(max_threads, channels), 1u);
+	groups.reset(new Group[n_groups]);
+
+	AudioFormat result = AudioFormat::Undefined();
+	AudioFormat requested = af;
+
+	for (unsigned i = 0; i < n_groups; ++i) {
+		Group &g = groups[i];
+		g.parent = this;
+		g.first_channel = i * channels / n_groups;
+		g.n_channels = (i + 1) * channels / n_groups - g.first_channel;
+		g.resampler = factory();
+
+		AudioFormat group_format = af;
+		group_format.channels = g.n_channels;
+
+		const AudioFormat group_result =
+			g.resampler->Open(group_format, new_sample_rate, error);
+		if (!group_result.IsValid()) {
+			delete g.resampler;
+			g.resampler = nullptr;
+			DeleteResamplers();
+			return AudioFormat::Undefined();
+		}
+
+		/* all instances are of the same class, so they all
+		   request the same formats */
+		requested.format = group_format.format;
+		result = group_result;
+		result.channels = channels;
+	}
+
+	af = requested;
+	src_sample_size = sample_format_size(af.format);
+	dest_sample_size = sample_format_size(result.format);
+
+	generation = 0;
+	pending = 0;
+	quit = false;
+
+	for (unsigned i = 1; i < n_groups; ++i) {
+		if (!groups[i].thread.Start(Run, &groups[i], error)) {
+			StopWorkers(i);
+			DeleteResamplers();
+			return AudioFormat::Undefined();
+		}
+	}
+
+	return result;
+}
+
+void
+ThreadedPcmResampler::StopWorkers(unsigned n)
+{
+	mutex.lock();
+	quit = true;
+	work_cond.broadcast();
+	mutex.unlock();
+
+	for (unsigned i = 1; i < n; ++i)
+		groups[i].thread.Join();
+}
+
+void
+ThreadedPcmResampler::DeleteResamplers()
+{
+	for (unsigned i = 0; i < n_groups; ++i) {
+		Group &g = groups[i];
+		if (g.resampler != nullptr) {
+			g.resampler->Close();
+			delete g.resampler;
+		}
+	}
+
+	groups.reset();
+	n_groups = 0;
+}
+
+void
+ThreadedPcmResampler::Close()
+{
+	StopWorkers(n_groups);
+	DeleteResamplers();
+}
+
+inline void
+ThreadedPcmResampler::Run(Group &g)
+{
+	SetThreadName("resampler");
+
+	/* this thread does the work of an output thread */
+	if (!ApplyThreadPolicy(ThreadClass::OUTPUT))
+		SetThreadRealtime();
+
+	unsigned done = 0;
+
+	mutex.lock();
+
+	while (true) {
+		while (!quit && generation == done)
+			work_cond.wait(mutex);
+
+		if (quit)
+			break;
+
+		done = generation;
+		mutex.unlock();
+
+		g.error.Clear();
+		g.dest = g.resampler->Resample(g.src, g.error);
+
+		mutex.lock();
+		if (--pending == 0)
+			done_cond.signal();
+	}
+
+	mutex.unlock();
+}
+
+void
+ThreadedPcmResampler::Run(void *ctx)
+{
+	Group &g = *(Group *)ctx;
+	g.parent->Run(g);
+}
+
+/**
+ * Copy a range of channels from one interleaved buffer to another.
+ */
+static void
+CopyChannels(uint8_t *dest, size_t dest_frame_size,
+	     const uint8_t *src, size_t src_frame_size,
+	     size_t size, size_t n_frames)
+{
+	for (size_t i = 0; i < n_frames; ++i,
+		     dest += dest_frame_size, src += src_frame_size)
+		memcpy(dest, src, size);
+}
+
+ConstBuffer<void>
+ThreadedPcmResampler::Resample(ConstBuffer<void> src, Error &error)
+{
+	assert(n_groups > 0);
+
+	if (n_groups == 1)
+		return groups[0].resampler->Resample(src, error);
+
+	const size_t src_frame_size = channels * src_sample_size;
+	assert(src.size % src_frame_size == 0);
+	const size_t n_frames = src.size / src_frame_size;
+
+	for (unsigned i = 0; i < n_groups; ++i) {
+		Group &g = groups[i];
+		const size_t group_frame_size = g.n_channels * src_sample_size;
+		const size_t size = n_frames * group_frame_size;
+		uint8_t *p = (uint8_t *)g.buffer.Get(size);
+		CopyChannels(p, group_frame_size,
+			     (const uint8_t *)src.data + g.first_channel * src_sample_size,
+			     src_frame_size,
+			     group_frame_size, n_frames);
+		g.src = { p, size };
+	}
+
+	mutex.lock();
+	++generation;
+	pending = n_groups - 1;
+	work_cond.broadcast();
+	mutex.unlock();
+
+	Group &first = groups[0];
+	first.error.Clear();
+	first.dest = first.resampler->Resample(first.src, first.error);
+
+	mutex.lock();
+	while (pending > 0)
+		done_cond.wait(mutex);
+	mutex.unlock();
+
+	for (unsigned i = 0; i < n_groups; ++i) {
+		if (groups[i].dest.IsNull()) {
+			error.Set(groups[i].error);
+			return nullptr;
+		}
+	}
+
+	/* all groups must have generated the same number of frames */
+	const size_t n_output = first.dest.size /
+		(first.n_channels * dest_sample_size);
+	for (unsigned i = 1; i < n_groups; ++i) {
+		if (groups[i].dest.size !=
+		    n_output * groups[i].n_channels * dest_sample_size) {
+			error.Set(pcm_domain,
+				  "Resampler output size mismatch");
+			return nullptr;
+		}
+	}
+
+	const size_t dest_frame_size = channels * dest_sample_size;
+	uint8_t *dest = (uint8_t *)buffer.Get(n_output * dest_frame_size);
+	for (unsigned i = 0; i < n_groups; ++i) {
+		const Group &g = groups[i];
+		const size_t group_frame_size = g.n_channels * dest_sample_size;
+		CopyChannels(dest + g.first_channel * dest_sample_size,
+			     dest_frame_size,
+			     (const uint8_t *)g.dest.data, group_frame_size,
+			     group_frame_size, n_output);
+	}
+
+	return { dest, n_output * dest_frame_size };
+}
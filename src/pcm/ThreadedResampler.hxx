@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_THREADED_RESAMPLER_HXX
+#define MPD_PCM_THREADED_RESAMPLER_HXX
+
+#include "Resampler.hxx"
+#include "PcmBuffer.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+#include "util/Error.hxx"
+#include "Compiler.h"
+
+#include <memory>
+
+#include <stddef.h>
+
+/**
+ * A #PcmResampler which splits the channels into groups and
+ * resamples each group with its own #PcmResampler instance.  All but
+ * the first group are processed by worker threads, while the calling
+ * thread processes the first one.
+ */
+class ThreadedPcmResampler final : public PcmResampler {
+	struct Group {
+		ThreadedPcmResampler *parent;
+
+		PcmResampler *resampler;
+
+		unsigned first_channel, n_channels;
+
+		PcmBuffer buffer;
+
+		ConstBuffer<void> src, dest;
+
+		Error error;
+
+		/**
+		 * The worker thread; not used for the first group.
+		 */
+		Thread thread;
+
+		Group():resampler(nullptr) {}
+	};
+
+	/**
+	 * Creates the resampler for one group.
+	 */
+	PcmResampler *(*const factory)();
+
+	const unsigned max_threads;
+
+	std::unique_ptr<Group[]> groups;
+	unsigned n_groups;
+
+	unsigned channels;
+	size_t src_sample_size, dest_sample_size;
+
+	/**
+	 * Protects #generation, #pending and #quit.
+	 */
+	Mutex mutex;
+
+	/**
+	 * Signals the workers that #generation has been incremented
+	 * or that #quit has been set.
+	 */
+	Cond work_cond;
+
+	/**
+	 * Signalled by the last worker which has finished.
+	 */
+	Cond done_cond;
+
+	/**
+	 * Incremented for each Resample() call.
+	 */
+	unsigned generation;
+
+	/**
+	 * The number of workers which have not yet finished the
+	 * current #generation.
+	 */
+	unsigned pending;
+
+	bool quit;
+
+	PcmBuffer buffer;
+
+public:
+	/**
+	 * @param _max_threads the maximum number of groups (including
+	 * the calling thread)
+	 */
+	ThreadedPcmResampler(PcmResampler *(*_factory)(),
+			     unsigned _max_threads)
+		:factory(_factory), max_threads(_max_threads),
+		 n_groups(0) {}
+
+	virtual AudioFormat Open(AudioFormat &af, unsigned new_sample_rate,
+				 Error &error) override;
+	virtual void Close() override;
+	virtual ConstBuffer<void> Resample(ConstBuffer<void> src,
+					   Error &error) override;
+
+private:
+	void StopWorkers(unsigned n);
+	void DeleteResamplers();
+
+	void Run(Group &group);
+	static void Run(void *ctx);
+};
+
+#endif
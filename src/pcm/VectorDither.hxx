@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_VECTOR_DITHER_HXX
+#define MPD_PCM_VECTOR_DITHER_HXX
+
+#include "PcmPrng.hxx"
+
+#include <stdint.h>
+
+/**
+ * The dithering state of the vectorized volume and mixing kernels
+ * (see VolumeKernels.hxx).
+ *
+ * Unlike #PcmDither, this does not do noise shaping: its error
+ * feedback makes each sample depend on the previous one, which
+ * cannot be vectorized.  Instead, sample number i is assigned to
+ * lane (i % #LANES), and each lane has its own random number
+ * generator producing triangular (high-pass) dither.  The upper bits
+ * of pcm_prng() are used, because they are more random than the
+ * lower ones.
+ */
+class PcmVectorDither {
+	static constexpr uint32_t SEED = 0x9e3779b9;
+
+public:
+	static constexpr unsigned LANES = 8;
+
+	/**
+	 * The pcm_prng() state of each lane.  The SIMD kernels load
+	 * and store it directly.
+	 */
+	uint32_t random[LANES];
+
+	constexpr PcmVectorDither()
+		:random{SEED, 2 * SEED, 3 * SEED, 4 * SEED,
+			5 * SEED, 6 * SEED, 7 * SEED, 8 * SEED} {}
+
+	/**
+	 * Advance the random number generator of the given lane and
+	 * return the dither value for discarding #scale_bits bits.
+	 */
+	template<unsigned scale_bits>
+	int32_t Next(unsigned lane) {
+		const uint32_t old = random[lane];
+		const uint32_t rnd = pcm_prng(old);
+		random[lane] = rnd;
+
+		return int32_t(rnd >> (32 - scale_bits)) -
+			int32_t(old >> (32 - scale_bits));
+	}
+
+	/**
+	 * Shift the given sample by #SBITS-#DBITS to the right,
+	 * applying rounding, dither and clipping.  This is the
+	 * portable equivalent of what the SIMD kernels do.
+	 *
+	 * @tparam T the input sample type
+	 * @tparam SBITS the input bit width
+	 * @tparam DBITS the output bit width
+	 * @param sample the input sample value
+	 * @param lane the lane this sample is assigned to
+	 */
+	template<typename T, unsigned SBITS, unsigned DBITS>
+	T DitherShift(T sample, unsigned lane) {
+		static_assert(sizeof(T) * 8 > SBITS, "Source type too small");
+		static_assert(SBITS > DBITS, "Non-positive scale_bits");
+
+		constexpr unsigned scale_bits = SBITS - DBITS;
+		constexpr T MIN = -(T(1) << (SBITS - 1));
+		constexpr T MAX = (T(1) << (SBITS - 1)) - 1;
+
+		T output = sample + (T(1) << (scale_bits - 1)) +
+			Next<scale_bits>(lane);
+
+		if (output > MAX)
+			output = MAX;
+		else if (output < MIN)
+			output = MIN;
+
+		return output >> scale_bits;
+	}
+};
+
+#endif
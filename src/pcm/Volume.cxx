@@ -19,6 +19,7 @@
 
 #include "config.h"
 #include "Volume.hxx"
+#include "VolumeKernels.hxx"
 #include "Domain.hxx"
 #include "PcmUtils.hxx"
 #include "Traits.hxx"
@@ -60,7 +61,12 @@ pcm_volume_change_8(PcmDither &dither,
 		    int8_t *dest, const int8_t *src, size_t n,
 		    int volume)
 {
+#ifdef HAVE_PCM_VECTOR_VOLUME
+	PcmVectorVolume<SampleFormat::S8>(dither.GetVector(), dest, src, n,
+					  volume);
+#else
 	pcm_volume_change<SampleFormat::S8>(dither, dest, src, n, volume);
+#endif
 }
 
 static void
@@ -68,7 +74,12 @@ pcm_volume_change_16(PcmDither &dither,
 		     int16_t *dest, const int16_t *src, size_t n,
 		     int volume)
 {
+#ifdef HAVE_PCM_VECTOR_VOLUME
+	PcmVectorVolume<SampleFormat::S16>(dither.GetVector(), dest, src, n,
+					   volume);
+#else
 	pcm_volume_change<SampleFormat::S16>(dither, dest, src, n, volume);
+#endif
 }
 
 static void
@@ -76,8 +87,13 @@ pcm_volume_change_24(PcmDither &dither,
 		     int32_t *dest, const int32_t *src, size_t n,
 		     int volume)
 {
+#ifdef HAVE_PCM_VECTOR_VOLUME
+	PcmVectorVolume<SampleFormat::S24_P32>(dither.GetVector(), dest, src, n,
+					       volume);
+#else
 	pcm_volume_change<SampleFormat::S24_P32>(dither, dest, src, n,
 						 volume);
+#endif
 }
 
 static void
@@ -85,15 +101,28 @@ pcm_volume_change_32(PcmDither &dither,
 		     int32_t *dest, const int32_t *src, size_t n,
 		     int volume)
 {
+#ifdef HAVE_PCM_VECTOR_VOLUME
+	PcmVectorVolume<SampleFormat::S32>(dither.GetVector(), dest, src, n,
+					   volume);
+#else
 	pcm_volume_change<SampleFormat::S32>(dither, dest, src, n, volume);
+#endif
 }
 
 static void
-pcm_volume_change_float(float *dest, const float *src, size_t n,
-			float volume)
+pcm_volume_change_float(gcc_unused PcmDither &dither,
+			float *dest, const float *src, size_t n,
+			int volume)
 {
+#ifdef HAVE_PCM_VECTOR_VOLUME
+	PcmVectorVolume<SampleFormat::FLOAT>(dither.GetVector(), dest, src, n,
+					     volume);
+#else
+	const float v = pcm_volume_to_float(volume);
+
 	for (size_t i = 0; i != n; ++i)
-		dest[i] = src[i] * volume;
+		dest[i] = src[i] * v;
+#endif
 }
 
 bool
@@ -131,13 +160,25 @@ PcmVolume::Apply(ConstBuffer<void> src)
 		return src;
 
 	void *data = buffer.Get(src.size);
+	ApplyTo(src, data);
+	return { data, src.size };
+}
+
+void
+PcmVolume::ApplyTo(ConstBuffer<void> src, void *dest)
+{
+	if (volume == PCM_VOLUME_1) {
+		if (dest != src.data)
+			memcpy(dest, src.data, src.size);
+		return;
+	}
 
 	if (volume == 0) {
 		/* optimized special case: 0% volume = memset(0) */
 		/* TODO: is this valid for all sample formats? What
 		   about floating point? */
-		memset(data, 0, src.size);
-		return { data, src.size };
+		memset(dest, 0, src.size);
+		return;
 	}
 
 	switch (format) {
@@ -146,44 +187,44 @@ PcmVolume::Apply(ConstBuffer<void> src)
 		gcc_unreachable();
 
 	case SampleFormat::S8:
-		pcm_volume_change_8(dither, (int8_t *)data,
+		pcm_volume_change_8(dither, (int8_t *)dest,
 				    (const int8_t *)src.data,
 				    src.size / sizeof(int8_t),
 				    volume);
 		break;
 
 	case SampleFormat::S16:
-		pcm_volume_change_16(dither, (int16_t *)data,
+		pcm_volume_change_16(dither, (int16_t *)dest,
 				     (const int16_t *)src.data,
 				     src.size / sizeof(int16_t),
 				     volume);
 		break;
 
 	case SampleFormat::S24_P32:
-		pcm_volume_change_24(dither, (int32_t *)data,
+		pcm_volume_change_24(dither, (int32_t *)dest,
 				     (const int32_t *)src.data,
 				     src.size / sizeof(int32_t),
 				     volume);
 		break;
 
 	case SampleFormat::S32:
-		pcm_volume_change_32(dither, (int32_t *)data,
+		pcm_volume_change_32(dither, (int32_t *)dest,
 				     (const int32_t *)src.data,
 				     src.size / sizeof(int32_t),
 				     volume);
 		break;
 
 	case SampleFormat::FLOAT:
-		pcm_volume_change_float((float *)data,
+		pcm_volume_change_float(dither, (float *)dest,
 					(const float *)src.data,
 					src.size / sizeof(float),
-					pcm_volume_to_float(volume));
+					volume);
 		break;
 
 	case SampleFormat::DSD:
 		// TODO: implement this; currently, it's a no-op
-		return src;
+		if (dest != src.data)
+			memcpy(dest, src.data, src.size);
+		break;
 	}
-
-	return { data, src.size };
 }
@@ -125,6 +125,15 @@ public:
 	 */
 	gcc_pure
 	ConstBuffer<void> Apply(ConstBuffer<void> src);
+
+	/**
+	 * Apply the volume level, writing the result to a buffer
+	 * owned by the caller.
+	 *
+	 * @param dest the destination buffer with src.size bytes; may
+	 * be equal to src.data
+	 */
+	void ApplyTo(ConstBuffer<void> src, void *dest);
 };
 
 #endif
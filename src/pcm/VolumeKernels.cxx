@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "VolumeKernels.hxx"
+
+#ifdef HAVE_PCM_VECTOR_VOLUME
+
+#include "Sse2Volume.hxx"
+#include "CpuFeatures.hxx"
+#ifdef HAVE_AVX2_DISPATCH
+#include "Avx2Volume.hxx"
+#endif
+
+template<SampleFormat F, class Traits>
+void
+PcmVectorVolume(PcmVectorDither &dither,
+		typename Traits::pointer_type dest,
+		typename Traits::const_pointer_type src,
+		size_t n, int volume)
+{
+#ifdef HAVE_AVX2_DISPATCH
+	if (CpuHasAvx2()) {
+		GlueVolumeKernel<F, Avx2VolumeKernel<F>>::Volume(dither,
+								 dest, src,
+								 n, volume);
+		return;
+	}
+#endif
+
+	GlueVolumeKernel<F, Sse2VolumeKernel<F>>::Volume(dither, dest, src,
+							 n, volume);
+}
+
+template<SampleFormat F, class Traits>
+void
+PcmVectorAddVolume(PcmVectorDither &dither,
+		   typename Traits::pointer_type a,
+		   typename Traits::const_pointer_type b,
+		   size_t n, int volume1, int volume2)
+{
+#ifdef HAVE_AVX2_DISPATCH
+	if (CpuHasAvx2()) {
+		GlueVolumeKernel<F, Avx2VolumeKernel<F>>::AddVolume(dither,
+								    a, b, n,
+								    volume1,
+								    volume2);
+		return;
+	}
+#endif
+
+	GlueVolumeKernel<F, Sse2VolumeKernel<F>>::AddVolume(dither, a, b, n,
+							    volume1, volume2);
+}
+
+#define INSTANTIATE(F) \
+	template void \
+	PcmVectorVolume<F>(PcmVectorDither &, \
+			   SampleTraits<F>::pointer_type, \
+			   SampleTraits<F>::const_pointer_type, \
+			   size_t, int); \
+	template void \
+	PcmVectorAddVolume<F>(PcmVectorDither &, \
+			      SampleTraits<F>::pointer_type, \
+			      SampleTraits<F>::const_pointer_type, \
+			      size_t, int, int)
+
+INSTANTIATE(SampleFormat::S8);
+INSTANTIATE(SampleFormat::S16);
+INSTANTIATE(SampleFormat::S24_P32);
+INSTANTIATE(SampleFormat::S32);
+INSTANTIATE(SampleFormat::FLOAT);
+
+#endif
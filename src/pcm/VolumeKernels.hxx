@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_VOLUME_KERNELS_HXX
+#define MPD_PCM_VOLUME_KERNELS_HXX
+
+#include "Volume.hxx"
+#include "VectorDither.hxx"
+#include "Traits.hxx"
+#include "Compiler.h"
+
+#include <stddef.h>
+
+/**
+ * Defined if there are SIMD volume and mixing kernels for this
+ * architecture.  Without them, #PcmVolume and pcm_mix() use the
+ * noise shaping #PcmDither.
+ */
+#ifdef __SSE2__
+#define HAVE_PCM_VECTOR_VOLUME
+#endif
+
+/**
+ * The portable implementation of the volume and mixing kernels.  It
+ * processes the remainder of a buffer which is not a multiple of the
+ * SIMD block size, and it specifies the results of the SIMD kernels.
+ */
+template<SampleFormat F, class Traits=SampleTraits<F>>
+struct PortableVolumeKernel {
+	typedef typename Traits::pointer_type pointer_type;
+	typedef typename Traits::const_pointer_type const_pointer_type;
+	typedef typename Traits::long_type long_type;
+
+	static constexpr size_t BLOCK_SIZE = 1;
+
+	static long_type DitherShift(PcmVectorDither &dither,
+				     long_type sample, size_t i) {
+		return dither.DitherShift<long_type,
+					  Traits::BITS + PCM_VOLUME_BITS,
+					  Traits::BITS>(sample,
+							i % PcmVectorDither::LANES);
+	}
+
+	static void Volume(PcmVectorDither &dither,
+			   pointer_type dest, const_pointer_type src,
+			   size_t n, int volume) {
+		for (size_t i = 0; i != n; ++i)
+			dest[i] = DitherShift(dither, long_type(src[i]) * volume,
+					      i);
+	}
+
+	static void AddVolume(PcmVectorDither &dither,
+			      pointer_type a, const_pointer_type b,
+			      size_t n, int volume1, int volume2) {
+		for (size_t i = 0; i != n; ++i)
+			a[i] = DitherShift(dither,
+					   long_type(a[i]) * volume1 +
+					   long_type(b[i]) * volume2,
+					   i);
+	}
+};
+
+template<>
+struct PortableVolumeKernel<SampleFormat::FLOAT> {
+	static constexpr size_t BLOCK_SIZE = 1;
+
+	static void Volume(gcc_unused PcmVectorDither &dither,
+			   float *dest, const float *src,
+			   size_t n, int volume) {
+		const float v1 = pcm_volume_to_float(volume);
+
+		for (size_t i = 0; i != n; ++i)
+			dest[i] = src[i] * v1;
+	}
+
+	static void AddVolume(gcc_unused PcmVectorDither &dither,
+			      float *a, const float *b,
+			      size_t n, int volume1, int volume2) {
+		const float v1 = pcm_volume_to_float(volume1);
+		const float v2 = pcm_volume_to_float(volume2);
+
+		for (size_t i = 0; i != n; ++i)
+			a[i] = a[i] * v1 + b[i] * v2;
+	}
+};
+
+/**
+ * Run a SIMD kernel on all whole blocks, and #PortableVolumeKernel on
+ * the rest.
+ */
+template<SampleFormat F, class Optimized, class Traits=SampleTraits<F>>
+struct GlueVolumeKernel {
+	static_assert(Optimized::BLOCK_SIZE % PcmVectorDither::LANES == 0,
+		      "Block size must be a multiple of the number of lanes");
+
+	typedef PortableVolumeKernel<F> Portable;
+
+	static void Volume(PcmVectorDither &dither,
+			   typename Traits::pointer_type dest,
+			   typename Traits::const_pointer_type src,
+			   size_t n, int volume) {
+		const size_t n1 = n - n % Optimized::BLOCK_SIZE;
+		Optimized::Volume(dither, dest, src, n1, volume);
+		Portable::Volume(dither, dest + n1, src + n1, n - n1, volume);
+	}
+
+	static void AddVolume(PcmVectorDither &dither,
+			      typename Traits::pointer_type a,
+			      typename Traits::const_pointer_type b,
+			      size_t n, int volume1, int volume2) {
+		const size_t n1 = n - n % Optimized::BLOCK_SIZE;
+		Optimized::AddVolume(dither, a, b, n1, volume1, volume2);
+		Portable::AddVolume(dither, a + n1, b + n1, n - n1,
+				    volume1, volume2);
+	}
+};
+
+#ifdef HAVE_PCM_VECTOR_VOLUME
+
+/**
+ * Change the volume of the given samples using the best SIMD kernel
+ * this CPU supports.
+ *
+ * @param volume the volume between 0 and #PCM_VOLUME_1 (may be
+ * bigger than #PCM_VOLUME_1)
+ */
+template<SampleFormat F, class Traits=SampleTraits<F>>
+void
+PcmVectorVolume(PcmVectorDither &dither,
+		typename Traits::pointer_type dest,
+		typename Traits::const_pointer_type src,
+		size_t n, int volume);
+
+/**
+ * Mix the samples in #b into #a, each multiplied with its volume,
+ * using the best SIMD kernel this CPU supports.
+ */
+template<SampleFormat F, class Traits=SampleTraits<F>>
+void
+PcmVectorAddVolume(PcmVectorDither &dither,
+		   typename Traits::pointer_type a,
+		   typename Traits::const_pointer_type b,
+		   size_t n, int volume1, int volume2);
+
+#endif
+
+#endif
@@ -21,6 +21,7 @@
 #include "Control.hxx"
 #include "Idle.hxx"
 #include "DetachedSong.hxx"
+#include "decoder/DecoderPrefetch.hxx"
 
 #include <algorithm>
 
@@ -29,15 +30,20 @@
 PlayerControl::PlayerControl(PlayerListener &_listener,
 			     MultipleOutputs &_outputs,
 			     unsigned _buffer_chunks,
+			     size_t _chunk_size,
+			     BufferMemory _buffer_memory,
 			     unsigned _buffered_before_play)
 	:listener(_listener), outputs(_outputs),
 	 buffer_chunks(_buffer_chunks),
+	 chunk_size(_chunk_size),
+	 buffer_memory(_buffer_memory),
 	 buffered_before_play(_buffered_before_play),
 	 command(PlayerCommand::NONE),
 	 state(PlayerState::STOP),
 	 error_type(PlayerError::NONE),
 	 tagged_song(nullptr),
 	 next_song(nullptr),
+	 prefetch(nullptr),
 	 total_play_time(0),
 	 border_pause(false)
 {
@@ -196,6 +202,18 @@ PlayerControl::LockEnqueueSong(DetachedSong *song)
 	EnqueueSongLocked(song);
 }
 
+void
+PlayerControl::LockPrefetch(std::list<std::string> &&uris)
+{
+	const ScopeLock protect(mutex);
+	if (uris == prefetch_uris)
+		return;
+
+	prefetch_uris = std::move(uris);
+	if (prefetch != nullptr)
+		prefetch->Post(std::list<std::string>(prefetch_uris));
+}
+
 bool
 PlayerControl::SeekLocked(DetachedSong *song, SongTime t, Error &error_r)
 {
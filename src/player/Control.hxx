@@ -26,13 +26,19 @@
 #include "thread/Thread.hxx"
 #include "util/Error.hxx"
 #include "CrossFade.hxx"
+#include "MusicBuffer.hxx"
 #include "Chrono.hxx"
 
+#include <list>
+#include <string>
+
 #include <stdint.h>
+#include <stddef.h>
 
 class PlayerListener;
 class MultipleOutputs;
 class DetachedSong;
+class DecoderPrefetch;
 
 enum class PlayerState : uint8_t {
 	STOP,
@@ -100,6 +106,16 @@ struct PlayerControl {
 
 	const unsigned buffer_chunks;
 
+	/**
+	 * The size of each #MusicChunk, see MusicBuffer::GetChunkSize().
+	 */
+	const size_t chunk_size;
+
+	/**
+	 * How the #MusicBuffer memory is allocated.
+	 */
+	const BufferMemory buffer_memory;
+
 	const unsigned buffered_before_play;
 
 	/**
@@ -162,6 +178,19 @@ struct PlayerControl {
 	 */
 	DetachedSong *next_song;
 
+	/**
+	 * The URIs of upcoming songs which shall be opened in
+	 * advance.  See LockPrefetch().
+	 */
+	std::list<std::string> prefetch_uris;
+
+	/**
+	 * The #DecoderPrefetch of the player thread's
+	 * #DecoderControl, or nullptr if the player thread has not
+	 * started yet or is exiting.  Protected by #mutex.
+	 */
+	DecoderPrefetch *prefetch;
+
 	SongTime seek_time;
 
 	CrossFadeSettings cross_fade;
@@ -180,6 +209,8 @@ struct PlayerControl {
 	PlayerControl(PlayerListener &_listener,
 		      MultipleOutputs &_outputs,
 		      unsigned buffer_chunks,
+		      size_t chunk_size,
+		      BufferMemory buffer_memory,
 		      unsigned buffered_before_play);
 	~PlayerControl();
 
@@ -434,6 +465,14 @@ public:
 	 */
 	void LockEnqueueSong(DetachedSong *song);
 
+	/**
+	 * Ask the decoder's #DecoderPrefetch to open the input
+	 * streams of the given upcoming songs in advance.  This does
+	 * not wait for the player thread.  Does nothing if the list
+	 * has not changed since the last call.
+	 */
+	void LockPrefetch(std::list<std::string> &&uris);
+
 	/**
 	 * Makes the player thread seek the specified song to a position.
 	 *
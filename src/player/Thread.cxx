@@ -34,6 +34,7 @@
 #include "Idle.hxx"
 #include "util/Domain.hxx"
 #include "thread/Name.hxx"
+#include "thread/Policy.hxx"
 #include "Log.hxx"
 
 #include <string.h>
@@ -539,7 +540,7 @@ Player::SendSilence()
 	const size_t frame_size = play_audio_format.GetFrameSize();
 	/* this formula ensures that we don't send
 	   partial frames */
-	unsigned num_frames = sizeof(chunk->data) / frame_size;
+	unsigned num_frames = chunk->capacity / frame_size;
 
 	chunk->time = SignedSongTime::Negative(); /* undefined time stamp */
 	chunk->length = num_frames * frame_size;
@@ -1044,6 +1045,7 @@ Player::Run()
 							dc.GetMixRampPreviousEnd(),
 							dc.out_audio_format,
 							play_audio_format,
+							buffer.GetChunkSize(),
 							buffer.GetSize() -
 							pc.buffered_before_play);
 			if (cross_fade_chunks > 0)
@@ -1143,14 +1145,22 @@ player_task(void *arg)
 	PlayerControl &pc = *(PlayerControl *)arg;
 
 	SetThreadName("player");
+	ApplyThreadPolicy(ThreadClass::PLAYER);
 
 	DecoderControl dc(pc.mutex, pc.cond);
 	decoder_thread_start(dc);
 
-	MusicBuffer buffer(pc.buffer_chunks);
+	MusicBuffer buffer(pc.buffer_chunks, pc.chunk_size,
+			   pc.buffer_memory);
 
 	pc.Lock();
 
+	/* from now on, PlayerControl::LockPrefetch() posts directly
+	   to the prefetch thread */
+	pc.prefetch = &dc.prefetch;
+	if (!pc.prefetch_uris.empty())
+		dc.prefetch.Post(std::list<std::string>(pc.prefetch_uris));
+
 	while (1) {
 		switch (pc.command) {
 		case PlayerCommand::SEEK:
@@ -1197,8 +1207,10 @@ player_task(void *arg)
 			break;
 
 		case PlayerCommand::EXIT:
+			pc.prefetch = nullptr;
 			pc.Unlock();
 
+			dc.prefetch.Stop();
 			dc.Quit();
 
 			pc.outputs.Close();
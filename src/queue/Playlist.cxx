@@ -150,6 +150,32 @@ playlist::UpdateQueuedSong(PlayerControl &pc, const DetachedSong *prev)
 		else
 			queued = next_order;
 	}
+
+	UpdatePrefetch(pc);
+}
+
+void
+playlist::UpdatePrefetch(PlayerControl &pc)
+{
+	if (prefetch_songs == 0)
+		return;
+
+	std::list<std::string> uris;
+
+	if (playing && queued >= 0) {
+		int order = queued;
+		for (unsigned i = 0; i < prefetch_songs; ++i) {
+			uris.emplace_back(queue.GetOrder(order).GetRealURI());
+
+			order = queue.GetNextOrder(order);
+			if (order < 0 || order == queued || order == current)
+				/* end of queue, or wrapped around in
+				   "repeat" mode */
+				break;
+		}
+	}
+
+	pc.LockPrefetch(std::move(uris));
 }
 
 void
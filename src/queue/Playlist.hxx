@@ -86,10 +86,17 @@ struct playlist {
 	 */
 	int queued;
 
-	playlist(unsigned max_length)
+	/**
+	 * The number of upcoming songs whose input streams are
+	 * opened in advance.  0 disables this feature.
+	 */
+	const unsigned prefetch_songs;
+
+	playlist(unsigned max_length, unsigned _prefetch_songs=0)
 		:queue(max_length), playing(false),
 		 bulk_edit(false),
-		 current(-1), queued(-1) {
+		 current(-1), queued(-1),
+		 prefetch_songs(_prefetch_songs) {
 	}
 
 	~playlist() {
@@ -156,6 +163,13 @@ protected:
 	 */
 	void UpdateQueuedSong(PlayerControl &pc, const DetachedSong *prev);
 
+	/**
+	 * Pass the URIs of the next #prefetch_songs songs (starting
+	 * with the queued one) to the player, which will open their
+	 * input streams in advance.
+	 */
+	void UpdatePrefetch(PlayerControl &pc);
+
 	/**
 	 * Queue a song, addressed by its order number.
 	 */
@@ -41,6 +41,7 @@ playlist::Stop(PlayerControl &pc)
 	pc.LockStop();
 	queued = -1;
 	playing = false;
+	UpdatePrefetch(pc);
 
 	if (queue.random) {
 		/* shuffle the playlist, so the next playback will
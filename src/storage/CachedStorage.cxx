@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "CachedStorage.hxx"
+#include "StorageInterface.hxx"
+#include "FileInfo.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/Traits.hxx"
+#include "thread/Mutex.hxx"
+#include "system/Clock.hxx"
+#include "util/Error.hxx"
+#include "Compiler.h"
+
+#ifdef ENABLE_NFS
+#include "lib/nfs/Domain.hxx"
+#endif
+
+#include <string>
+#include <map>
+
+#include <assert.h>
+#include <errno.h>
+
+/**
+ * Does the error say that the file does not exist?  Unlike other
+ * errors, this is not likely to go away by itself, therefore it may
+ * be cached.
+ */
+gcc_pure
+static bool
+IsFileNotFound(const Error &error)
+{
+	if (error.IsDomain(errno_domain))
+		return error.GetCode() == ENOENT ||
+			error.GetCode() == ENOTDIR;
+
+#ifdef ENABLE_NFS
+	/* libnfs reports negative errno values */
+	if (error.IsDomain(nfs_domain))
+		return error.GetCode() == -ENOENT ||
+			error.GetCode() == -ENOTDIR;
+#endif
+
+	return false;
+}
+
+/**
+ * The actual cache.  It is thread-safe, because the #Storage may be
+ * used by the main thread and the update thread at the same time.
+ */
+class StorageInfoCache {
+	/**
+	 * The maximum number of items per map.  When this is
+	 * exceeded, the map is flushed.
+	 */
+	static constexpr size_t MAX_SIZE = 16384;
+
+	struct Item {
+		unsigned expires;
+
+		bool success;
+
+		StorageFileInfo info;
+
+		Error error;
+	};
+
+	const unsigned ttl_s;
+
+	mutable Mutex mutex;
+
+	/**
+	 * Two separate maps: one for follow=false and one for
+	 * follow=true.
+	 */
+	std::map<std::string, Item> maps[2];
+
+public:
+	explicit StorageInfoCache(unsigned _ttl_s):ttl_s(_ttl_s) {}
+
+	/**
+	 * @return true if a valid item was found; then #result
+	 * contains the return value of the original GetInfo() call
+	 */
+	bool Lookup(const std::string &uri, bool follow, bool &result,
+		    StorageFileInfo &info, Error &error) {
+		const ScopeLock protect(mutex);
+
+		auto &map = maps[follow];
+		auto i = map.find(uri);
+		if (i == map.end())
+			return false;
+
+		const Item &item = i->second;
+		if (MonotonicClockS() >= item.expires) {
+			map.erase(i);
+			return false;
+		}
+
+		result = item.success;
+		if (result)
+			info = item.info;
+		else if (item.error.IsDefined())
+			error.Set(item.error);
+		return true;
+	}
+
+	void Insert(std::string &&uri, bool follow, bool success,
+		    const StorageFileInfo &info, const Error &error) {
+		const ScopeLock protect(mutex);
+
+		auto &map = maps[follow];
+
+		if (!success && !IsFileNotFound(error)) {
+			/* don't cache errors which may be temporary,
+			   and forget what we knew before */
+			map.erase(uri);
+			return;
+		}
+
+		if (map.size() >= MAX_SIZE)
+			map.clear();
+
+		Item &item = map[std::move(uri)];
+		item.expires = MonotonicClockS() + ttl_s;
+		item.success = success;
+		item.error.Clear();
+		if (success)
+			item.info = info;
+		else
+			item.error.Set(error);
+	}
+
+	void Clear() {
+		const ScopeLock protect(mutex);
+
+		for (auto &map : maps)
+			map.clear();
+	}
+};
+
+class CachedDirectoryReader final : public StorageDirectoryReader {
+	StorageInfoCache &cache;
+
+	StorageDirectoryReader *const next;
+
+	const std::string base;
+
+	const char *name;
+
+public:
+	CachedDirectoryReader(StorageInfoCache &_cache,
+			      StorageDirectoryReader *_next,
+			      const char *_base)
+		:cache(_cache), next(_next), base(_base), name(nullptr) {}
+
+	~CachedDirectoryReader() {
+		delete next;
+	}
+
+	/* virtual methods from class StorageDirectoryReader */
+	const char *Read() override {
+		name = next->Read();
+		return name;
+	}
+
+	bool GetInfo(bool follow, StorageFileInfo &info,
+		     Error &error) override {
+		assert(name != nullptr);
+
+		Error error2;
+		bool success = next->GetInfo(follow, info, error2);
+		cache.Insert(PathTraitsUTF8::Build(base.c_str(), name),
+			     follow, success, info, error2);
+		if (!success)
+			error = std::move(error2);
+		return success;
+	}
+
+	AllocatedPath ReadLink() override {
+		return next->ReadLink();
+	}
+};
+
+class CachedStorage final : public Storage {
+	Storage *const next;
+
+	StorageInfoCache cache;
+
+public:
+	CachedStorage(Storage *_next, unsigned ttl_s)
+		:next(_next), cache(ttl_s) {}
+
+	~CachedStorage() {
+		delete next;
+	}
+
+	/* virtual methods from class Storage */
+	bool GetInfo(const char *uri_utf8, bool follow, StorageFileInfo &info,
+		     Error &error) override;
+
+	StorageDirectoryReader *OpenDirectory(const char *uri_utf8,
+					      Error &error) override {
+		auto *reader = next->OpenDirectory(uri_utf8, error);
+		if (reader == nullptr)
+			return nullptr;
+
+		return new CachedDirectoryReader(cache, reader, uri_utf8);
+	}
+
+	std::string MapUTF8(const char *uri_utf8) const override {
+		return next->MapUTF8(uri_utf8);
+	}
+
+	AllocatedPath MapFS(const char *uri_utf8) const override {
+		return next->MapFS(uri_utf8);
+	}
+
+	const char *MapToRelativeUTF8(const char *uri_utf8) const override {
+		return next->MapToRelativeUTF8(uri_utf8);
+	}
+
+	void ClearCache() override {
+		cache.Clear();
+		next->ClearCache();
+	}
+};
+
+bool
+CachedStorage::GetInfo(const char *uri_utf8, bool follow,
+		       StorageFileInfo &info, Error &error)
+{
+	std::string uri(uri_utf8);
+
+	bool result;
+	if (cache.Lookup(uri, follow, result, info, error))
+		return result;
+
+	Error error2;
+	result = next->GetInfo(uri_utf8, follow, info, error2);
+	cache.Insert(std::move(uri), follow, result, info, error2);
+	if (!result)
+		error = std::move(error2);
+	return result;
+}
+
+Storage *
+CreateCachedStorage(Storage *next, unsigned ttl_s)
+{
+	assert(next != nullptr);
+	assert(ttl_s > 0);
+
+	return new CachedStorage(next, ttl_s);
+}
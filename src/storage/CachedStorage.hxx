@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_CACHED_STORAGE_HXX
+#define MPD_CACHED_STORAGE_HXX
+
+#include "check.h"
+
+class Storage;
+
+/**
+ * Wrap a #Storage instance in a decorator which remembers the
+ * results of Storage::GetInfo() for the given amount of time.  Only
+ * successful calls and "file not found" errors are cached; other
+ * errors may be temporary.  Directory listings obtained through
+ * Storage::OpenDirectory() populate the cache as well, and
+ * Storage::ClearCache() discards it.
+ *
+ * This is useful for remote storages such as NFS and SMB, where
+ * each GetInfo() call is a network round trip.
+ *
+ * @param next the #Storage to be wrapped; the returned object takes
+ * over ownership
+ * @param ttl_s the number of seconds a cached result is valid
+ */
+Storage *
+CreateCachedStorage(Storage *next, unsigned ttl_s);
+
+#endif
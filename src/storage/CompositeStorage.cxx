@@ -27,6 +27,7 @@
 
 #include <set>
 
+#include <errno.h>
 #include <string.h>
 
 static constexpr Domain composite_domain("composite");
@@ -58,6 +59,7 @@ public:
 	/* virtual methods from class StorageDirectoryReader */
 	const char *Read() override;
 	bool GetInfo(bool follow, StorageFileInfo &info, Error &error) override;
+	AllocatedPath ReadLink() override;
 };
 
 const char *
@@ -97,6 +99,17 @@ CompositeDirectoryReader::GetInfo(bool follow, StorageFileInfo &info,
 	return true;
 }
 
+AllocatedPath
+CompositeDirectoryReader::ReadLink()
+{
+	if (other != nullptr)
+		return other->ReadLink();
+
+	/* a mount point is not a symbolic link */
+	errno = EINVAL;
+	return AllocatedPath::Null();
+}
+
 static std::string
 NextSegment(const char *&uri_r)
 {
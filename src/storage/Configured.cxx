@@ -20,6 +20,7 @@
 #include "config.h"
 #include "Configured.hxx"
 #include "Registry.hxx"
+#include "CachedStorage.hxx"
 #include "plugins/LocalStorage.hxx"
 #include "config/ConfigGlobal.hxx"
 #include "config/ConfigError.hxx"
@@ -35,10 +36,14 @@ CreateConfiguredStorageUri(EventLoop &event_loop, const char *uri,
 			   Error &error)
 {
 	Storage *storage = CreateStorageURI(event_loop, uri, error);
-	if (storage == nullptr && !error.IsDefined())
-		error.Format(config_domain,
-			     "Unrecognized storage URI: %s", uri);
-	return storage;
+	if (storage == nullptr) {
+		if (!error.IsDefined())
+			error.Format(config_domain,
+				     "Unrecognized storage URI: %s", uri);
+		return nullptr;
+	}
+
+	return CacheConfiguredStorage(storage);
 }
 
 static AllocatedPath
@@ -75,6 +80,19 @@ CreateConfiguredStorage(EventLoop &event_loop, Error &error)
 	return CreateConfiguredStorageLocal(error);
 }
 
+Storage *
+CacheConfiguredStorage(Storage *storage)
+{
+	assert(storage != nullptr);
+
+	const unsigned ttl = config_get_unsigned(ConfigOption::STORAGE_CACHE_TTL,
+						 0);
+	if (ttl == 0)
+		return storage;
+
+	return CreateCachedStorage(storage, ttl);
+}
+
 bool
 IsStorageConfigured()
 {
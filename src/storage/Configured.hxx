@@ -35,6 +35,14 @@ class EventLoop;
 Storage *
 CreateConfiguredStorage(EventLoop &event_loop, Error &error);
 
+/**
+ * Wrap the given #Storage in a #CachedStorage if the setting
+ * "storage_cache_ttl" is configured.  Returns the given object
+ * otherwise.
+ */
+Storage *
+CacheConfiguredStorage(Storage *storage);
+
 /**
  * Returns true if there is configuration for a #Storage instance.
  */
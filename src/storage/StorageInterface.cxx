@@ -22,6 +22,15 @@
 #include "fs/AllocatedPath.hxx"
 #include "fs/Traits.hxx"
 
+#include <errno.h>
+
+AllocatedPath
+StorageDirectoryReader::ReadLink()
+{
+	errno = EINVAL;
+	return AllocatedPath::Null();
+}
+
 AllocatedPath
 Storage::MapFS(gcc_unused const char *uri_utf8) const
 {
@@ -38,6 +38,15 @@ public:
 	virtual const char *Read() = 0;
 	virtual bool GetInfo(bool follow, StorageFileInfo &info,
 			     Error &error) = 0;
+
+	/**
+	 * Read the target of the current entry if it is a symbolic
+	 * link.  Returns AllocatedPath::Null() (with errno set to
+	 * EINVAL) if the entry is not a symbolic link or if this
+	 * storage does not support local files, or on any other error
+	 * (with errno set accordingly).
+	 */
+	virtual AllocatedPath ReadLink();
 };
 
 class Storage {
@@ -78,6 +87,13 @@ public:
 	 */
 	gcc_pure
 	virtual const char *MapToRelativeUTF8(const char *uri_utf8) const = 0;
+
+	/**
+	 * Discard all information this object may have cached about
+	 * the files in the storage, e.g. before the database is
+	 * updated.
+	 */
+	virtual void ClearCache() {}
 };
 
 #endif
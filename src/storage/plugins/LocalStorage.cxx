@@ -25,11 +25,15 @@
 #include "fs/FileInfo.hxx"
 #include "fs/AllocatedPath.hxx"
 #include "fs/DirectoryReader.hxx"
+#include "fs/FileSystem.hxx"
+#include "fs/Charset.hxx"
 #include "util/Error.hxx"
 #include "util/StringCompare.hxx"
 
 #include <string>
 
+#include <errno.h>
+
 class LocalDirectoryReader final : public StorageDirectoryReader {
 	AllocatedPath base_fs;
 
@@ -45,6 +49,7 @@ public:
 	const char *Read() override;
 	bool GetInfo(bool follow, StorageFileInfo &info,
 		     Error &error) override;
+	AllocatedPath ReadLink() override;
 };
 
 class LocalStorage final : public Storage {
@@ -75,13 +80,9 @@ private:
 	AllocatedPath MapFS(const char *uri_utf8, Error &error) const;
 };
 
-static bool
-Stat(Path path, bool follow, StorageFileInfo &info, Error &error)
+static void
+Copy(StorageFileInfo &info, const FileInfo &src)
 {
-	FileInfo src;
-	if (!GetFileInfo(path, src, follow, error))
-		return false;
-
 	if (src.IsRegular())
 		info.type = StorageFileInfo::Type::REGULAR;
 	else if (src.IsDirectory())
@@ -97,6 +98,16 @@ Stat(Path path, bool follow, StorageFileInfo &info, Error &error)
 	info.device = src.GetDevice();
 	info.inode = src.GetInode();
 #endif
+}
+
+static bool
+Stat(Path path, bool follow, StorageFileInfo &info, Error &error)
+{
+	FileInfo src;
+	if (!GetFileInfo(path, src, follow, error))
+		return false;
+
+	Copy(info, src);
 	return true;
 }
 
@@ -176,8 +187,8 @@ LocalDirectoryReader::Read()
 		if (SkipNameFS(name_fs.c_str()))
 			continue;
 
-		name_utf8 = name_fs.ToUTF8();
-		if (name_utf8.empty())
+		/* reuse the buffer of the previous entry */
+		if (!PathToUTF8(name_fs.c_str(), name_utf8))
 			continue;
 
 		return name_utf8.c_str();
@@ -189,9 +200,44 @@ LocalDirectoryReader::Read()
 bool
 LocalDirectoryReader::GetInfo(bool follow, StorageFileInfo &info, Error &error)
 {
+#ifdef WIN32
 	const AllocatedPath path_fs =
 		AllocatedPath::Build(base_fs, reader.GetEntry());
 	return Stat(path_fs, follow, info, error);
+#else
+	/* stat the entry relative to the directory file descriptor;
+	   this neither allocates a path nor makes the kernel resolve
+	   all of its components again */
+	FileInfo src;
+	if (!GetFileInfoAt(reader.GetFD(), reader.GetEntry(), src, follow)) {
+		const int e = errno;
+		const AllocatedPath path_fs =
+			AllocatedPath::Build(base_fs, reader.GetEntry());
+		error.FormatErrno(e, "Failed to access %s",
+				  path_fs.ToUTF8().c_str());
+		return false;
+	}
+
+	Copy(info, src);
+	return true;
+#endif
+}
+
+AllocatedPath
+LocalDirectoryReader::ReadLink()
+{
+#ifdef WIN32
+	return StorageDirectoryReader::ReadLink();
+#else
+#ifdef _DIRENT_HAVE_D_TYPE
+	if (reader.IsEntryNoSymlink()) {
+		errno = EINVAL;
+		return AllocatedPath::Null();
+	}
+#endif
+
+	return ReadLinkAt(reader.GetFD(), reader.GetEntry());
+#endif
 }
 
 Storage *
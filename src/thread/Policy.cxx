@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "Policy.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+static constexpr Domain thread_policy_domain("thread_policy");
+
+static constexpr const char *thread_class_names[] = {
+	"main",
+	"io",
+	"player",
+	"decoder",
+	"output",
+	"update",
+};
+
+static_assert(sizeof(thread_class_names) / sizeof(thread_class_names[0]) ==
+	      unsigned(ThreadClass::MAX),
+	      "Wrong number of thread_class_names");
+
+static ThreadPolicy thread_policies[unsigned(ThreadClass::MAX)];
+
+/**
+ * The settings of the main thread before the "main" policy was
+ * applied, limited to the parts which that policy changes.  New
+ * threads inherit the scheduler, the nice value and the CPU affinity
+ * of the main thread, so these are restored in threads whose class
+ * is not configured.
+ */
+static ThreadPolicy default_policy;
+
+const char *
+GetThreadClassName(ThreadClass c)
+{
+	assert(c < ThreadClass::MAX);
+
+	return thread_class_names[unsigned(c)];
+}
+
+/**
+ * Save the current thread's settings which the given policy would
+ * change to #default_policy.
+ */
+static void
+SaveDefaultPolicy(const ThreadPolicy &main_policy)
+{
+	ThreadPolicy &policy = default_policy;
+
+#ifdef __linux__
+	if (main_policy.set_scheduler) {
+		struct sched_param sched_param;
+		const int scheduler = sched_getscheduler(0);
+		if (scheduler >= 0 && sched_getparam(0, &sched_param) == 0) {
+			policy.set_scheduler = true;
+			policy.scheduler = scheduler;
+#ifdef SCHED_RESET_ON_FORK
+			policy.scheduler &= ~SCHED_RESET_ON_FORK;
+#endif
+			policy.priority = sched_param.sched_priority;
+		}
+	}
+
+	if (main_policy.set_nice) {
+		errno = 0;
+		const int nice = getpriority(PRIO_PROCESS,
+					     syscall(__NR_gettid));
+		if (nice != -1 || errno == 0) {
+			policy.set_nice = true;
+			policy.nice = nice;
+		}
+	}
+
+	if (main_policy.set_affinity &&
+	    sched_getaffinity(0, sizeof(policy.affinity),
+			      &policy.affinity) == 0)
+		policy.set_affinity = true;
+#else
+	(void)main_policy;
+#endif
+
+	policy.defined = true;
+}
+
+void
+SetThreadPolicy(ThreadClass c, const ThreadPolicy &policy)
+{
+	assert(c < ThreadClass::MAX);
+
+	if (c == ThreadClass::MAIN)
+		SaveDefaultPolicy(policy);
+
+	thread_policies[unsigned(c)] = policy;
+	thread_policies[unsigned(c)].defined = true;
+}
+
+static void
+ApplyPolicy(ThreadClass c, const ThreadPolicy &policy)
+{
+#ifdef __linux__
+	/* on Linux, these system calls affect only the calling
+	   thread if "who" is 0 or the thread id */
+
+	if (policy.set_scheduler) {
+		struct sched_param sched_param;
+		sched_param.sched_priority = policy.priority;
+
+		int scheduler = policy.scheduler;
+#ifdef SCHED_RESET_ON_FORK
+		if (scheduler == SCHED_FIFO || scheduler == SCHED_RR)
+			scheduler |= SCHED_RESET_ON_FORK;
+#endif
+
+		if (sched_setscheduler(0, scheduler, &sched_param) < 0)
+			FormatWarning(thread_policy_domain,
+				      "Failed to set the scheduler of the %s thread: %s",
+				      GetThreadClassName(c), strerror(errno));
+	}
+
+	if (policy.set_nice &&
+	    setpriority(PRIO_PROCESS, syscall(__NR_gettid),
+			policy.nice) < 0)
+		FormatWarning(thread_policy_domain,
+			      "Failed to set the nice value of the %s thread: %s",
+			      GetThreadClassName(c), strerror(errno));
+
+	if (policy.set_affinity &&
+	    sched_setaffinity(0, sizeof(policy.affinity),
+			      &policy.affinity) < 0)
+		FormatWarning(thread_policy_domain,
+			      "Failed to set the CPU affinity of the %s thread: %s",
+			      GetThreadClassName(c), strerror(errno));
+#else
+	(void)c;
+	(void)policy;
+#endif
+}
+
+bool
+ApplyThreadPolicy(ThreadClass c)
+{
+	assert(c < ThreadClass::MAX);
+
+	const ThreadPolicy &policy = thread_policies[unsigned(c)];
+	if (!policy.defined) {
+		/* don't inherit the "main" policy */
+		if (c != ThreadClass::MAIN && default_policy.defined)
+			ApplyPolicy(c, default_policy);
+
+		return false;
+	}
+
+	ApplyPolicy(c, policy);
+	return true;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_THREAD_POLICY_HXX
+#define MPD_THREAD_POLICY_HXX
+
+#include "check.h"
+#include "Compiler.h"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <stdint.h>
+
+/**
+ * The classes of threads MPD runs.  Each can be assigned a
+ * #ThreadPolicy.
+ */
+enum class ThreadClass : uint8_t {
+	/**
+	 * The main thread, which handles clients.
+	 */
+	MAIN,
+
+	IO,
+	PLAYER,
+	DECODER,
+	OUTPUT,
+	UPDATE,
+
+	MAX
+};
+
+/**
+ * Scheduling settings for one #ThreadClass.
+ */
+struct ThreadPolicy {
+	/**
+	 * Is this policy configured at all?  If not, the thread
+	 * keeps MPD's built-in defaults.
+	 */
+	bool defined;
+
+	/**
+	 * Shall the scheduler be changed?  Then #scheduler and
+	 * #priority are used.
+	 */
+	bool set_scheduler;
+
+	/**
+	 * Shall the nice value be changed?
+	 */
+	bool set_nice;
+
+	/**
+	 * Shall the CPU affinity be changed?
+	 */
+	bool set_affinity;
+
+	/**
+	 * The scheduling policy, e.g. SCHED_FIFO.
+	 */
+	int scheduler;
+
+	/**
+	 * The static priority for SCHED_FIFO and SCHED_RR.
+	 */
+	int priority;
+
+	int nice;
+
+#ifdef __linux__
+	cpu_set_t affinity;
+#endif
+
+	ThreadPolicy()
+		:defined(false), set_scheduler(false), set_nice(false),
+		 set_affinity(false) {}
+};
+
+/**
+ * @return the name of the thread class in the configuration file
+ */
+gcc_const
+const char *
+GetThreadClassName(ThreadClass c);
+
+/**
+ * Configure the policy of a thread class.  This must be called
+ * during startup, before the threads are started.
+ */
+void
+SetThreadPolicy(ThreadClass c, const ThreadPolicy &policy);
+
+/**
+ * Apply the configured policy to the current thread.  Errors are
+ * logged as warnings.
+ *
+ * If no policy was configured for this class, but one was
+ * configured for #ThreadClass::MAIN, the settings inherited from the
+ * main thread are reset to the ones the main thread had before.
+ *
+ * @return false if no policy was configured for this class; the
+ * caller may then apply its own defaults
+ */
+bool
+ApplyThreadPolicy(ThreadClass c);
+
+#endif
@@ -32,6 +32,8 @@
 #ifdef __linux__
 #include <sys/mman.h>
 #include <unistd.h>
+#include <stdio.h>
+#include <errno.h>
 #else
 #include <stdlib.h>
 #endif
@@ -94,4 +96,69 @@ HugeDiscard(void *p, size_t size)
 #endif
 }
 
+/**
+ * Determine the default huge page size from /proc/meminfo.
+ *
+ * @return the size in bytes or 0 if unknown
+ */
+static size_t
+ReadHugePageSize()
+{
+	FILE *file = fopen("/proc/meminfo", "r");
+	if (file == nullptr)
+		return 0;
+
+	size_t result = 0;
+	char line[256];
+	unsigned long kb;
+	while (fgets(line, sizeof(line), file) != nullptr) {
+		if (sscanf(line, "Hugepagesize: %lu kB", &kb) == 1) {
+			result = size_t(kb) * 1024;
+			break;
+		}
+	}
+
+	fclose(file);
+	return result;
+}
+
+void *
+HugeAllocateReserved(size_t &size)
+{
+#ifdef MAP_HUGETLB
+	static const size_t huge_page_size = ReadHugePageSize();
+	if (huge_page_size == 0) {
+		errno = ENOSYS;
+		return nullptr;
+	}
+
+	const size_t aligned_size =
+		(size + huge_page_size - 1) / huge_page_size * huge_page_size;
+
+	constexpr int flags = MAP_ANONYMOUS|MAP_PRIVATE|MAP_HUGETLB;
+	void *p = mmap(nullptr, aligned_size,
+		       PROT_READ|PROT_WRITE, flags,
+		       -1, 0);
+	if (p == (void *)-1)
+		return nullptr;
+
+#ifdef MADV_DONTFORK
+	madvise(p, aligned_size, MADV_DONTFORK);
+#endif
+
+	size = aligned_size;
+	return p;
+#else
+	(void)size;
+	errno = ENOSYS;
+	return nullptr;
+#endif
+}
+
+bool
+HugeLock(void *p, size_t size)
+{
+	return mlock(p, AlignToPageSize(size)) == 0;
+}
+
 #endif
@@ -63,6 +63,31 @@ HugeFree(void *p, size_t size);
 void
 HugeDiscard(void *p, size_t size);
 
+/**
+ * Allocate memory from the pool of explicitly reserved huge pages
+ * (see /proc/sys/vm/nr_hugepages).  These are never paged out.
+ *
+ * @param size the requested size; on return, the size rounded up to
+ * the huge page size, which must be passed to HugeFree()
+ * @return the allocation or nullptr if there are not enough
+ * reserved huge pages (errno set)
+ */
+gcc_malloc
+void *
+HugeAllocateReserved(size_t &size);
+
+/**
+ * Lock an allocation into RAM, so it does not get paged out.  This
+ * also populates all of its pages.  Note that HugeDiscard() has no
+ * effect on locked memory.
+ *
+ * @param p an allocation returned by HugeAllocate()
+ * @param size the allocation's size as passed to HugeAllocate()
+ * @return true on success, false on error (errno set)
+ */
+bool
+HugeLock(void *p, size_t size);
+
 #elif defined(WIN32)
 #include <windows.h>
 
@@ -88,6 +113,18 @@ HugeDiscard(void *p, size_t size)
 	VirtualAlloc(p, size, MEM_RESET, PAGE_NOACCESS);
 }
 
+static inline void *
+HugeAllocateReserved(size_t &)
+{
+	return nullptr;
+}
+
+static inline bool
+HugeLock(void *p, size_t size)
+{
+	return VirtualLock(p, size);
+}
+
 #else
 
 /* not Linux: fall back to standard C calls */
@@ -112,6 +149,18 @@ HugeDiscard(void *, size_t)
 {
 }
 
+static inline void *
+HugeAllocateReserved(size_t &)
+{
+	return nullptr;
+}
+
+static inline bool
+HugeLock(void *, size_t)
+{
+	return false;
+}
+
 #endif
 
 #endif
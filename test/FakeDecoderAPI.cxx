@@ -42,6 +42,7 @@ decoder_initialized(Decoder &decoder,
 		duration.ToDoubleS());
 
 	decoder.initialized = true;
+	decoder.frame_size = audio_format.GetFrameSize();
 }
 
 DecoderCommand
@@ -142,6 +143,30 @@ decoder_data(gcc_unused Decoder &decoder,
 	return DecoderCommand::NONE;
 }
 
+static uint8_t write_buffer[4096];
+
+WritableBuffer<void>
+decoder_get_buffer(Decoder &decoder,
+		   gcc_unused InputStream *is,
+		   uint16_t kbit_rate, gcc_unused size_t min_size)
+{
+	static uint16_t prev_kbit_rate;
+	if (kbit_rate != prev_kbit_rate) {
+		prev_kbit_rate = kbit_rate;
+		fprintf(stderr, "%u kbit/s\n", kbit_rate);
+	}
+
+	return {write_buffer,
+		sizeof(write_buffer) - sizeof(write_buffer) % decoder.frame_size};
+}
+
+DecoderCommand
+decoder_commit_buffer(gcc_unused Decoder &decoder, size_t length)
+{
+	gcc_unused ssize_t nbytes = write(1, write_buffer, length);
+	return DecoderCommand::NONE;
+}
+
 DecoderCommand
 decoder_tag(gcc_unused Decoder &decoder,
 	    gcc_unused InputStream *is,
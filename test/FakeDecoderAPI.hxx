@@ -24,14 +24,18 @@
 #include "thread/Mutex.hxx"
 #include "thread/Cond.hxx"
 
+#include <stddef.h>
+
 struct Decoder {
 	Mutex mutex;
 	Cond cond;
 
 	bool initialized;
 
+	size_t frame_size;
+
 	Decoder()
-		:initialized(false) {}
+		:initialized(false), frame_size(1) {}
 };
 
 #endif
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the throughput of MusicPipe and MusicBuffer
+ * with one producer thread, one consumer thread and an optional
+ * number of threads which allocate and return chunks concurrently.
+ *
+ */
+
+#include "config.h"
+#include "MusicPipe.hxx"
+#include "MusicBuffer.hxx"
+#include "MusicChunk.hxx"
+#include "AudioFormat.hxx"
+#include "thread/Thread.hxx"
+#include "system/Clock.hxx"
+#include "util/Error.hxx"
+#include "Log.hxx"
+
+#include <atomic>
+#include <thread>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static constexpr AudioFormat audio_format(44100, SampleFormat::S16, 2);
+
+static MusicBuffer *buffer;
+static MusicPipe *pipe;
+static unsigned num_chunks;
+static std::atomic_bool done;
+
+static MusicChunk *
+AllocateChunk()
+{
+	MusicChunk *chunk;
+	while ((chunk = buffer->Allocate()) == nullptr)
+		std::this_thread::yield();
+
+	return chunk;
+}
+
+static void
+ProducerThread(void *)
+{
+	for (unsigned i = 0; i < num_chunks; ++i) {
+		MusicChunk *chunk = AllocateChunk();
+
+		auto dest = chunk->Write(audio_format, SongTime::zero(), 0);
+		memcpy(dest.data, &i, sizeof(i));
+		chunk->Expand(audio_format, dest.size);
+
+		pipe->Push(chunk);
+	}
+}
+
+static void
+NoiseThread(void *)
+{
+	while (!done.load(std::memory_order_relaxed)) {
+		MusicChunk *chunk = AllocateChunk();
+		buffer->Return(chunk);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 3) {
+		fprintf(stderr, "Usage: bench_music_pipe [CHUNKS [THREADS]]\n");
+		return EXIT_FAILURE;
+	}
+
+	num_chunks = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+	const unsigned num_threads = argc > 2
+		? strtoul(argv[2], nullptr, 10)
+		: 2;
+
+	buffer = new MusicBuffer(256, DEFAULT_CHUNK_SIZE);
+	pipe = new MusicPipe();
+
+	/* keep one chunk allocated all the time, or else the buffer
+	   would give its memory back to the kernel whenever the pipe
+	   runs empty, and we would measure page faults */
+	MusicChunk *const pinned = buffer->Allocate();
+
+	Error error;
+	Thread producer;
+	Thread *const noise = new Thread[num_threads];
+	for (unsigned i = 0; i < num_threads; ++i) {
+		if (!noise[i].Start(NoiseThread, nullptr, error)) {
+			LogError(error);
+			return EXIT_FAILURE;
+		}
+	}
+
+	const uint64_t start = MonotonicClockUS();
+
+	if (!producer.Start(ProducerThread, nullptr, error)) {
+		LogError(error);
+		return EXIT_FAILURE;
+	}
+
+	unsigned errors = 0;
+	for (unsigned i = 0; i < num_chunks;) {
+		MusicChunk *chunk = pipe->Shift();
+		if (chunk == nullptr) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		unsigned value;
+		memcpy(&value, chunk->data, sizeof(value));
+		if (value != i)
+			++errors;
+
+		buffer->Return(chunk);
+		++i;
+	}
+
+	const uint64_t duration = MonotonicClockUS() - start;
+
+	producer.Join();
+
+	done = true;
+	for (unsigned i = 0; i < num_threads; ++i)
+		noise[i].Join();
+	delete[] noise;
+
+	buffer->Return(pinned);
+	delete pipe;
+	delete buffer;
+
+	printf("chunks=%u threads=%u usec=%llu chunks_per_sec=%.0f\n",
+	       num_chunks, num_threads, (unsigned long long)duration,
+	       duration > 0 ? num_chunks * 1e6 / duration : 0.);
+
+	if (errors > 0) {
+		fprintf(stderr, "%u chunks out of order\n", errors);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
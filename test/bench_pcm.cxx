@@ -0,0 +1,633 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the throughput of the PCM library: sample
+ * format and channel conversion, volume, mixing, dithering, packing,
+ * export, DSD and the resamplers, for several formats, channel
+ * counts and buffer sizes.
+ *
+ * Each measurement prints one line of "key=value" pairs.  The "simd"
+ * column names the best instruction set the build uses on this CPU,
+ * which allows comparing the output of a SIMD build with the output
+ * of a build for a target without SIMD kernels.
+ */
+
+#include "config.h"
+#include "pcm/PcmFormat.hxx"
+#include "pcm/PcmChannels.hxx"
+#include "pcm/PcmBuffer.hxx"
+#include "pcm/PcmDither.hxx"
+#include "pcm/PcmMix.hxx"
+#include "pcm/PcmPack.hxx"
+#include "pcm/PcmExport.hxx"
+#include "pcm/Interleave.hxx"
+#include "pcm/Volume.hxx"
+#include "pcm/SincResampler.hxx"
+#include "pcm/FallbackResampler.hxx"
+#include "pcm/ThreadedResampler.hxx"
+#include "pcm/CpuFeatures.hxx"
+#include "pcm/Traits.hxx"
+#include "AudioFormat.hxx"
+#include "system/Clock.hxx"
+#include "util/ConstBuffer.hxx"
+#include "util/Error.hxx"
+
+#include "pcm/PcmDither.cxx" // including the .cxx file to get inlined templates
+
+#ifdef ENABLE_DSD
+#include "pcm/PcmDsd.hxx"
+#endif
+
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Only run measurements whose name starts with this string.
+ */
+static const char *filter = "";
+
+/**
+ * The number of (input) samples processed by each measurement.
+ */
+static size_t total_samples = 1 << 21;
+
+/**
+ * The buffer sizes (in frames) of each measurement.
+ */
+static constexpr size_t buffer_sizes[] = { 64, 1024, 16384 };
+
+static const char *
+GetSimd()
+{
+#ifdef __SSE2__
+#ifdef HAVE_AVX2_DISPATCH
+	if (CpuHasAvx2())
+		return "avx2";
+#endif
+	return "sse2";
+#elif defined(__ARM_NEON__)
+	return "neon";
+#else
+	return "none";
+#endif
+}
+
+static std::minstd_rand random_engine;
+
+template<SampleFormat F, class Traits=SampleTraits<F>>
+static void
+FillFormat(void *_p, size_t n)
+{
+	auto *p = (typename Traits::pointer_type)_p;
+	std::uniform_int_distribution<int64_t> dis(Traits::MIN, Traits::MAX);
+	for (size_t i = 0; i != n; ++i)
+		p[i] = dis(random_engine);
+}
+
+/**
+ * Allocate #n random samples of the given format.
+ */
+static ConstBuffer<void>
+Fill(std::vector<uint8_t> &v, SampleFormat format, size_t n)
+{
+	v.resize(n * sample_format_size(format));
+
+	switch (format) {
+	case SampleFormat::UNDEFINED:
+		break;
+
+	case SampleFormat::S8:
+		FillFormat<SampleFormat::S8>(v.data(), n);
+		break;
+
+	case SampleFormat::S16:
+		FillFormat<SampleFormat::S16>(v.data(), n);
+		break;
+
+	case SampleFormat::S24_P32:
+		FillFormat<SampleFormat::S24_P32>(v.data(), n);
+		break;
+
+	case SampleFormat::S32:
+		FillFormat<SampleFormat::S32>(v.data(), n);
+		break;
+
+	case SampleFormat::FLOAT:
+		{
+			std::uniform_real_distribution<float> dis(-1.0, 1.0);
+			float *p = (float *)v.data();
+			for (size_t i = 0; i != n; ++i)
+				p[i] = dis(random_engine);
+		}
+		break;
+
+	case SampleFormat::DSD:
+		for (auto &i : v)
+			i = random_engine();
+		break;
+	}
+
+	return {v.data(), v.size()};
+}
+
+static volatile size_t sink;
+
+static const void *volatile launder;
+
+/**
+ * Hide the pointer from the optimizer, so it cannot merge repeated
+ * calls to gcc_pure functions.
+ */
+static ConstBuffer<void>
+Launder(ConstBuffer<void> src)
+{
+	launder = src.data;
+	return {launder, src.size};
+}
+
+/**
+ * Run the function repeatedly until #total_samples input samples
+ * have been processed, and print the result.
+ *
+ * @param f a function returning the size of its output (to keep the
+ * compiler from optimizing it away)
+ */
+template<typename F>
+static void
+Measure(const char *op, SampleFormat format, unsigned channels,
+	size_t frames, F &&f)
+{
+	if (strncmp(op, filter, strlen(filter)) != 0)
+		return;
+
+	const size_t samples = frames * channels;
+	const unsigned iterations = std::max<size_t>(total_samples / samples,
+						     1);
+
+	/* warm up (and let the object allocate its buffers) */
+	size_t result = f();
+
+	const uint64_t start = MonotonicClockUS();
+	for (unsigned i = 0; i < iterations; ++i)
+		result += f();
+	const uint64_t duration = MonotonicClockUS() - start;
+
+	sink = sink + result;
+
+	printf("op=%s format=%s channels=%u frames=%zu simd=%s"
+	       " iterations=%u usec=%llu samples_per_sec=%.0f\n",
+	       op, sample_format_to_string(format), channels, frames,
+	       GetSimd(), iterations, (unsigned long long)duration,
+	       duration > 0
+	       ? double(samples) * iterations * 1e6 / duration
+	       : 0.);
+	fflush(stdout);
+}
+
+static constexpr SampleFormat pcm_formats[] = {
+	SampleFormat::S8,
+	SampleFormat::S16,
+	SampleFormat::S24_P32,
+	SampleFormat::S32,
+	SampleFormat::FLOAT,
+};
+
+static void
+BenchFormat(size_t frames)
+{
+	constexpr unsigned channels = 2;
+
+	for (const auto format : pcm_formats) {
+		std::vector<uint8_t> v;
+		const auto src = Fill(v, format, frames * channels);
+
+		PcmBuffer buffer;
+		PcmDither dither;
+
+		if (format != SampleFormat::S16)
+			Measure("format_to_16", format, channels, frames, [&](){
+					const auto s = Launder(src);
+					return pcm_convert_to_16(buffer, dither,
+								 format, s).size;
+				});
+
+		if (format != SampleFormat::S24_P32)
+			Measure("format_to_24", format, channels, frames, [&](){
+					const auto s = Launder(src);
+					return pcm_convert_to_24(buffer,
+								 format, s).size;
+				});
+
+		if (format != SampleFormat::S32)
+			Measure("format_to_32", format, channels, frames, [&](){
+					const auto s = Launder(src);
+					return pcm_convert_to_32(buffer,
+								 format, s).size;
+				});
+
+		if (format != SampleFormat::FLOAT)
+			Measure("format_to_float", format, channels, frames, [&](){
+					const auto s = Launder(src);
+					return pcm_convert_to_float(buffer,
+								    format, s).size;
+				});
+	}
+}
+
+static ConstBuffer<void>
+ConvertChannels(PcmBuffer &buffer, SampleFormat format,
+		unsigned dest_channels, unsigned src_channels,
+		ConstBuffer<void> src)
+{
+	switch (format) {
+	case SampleFormat::S16:
+		return pcm_convert_channels_16(buffer, dest_channels,
+					       src_channels,
+					       ConstBuffer<int16_t>::FromVoid(src))
+			.ToVoid();
+
+	case SampleFormat::S24_P32:
+		return pcm_convert_channels_24(buffer, dest_channels,
+					       src_channels,
+					       ConstBuffer<int32_t>::FromVoid(src))
+			.ToVoid();
+
+	case SampleFormat::S32:
+		return pcm_convert_channels_32(buffer, dest_channels,
+					       src_channels,
+					       ConstBuffer<int32_t>::FromVoid(src))
+			.ToVoid();
+
+	case SampleFormat::FLOAT:
+		return pcm_convert_channels_float(buffer, dest_channels,
+						  src_channels,
+						  ConstBuffer<float>::FromVoid(src))
+			.ToVoid();
+
+	default:
+		return nullptr;
+	}
+}
+
+static void
+BenchChannels(size_t frames)
+{
+	static constexpr struct {
+		const char *op;
+		unsigned src_channels, dest_channels;
+	} conversions[] = {
+		{ "channels_1_2", 1, 2 },
+		{ "channels_2_1", 2, 1 },
+		{ "channels_2_6", 2, 6 },
+		{ "channels_6_2", 6, 2 },
+		{ "channels_8_2", 8, 2 },
+	};
+
+	for (const auto format : pcm_formats) {
+		if (format == SampleFormat::S8)
+			continue;
+
+		for (const auto &c : conversions) {
+			std::vector<uint8_t> v;
+			const auto src = Fill(v, format,
+					      frames * c.src_channels);
+
+			PcmBuffer buffer;
+			Measure(c.op, format, c.src_channels, frames, [&](){
+					return ConvertChannels(buffer, format,
+							       c.dest_channels,
+							       c.src_channels,
+							       src).size;
+				});
+		}
+	}
+}
+
+static void
+BenchInterleave(size_t frames)
+{
+	for (const unsigned channels : { 2u, 6u }) {
+		for (const auto format : { SampleFormat::S16,
+					   SampleFormat::S32 }) {
+			const size_t sample_size = sample_format_size(format);
+
+			std::vector<uint8_t> v, dest(frames * channels * sample_size);
+			Fill(v, format, frames * channels);
+
+			const void *planes[MAX_CHANNELS];
+			for (unsigned c = 0; c < channels; ++c)
+				planes[c] = v.data() + c * frames * sample_size;
+
+			Measure("interleave", format, channels, frames, [&](){
+					PcmInterleave(dest.data(),
+						      {planes, channels},
+						      frames, sample_size);
+					return dest.size();
+				});
+		}
+	}
+}
+
+static void
+BenchVolume(size_t frames)
+{
+	constexpr unsigned channels = 2;
+
+	for (const auto format : pcm_formats) {
+		std::vector<uint8_t> v;
+		const auto src = Fill(v, format, frames * channels);
+
+		PcmVolume pv;
+		if (!pv.Open(format, IgnoreError()))
+			continue;
+
+		pv.SetVolume(PCM_VOLUME_1 / 2);
+
+		Measure("volume", format, channels, frames, [&](){
+				return pv.Apply(Launder(src)).size;
+			});
+
+		pv.Close();
+	}
+}
+
+static void
+BenchMix(size_t frames)
+{
+	constexpr unsigned channels = 2;
+
+	for (const auto format : pcm_formats) {
+		std::vector<uint8_t> a, b;
+		Fill(a, format, frames * channels);
+		Fill(b, format, frames * channels);
+
+		PcmDither dither;
+
+		Measure("mix", format, channels, frames, [&](){
+				return pcm_mix(dither, a.data(), b.data(),
+					       a.size(), format, 0.7)
+					? a.size() : 0;
+			});
+
+		/* MixRamp (simple addition) */
+		Measure("mix_add", format, channels, frames, [&](){
+				return pcm_mix(dither, a.data(), b.data(),
+					       a.size(), format, -1)
+					? a.size() : 0;
+			});
+	}
+}
+
+static void
+BenchDither(size_t frames)
+{
+	constexpr unsigned channels = 2;
+	const size_t n = frames * channels;
+
+	std::vector<int16_t> dest(n);
+	std::vector<uint8_t> v;
+	PcmDither dither;
+
+	auto src = ConstBuffer<int32_t>::FromVoid(Fill(v, SampleFormat::S24_P32, n));
+	Measure("dither_to_16", SampleFormat::S24_P32, channels, frames, [&](){
+			dither.Dither24To16(dest.data(), src.begin(), src.end());
+			return dest.size();
+		});
+
+	src = ConstBuffer<int32_t>::FromVoid(Fill(v, SampleFormat::S32, n));
+	Measure("dither_to_16", SampleFormat::S32, channels, frames, [&](){
+			dither.Dither32To16(dest.data(), src.begin(), src.end());
+			return dest.size();
+		});
+}
+
+static void
+BenchPack(size_t frames)
+{
+	constexpr unsigned channels = 2;
+	const size_t n = frames * channels;
+
+	std::vector<uint8_t> v, packed(n * 3);
+	std::vector<int32_t> unpacked(n);
+	const auto src =
+		ConstBuffer<int32_t>::FromVoid(Fill(v, SampleFormat::S24_P32, n));
+
+	Measure("pack_24", SampleFormat::S24_P32, channels, frames, [&](){
+			pcm_pack_24(packed.data(), src.begin(), src.end());
+			return packed.size();
+		});
+
+	Measure("unpack_24", SampleFormat::S24_P32, channels, frames, [&](){
+			pcm_unpack_24(unpacked.data(), packed.data(),
+				      packed.data() + packed.size());
+			return unpacked.size();
+		});
+}
+
+static void
+BenchExport(size_t frames)
+{
+	static constexpr struct {
+		const char *op;
+		SampleFormat format;
+		unsigned channels;
+		bool alsa_channel_order, dop, shift8, pack24, reverse_endian;
+	} exports[] = {
+		{ "export_shift8", SampleFormat::S24_P32, 2, false, false, true, false, false },
+		{ "export_pack24", SampleFormat::S24_P32, 2, false, false, false, true, false },
+		{ "export_pack24_reverse", SampleFormat::S24_P32, 2, false, false, false, true, true },
+		{ "export_reverse", SampleFormat::S16, 2, false, false, false, false, true },
+		{ "export_reverse", SampleFormat::S32, 2, false, false, false, false, true },
+		{ "export_alsa_order", SampleFormat::S16, 6, true, false, false, false, false },
+		{ "export_alsa_order", SampleFormat::S32, 8, true, false, false, false, false },
+		{ "export_dop", SampleFormat::DSD, 2, false, true, false, false, false },
+		{ "export_dop_reverse", SampleFormat::DSD, 2, false, true, false, false, true },
+	};
+
+	for (const auto &e : exports) {
+		std::vector<uint8_t> v;
+		const auto src = Fill(v, e.format, frames * e.channels);
+
+		PcmExport pe;
+		pe.Open(e.format, e.channels, e.alsa_channel_order,
+			e.dop, e.shift8, e.pack24, e.reverse_endian);
+
+		Measure(e.op, e.format, e.channels, frames, [&](){
+				return pe.Export(Launder(src)).size;
+			});
+	}
+}
+
+#ifdef ENABLE_DSD
+
+static void
+BenchDsd(size_t frames)
+{
+	/* DSD64 and DSD256, in bytes per second */
+	for (const unsigned sample_rate : { 352800u, 1411200u }) {
+		for (const bool high_quality : { false, true }) {
+			constexpr unsigned channels = 2;
+
+			std::vector<uint8_t> v;
+			const size_t n = frames * channels;
+			const auto src = ConstBuffer<uint8_t>::FromVoid(
+				Fill(v, SampleFormat::DSD, n));
+
+			PcmDsd::SetHighQuality(high_quality);
+
+			PcmDsd dsd;
+			const unsigned out_rate = dsd.Open(channels, sample_rate);
+
+			char op[64];
+			snprintf(op, sizeof(op), "dsd_to_float%s_%u_%u",
+				 high_quality ? "_hq" : "",
+				 sample_rate * 8, out_rate);
+
+			Measure(op, SampleFormat::DSD, channels, frames, [&](){
+					return dsd.ToFloat(src).size;
+				});
+		}
+	}
+
+	PcmDsd::SetHighQuality(false);
+}
+
+#endif
+
+static PcmResampler *
+CreateSincResampler()
+{
+	return new SincPcmResampler();
+}
+
+static void
+BenchResampler(const char *name, PcmResampler &resampler,
+	       SampleFormat format, unsigned channels,
+	       unsigned sample_rate, unsigned new_sample_rate,
+	       size_t frames)
+{
+	AudioFormat af(sample_rate, format, channels);
+	if (!resampler.Open(af, new_sample_rate, IgnoreError()).IsDefined())
+		return;
+
+	std::vector<uint8_t> v;
+	const auto src = Fill(v, af.format, frames * channels);
+
+	char op[64];
+	snprintf(op, sizeof(op), "resample_%s_%u_%u",
+		 name, sample_rate, new_sample_rate);
+
+	Measure(op, af.format, channels, frames, [&](){
+			return resampler.Resample(Launder(src),
+						  IgnoreError()).size;
+		});
+
+	resampler.Close();
+}
+
+static void
+BenchResampler(size_t frames)
+{
+	static constexpr struct {
+		unsigned sample_rate, new_sample_rate;
+	} rates[] = {
+		{ 44100, 48000 },
+		{ 48000, 44100 },
+		{ 44100, 96000 },
+		{ 192000, 48000 },
+	};
+
+	static constexpr struct {
+		const char *name, *quality;
+	} qualities[] = {
+		{ "sinc_low", "low" },
+		{ "sinc_medium", "medium" },
+		{ "sinc_high", "high" },
+		{ "sinc_very_high", "very high" },
+	};
+
+	for (const auto &r : rates) {
+		for (const unsigned channels : { 1u, 2u, 6u }) {
+			for (const auto &q : qualities) {
+				pcm_resample_sinc_set_quality(q.quality);
+
+				SincPcmResampler resampler;
+				BenchResampler(q.name, resampler,
+					       SampleFormat::FLOAT, channels,
+					       r.sample_rate, r.new_sample_rate,
+					       frames);
+			}
+
+			pcm_resample_sinc_set_quality("high");
+
+			if (channels > 1) {
+				ThreadedPcmResampler resampler(CreateSincResampler,
+							       channels);
+				BenchResampler("sinc_high_threaded", resampler,
+					       SampleFormat::FLOAT, channels,
+					       r.sample_rate, r.new_sample_rate,
+					       frames);
+			}
+
+			if (channels <= 2) {
+				FallbackPcmResampler resampler;
+				BenchResampler("fallback", resampler,
+					       SampleFormat::S16, channels,
+					       r.sample_rate, r.new_sample_rate,
+					       frames);
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 3) {
+		fprintf(stderr, "Usage: bench_pcm [OP_PREFIX [SAMPLES]]\n");
+		return EXIT_FAILURE;
+	}
+
+	if (argc > 1)
+		filter = argv[1];
+
+	if (argc > 2)
+		total_samples = strtoul(argv[2], nullptr, 10);
+
+	for (const size_t frames : buffer_sizes) {
+		BenchFormat(frames);
+		BenchChannels(frames);
+		BenchInterleave(frames);
+		BenchVolume(frames);
+		BenchMix(frames);
+		BenchDither(frames);
+		BenchPack(frames);
+		BenchExport(frames);
+#ifdef ENABLE_DSD
+		BenchDsd(frames);
+#endif
+		BenchResampler(frames);
+	}
+
+	return EXIT_SUCCESS;
+}
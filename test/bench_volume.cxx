@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the throughput of the software volume and
+ * mixing kernels, comparing the SIMD implementations with the
+ * portable one and with the noise shaping #PcmDither.
+ *
+ */
+
+#include "config.h"
+#include "pcm/VolumeKernels.hxx"
+#include "pcm/PcmDither.hxx"
+#include "pcm/Traits.hxx"
+#include "AudioFormat.hxx"
+#include "system/Clock.hxx"
+
+#include "pcm/PcmDither.cxx" // including the .cxx file to get inlined templates
+
+#ifdef __SSE2__
+#include "pcm/Sse2Volume.hxx"
+#include "pcm/CpuFeatures.hxx"
+#ifdef HAVE_AVX2_DISPATCH
+#include "pcm/Avx2Volume.hxx"
+#endif
+#endif
+
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * The scalar implementation with noise shaping, which is used on
+ * architectures without SIMD kernels.
+ */
+template<SampleFormat F, class Traits=SampleTraits<F>>
+struct NoiseShapingVolumeKernel {
+	typedef typename Traits::pointer_type pointer_type;
+	typedef typename Traits::const_pointer_type const_pointer_type;
+	typedef typename Traits::long_type long_type;
+
+	static PcmDither dither;
+
+	static long_type DitherShift(long_type sample) {
+		return dither.DitherShift<long_type,
+					  Traits::BITS + PCM_VOLUME_BITS,
+					  Traits::BITS>(sample);
+	}
+
+	static void Volume(PcmVectorDither &,
+			   pointer_type dest, const_pointer_type src,
+			   size_t n, int volume) {
+		for (size_t i = 0; i != n; ++i)
+			dest[i] = DitherShift(long_type(src[i]) * volume);
+	}
+
+	static void AddVolume(PcmVectorDither &,
+			      pointer_type a, const_pointer_type b,
+			      size_t n, int volume1, int volume2) {
+		for (size_t i = 0; i != n; ++i)
+			a[i] = DitherShift(long_type(a[i]) * volume1 +
+					   long_type(b[i]) * volume2);
+	}
+};
+
+template<SampleFormat F, class Traits>
+PcmDither NoiseShapingVolumeKernel<F, Traits>::dither;
+
+static std::minstd_rand random_engine;
+
+template<typename T>
+static void
+Fill(std::vector<T> &v)
+{
+	for (auto &i : v)
+		i = T(random_engine());
+}
+
+static void
+Fill(std::vector<float> &v)
+{
+	std::uniform_real_distribution<float> dis(-1.0, 1.0);
+	for (auto &i : v)
+		i = dis(random_engine);
+}
+
+static volatile unsigned sink;
+
+static void
+Report(const char *op, SampleFormat format, const char *kernel,
+       size_t n, unsigned iterations, uint64_t duration)
+{
+	printf("op=%s format=%s kernel=%s samples=%zu iterations=%u"
+	       " usec=%llu samples_per_sec=%.0f\n",
+	       op, sample_format_to_string(format), kernel,
+	       n, iterations, (unsigned long long)duration,
+	       duration > 0 ? double(n) * iterations * 1e6 / duration : 0.);
+}
+
+template<SampleFormat F, class Kernel>
+static void
+Bench(const char *kernel, size_t n, unsigned iterations)
+{
+	typedef typename SampleTraits<F>::value_type value_type;
+
+	std::vector<value_type> a(n), b(n), dest(n);
+	Fill(a);
+	Fill(b);
+
+	PcmVectorDither dither;
+
+	uint64_t start = MonotonicClockUS();
+	for (unsigned i = 0; i < iterations; ++i)
+		Kernel::Volume(dither, dest.data(), a.data(), n,
+			       PCM_VOLUME_1 / 2);
+	Report("volume", F, kernel, n, iterations,
+	       MonotonicClockUS() - start);
+
+	start = MonotonicClockUS();
+	for (unsigned i = 0; i < iterations; ++i)
+		Kernel::AddVolume(dither, dest.data(), b.data(), n,
+				  700, PCM_VOLUME_1S - 700);
+	Report("mix", F, kernel, n, iterations,
+	       MonotonicClockUS() - start);
+
+	sink = sink + unsigned(dest[n / 2]);
+}
+
+template<SampleFormat F>
+static void
+BenchNoiseShaping(size_t n, unsigned iterations)
+{
+	Bench<F, NoiseShapingVolumeKernel<F>>("noise_shaping", n, iterations);
+}
+
+template<>
+void
+BenchNoiseShaping<SampleFormat::FLOAT>(size_t, unsigned)
+{
+	/* there is no dithering for floating point samples */
+}
+
+template<SampleFormat F>
+static void
+BenchFormat(size_t n, unsigned iterations)
+{
+	BenchNoiseShaping<F>(n, iterations);
+	Bench<F, PortableVolumeKernel<F>>("portable", n, iterations);
+
+#ifdef __SSE2__
+	Bench<F, GlueVolumeKernel<F, Sse2VolumeKernel<F>>>("sse2",
+							   n, iterations);
+#ifdef HAVE_AVX2_DISPATCH
+	if (CpuHasAvx2())
+		Bench<F, GlueVolumeKernel<F, Avx2VolumeKernel<F>>>("avx2",
+								   n, iterations);
+#endif
+#endif
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 3) {
+		fprintf(stderr, "Usage: bench_volume [SAMPLES [ITERATIONS]]\n");
+		return EXIT_FAILURE;
+	}
+
+	const size_t n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 4096;
+	const unsigned iterations = argc > 2
+		? strtoul(argv[2], nullptr, 10)
+		: 10000;
+
+	BenchFormat<SampleFormat::S8>(n, iterations);
+	BenchFormat<SampleFormat::S16>(n, iterations);
+	BenchFormat<SampleFormat::S24_P32>(n, iterations);
+	BenchFormat<SampleFormat::S32>(n, iterations);
+	BenchFormat<SampleFormat::FLOAT>(n, iterations);
+
+	return EXIT_SUCCESS;
+}
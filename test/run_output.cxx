@@ -51,9 +51,13 @@ filter_plugin_by_name(gcc_unused const char *name)
 PlayerControl::PlayerControl(PlayerListener &_listener,
 			     MultipleOutputs &_outputs,
 			     unsigned _buffer_chunks,
+			     size_t _chunk_size,
+			     BufferMemory _buffer_memory,
 			     unsigned _buffered_before_play)
 	:listener(_listener), outputs(_outputs),
 	 buffer_chunks(_buffer_chunks),
+	 chunk_size(_chunk_size),
+	 buffer_memory(_buffer_memory),
 	 buffered_before_play(_buffered_before_play) {}
 PlayerControl::~PlayerControl() {}
 
@@ -69,7 +73,8 @@ load_audio_output(EventLoop &event_loop, const char *name)
 
 	static struct PlayerControl dummy_player_control(*(PlayerListener *)nullptr,
 							 *(MultipleOutputs *)nullptr,
-							 32, 4);
+							 32, 4096,
+							 BufferMemory::DEFAULT, 4);
 
 	Error error;
 	AudioOutput *ao =
@@ -0,0 +1,231 @@
+/*
+ * Unit tests for CreateCachedStorage().
+ */
+
+#include "config.h"
+#include "storage/CachedStorage.hxx"
+#include "storage/StorageInterface.hxx"
+#include "storage/MemoryDirectoryReader.hxx"
+#include "storage/FileInfo.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "util/Error.hxx"
+#include "Compiler.h"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * A #Storage which returns configured results and counts the
+ * GetInfo() calls.
+ */
+class FakeStorage final : public Storage {
+public:
+	/**
+	 * The errno GetInfo() fails with for each URI; 0 means
+	 * success.  Unknown URIs fail with ENOENT.
+	 */
+	std::map<std::string, int> files;
+
+	unsigned n_calls;
+
+	FakeStorage():n_calls(0) {}
+
+	/* virtual methods from class Storage */
+	bool GetInfo(const char *uri_utf8, gcc_unused bool follow,
+		     StorageFileInfo &info, Error &error) override {
+		++n_calls;
+
+		const auto i = files.find(uri_utf8);
+		const int e = i != files.end() ? i->second : ENOENT;
+		if (e != 0) {
+			error.SetErrno(e, uri_utf8);
+			return false;
+		}
+
+		info.type = StorageFileInfo::Type::REGULAR;
+		info.size = 42;
+		info.mtime = 0;
+		info.device = info.inode = 0;
+		return true;
+	}
+
+	/**
+	 * Lists all successful entries below the given URI.
+	 */
+	StorageDirectoryReader *OpenDirectory(const char *uri_utf8,
+					      gcc_unused Error &error) override {
+		const std::string prefix = std::string(uri_utf8) + "/";
+
+		MemoryStorageDirectoryReader::List entries;
+		for (const auto &i : files) {
+			if (i.second != 0 ||
+			    i.first.compare(0, prefix.length(), prefix) != 0)
+				continue;
+
+			entries.emplace_front(i.first.substr(prefix.length()));
+			auto &info = entries.front().info;
+			info.type = StorageFileInfo::Type::REGULAR;
+			info.size = 42;
+			info.mtime = 0;
+			info.device = info.inode = 0;
+		}
+
+		return new MemoryStorageDirectoryReader(std::move(entries));
+	}
+
+	std::string MapUTF8(const char *uri_utf8) const override {
+		return uri_utf8;
+	}
+
+	const char *MapToRelativeUTF8(gcc_unused const char *uri_utf8) const override {
+		return nullptr;
+	}
+};
+
+class CachedStorageTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CachedStorageTest);
+	CPPUNIT_TEST(TestSuccess);
+	CPPUNIT_TEST(TestNotFound);
+	CPPUNIT_TEST(TestError);
+	CPPUNIT_TEST(TestExpire);
+	CPPUNIT_TEST(TestClear);
+	CPPUNIT_TEST(TestDirectory);
+	CPPUNIT_TEST_SUITE_END();
+
+	FakeStorage *fake;
+	std::unique_ptr<Storage> storage;
+
+public:
+	void setUp() override {
+		fake = new FakeStorage();
+		fake->files["a"] = 0;
+		fake->files["dir/x"] = 0;
+		fake->files["dir/y"] = 0;
+		fake->files["broken"] = EIO;
+
+		storage.reset(CreateCachedStorage(fake, 1));
+	}
+
+	void tearDown() override {
+		storage.reset();
+	}
+
+	void TestSuccess() {
+		CPPUNIT_ASSERT(GetInfo("a"));
+		CPPUNIT_ASSERT(GetInfo("a"));
+		CPPUNIT_ASSERT_EQUAL(1u, fake->n_calls);
+
+		/* "follow" is a different key */
+		CPPUNIT_ASSERT(GetInfo("a", true));
+		CPPUNIT_ASSERT_EQUAL(2u, fake->n_calls);
+	}
+
+	void TestNotFound() {
+		CPPUNIT_ASSERT_EQUAL(ENOENT, GetError("missing"));
+		CPPUNIT_ASSERT_EQUAL(ENOENT, GetError("missing"));
+		CPPUNIT_ASSERT_EQUAL(1u, fake->n_calls);
+	}
+
+	void TestError() {
+		/* other errors may be temporary and are not cached */
+		CPPUNIT_ASSERT_EQUAL(EIO, GetError("broken"));
+		CPPUNIT_ASSERT_EQUAL(EIO, GetError("broken"));
+		CPPUNIT_ASSERT_EQUAL(2u, fake->n_calls);
+
+		fake->files["broken"] = 0;
+		CPPUNIT_ASSERT(GetInfo("broken"));
+		CPPUNIT_ASSERT(GetInfo("broken"));
+		CPPUNIT_ASSERT_EQUAL(3u, fake->n_calls);
+	}
+
+	void TestExpire() {
+		CPPUNIT_ASSERT(GetInfo("a"));
+		CPPUNIT_ASSERT_EQUAL(ENOENT, GetError("missing"));
+		CPPUNIT_ASSERT_EQUAL(2u, fake->n_calls);
+
+		/* the TTL is one second */
+		sleep(2);
+
+		CPPUNIT_ASSERT(GetInfo("a"));
+		CPPUNIT_ASSERT_EQUAL(ENOENT, GetError("missing"));
+		CPPUNIT_ASSERT_EQUAL(4u, fake->n_calls);
+	}
+
+	void TestClear() {
+		CPPUNIT_ASSERT(GetInfo("a"));
+		CPPUNIT_ASSERT_EQUAL(ENOENT, GetError("missing"));
+		CPPUNIT_ASSERT_EQUAL(2u, fake->n_calls);
+
+		storage->ClearCache();
+		fake->files["missing"] = 0;
+
+		CPPUNIT_ASSERT(GetInfo("a"));
+		CPPUNIT_ASSERT(GetInfo("missing"));
+		CPPUNIT_ASSERT_EQUAL(4u, fake->n_calls);
+	}
+
+	void TestDirectory() {
+		Error error;
+		std::unique_ptr<StorageDirectoryReader>
+			reader(storage->OpenDirectory("dir", error));
+		CPPUNIT_ASSERT(reader != nullptr);
+
+		unsigned n = 0;
+		while (reader->Read() != nullptr) {
+			StorageFileInfo info;
+			CPPUNIT_ASSERT(reader->GetInfo(false, info, error));
+			++n;
+		}
+
+		CPPUNIT_ASSERT_EQUAL(2u, n);
+
+		/* the listing has populated the cache */
+		CPPUNIT_ASSERT(GetInfo("dir/x"));
+		CPPUNIT_ASSERT(GetInfo("dir/y"));
+		CPPUNIT_ASSERT_EQUAL(0u, fake->n_calls);
+	}
+
+private:
+	bool GetInfo(const char *uri, bool follow=false) {
+		StorageFileInfo info;
+		Error error;
+		bool success = storage->GetInfo(uri, follow, info, error);
+		if (success)
+			CPPUNIT_ASSERT_EQUAL(uint64_t(42), info.size);
+		return success;
+	}
+
+	/**
+	 * Call GetInfo(), which is expected to fail, and return the
+	 * errno.
+	 */
+	int GetError(const char *uri) {
+		StorageFileInfo info;
+		Error error;
+		CPPUNIT_ASSERT(!storage->GetInfo(uri, false, info, error));
+		CPPUNIT_ASSERT(error.IsDomain(errno_domain));
+		return error.GetCode();
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CachedStorageTest);
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	return runner.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,96 @@
+/*
+ * Unit tests for src/fs/Charset.cxx
+ */
+
+#include "config.h"
+#include "fs/Charset.hxx"
+#include "util/Error.hxx"
+#include "Compiler.h"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+
+#include <stdlib.h>
+
+#ifdef HAVE_FS_CHARSET
+
+struct PathPair {
+	const char *utf8, *fs;
+};
+
+static constexpr PathPair latin1_tests[] = {
+	{ "foo", "foo" },
+	{ "/m\xc3\xbcsic", "/m\xfcsic" },
+	{ "/m\xc3\xbcsic/\xc3\xa4/b", "/m\xfcsic/\xe4/b" },
+	{ "/m\xc3\xbcsic/\xc3\xa4/\xc3\xb6.ogg", "/m\xfcsic/\xe4/\xf6.ogg" },
+	{ "m\xc3\xbcsic/", "m\xfcsic/" },
+};
+
+/**
+ * In ISO-2022-JP, U+4E11 is encoded as "ESC $ B 1 / ESC ( B"; its
+ * second byte is the path separator.
+ */
+static constexpr PathPair iso2022jp_tests[] = {
+	{ "a/\xe4\xb8\x91", "a/\x1b$B1/\x1b(B" },
+	{ "/\xe4\xb8\x91/\xe4\xb8\x91", "/\x1b$B1/\x1b(B/\x1b$B1/\x1b(B" },
+	{ "\xe4\xb8\x91\xe4\xb8\x91/b", "\x1b$B1/1/\x1b(B/b" },
+};
+
+class CharsetTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CharsetTest);
+	CPPUNIT_TEST(TestLatin1);
+	CPPUNIT_TEST(TestStateful);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void tearDown() override {
+		DeinitFSCharset();
+	}
+
+	void TestLatin1() {
+		CPPUNIT_ASSERT(SetFSCharset("ISO-8859-1", IgnoreError()));
+
+		/* twice: the second run uses the directory cache */
+		Check(latin1_tests);
+		Check(latin1_tests);
+	}
+
+	void TestStateful() {
+		CPPUNIT_ASSERT(SetFSCharset("ISO-2022-JP", IgnoreError()));
+
+		Check(iso2022jp_tests);
+		Check(iso2022jp_tests);
+	}
+
+private:
+	template<size_t n>
+	static void Check(const PathPair (&tests)[n]) {
+		for (const auto &i : tests) {
+			CPPUNIT_ASSERT_EQUAL(std::string(i.utf8),
+					     PathToUTF8(i.fs));
+			CPPUNIT_ASSERT_EQUAL(std::string(i.fs),
+					     PathFromUTF8(i.utf8));
+		}
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CharsetTest);
+
+#endif
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+#ifdef HAVE_FS_CHARSET
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	return runner.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+#else
+	return EXIT_SUCCESS;
+#endif
+}
@@ -0,0 +1,176 @@
+/*
+ * Unit tests for class ConvertStage.
+ */
+
+#include "config.h"
+#include "output/ConvertStage.hxx"
+#include "MusicChunk.hxx"
+#include "AudioFormat.hxx"
+#include "pcm/PcmConvert.hxx"
+#include "util/ConstBuffer.hxx"
+#include "util/Error.hxx"
+#include "Compiler.h"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+static constexpr AudioFormat in_format(44100, SampleFormat::S16, 2);
+static constexpr AudioFormat out_format(44100, SampleFormat::S32, 2);
+static constexpr AudioFormat other_out_format(44100, SampleFormat::S24_P32, 2);
+
+class ConvertStageTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(ConvertStageTest);
+	CPPUNIT_TEST(TestKey);
+	CPPUNIT_TEST(TestRefs);
+	CPPUNIT_TEST(TestCache);
+	CPPUNIT_TEST(TestForget);
+	CPPUNIT_TEST_SUITE_END();
+
+	int16_t a[256], b[256];
+
+public:
+	void setUp() override {
+		unsigned seed = 42;
+		for (auto &i : a)
+			i = int16_t(rand_r(&seed));
+		for (auto &i : b)
+			i = int16_t(rand_r(&seed));
+	}
+
+	void TestKey() {
+		ConvertStage stage;
+
+		SharedConverter *x = Acquire(stage, out_format, false);
+		CPPUNIT_ASSERT_EQUAL(x, Acquire(stage, out_format, false));
+
+		/* the replay gain variant and the output format are
+		   part of the key */
+		SharedConverter *y = Acquire(stage, out_format, true);
+		CPPUNIT_ASSERT(y != x);
+
+		SharedConverter *z = Acquire(stage, other_out_format, false);
+		CPPUNIT_ASSERT(z != x);
+		CPPUNIT_ASSERT(z != y);
+
+		stage.Release(*z);
+		stage.Release(*y);
+		stage.Release(*x);
+		stage.Release(*x);
+	}
+
+	void TestRefs() {
+		ConvertStage stage;
+		MusicChunk chunk(0);
+
+		SharedConverter *x = Acquire(stage, out_format, false);
+		CPPUNIT_ASSERT_EQUAL(x, Acquire(stage, out_format, false));
+
+		/* one output is closed; the other one still uses the
+		   same converter */
+		stage.Release(*x);
+		CPPUNIT_ASSERT_EQUAL(x, Acquire(stage, out_format, false));
+		stage.Release(*x);
+
+		Check(stage.Convert(*x, chunk, Source(a)), a);
+
+		stage.Release(*x);
+	}
+
+	void TestCache() {
+		ConvertStage stage;
+		MusicChunk chunk1(0), chunk2(0);
+
+		SharedConverter *x = Acquire(stage, out_format, false);
+		SharedConverter *y = Acquire(stage, out_format, false);
+
+		const auto result1 = stage.Convert(*x, chunk1, Source(a));
+		Check(result1, a);
+
+		/* the second output gets the result of the first one
+		   without another conversion */
+		const auto result2 = stage.Convert(*y, chunk1, Source(b));
+		CPPUNIT_ASSERT(result2.data == result1.data);
+		Check(result2, a);
+
+		/* the key is the chunk */
+		const auto result3 = stage.Convert(*y, chunk2, Source(b));
+		CPPUNIT_ASSERT(result3.data != result1.data);
+		Check(result3, b);
+		Check(result1, a);
+
+		stage.Release(*y);
+		stage.Release(*x);
+	}
+
+	void TestForget() {
+		ConvertStage stage;
+		MusicChunk chunk1(0), chunk2(0);
+
+		SharedConverter *x = Acquire(stage, out_format, false);
+
+		Check(stage.Convert(*x, chunk1, Source(a)), a);
+		Check(stage.Convert(*x, chunk2, Source(a)), a);
+
+		/* after the chunk has been returned to the
+		   MusicBuffer, it is converted again */
+		stage.Forget(chunk1);
+		Check(stage.Convert(*x, chunk1, Source(b)), b);
+		Check(stage.Convert(*x, chunk2, Source(b)), a);
+
+		stage.Clear();
+		Check(stage.Convert(*x, chunk2, Source(b)), b);
+
+		stage.Release(*x);
+	}
+
+private:
+	static SharedConverter *Acquire(ConvertStage &stage,
+					AudioFormat af, bool replay_gain) {
+		Error error;
+		SharedConverter *converter =
+			stage.Acquire(in_format, af, replay_gain, error);
+		CPPUNIT_ASSERT(converter != nullptr);
+		return converter;
+	}
+
+	template<size_t n>
+	static ConstBuffer<void> Source(const int16_t (&src)[n]) {
+		return { src, sizeof(src) };
+	}
+
+	/**
+	 * Compare the result with a conversion by a separate
+	 * #PcmConvert instance.
+	 */
+	template<size_t n>
+	static void Check(ConstBuffer<void> result, const int16_t (&src)[n]) {
+		Error error;
+		PcmConvert convert;
+		CPPUNIT_ASSERT(convert.Open(in_format, out_format, error));
+
+		const auto expected = convert.Convert(Source(src), error);
+		CPPUNIT_ASSERT(!expected.IsNull());
+		CPPUNIT_ASSERT(!result.IsNull());
+		CPPUNIT_ASSERT_EQUAL(expected.size, result.size);
+		CPPUNIT_ASSERT(memcmp(expected.data, result.data,
+				      expected.size) == 0);
+
+		convert.Close();
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ConvertStageTest);
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	return runner.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,282 @@
+/*
+ * Unit tests for class CrossFadeStage.
+ */
+
+#include "config.h"
+#include "output/CrossFadeStage.hxx"
+#include "MusicBuffer.hxx"
+#include "MusicChunk.hxx"
+#include "AudioFormat.hxx"
+#include "ReplayGainInfo.hxx"
+#include "filter/FilterPlugin.hxx"
+#include "filter/FilterInternal.hxx"
+#include "filter/FilterRegistry.hxx"
+#include "filter/plugins/ReplayGainFilterPlugin.hxx"
+#include "mixer/MixerControl.hxx"
+#include "config/Block.hxx"
+#include "pcm/PcmBuffer.hxx"
+#include "pcm/PcmDither.hxx"
+#include "pcm/PcmMix.hxx"
+#include "util/ConstBuffer.hxx"
+#include "util/Error.hxx"
+#include "Compiler.h"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <memory>
+
+#include <stdlib.h>
+#include <string.h>
+
+bool
+mixer_set_volume(gcc_unused Mixer *mixer,
+		 gcc_unused unsigned volume, gcc_unused Error &error)
+{
+	return true;
+}
+
+static constexpr AudioFormat test_format(44100, SampleFormat::S16, 2);
+
+static constexpr unsigned N_CHUNKS = 16;
+
+/**
+ * The replay gain and cross-fade code which each audio output ran
+ * before #CrossFadeStage was introduced.
+ */
+class OldOutput {
+	std::unique_ptr<Filter> replay_gain_filter;
+	unsigned replay_gain_serial = 0;
+
+	std::unique_ptr<Filter> other_replay_gain_filter;
+	unsigned other_replay_gain_serial = 0;
+
+	PcmBuffer cross_fade_buffer;
+	PcmDither cross_fade_dither;
+
+public:
+	explicit OldOutput(bool replay_gain) {
+		if (replay_gain) {
+			replay_gain_filter.reset(NewReplayGainFilter());
+			other_replay_gain_filter.reset(NewReplayGainFilter());
+		}
+	}
+
+	~OldOutput() {
+		if (replay_gain_filter != nullptr) {
+			replay_gain_filter->Close();
+			other_replay_gain_filter->Close();
+		}
+	}
+
+	ConstBuffer<void> Process(const MusicChunk &chunk) {
+		ConstBuffer<void> data =
+			ApplyReplayGain(chunk, replay_gain_filter.get(),
+					replay_gain_serial);
+		if (data.IsEmpty() || chunk.other == nullptr)
+			return data;
+
+		ConstBuffer<void> other_data =
+			ApplyReplayGain(*chunk.other,
+					other_replay_gain_filter.get(),
+					other_replay_gain_serial);
+		if (other_data.IsEmpty())
+			return data;
+
+		if (data.size > other_data.size)
+			data.size = other_data.size;
+
+		float mix_ratio = chunk.mix_ratio;
+		if (mix_ratio >= 0)
+			mix_ratio = 1.0 - mix_ratio;
+
+		void *dest = cross_fade_buffer.Get(other_data.size);
+		memcpy(dest, other_data.data, other_data.size);
+		CPPUNIT_ASSERT(pcm_mix(cross_fade_dither, dest,
+				       data.data, data.size,
+				       test_format.format, mix_ratio));
+		return { dest, other_data.size };
+	}
+
+private:
+	static Filter *NewReplayGainFilter() {
+		Error error;
+		Filter *filter = filter_new(&replay_gain_filter_plugin,
+					    ConfigBlock(), error);
+		CPPUNIT_ASSERT(filter != nullptr);
+		replay_gain_filter_set_mode(filter, REPLAY_GAIN_TRACK);
+
+		AudioFormat af = test_format;
+		CPPUNIT_ASSERT(filter->Open(af, error).IsDefined());
+		return filter;
+	}
+
+	static ConstBuffer<void> ApplyReplayGain(const MusicChunk &chunk,
+						 Filter *filter,
+						 unsigned &serial) {
+		ConstBuffer<void> data(chunk.data, chunk.length);
+		if (filter == nullptr)
+			return data;
+
+		if (chunk.replay_gain_serial != serial) {
+			replay_gain_filter_set_info(filter,
+						    chunk.replay_gain_serial != 0
+						    ? &chunk.replay_gain_info
+						    : nullptr);
+			serial = chunk.replay_gain_serial;
+		}
+
+		Error error;
+		data = filter->FilterPCM(data, error);
+		CPPUNIT_ASSERT(!data.IsNull());
+		return data;
+	}
+};
+
+class CrossFadeStageTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CrossFadeStageTest);
+	CPPUNIT_TEST(TestReplayGain);
+	CPPUNIT_TEST(TestNoReplayGain);
+	CPPUNIT_TEST(TestMixed);
+	CPPUNIT_TEST_SUITE_END();
+
+	std::unique_ptr<MusicBuffer> buffer;
+
+	/**
+	 * The chunks of the song being played and the chunks of the
+	 * song being faded in.
+	 */
+	MusicChunk *chunks[N_CHUNKS], *others[N_CHUNKS];
+
+public:
+	void setUp() override {
+		buffer.reset(new MusicBuffer(N_CHUNKS * 2, 4096));
+
+		unsigned seed = 42;
+		for (unsigned i = 0; i < N_CHUNKS; ++i) {
+			/* a new song (with new replay gain info)
+			   starts in the middle */
+			chunks[i] = NewChunk(seed, 4096,
+					     i < N_CHUNKS / 2 ? 1 : 2,
+					     i < N_CHUNKS / 2 ? -6 : 4);
+
+			/* the other song is sometimes shorter and
+			   sometimes longer */
+			others[i] = NewChunk(seed, i % 3 == 0 ? 2048 : 4096,
+					     i < N_CHUNKS / 4 ? 0 : 3, -2);
+		}
+
+		/* cross-fade the second half; the last chunk uses a
+		   MixRamp style negative mix ratio */
+		for (unsigned i = N_CHUNKS / 2; i < N_CHUNKS; ++i) {
+			chunks[i]->other = others[i];
+			chunks[i]->mix_ratio = float(N_CHUNKS - i) / N_CHUNKS;
+		}
+
+		chunks[N_CHUNKS - 1]->mix_ratio = -1;
+	}
+
+	void tearDown() override {
+		for (unsigned i = 0; i < N_CHUNKS; ++i) {
+			buffer->Return(chunks[i]);
+			buffer->Return(others[i]);
+		}
+
+		buffer.reset();
+	}
+
+	void TestReplayGain() {
+		Run(true, true);
+	}
+
+	void TestNoReplayGain() {
+		Run(false, false);
+	}
+
+	/**
+	 * One output applies replay gain, the other one does not.
+	 */
+	void TestMixed() {
+		Run(true, false);
+	}
+
+private:
+	MusicChunk *NewChunk(unsigned &seed, size_t size,
+			     unsigned replay_gain_serial, float gain) {
+		MusicChunk *chunk = buffer->Allocate();
+		CPPUNIT_ASSERT(chunk != nullptr);
+
+		auto w = chunk->Write(test_format, SongTime::zero(), 0);
+		CPPUNIT_ASSERT(w.size >= size);
+
+		int16_t *p = (int16_t *)w.data;
+		for (size_t i = 0; i < size / sizeof(*p); ++i)
+			p[i] = int16_t(rand_r(&seed));
+
+		chunk->Expand(test_format, size);
+
+		chunk->replay_gain_serial = replay_gain_serial;
+		chunk->replay_gain_info.Clear();
+		chunk->replay_gain_info.tuples[REPLAY_GAIN_TRACK].gain = gain;
+		chunk->replay_gain_info.tuples[REPLAY_GAIN_TRACK].peak = 0.5;
+		return chunk;
+	}
+
+	/**
+	 * Run all chunks through a #CrossFadeStage for two outputs
+	 * and compare the results with what #OldOutput calculates.
+	 * The first output runs ahead of the second one, like an
+	 * output thread which does not have to wait for the device.
+	 */
+	void Run(bool replay_gain_a, bool replay_gain_b) {
+		CrossFadeStage stage;
+		stage.SetReplayGainMode(REPLAY_GAIN_TRACK);
+
+		Error error;
+		CPPUNIT_ASSERT(stage.Open(test_format, error));
+
+		OldOutput old_a(replay_gain_a), old_b(replay_gain_b);
+
+		ConstBuffer<void> results_a[N_CHUNKS];
+		for (unsigned i = 0; i < N_CHUNKS; ++i) {
+			results_a[i] = stage.Get(*chunks[i], replay_gain_a);
+			Compare(old_a.Process(*chunks[i]), results_a[i]);
+		}
+
+		for (unsigned i = 0; i < N_CHUNKS; ++i) {
+			const auto b = stage.Get(*chunks[i], replay_gain_b);
+			Compare(old_b.Process(*chunks[i]), b);
+
+			if (replay_gain_a == replay_gain_b)
+				/* the result is shared */
+				CPPUNIT_ASSERT(b.data == results_a[i].data);
+
+			/* the chunk has been consumed by all
+			   outputs */
+			stage.Forget(*chunks[i]);
+		}
+
+		stage.Close();
+	}
+
+	static void Compare(ConstBuffer<void> expected,
+			    ConstBuffer<void> actual) {
+		CPPUNIT_ASSERT(!actual.IsNull());
+		CPPUNIT_ASSERT_EQUAL(expected.size, actual.size);
+		CPPUNIT_ASSERT(memcmp(expected.data, actual.data,
+				      expected.size) == 0);
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CrossFadeStageTest);
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	return runner.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,181 @@
+/*
+ * Unit tests for class DecoderCache.
+ */
+
+#include "config.h"
+#include "decoder/DecoderCache.hxx"
+#include "AudioFormat.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "Compiler.h"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <memory>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static constexpr AudioFormat test_format(44100, SampleFormat::S16, 2);
+
+class DecoderCacheTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(DecoderCacheTest);
+	CPPUNIT_TEST(TestLRU);
+	CPPUNIT_TEST(TestSpill);
+	CPPUNIT_TEST(TestSpillTooLarge);
+	CPPUNIT_TEST(TestInUse);
+	CPPUNIT_TEST(TestModified);
+	CPPUNIT_TEST(TestFormatChanged);
+	CPPUNIT_TEST_SUITE_END();
+
+	char directory[32];
+
+public:
+	void setUp() override {
+		strcpy(directory, "/tmp/test_decoder_cache.XXXXXX");
+		CPPUNIT_ASSERT(mkdtemp(directory) != nullptr);
+	}
+
+	void tearDown() override {
+		/* spill files are unlinked right after they have
+		   been created, so the directory must be empty */
+		CPPUNIT_ASSERT_EQUAL(0, rmdir(directory));
+	}
+
+	void TestLRU() {
+		DecoderCache cache(300, AllocatedPath::Null(), 0);
+		Store(cache, "a", 100, 'a');
+		Store(cache, "b", 100, 'b');
+		Store(cache, "c", 100, 'c');
+
+		/* "a" becomes the most recently used entry */
+		CPPUNIT_ASSERT(Lookup(cache, "a") != nullptr);
+
+		/* ... and so "b" gets evicted */
+		Store(cache, "d", 100, 'd');
+		CPPUNIT_ASSERT(Lookup(cache, "b") == nullptr);
+		CheckEntry(Lookup(cache, "a"), 100, 'a', false);
+		CheckEntry(Lookup(cache, "c"), 100, 'c', false);
+		CheckEntry(Lookup(cache, "d"), 100, 'd', false);
+	}
+
+	void TestSpill() {
+		DecoderCache cache(200, AllocatedPath::FromFS(directory),
+				   1000);
+		Store(cache, "a", 100, 'a');
+		Store(cache, "b", 100, 'b');
+		Store(cache, "c", 100, 'c');
+
+		/* the least recently used entry has been moved to
+		   the spill directory */
+		CheckEntry(Lookup(cache, "a"), 100, 'a', true);
+		CheckEntry(Lookup(cache, "b"), 100, 'b', false);
+		CheckEntry(Lookup(cache, "c"), 100, 'c', false);
+	}
+
+	void TestSpillTooLarge() {
+		/* the entry does not fit into the spill directory; it
+		   gets dropped */
+		DecoderCache cache(200, AllocatedPath::FromFS(directory),
+				   50);
+		Store(cache, "a", 100, 'a');
+		Store(cache, "b", 100, 'b');
+		Store(cache, "c", 100, 'c');
+
+		CPPUNIT_ASSERT(Lookup(cache, "a") == nullptr);
+		CheckEntry(Lookup(cache, "b"), 100, 'b', false);
+		CheckEntry(Lookup(cache, "c"), 100, 'c', false);
+	}
+
+	void TestInUse() {
+		DecoderCache cache(200, AllocatedPath::FromFS(directory),
+				   1000);
+		Store(cache, "a", 100, 'a');
+		Store(cache, "b", 100, 'b');
+
+		/* "a" is being played while it is the least recently
+		   used entry */
+		const auto a = Lookup(cache, "a");
+		CPPUNIT_ASSERT(Lookup(cache, "b") != nullptr);
+
+		/* it must be skipped; "b" is spilled instead */
+		Store(cache, "c", 100, 'c');
+		CheckEntry(a, 100, 'a', false);
+		CheckEntry(Lookup(cache, "b"), 100, 'b', true);
+	}
+
+	void TestModified() {
+		DecoderCache cache(1000, AllocatedPath::Null(), 0);
+		Store(cache, "a", 100, 'a');
+
+		CPPUNIT_ASSERT(Lookup(cache, "a", 2) == nullptr);
+
+		/* the stale entry has been removed */
+		CPPUNIT_ASSERT(Lookup(cache, "a") == nullptr);
+	}
+
+	void TestFormatChanged() {
+		DecoderCache cache(1000, AllocatedPath::Null(), 0);
+
+		/* recorded while a different "audio_output_format"
+		   was configured */
+		auto entry = CreateEntry("a", 100, 'a');
+		entry->out_format.sample_rate = 48000;
+		cache.Store(std::move(entry));
+
+		CPPUNIT_ASSERT(Lookup(cache, "a") == nullptr);
+	}
+
+private:
+	static std::unique_ptr<DecoderCacheEntry>
+	CreateEntry(const char *uri, size_t size, uint8_t value) {
+		std::unique_ptr<DecoderCacheEntry>
+			entry(new DecoderCacheEntry(uri, SongTime::zero(),
+						    SongTime::zero(), 1));
+		entry->in_format = entry->out_format = test_format;
+
+		uint8_t buffer[256];
+		memset(buffer, value, sizeof(buffer));
+		CPPUNIT_ASSERT(size <= sizeof(buffer));
+		CPPUNIT_ASSERT(entry->Append(buffer, size, size));
+		return entry;
+	}
+
+	static void Store(DecoderCache &cache, const char *uri,
+			  size_t size, uint8_t value) {
+		cache.Store(CreateEntry(uri, size, value));
+	}
+
+	static std::shared_ptr<const DecoderCacheEntry>
+	Lookup(DecoderCache &cache, const char *uri, time_t mtime=1) {
+		return cache.Lookup(uri, SongTime::zero(), SongTime::zero(),
+				    mtime);
+	}
+
+	static void CheckEntry(std::shared_ptr<const DecoderCacheEntry> entry,
+			       size_t size, uint8_t value, bool spilled) {
+		CPPUNIT_ASSERT(entry != nullptr);
+		CPPUNIT_ASSERT_EQUAL(spilled, entry->IsSpilled());
+		CPPUNIT_ASSERT_EQUAL(size, entry->size);
+
+		uint8_t buffer[256];
+		CPPUNIT_ASSERT_EQUAL(size, entry->Read(0, buffer,
+						       sizeof(buffer)));
+		for (size_t i = 0; i < size; ++i)
+			CPPUNIT_ASSERT_EQUAL(value, buffer[i]);
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DecoderCacheTest);
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	return runner.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,329 @@
+/*
+ * Unit tests for the in-place processing of the "chain" and "route"
+ * filters.
+ */
+
+#include "config.h"
+#include "filter/FilterPlugin.hxx"
+#include "filter/FilterInternal.hxx"
+#include "filter/FilterRegistry.hxx"
+#include "filter/plugins/ChainFilterPlugin.hxx"
+#include "mixer/MixerControl.hxx"
+#include "config/Block.hxx"
+#include "AudioFormat.hxx"
+#include "pcm/PcmBuffer.hxx"
+#include "util/ConstBuffer.hxx"
+#include "util/Error.hxx"
+#include "Compiler.h"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <memory>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool
+mixer_set_volume(gcc_unused Mixer *mixer,
+		 gcc_unused unsigned volume, gcc_unused Error &error)
+{
+	return true;
+}
+
+/**
+ * An in-place filter which adds a constant to each byte.
+ */
+class AddFilter final : public Filter {
+	const uint8_t value;
+
+	PcmBuffer buffer;
+
+public:
+	explicit AddFilter(uint8_t _value):value(_value) {}
+
+	AudioFormat Open(AudioFormat &af, gcc_unused Error &error) override {
+		return af;
+	}
+
+	void Close() override {}
+
+	ConstBuffer<void> FilterPCM(ConstBuffer<void> src,
+				    gcc_unused Error &error) override {
+		void *dest = buffer.Get(src.size);
+		Add(src, (uint8_t *)dest);
+		return { dest, src.size };
+	}
+
+	bool IsInPlace() const override {
+		return true;
+	}
+
+	bool FilterInPlace(ConstBuffer<void> src, void *dest,
+			   gcc_unused Error &error) override {
+		const uint8_t *s = (const uint8_t *)src.data;
+		const uint8_t *d = (const uint8_t *)dest;
+
+		/* the buffers must be equal or must not overlap */
+		CPPUNIT_ASSERT(d == s || d + src.size <= s ||
+			       s + src.size <= d);
+
+		Add(src, (uint8_t *)dest);
+		return true;
+	}
+
+private:
+	void Add(ConstBuffer<void> src, uint8_t *dest) const {
+		const uint8_t *s = (const uint8_t *)src.data;
+		for (size_t i = 0; i < src.size; ++i)
+			dest[i] = s[i] + value;
+	}
+};
+
+/**
+ * A filter which returns its input without the first bytes,
+ * i.e. a pointer into the caller's buffer.
+ */
+class SkipFilter final : public Filter {
+	const size_t n;
+
+public:
+	explicit SkipFilter(size_t _n):n(_n) {}
+
+	AudioFormat Open(AudioFormat &af, gcc_unused Error &error) override {
+		return af;
+	}
+
+	void Close() override {}
+
+	ConstBuffer<void> FilterPCM(ConstBuffer<void> src,
+				    gcc_unused Error &error) override {
+		assert(src.size >= n);
+		return { (const uint8_t *)src.data + n, src.size - n };
+	}
+};
+
+/**
+ * A filter which copies its input into its own buffer.
+ */
+class CopyFilter final : public Filter {
+	PcmBuffer buffer;
+
+public:
+	AudioFormat Open(AudioFormat &af, gcc_unused Error &error) override {
+		return af;
+	}
+
+	void Close() override {}
+
+	ConstBuffer<void> FilterPCM(ConstBuffer<void> src,
+				    gcc_unused Error &error) override {
+		void *dest = buffer.Get(src.size);
+		memcpy(dest, src.data, src.size);
+		return { dest, src.size };
+	}
+};
+
+static constexpr AudioFormat test_format(44100, SampleFormat::S16, 2);
+
+class ChainFilterTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(ChainFilterTest);
+	CPPUNIT_TEST(TestInPlace);
+	CPPUNIT_TEST(TestPassThrough);
+	CPPUNIT_TEST(TestSkip);
+	CPPUNIT_TEST(TestMixed);
+	CPPUNIT_TEST_SUITE_END();
+
+	uint8_t input[256];
+
+public:
+	void setUp() override {
+		for (size_t i = 0; i < sizeof(input); ++i)
+			input[i] = i * 7;
+	}
+
+	void TestInPlace() {
+		std::unique_ptr<Filter> chain(filter_chain_new());
+		filter_chain_append(*chain, "a", new AddFilter(1));
+		filter_chain_append(*chain, "b", new AddFilter(2));
+
+		Check(*chain, 0, 3);
+	}
+
+	/**
+	 * A filter which is not in-place returns its input: the
+	 * caller's buffer must not be modified, and the chain's own
+	 * buffer may be.
+	 */
+	void TestPassThrough() {
+		std::unique_ptr<Filter> chain(filter_chain_new());
+		filter_chain_append(*chain, "a", new SkipFilter(0));
+		filter_chain_append(*chain, "b", new AddFilter(1));
+		filter_chain_append(*chain, "c", new SkipFilter(0));
+		filter_chain_append(*chain, "d", new AddFilter(2));
+
+		Check(*chain, 0, 3);
+	}
+
+	/**
+	 * A filter which is not in-place returns a pointer into the
+	 * chain's buffer, but not to its beginning.
+	 */
+	void TestSkip() {
+		std::unique_ptr<Filter> chain(filter_chain_new());
+		filter_chain_append(*chain, "a", new AddFilter(1));
+		filter_chain_append(*chain, "b", new SkipFilter(4));
+		filter_chain_append(*chain, "c", new AddFilter(2));
+		filter_chain_append(*chain, "d", new SkipFilter(4));
+		filter_chain_append(*chain, "e", new AddFilter(3));
+
+		Check(*chain, 8, 6);
+	}
+
+	void TestMixed() {
+		std::unique_ptr<Filter> chain(filter_chain_new());
+		filter_chain_append(*chain, "a", new CopyFilter());
+		filter_chain_append(*chain, "b", new AddFilter(1));
+		filter_chain_append(*chain, "c", new CopyFilter());
+		filter_chain_append(*chain, "d", new AddFilter(2));
+		filter_chain_append(*chain, "e", new AddFilter(3));
+		filter_chain_append(*chain, "f", new CopyFilter());
+		filter_chain_append(*chain, "g", new SkipFilter(2));
+
+		Check(*chain, 2, 6);
+	}
+
+private:
+	/**
+	 * Run #input through the chain twice (the second time with
+	 * the buffers from the first run), and compare the result
+	 * with the expected one.
+	 */
+	void Check(Filter &chain, size_t skip, uint8_t add) {
+		AudioFormat af = test_format;
+		Error error;
+		CPPUNIT_ASSERT(chain.Open(af, error).IsDefined());
+
+		uint8_t copy[sizeof(input)];
+		memcpy(copy, input, sizeof(input));
+
+		for (unsigned i = 0; i < 2; ++i) {
+			const auto result =
+				chain.FilterPCM({input, sizeof(input)}, error);
+			CPPUNIT_ASSERT(!result.IsNull());
+			CPPUNIT_ASSERT_EQUAL(sizeof(input) - skip, result.size);
+
+			const uint8_t *p = (const uint8_t *)result.data;
+			for (size_t j = 0; j < result.size; ++j)
+				CPPUNIT_ASSERT_EQUAL(uint8_t(input[skip + j] + add),
+						     p[j]);
+
+			/* the input must not have been modified */
+			CPPUNIT_ASSERT(memcmp(copy, input, sizeof(input)) == 0);
+		}
+
+		chain.Close();
+	}
+};
+
+class RouteFilterTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(RouteFilterTest);
+	CPPUNIT_TEST(TestSwap);
+	CPPUNIT_TEST(TestRotate);
+	CPPUNIT_TEST(TestChain);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void TestSwap() {
+		Check("0>1, 1>0", AudioFormat(44100, SampleFormat::S16, 2));
+	}
+
+	void TestRotate() {
+		Check("0>1, 1>2, 2>0",
+		      AudioFormat(44100, SampleFormat::S32, 3));
+	}
+
+	/**
+	 * The "route" filter after an in-place filter in a chain
+	 * operates on the chain's buffer.
+	 */
+	void TestChain() {
+		std::unique_ptr<Filter> chain(filter_chain_new());
+		filter_chain_append(*chain, "add", new AddFilter(1));
+		filter_chain_append(*chain, "route", NewRoute("0>1, 1>0"));
+
+		AudioFormat af(44100, SampleFormat::S8, 2);
+		Error error;
+		CPPUNIT_ASSERT(chain->Open(af, error).IsDefined());
+
+		const uint8_t input[] = { 1, 2, 3, 4, 5, 6 };
+		const auto result = chain->FilterPCM({input, sizeof(input)},
+						     error);
+		CPPUNIT_ASSERT(!result.IsNull());
+		CPPUNIT_ASSERT_EQUAL(sizeof(input), result.size);
+
+		const uint8_t expected[] = { 3, 2, 5, 4, 7, 6 };
+		CPPUNIT_ASSERT(memcmp(expected, result.data,
+				      sizeof(expected)) == 0);
+
+		chain->Close();
+	}
+
+private:
+	static Filter *NewRoute(const char *routes) {
+		ConfigBlock block;
+		block.AddBlockParam("routes", routes);
+
+		Error error;
+		Filter *filter = filter_new(&route_filter_plugin, block,
+					    error);
+		CPPUNIT_ASSERT(filter != nullptr);
+		return filter;
+	}
+
+	/**
+	 * Compare FilterInPlace() with dest==src.data with
+	 * FilterPCM().
+	 */
+	static void Check(const char *routes, AudioFormat format) {
+		std::unique_ptr<Filter> filter(NewRoute(routes));
+
+		AudioFormat af = format;
+		Error error;
+		CPPUNIT_ASSERT(filter->Open(af, error).IsDefined());
+		CPPUNIT_ASSERT(filter->IsInPlace());
+
+		uint8_t buffer[64 * 3 * sizeof(int32_t)];
+		const size_t size = 64 * format.GetFrameSize();
+		CPPUNIT_ASSERT(size <= sizeof(buffer));
+
+		for (size_t i = 0; i < size; ++i)
+			buffer[i] = i * 13;
+
+		const auto expected = filter->FilterPCM({buffer, size}, error);
+		CPPUNIT_ASSERT(!expected.IsNull());
+		CPPUNIT_ASSERT_EQUAL(size, expected.size);
+		CPPUNIT_ASSERT(memcmp(expected.data, buffer, size) != 0);
+
+		CPPUNIT_ASSERT(filter->FilterInPlace({buffer, size}, buffer,
+						     error));
+		CPPUNIT_ASSERT(memcmp(expected.data, buffer, size) == 0);
+
+		filter->Close();
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ChainFilterTest);
+CPPUNIT_TEST_SUITE_REGISTRATION(RouteFilterTest);
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	return runner.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
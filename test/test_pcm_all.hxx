@@ -49,11 +49,13 @@ class PcmChannelsTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST_SUITE(PcmChannelsTest);
 	CPPUNIT_TEST(TestChannels16);
 	CPPUNIT_TEST(TestChannels32);
+	CPPUNIT_TEST(TestChannelMatrix);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
 	void TestChannels16();
 	void TestChannels32();
+	void TestChannelMatrix();
 };
 
 class PcmVolumeTest : public CppUnit::TestFixture {
@@ -63,6 +65,8 @@ class PcmVolumeTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST(TestVolume24);
 	CPPUNIT_TEST(TestVolume32);
 	CPPUNIT_TEST(TestVolumeFloat);
+	CPPUNIT_TEST(TestVolumeSimd);
+	CPPUNIT_TEST(TestFusedGain);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -71,6 +75,8 @@ public:
 	void TestVolume24();
 	void TestVolume32();
 	void TestVolumeFloat();
+	void TestVolumeSimd();
+	void TestFusedGain();
 };
 
 class PcmFormatTest : public CppUnit::TestFixture {
@@ -79,6 +85,8 @@ class PcmFormatTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST(TestFormat16to24);
 	CPPUNIT_TEST(TestFormat16to32);
 	CPPUNIT_TEST(TestFormatFloat);
+	CPPUNIT_TEST(TestFormatFloatTo32);
+	CPPUNIT_TEST(TestFormatSimd);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -86,6 +94,8 @@ public:
 	void TestFormat16to24();
 	void TestFormat16to32();
 	void TestFormatFloat();
+	void TestFormatFloatTo32();
+	void TestFormatSimd();
 };
 
 class PcmMixTest : public CppUnit::TestFixture {
@@ -94,6 +104,7 @@ class PcmMixTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST(TestMix16);
 	CPPUNIT_TEST(TestMix24);
 	CPPUNIT_TEST(TestMix32);
+	CPPUNIT_TEST(TestMixSimd);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -101,6 +112,35 @@ public:
 	void TestMix16();
 	void TestMix24();
 	void TestMix32();
+	void TestMixSimd();
+};
+
+#ifdef ENABLE_DSD
+
+class PcmDsdTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(PcmDsdTest);
+	CPPUNIT_TEST(TestStandardFilter);
+	CPPUNIT_TEST(TestToFloat);
+	CPPUNIT_TEST(TestHighQualityFilter);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void TestStandardFilter();
+	void TestToFloat();
+	void TestHighQualityFilter();
+};
+
+#endif
+
+class PcmResamplerTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(PcmResamplerTest);
+	CPPUNIT_TEST(TestSinc);
+	CPPUNIT_TEST(TestThreaded);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void TestSinc();
+	void TestThreaded();
 };
 
 class PcmInterleaveTest : public CppUnit::TestFixture {
@@ -127,6 +167,7 @@ class PcmExportTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST(TestReverseEndian);
 	CPPUNIT_TEST(TestDop);
 	CPPUNIT_TEST(TestAlsaChannelOrder);
+	CPPUNIT_TEST(TestCombined);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -135,6 +176,7 @@ public:
 	void TestReverseEndian();
 	void TestDop();
 	void TestAlsaChannelOrder();
+	void TestCombined();
 };
 
 #endif
@@ -22,8 +22,14 @@
 #include "test_pcm_util.hxx"
 #include "pcm/PcmChannels.hxx"
 #include "pcm/PcmBuffer.hxx"
+#include "pcm/ChannelMatrix.hxx"
 #include "util/ConstBuffer.hxx"
 
+#include <algorithm>
+
+#include <math.h>
+#include <stdlib.h>
+
 void
 PcmChannelsTest::TestChannels16()
 {
@@ -79,3 +85,86 @@ PcmChannelsTest::TestChannels32()
 		CPPUNIT_ASSERT_EQUAL(src[i], dest[i * 2 + 1]);
 	}
 }
+
+void
+PcmChannelsTest::TestChannelMatrix()
+{
+	/* ITU downmix of 5.1 to stereo, normalized */
+	PcmChannelMatrix matrix;
+	matrix.SetDefault(6, 2);
+	CPPUNIT_ASSERT_EQUAL(6u, matrix.GetSourceChannels());
+	CPPUNIT_ASSERT_EQUAL(2u, matrix.GetDestChannels());
+
+	const float scale = 1 / (1 + 2 * 0.70710678f);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL(scale, matrix.Get(0, 0), 1e-6);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL(0, matrix.Get(0, 1), 1e-6);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL(0.70710678 * scale, matrix.Get(0, 2), 1e-6);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL(0, matrix.Get(0, 3), 1e-6);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL(0.70710678 * scale, matrix.Get(0, 4), 1e-6);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL(0, matrix.Get(0, 5), 1e-6);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL(0.70710678 * scale, matrix.Get(1, 5), 1e-6);
+
+	/* float: compare with a scalar calculation */
+	constexpr size_t N = 509;
+	const auto src = TestDataBuffer<float, N * 6>(RandomFloat());
+
+	PcmBuffer buffer;
+	auto dest = ConstBuffer<float>::FromVoid(matrix.Apply(buffer, SampleFormat::FLOAT,
+							      ConstBuffer<float>(src, N * 6).ToVoid()));
+	CPPUNIT_ASSERT_EQUAL(N * 2, dest.size);
+	for (unsigned i = 0; i < N; ++i) {
+		for (unsigned o = 0; o < 2; ++o) {
+			float expected = 0;
+			for (unsigned c = 0; c < 6; ++c)
+				expected += src[i * 6 + c] * matrix.Get(o, c);
+
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, dest[i * 2 + o],
+						     1e-6);
+		}
+	}
+
+	/* 16 bit with clipping */
+	matrix.Clear(2, 3);
+	matrix.Set(0, 0, 1);
+	matrix.Set(1, 0, 0.5);
+	matrix.Set(1, 1, 0.5);
+	matrix.Set(2, 1, 2);
+
+	const auto src16 = TestDataBuffer<int16_t, N * 2>();
+	auto dest16 = ConstBuffer<int16_t>::FromVoid(matrix.Apply(buffer, SampleFormat::S16,
+								  ConstBuffer<int16_t>(src16, N * 2).ToVoid()));
+	CPPUNIT_ASSERT_EQUAL(N * 3, dest16.size);
+	for (unsigned i = 0; i < N; ++i) {
+		const int a = src16[i * 2], b = src16[i * 2 + 1];
+		CPPUNIT_ASSERT_EQUAL(int16_t(a), dest16[i * 3]);
+		CPPUNIT_ASSERT(abs(dest16[i * 3 + 1] - (a + b) / 2) <= 1);
+		CPPUNIT_ASSERT_EQUAL(int16_t(std::max(-32768, std::min(2 * b, 32767))),
+				     dest16[i * 3 + 2]);
+	}
+
+	/* 8 bit (the "route" filter passes it unchanged) */
+	const auto src8 = TestDataBuffer<int8_t, N * 2>();
+	auto dest8 = ConstBuffer<int8_t>::FromVoid(matrix.Apply(buffer, SampleFormat::S8,
+								ConstBuffer<int8_t>(src8, N * 2).ToVoid()));
+	CPPUNIT_ASSERT_EQUAL(N * 3, dest8.size);
+	for (unsigned i = 0; i < N; ++i) {
+		const int a = src8[i * 2], b = src8[i * 2 + 1];
+		CPPUNIT_ASSERT_EQUAL(int8_t(a), dest8[i * 3]);
+		CPPUNIT_ASSERT(abs(dest8[i * 3 + 1] - (a + b) / 2) <= 1);
+		CPPUNIT_ASSERT_EQUAL(int8_t(std::max(-128, std::min(2 * b, 127))),
+				     dest8[i * 3 + 2]);
+	}
+
+	/* the default conversion uses the matrix, too */
+	const auto src24 = TestDataBuffer<int32_t, N * 6>(RandomInt24());
+	auto dest24 = pcm_convert_channels_24(buffer, 2, 6, { src24, N * 6 });
+	CPPUNIT_ASSERT_EQUAL(N * 2, dest24.size);
+	matrix.SetDefault(6, 2);
+	for (unsigned i = 0; i < N; ++i) {
+		float expected = 0;
+		for (unsigned c = 0; c < 6; ++c)
+			expected += src24[i * 6 + c] * matrix.Get(0, c);
+
+		CPPUNIT_ASSERT(fabs(expected - dest24[i * 2]) <= 1);
+	}
+}
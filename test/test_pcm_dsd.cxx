@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "test_pcm_all.hxx"
+#include "pcm/PcmDsd.hxx"
+#include "pcm/DsdFilter.hxx"
+#include "pcm/dsd2pcm/dsd2pcm.h"
+#include "util/ConstBuffer.hxx"
+
+#include <random>
+#include <vector>
+
+#include <math.h>
+
+static constexpr unsigned DSD_CHANNELS = 3;
+static constexpr unsigned DSD_FRAMES = 1021;
+
+/**
+ * Generate random DSD frames.
+ */
+static std::vector<uint8_t>
+MakeDsd(size_t n_frames)
+{
+	std::minstd_rand engine;
+	std::vector<uint8_t> dsd(n_frames * DSD_CHANNELS);
+	for (auto &i : dsd)
+		i = uint8_t(engine());
+	return dsd;
+}
+
+/**
+ * Convert with the dsd2pcm library, one channel after another.
+ */
+static std::vector<float>
+ReferenceToFloat(const std::vector<uint8_t> &src)
+{
+	const size_t n_frames = src.size() / DSD_CHANNELS;
+	std::vector<float> dest(src.size());
+
+	for (unsigned c = 0; c < DSD_CHANNELS; ++c) {
+		dsd2pcm_ctx *ctx = dsd2pcm_init();
+		dsd2pcm_translate(ctx, n_frames, &src[c], DSD_CHANNELS,
+				  false, &dest[c], DSD_CHANNELS);
+		dsd2pcm_destroy(ctx);
+	}
+
+	return dest;
+}
+
+typedef void (*DsdStandardFilterFunction)(const uint8_t *src,
+					  unsigned channels, size_t n,
+					  float *dest);
+
+static void
+TestStandardFilter(DsdStandardFilterFunction f)
+{
+	const auto src = MakeDsd(DSD_FRAMES);
+	const auto expected = ReferenceToFloat(src);
+
+	/* prepend dsd2pcm's initial state, see PcmDsd::Reset() */
+	std::vector<uint8_t> input(5 * DSD_CHANNELS, 0x96);
+	input.insert(input.end(), 6 * DSD_CHANNELS, 0x69);
+	input.insert(input.end(), src.begin(), src.end());
+
+	std::vector<float> dest(src.size());
+	f(input.data(), DSD_CHANNELS, dest.size(), dest.data());
+
+	for (size_t i = 0; i < dest.size(); ++i)
+		CPPUNIT_ASSERT_EQUAL(expected[i], dest[i]);
+}
+
+void
+PcmDsdTest::TestStandardFilter()
+{
+	::TestStandardFilter(DsdStandardFilterPortable);
+
+#ifdef __SSE2__
+	::TestStandardFilter(DsdStandardFilterSse2);
+#endif
+
+#ifdef HAVE_AVX2_DISPATCH
+	if (CpuHasAvx2())
+		::TestStandardFilter(DsdStandardFilterAvx2);
+#endif
+}
+
+void
+PcmDsdTest::TestToFloat()
+{
+	const auto src = MakeDsd(DSD_FRAMES);
+	const auto expected = ReferenceToFloat(src);
+
+	PcmDsd dsd;
+	CPPUNIT_ASSERT_EQUAL(352800u, dsd.Open(DSD_CHANNELS, 352800));
+
+	/* convert in chunks of different sizes to verify that the
+	   history is carried over correctly */
+	static constexpr size_t chunks[] = { 1, 7, 200, 13, 800 };
+	size_t position = 0;
+	for (const size_t n_frames : chunks) {
+		const ConstBuffer<uint8_t> in(&src[position],
+					      n_frames * DSD_CHANNELS);
+		const auto out = dsd.ToFloat(in);
+		CPPUNIT_ASSERT_EQUAL(in.size, out.size);
+
+		for (size_t i = 0; i < out.size; ++i)
+			CPPUNIT_ASSERT_EQUAL(expected[position + i],
+					     out.data[i]);
+
+		position += in.size;
+	}
+
+	CPPUNIT_ASSERT_EQUAL(src.size(), position);
+}
+
+void
+PcmDsdTest::TestHighQualityFilter()
+{
+	CPPUNIT_ASSERT_EQUAL(1u,
+			     DsdHighQualityFilter::GetDecimation(352800));
+	CPPUNIT_ASSERT_EQUAL(2u,
+			     DsdHighQualityFilter::GetDecimation(705600));
+	CPPUNIT_ASSERT_EQUAL(8u,
+			     DsdHighQualityFilter::GetDecimation(3072000));
+
+	const DsdHighQualityFilter filter(4);
+	const size_t n_frames = filter.GetHistory() + 1 + 4 * 7;
+
+	/* silence */
+	std::vector<uint8_t> src(n_frames * DSD_CHANNELS, 0x69);
+	std::vector<float> dest(8 * DSD_CHANNELS);
+	filter.Apply(src.data(), DSD_CHANNELS, 8, dest.data());
+	for (const float i : dest)
+		CPPUNIT_ASSERT(fabs(i) < 1e-5);
+
+	/* full scale DC has a gain of 1 */
+	std::fill(src.begin(), src.end(), 0xff);
+	filter.Apply(src.data(), DSD_CHANNELS, 8, dest.data());
+	for (const float i : dest)
+		CPPUNIT_ASSERT(fabs(i - 1) < 1e-5);
+}
@@ -20,8 +20,14 @@
 #include "config.h"
 #include "test_pcm_all.hxx"
 #include "pcm/PcmExport.hxx"
+#include "pcm/Order.hxx"
+#include "pcm/PcmDop.hxx"
+#include "pcm/PcmPack.hxx"
+#include "pcm/PcmBuffer.hxx"
 #include "pcm/Traits.hxx"
 #include "system/ByteOrder.hxx"
+#include "util/ByteReverse.hxx"
+#include "util/Macros.hxx"
 #include "util/ConstBuffer.hxx"
 
 #include <string.h>
@@ -127,6 +133,30 @@ PcmExportTest::TestDop()
 	auto dest = e.Export({src, sizeof(src)});
 	CPPUNIT_ASSERT_EQUAL(sizeof(expected), dest.size);
 	CPPUNIT_ASSERT(memcmp(dest.data, expected, dest.size) == 0);
+
+	/* the markers must alternate across buffers with an odd
+	   number of frames; the sizes cover both the portable and
+	   the SIMD code */
+	static constexpr size_t n_frames[] = { 1, 1, 5, 8, 3, 16, 7 };
+	uint8_t dsd[16 * 2 * 2];
+	for (size_t i = 0; i < sizeof(dsd); ++i)
+		dsd[i] = i;
+
+	e.Open(SampleFormat::DSD, 2, false, true, false, false, false);
+
+	unsigned frame = 0;
+	for (size_t n : n_frames) {
+		dest = e.Export({dsd, n * 2 * 2});
+		CPPUNIT_ASSERT_EQUAL(n * 2 * sizeof(uint32_t), dest.size);
+
+		const auto *p = (const uint32_t *)dest.data;
+		for (size_t i = 0; i < n * 2; i += 2, ++frame) {
+			const uint32_t marker = frame % 2 == 0
+				? 0xff050000 : 0xfffa0000;
+			CPPUNIT_ASSERT_EQUAL(marker, p[i] & 0xffff0000);
+			CPPUNIT_ASSERT_EQUAL(marker, p[i + 1] & 0xffff0000);
+		}
+	}
 }
 
 template<SampleFormat F, class Traits=SampleTraits<F>>
@@ -175,6 +205,26 @@ TestAlsaChannelOrder71()
 	auto dest = e.Export({src, sizeof(src)});
 	CPPUNIT_ASSERT_EQUAL(sizeof(expected), dest.size);
 	CPPUNIT_ASSERT(memcmp(dest.data, expected, dest.size) == 0);
+
+	/* an odd number of frames must not touch anything beyond the
+	   end of the destination buffer (this used to calculate the
+	   number of frames with 6 channels) */
+	static constexpr size_t N = 3;
+	value_type src3[N * 8 * 2];
+	for (size_t i = 0; i < ARRAY_SIZE(src3); ++i)
+		src3[i] = i;
+
+	PcmBuffer buffer;
+	memset(buffer.Get(sizeof(src3)), 0x55, sizeof(src3));
+
+	auto dest3 = ToAlsaChannelOrder(buffer,
+					{src3, N * 8 * sizeof(value_type)},
+					F, 8);
+	CPPUNIT_ASSERT_EQUAL(N * 8 * sizeof(value_type), dest3.size);
+
+	const auto *p = (const uint8_t *)dest3.data;
+	for (size_t i = dest3.size; i < sizeof(src3); ++i)
+		CPPUNIT_ASSERT_EQUAL(uint8_t(0x55), p[i]);
 }
 
 void
@@ -185,3 +235,99 @@ PcmExportTest::TestAlsaChannelOrder()
 	TestAlsaChannelOrder51<SampleFormat::S32>();
 	TestAlsaChannelOrder71<SampleFormat::S32>();
 }
+
+/**
+ * The sequential implementation of the export options which
+ * PcmExport used before the fused kernels.
+ */
+static ConstBuffer<void>
+ExportSequential(PcmBuffer &buffer1, PcmBuffer &buffer2,
+		 SampleFormat format, unsigned channels,
+		 bool dop, bool shift8, bool pack24, bool reverse,
+		 ConstBuffer<void> data)
+{
+	if (dop && format == SampleFormat::DSD) {
+		data = pcm_dsd_to_dop(buffer1, channels,
+				      ConstBuffer<uint8_t>::FromVoid(data))
+			.ToVoid();
+		format = SampleFormat::S24_P32;
+	}
+
+	size_t sample_size = sample_format_size(format);
+
+	if (format != SampleFormat::S24_P32) {
+	} else if (pack24) {
+		const auto src = ConstBuffer<int32_t>::FromVoid(data);
+		uint8_t *dest = (uint8_t *)buffer2.Get(src.size * 3);
+		pcm_pack_24(dest, src.begin(), src.end());
+		data = {dest, src.size * 3};
+		sample_size = 3;
+	} else if (shift8) {
+		const auto src = ConstBuffer<int32_t>::FromVoid(data);
+		uint32_t *dest = (uint32_t *)buffer2.Get(data.size);
+		for (size_t i = 0; i != src.size; ++i)
+			dest[i] = src[i] << 8;
+		data.data = dest;
+	}
+
+	if (reverse && sample_size > 1) {
+		const auto src = ConstBuffer<uint8_t>::FromVoid(data);
+		uint8_t *dest = (uint8_t *)buffer1.Get(data.size);
+		reverse_bytes(dest, src.begin(), src.end(), sample_size);
+		data.data = dest;
+	}
+
+	return data;
+}
+
+static void
+CheckCombined(SampleFormat format, unsigned channels,
+	      ConstBuffer<void> src)
+{
+	PcmBuffer buffer1, buffer2;
+	PcmExport e;
+
+	for (unsigned i = 0; i < 16; ++i) {
+		const bool dop = i & 1, shift8 = i & 2, pack24 = i & 4,
+			reverse = i & 8;
+		if (shift8 && pack24)
+			continue;
+
+		e.Open(format, channels, false, dop, shift8, pack24, reverse);
+
+		const auto expected =
+			ExportSequential(buffer1, buffer2, format, channels,
+					 dop, shift8, pack24, reverse, src);
+		const auto dest = e.Export(src);
+		CPPUNIT_ASSERT_EQUAL(expected.size, dest.size);
+		CPPUNIT_ASSERT(memcmp(dest.data, expected.data,
+				      dest.size) == 0);
+	}
+}
+
+void
+PcmExportTest::TestCombined()
+{
+	/* the sizes are not multiples of the SIMD block sizes, to
+	   check the remainder; the number of DoP frames must be
+	   even, because pcm_dsd_to_dop() leaves the last odd frame
+	   uninitialized */
+	uint8_t dsd[2 * 2 * 38];
+	for (size_t i = 0; i < ARRAY_SIZE(dsd); ++i)
+		dsd[i] = i * 37 + 11;
+
+	int32_t s24[75 * 2];
+	for (size_t i = 0; i < ARRAY_SIZE(s24); ++i)
+		s24[i] = int32_t((i * 2654435761u) << 8) >> 8;
+
+	int16_t s16[37 * 2];
+	for (size_t i = 0; i < ARRAY_SIZE(s16); ++i)
+		s16[i] = i * 1733 - 30000;
+
+	CheckCombined(SampleFormat::DSD, 2, {dsd, sizeof(dsd)});
+	CheckCombined(SampleFormat::DSD, 3, {dsd, 3 * 2 * 20});
+	CheckCombined(SampleFormat::S24_P32, 2, {s24, sizeof(s24)});
+	CheckCombined(SampleFormat::S32, 2, {s24, sizeof(s24)});
+	CheckCombined(SampleFormat::FLOAT, 2, {s24, sizeof(s24)});
+	CheckCombined(SampleFormat::S16, 2, {s16, sizeof(s16)});
+}
@@ -24,8 +24,18 @@
 #include "pcm/PcmDither.hxx"
 #include "pcm/PcmUtils.hxx"
 #include "pcm/PcmBuffer.hxx"
+#include "pcm/ShiftConvert.hxx"
+#include "pcm/FloatConvert.hxx"
 #include "AudioFormat.hxx"
 
+#ifdef __SSE2__
+#include "pcm/Sse2.hxx"
+#include "pcm/CpuFeatures.hxx"
+#ifdef HAVE_AVX2_DISPATCH
+#include "pcm/Avx2.hxx"
+#endif
+#endif
+
 void
 PcmFormatTest::TestFormat8to16()
 {
@@ -118,3 +128,176 @@ PcmFormatTest::TestFormatFloat()
 	for (size_t i = 4; i < N; ++i)
 		CPPUNIT_ASSERT_EQUAL(src[i], d[i]);
 }
+
+void
+PcmFormatTest::TestFormatFloatTo32()
+{
+	constexpr size_t N = 509;
+	const auto src = TestDataBuffer<int32_t, N>();
+
+	PcmBuffer buffer1, buffer2;
+
+	auto f = pcm_convert_to_float(buffer1, SampleFormat::S32, src);
+	CPPUNIT_ASSERT_EQUAL(N, f.size);
+
+	auto d = pcm_convert_to_32(buffer2, SampleFormat::FLOAT, f.ToVoid());
+	CPPUNIT_ASSERT_EQUAL(N, d.size);
+
+	/* float has only 24 bits of mantissa */
+	for (size_t i = 0; i < N; ++i) {
+		const int64_t delta = int64_t(src[i]) - d[i];
+		CPPUNIT_ASSERT(delta >= -128 && delta <= 128);
+	}
+
+	/* check if clamping works */
+	float *writable = const_cast<float *>(f.data);
+	*writable++ = 1.0;
+	*writable++ = 10;
+	*writable++ = -1.01;
+	*writable++ = 0.5;
+
+	d = pcm_convert_to_32(buffer2, SampleFormat::FLOAT, f.ToVoid());
+	CPPUNIT_ASSERT_EQUAL(N, d.size);
+
+	CPPUNIT_ASSERT_EQUAL(2147483647, int(d[0]));
+	CPPUNIT_ASSERT_EQUAL(2147483647, int(d[1]));
+	CPPUNIT_ASSERT_EQUAL(-2147483647 - 1, int(d[2]));
+	CPPUNIT_ASSERT_EQUAL(1 << 30, int(d[3]));
+}
+
+#ifdef __SSE2__
+
+/**
+ * Generates float samples slightly beyond the valid range, starting
+ * with a few values at the edges.  Values which overflow the 32 bit
+ * integer conversion of the portable implementation are avoided,
+ * because its result is undefined then.
+ */
+struct EdgeFloat {
+	RandomFloat random;
+	unsigned i = 0;
+
+	float operator()() {
+		static constexpr float edges[] = {
+			0, -0.f, 1, -1, 0.99999994f, -0.99999994f,
+			1.0000001f, -1.0000001f, 2, -2, 1000, -1000,
+			0.5f / 32768, -0.5f / 32768, 1.5f / 32768,
+			-1.5f / 32768,
+		};
+
+		if (i < sizeof(edges) / sizeof(edges[0]))
+			return edges[i++];
+
+		return random() * 1.25f;
+	}
+};
+
+/**
+ * Compare a SIMD kernel with the portable per-sample conversion
+ * #Portable.
+ */
+template<typename Portable, typename Optimized, typename G>
+static void
+CheckBitExact(G g)
+{
+	typedef typename Portable::SrcTraits::value_type SV;
+	typedef typename Portable::DstTraits::value_type DV;
+
+	/* a multiple of all block sizes */
+	constexpr size_t N = 1024;
+	static_assert(N % Optimized::BLOCK_SIZE == 0, "Wrong block size");
+
+	const TestDataBuffer<SV, N> src(g);
+	std::array<DV, N> dest;
+	Optimized().Convert(dest.data(), src, N);
+
+	for (size_t i = 0; i < N; ++i)
+		CPPUNIT_ASSERT_EQUAL(Portable::Convert(src[i]), dest[i]);
+}
+
+template<SampleFormat SF, SampleFormat DF,
+	 typename G=RandomInt<typename SampleTraits<SF>::value_type>>
+static void
+CheckLeftShift(G g=G())
+{
+	typedef SampleTraits<SF> ST;
+	typedef SampleTraits<DF> DT;
+	typedef LeftShiftSampleConvert<SF, DF> P;
+
+	CheckBitExact<P, Sse2LeftShift<ST, DT>>(g);
+#ifdef HAVE_AVX2_DISPATCH
+	if (CpuHasAvx2())
+		CheckBitExact<P, Avx2LeftShift<ST, DT>>(g);
+#endif
+}
+
+template<SampleFormat SF, SampleFormat DF>
+static void
+CheckRightShift()
+{
+	typedef SampleTraits<SF> ST;
+	typedef SampleTraits<DF> DT;
+	typedef RightShiftSampleConvert<SF, DF> P;
+	typedef RandomInt<typename ST::value_type> G;
+
+	CheckBitExact<P, Sse2RightShift<ST, DT>>(G());
+#ifdef HAVE_AVX2_DISPATCH
+	if (CpuHasAvx2())
+		CheckBitExact<P, Avx2RightShift<ST, DT>>(G());
+#endif
+}
+
+template<SampleFormat F,
+	 typename G=RandomInt<typename SampleTraits<F>::value_type>>
+static void
+CheckIntegerToFloat(G g=G())
+{
+	typedef SampleTraits<F> T;
+	typedef IntegerToFloatSampleConvert<F> P;
+
+	CheckBitExact<P, Sse2IntegerToFloat<T>>(g);
+#ifdef HAVE_AVX2_DISPATCH
+	if (CpuHasAvx2())
+		CheckBitExact<P, Avx2IntegerToFloat<T>>(g);
+#endif
+}
+
+template<SampleFormat F>
+static void
+CheckFloatToInteger()
+{
+	typedef SampleTraits<F> T;
+	typedef FloatToIntegerSampleConvert<F> P;
+
+	CheckBitExact<P, Sse2FloatToInteger<T>>(EdgeFloat());
+#ifdef HAVE_AVX2_DISPATCH
+	if (CpuHasAvx2())
+		CheckBitExact<P, Avx2FloatToInteger<T>>(EdgeFloat());
+#endif
+}
+
+#endif
+
+void
+PcmFormatTest::TestFormatSimd()
+{
+#ifdef __SSE2__
+	CheckLeftShift<SampleFormat::S8, SampleFormat::S16>();
+	CheckLeftShift<SampleFormat::S8, SampleFormat::S24_P32>();
+	CheckLeftShift<SampleFormat::S8, SampleFormat::S32>();
+	CheckLeftShift<SampleFormat::S16, SampleFormat::S24_P32>();
+	CheckLeftShift<SampleFormat::S16, SampleFormat::S32>();
+	CheckLeftShift<SampleFormat::S24_P32, SampleFormat::S32>(RandomInt24());
+
+	CheckRightShift<SampleFormat::S32, SampleFormat::S24_P32>();
+
+	CheckIntegerToFloat<SampleFormat::S8>();
+	CheckIntegerToFloat<SampleFormat::S16>();
+	CheckIntegerToFloat<SampleFormat::S24_P32>(RandomInt24());
+	CheckIntegerToFloat<SampleFormat::S32>();
+
+	CheckFloatToInteger<SampleFormat::S16>();
+	CheckFloatToInteger<SampleFormat::S24_P32>();
+	CheckFloatToInteger<SampleFormat::S32>();
+#endif
+}
@@ -17,6 +17,7 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include "config.h"
 #include "test_pcm_all.hxx"
 #include "Compiler.h"
 
@@ -31,6 +32,10 @@ CPPUNIT_TEST_SUITE_REGISTRATION(PcmChannelsTest);
 CPPUNIT_TEST_SUITE_REGISTRATION(PcmVolumeTest);
 CPPUNIT_TEST_SUITE_REGISTRATION(PcmFormatTest);
 CPPUNIT_TEST_SUITE_REGISTRATION(PcmMixTest);
+#ifdef ENABLE_DSD
+CPPUNIT_TEST_SUITE_REGISTRATION(PcmDsdTest);
+#endif
+CPPUNIT_TEST_SUITE_REGISTRATION(PcmResamplerTest);
 CPPUNIT_TEST_SUITE_REGISTRATION(PcmInterleaveTest);
 CPPUNIT_TEST_SUITE_REGISTRATION(PcmExportTest);
 
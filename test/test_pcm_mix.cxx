@@ -22,6 +22,15 @@
 #include "test_pcm_util.hxx"
 #include "pcm/PcmMix.hxx"
 #include "pcm/PcmDither.hxx"
+#include "pcm/VolumeKernels.hxx"
+
+#ifdef __SSE2__
+#include "pcm/Sse2Volume.hxx"
+#include "pcm/CpuFeatures.hxx"
+#ifdef HAVE_AVX2_DISPATCH
+#include "pcm/Avx2Volume.hxx"
+#endif
+#endif
 
 template<typename T, SampleFormat format, typename G=RandomInt<T>>
 static void
@@ -84,3 +93,71 @@ PcmMixTest::TestMix32()
 {
 	TestPcmMix<int32_t, SampleFormat::S32>();
 }
+
+#ifdef __SSE2__
+
+/**
+ * Compare a SIMD kernel with #PortableVolumeKernel.
+ */
+template<SampleFormat F, class Optimized,
+	 typename G=RandomInt<typename SampleTraits<F>::value_type>>
+static void
+CheckAddVolumeKernel(G g=G())
+{
+	typedef typename SampleTraits<F>::value_type value_type;
+	typedef GlueVolumeKernel<F, Optimized> Glue;
+	typedef PortableVolumeKernel<F> Portable;
+
+	/* not a multiple of the block size, to check the glue code */
+	constexpr unsigned N = 509;
+	const auto src1 = TestDataBuffer<value_type, N>(g);
+	const auto src2 = TestDataBuffer<value_type, N>(g);
+
+	/* the last pair amplifies and checks the clipping */
+	static constexpr int volumes[][2] = {
+		{ PCM_VOLUME_1S, 0 },
+		{ 1, PCM_VOLUME_1S - 1 },
+		{ 700, PCM_VOLUME_1S - 700 },
+		{ 2000, 1500 },
+	};
+
+	PcmVectorDither expected_dither, actual_dither;
+	for (const auto &v : volumes) {
+		auto expected = src1, actual = src1;
+		Portable::AddVolume(expected_dither,
+				    expected.begin(), src2.begin(), N,
+				    v[0], v[1]);
+		Glue::AddVolume(actual_dither,
+				actual.begin(), src2.begin(), N,
+				v[0], v[1]);
+
+		for (unsigned i = 0; i < N; ++i)
+			CPPUNIT_ASSERT_EQUAL(expected[i], actual[i]);
+	}
+}
+
+template<SampleFormat F,
+	 typename G=RandomInt<typename SampleTraits<F>::value_type>>
+static void
+CheckAddVolumeKernels(G g=G())
+{
+	CheckAddVolumeKernel<F, Sse2VolumeKernel<F>>(g);
+#ifdef HAVE_AVX2_DISPATCH
+	if (CpuHasAvx2())
+		CheckAddVolumeKernel<F, Avx2VolumeKernel<F>>(g);
+#endif
+}
+
+#endif
+
+void
+PcmMixTest::TestMixSimd()
+{
+#ifdef __SSE2__
+	CheckAddVolumeKernels<SampleFormat::S8>();
+	CheckAddVolumeKernels<SampleFormat::S16>();
+	CheckAddVolumeKernels<SampleFormat::S24_P32>(RandomInt24());
+	CheckAddVolumeKernels<SampleFormat::S32>();
+	CheckAddVolumeKernels<SampleFormat::FLOAT>(RandomFloat());
+#endif
+}
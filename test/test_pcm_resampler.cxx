@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2003-2015 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "test_pcm_all.hxx"
+#include "test_pcm_util.hxx"
+#include "pcm/SincResampler.hxx"
+#include "pcm/ThreadedResampler.hxx"
+#include "AudioFormat.hxx"
+#include "util/ConstBuffer.hxx"
+#include "util/Error.hxx"
+
+#include <algorithm>
+#include <vector>
+
+#include <math.h>
+
+static constexpr unsigned RESAMPLER_CHANNELS = 3;
+
+static float
+Sine(double frequency, unsigned sample_rate, size_t i, unsigned channel)
+{
+	/* a different phase for each channel */
+	return 0.5 * sin(2 * M_PI * frequency * i / sample_rate + channel);
+}
+
+/**
+ * Resample a sine wave in chunks of the given sizes and return the
+ * output.
+ */
+static std::vector<float>
+ResampleSine(unsigned src_rate, unsigned dest_rate, double frequency,
+	     ConstBuffer<size_t> chunks)
+{
+	std::vector<float> src(src_rate * RESAMPLER_CHANNELS);
+	for (size_t i = 0; i < src_rate; ++i)
+		for (unsigned c = 0; c < RESAMPLER_CHANNELS; ++c)
+			src[i * RESAMPLER_CHANNELS + c] =
+				Sine(frequency, src_rate, i, c);
+
+	SincPcmResampler resampler;
+	AudioFormat af(src_rate, SampleFormat::FLOAT, RESAMPLER_CHANNELS);
+	Error error;
+	const auto out_format = resampler.Open(af, dest_rate, error);
+	CPPUNIT_ASSERT(out_format.IsValid());
+	CPPUNIT_ASSERT_EQUAL(dest_rate, out_format.sample_rate);
+	CPPUNIT_ASSERT(af.format == SampleFormat::FLOAT);
+
+	std::vector<float> dest;
+	size_t position = 0, i = 0;
+	while (position < src_rate) {
+		const size_t n = std::min(chunks[i++ % chunks.size],
+					  src_rate - position);
+		const ConstBuffer<float> in(&src[position * RESAMPLER_CHANNELS],
+					    n * RESAMPLER_CHANNELS);
+		const auto out = ConstBuffer<float>::FromVoid(resampler.Resample(in.ToVoid(), error));
+		CPPUNIT_ASSERT(!out.IsNull());
+		dest.insert(dest.end(), out.begin(), out.end());
+		position += n;
+	}
+
+	resampler.Close();
+	return dest;
+}
+
+/**
+ * Compare the resampled sine wave with the ideal one and return the
+ * signal to noise ratio [dB].
+ */
+static double
+SineSnr(const std::vector<float> &dest, unsigned dest_rate,
+	double frequency)
+{
+	const size_t n_frames = dest.size() / RESAMPLER_CHANNELS;
+
+	/* the filter needs some input after the last output frame;
+	   nearly all of it must have been generated */
+	CPPUNIT_ASSERT(n_frames <= dest_rate);
+	CPPUNIT_ASSERT(n_frames > dest_rate * 99 / 100);
+
+	double signal = 0, noise = 0;
+	for (size_t i = n_frames / 10; i < n_frames; ++i) {
+		for (unsigned c = 0; c < RESAMPLER_CHANNELS; ++c) {
+			const double expected =
+				Sine(frequency, dest_rate, i, c);
+			const double d = dest[i * RESAMPLER_CHANNELS + c] - expected;
+			signal += expected * expected;
+			noise += d * d;
+		}
+	}
+
+	return 10 * log10(signal / noise);
+}
+
+void
+PcmResamplerTest::TestSinc()
+{
+	static constexpr size_t whole[] = { 1 << 20 };
+	static constexpr size_t chunks[] = { 1, 333, 4096, 17 };
+
+	/* upsampling */
+	const auto a = ResampleSine(44100, 48000, 1000,
+				    ConstBuffer<size_t>(whole, 1));
+	CPPUNIT_ASSERT(SineSnr(a, 48000, 1000) > 100);
+
+	/* the result must not depend on the chunk sizes */
+	const auto b = ResampleSine(44100, 48000, 1000,
+				    ConstBuffer<size_t>(chunks, 4));
+	CPPUNIT_ASSERT(a == b);
+
+	/* downsampling */
+	const auto c = ResampleSine(48000, 44100, 5000,
+				    ConstBuffer<size_t>(chunks, 4));
+	CPPUNIT_ASSERT(SineSnr(c, 44100, 5000) > 100);
+
+	/* an odd ratio with interpolated coefficients */
+	const auto d = ResampleSine(44100, 44101, 1000,
+				    ConstBuffer<size_t>(chunks, 4));
+	CPPUNIT_ASSERT(SineSnr(d, 44101, 1000) > 100);
+}
+
+static PcmResampler *
+CreateSincResampler()
+{
+	return new SincPcmResampler();
+}
+
+void
+PcmResamplerTest::TestThreaded()
+{
+	constexpr unsigned channels = 7, n_frames = 4096;
+
+	RandomFloat g;
+	std::vector<float> src(n_frames * channels);
+	for (auto &i : src)
+		i = g();
+
+	const ConstBuffer<float> in(&src.front(), src.size());
+	Error error;
+
+	SincPcmResampler single;
+	AudioFormat af(44100, SampleFormat::FLOAT, channels);
+	CPPUNIT_ASSERT(single.Open(af, 96000, error).IsValid());
+	const auto expected =
+		ConstBuffer<float>::FromVoid(single.Resample(in.ToVoid(), error));
+	CPPUNIT_ASSERT(!expected.IsNull());
+
+	/* splitting the channels must not change the result */
+	ThreadedPcmResampler threaded(CreateSincResampler, 3);
+	AudioFormat af2(44100, SampleFormat::FLOAT, channels);
+	const auto out_format = threaded.Open(af2, 96000, error);
+	CPPUNIT_ASSERT(out_format.IsValid());
+	CPPUNIT_ASSERT_EQUAL(channels, unsigned(out_format.channels));
+
+	const auto actual =
+		ConstBuffer<float>::FromVoid(threaded.Resample(in.ToVoid(), error));
+	CPPUNIT_ASSERT(!actual.IsNull());
+	CPPUNIT_ASSERT_EQUAL(expected.size, actual.size);
+	CPPUNIT_ASSERT(std::equal(expected.begin(), expected.end(),
+				  actual.begin()));
+
+	threaded.Close();
+	single.Close();
+}
@@ -20,11 +20,21 @@
 #include "config.h"
 #include "test_pcm_all.hxx"
 #include "pcm/Volume.hxx"
+#include "pcm/VolumeKernels.hxx"
+#include "pcm/FusedGain.hxx"
 #include "pcm/Traits.hxx"
 #include "util/ConstBuffer.hxx"
 #include "util/Error.hxx"
 #include "test_pcm_util.hxx"
 
+#ifdef __SSE2__
+#include "pcm/Sse2Volume.hxx"
+#include "pcm/CpuFeatures.hxx"
+#ifdef HAVE_AVX2_DISPATCH
+#include "pcm/Avx2Volume.hxx"
+#endif
+#endif
+
 #include <algorithm>
 
 #include <string.h>
@@ -66,6 +76,25 @@ TestVolume(G g=G())
 	}
 
 	pv.Close();
+
+	/* in place must give the same result, given the same
+	   dither state */
+	PcmVolume a, b;
+	CPPUNIT_ASSERT(a.Open(F, IgnoreError()));
+	CPPUNIT_ASSERT(b.Open(F, IgnoreError()));
+	a.SetVolume(PCM_VOLUME_1 / 3);
+	b.SetVolume(PCM_VOLUME_1 / 3);
+
+	std::array<value_type, N> in_place;
+	std::copy_n(_src.begin(), N, in_place.begin());
+	b.ApplyTo({in_place.data(), sizeof(in_place)}, in_place.data());
+
+	dest = a.Apply(src);
+	CPPUNIT_ASSERT_EQUAL(0, memcmp(dest.data, in_place.data(),
+				       sizeof(in_place)));
+
+	a.Close();
+	b.Close();
 }
 
 void
@@ -123,3 +152,157 @@ PcmVolumeTest::TestVolumeFloat()
 
 	pv.Close();
 }
+
+#ifdef __SSE2__
+
+/**
+ * Compare a SIMD kernel with #PortableVolumeKernel.
+ */
+template<SampleFormat F, class Optimized,
+	 typename G=RandomInt<typename SampleTraits<F>::value_type>>
+static void
+CheckVolumeKernel(G g=G())
+{
+	typedef typename SampleTraits<F>::value_type value_type;
+	typedef GlueVolumeKernel<F, Optimized> Glue;
+	typedef PortableVolumeKernel<F> Portable;
+
+	/* not a multiple of the block size, to check the glue code */
+	constexpr size_t N = 509;
+	const TestDataBuffer<value_type, N> src(g);
+
+	/* 3000 amplifies and checks the clipping */
+	static constexpr int volumes[] = {
+		1, 333, PCM_VOLUME_1 / 2, PCM_VOLUME_1 - 1, 3000,
+	};
+
+	PcmVectorDither expected_dither, actual_dither;
+	for (int volume : volumes) {
+		std::array<value_type, N> expected, actual;
+		Portable::Volume(expected_dither, expected.data(), src.begin(),
+				 N, volume);
+		Glue::Volume(actual_dither, actual.data(), src.begin(),
+			     N, volume);
+
+		for (size_t i = 0; i < N; ++i)
+			CPPUNIT_ASSERT_EQUAL(expected[i], actual[i]);
+	}
+}
+
+template<SampleFormat F,
+	 typename G=RandomInt<typename SampleTraits<F>::value_type>>
+static void
+CheckVolumeKernels(G g=G())
+{
+	CheckVolumeKernel<F, Sse2VolumeKernel<F>>(g);
+#ifdef HAVE_AVX2_DISPATCH
+	if (CpuHasAvx2())
+		CheckVolumeKernel<F, Avx2VolumeKernel<F>>(g);
+#endif
+}
+
+#endif
+
+void
+PcmVolumeTest::TestVolumeSimd()
+{
+#ifdef __SSE2__
+	CheckVolumeKernels<SampleFormat::S8>();
+	CheckVolumeKernels<SampleFormat::S16>();
+	CheckVolumeKernels<SampleFormat::S24_P32>(RandomInt24());
+	CheckVolumeKernels<SampleFormat::S32>();
+	CheckVolumeKernels<SampleFormat::FLOAT>(RandomFloat());
+#endif
+}
+
+template<SampleFormat F, class Traits=SampleTraits<F>>
+static double
+FusedExpected(double x)
+{
+	return std::min(std::max(x, double(Traits::MIN)), double(Traits::MAX));
+}
+
+template<>
+double
+FusedExpected<SampleFormat::FLOAT>(double x)
+{
+	/* floating point samples are not clipped */
+	return x;
+}
+
+template<SampleFormat F, class Traits=SampleTraits<F>>
+static double
+FusedTolerance(double expected)
+{
+	/* the dither and the rounding, plus the float precision
+	   with 32 bit samples */
+	return Traits::BITS > 24
+		? std::abs(expected) / (1 << 22) + 2
+		: 2;
+}
+
+template<>
+double
+FusedTolerance<SampleFormat::FLOAT>(double expected)
+{
+	return std::abs(expected) / (1 << 22) + 1e-6;
+}
+
+/**
+ * Check #PcmFusedGain against the exact result, which may differ by
+ * the dither and the rounding.
+ */
+template<SampleFormat SF, SampleFormat DF,
+	 typename G=RandomInt<typename SampleTraits<SF>::value_type>>
+static void
+CheckFusedGain(double full_scale_ratio, G g=G())
+{
+	typedef typename SampleTraits<SF>::value_type src_type;
+	typedef typename SampleTraits<DF>::value_type dest_type;
+
+	PcmFusedGain fg;
+	CPPUNIT_ASSERT(fg.Open(SF, DF, IgnoreError()));
+
+	/* not a multiple of the block size, to check the glue code */
+	constexpr size_t N = 509;
+	const auto _src = TestDataBuffer<src_type, N>(g);
+	const ConstBuffer<void> src(_src, sizeof(_src));
+
+	/* 3 amplifies and checks the clipping */
+	static constexpr float gains[] = { 0, 0.0051, 0.5, 1, 3 };
+
+	for (float gain : gains) {
+		auto dest = fg.Apply(src, gain);
+		CPPUNIT_ASSERT_EQUAL(N * sizeof(dest_type), dest.size);
+
+		const auto _dest = ConstBuffer<dest_type>::FromVoid(dest);
+		for (size_t i = 0; i < N; ++i) {
+			const double expected =
+				FusedExpected<DF>(_src[i] * full_scale_ratio
+						  * gain);
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, double(_dest[i]),
+						     FusedTolerance<DF>(expected));
+		}
+	}
+
+	fg.Close();
+}
+
+void
+PcmVolumeTest::TestFusedGain()
+{
+	CheckFusedGain<SampleFormat::S16, SampleFormat::S16>(1);
+	CheckFusedGain<SampleFormat::S8, SampleFormat::S16>(256);
+	CheckFusedGain<SampleFormat::S24_P32,
+		       SampleFormat::S16>(1. / 256, RandomInt24());
+	CheckFusedGain<SampleFormat::S32, SampleFormat::S24_P32>(1. / 256);
+	CheckFusedGain<SampleFormat::S16, SampleFormat::S32>(65536);
+	CheckFusedGain<SampleFormat::FLOAT,
+		       SampleFormat::S16>(32768, RandomFloat());
+	CheckFusedGain<SampleFormat::S16,
+		       SampleFormat::FLOAT>(1. / 32768);
+
+	PcmFusedGain fg;
+	CPPUNIT_ASSERT(!fg.Open(SampleFormat::DSD, SampleFormat::S16,
+				IgnoreError()));
+}
@@ -0,0 +1,296 @@
+/*
+ * Unit tests for class SeekIndex.
+ */
+
+#include "config.h"
+#include "decoder/SeekIndex.hxx"
+#include "input/InputStream.hxx"
+#include "input/plugins/FileInputPlugin.hxx"
+#include "fs/AllocatedPath.hxx"
+#include "fs/DirectoryReader.hxx"
+#include "fs/FileSystem.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "util/Error.hxx"
+#include "Compiler.h"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <memory>
+#include <string>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+
+class SeekIndexTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(SeekIndexTest);
+	CPPUNIT_TEST(TestRoundTrip);
+	CPPUNIT_TEST(TestCorrupt);
+	CPPUNIT_TEST(TestInvalid);
+	CPPUNIT_TEST_SUITE_END();
+
+	char directory[32];
+	std::string song_path;
+
+	Mutex mutex;
+	Cond cond;
+
+public:
+	void setUp() override;
+	void tearDown() override;
+
+	void TestRoundTrip();
+	void TestCorrupt();
+	void TestInvalid();
+
+private:
+	std::unique_ptr<InputStream> OpenSong();
+
+	/**
+	 * Returns the path of the only table in the cache directory.
+	 */
+	std::string GetTablePath() const;
+
+	/**
+	 * Fill the table with points within the first 100000 bytes
+	 * of the song.
+	 */
+	static void Fill(SeekIndex &seek_index) {
+		for (uint64_t i = 0; i < 1000; ++i)
+			seek_index.push_back(i * 1152, 100 + i * 97);
+	}
+
+	/**
+	 * Save a table with one more point appended, and try to load
+	 * it again.
+	 *
+	 * @return true if the table was loaded
+	 */
+	bool SaveAndLoad(uint64_t frame, uint64_t offset);
+};
+
+void
+SeekIndexTest::setUp()
+{
+	strcpy(directory, "/tmp/test_seek_index.XXXXXX");
+	CPPUNIT_ASSERT(mkdtemp(directory) != nullptr);
+
+	song_path = std::string(directory) + "/song";
+	FILE *file = fopen(song_path.c_str(), "wb");
+	CPPUNIT_ASSERT(file != nullptr);
+	for (unsigned i = 0; i < 100000; ++i)
+		fputc(i * 7, file);
+	fclose(file);
+
+	seek_index_global_init(AllocatedPath::FromFS(directory));
+}
+
+void
+SeekIndexTest::tearDown()
+{
+	seek_index_global_finish();
+
+	const auto directory_path = AllocatedPath::FromFS(directory);
+	{
+		DirectoryReader reader(directory_path);
+		while (reader.ReadEntry()) {
+			const Path name = reader.GetEntry();
+			if (name.c_str()[0] != '.')
+				RemoveFile(AllocatedPath::Build(directory_path,
+								name));
+		}
+	}
+
+	rmdir(directory);
+}
+
+std::unique_ptr<InputStream>
+SeekIndexTest::OpenSong()
+{
+	Error error;
+	std::unique_ptr<InputStream> is(OpenFileInputStream(Path::FromFS(song_path.c_str()),
+							    mutex, cond,
+							    error));
+	CPPUNIT_ASSERT(is != nullptr);
+	return is;
+}
+
+std::string
+SeekIndexTest::GetTablePath() const
+{
+	std::string result;
+
+	DirectoryReader reader(Path::FromFS(directory));
+	while (reader.ReadEntry()) {
+		const Path name = reader.GetEntry();
+		if (name.c_str()[0] == '.' || strcmp(name.c_str(), "song") == 0)
+			continue;
+
+		CPPUNIT_ASSERT(result.empty());
+		result = std::string(directory) + "/" + name.c_str();
+	}
+
+	CPPUNIT_ASSERT(!result.empty());
+	return result;
+}
+
+void
+SeekIndexTest::TestRoundTrip()
+{
+	auto is = OpenSong();
+
+	SeekIndex a;
+	CPPUNIT_ASSERT(a.Open(*is, "test"));
+	CPPUNIT_ASSERT(!a.Load());
+	Fill(a);
+	a.Save();
+
+	SeekIndex b;
+	CPPUNIT_ASSERT(b.Open(*is, "test"));
+	CPPUNIT_ASSERT(b.Load());
+	CPPUNIT_ASSERT_EQUAL(a.size(), b.size());
+	for (size_t i = 0; i < a.size(); ++i) {
+		CPPUNIT_ASSERT_EQUAL(a[i].frame, b[i].frame);
+		CPPUNIT_ASSERT_EQUAL(a[i].offset, b[i].offset);
+	}
+
+	const SeekIndex::Point *p = b.Find(1152 * 10 + 1);
+	CPPUNIT_ASSERT(p != nullptr);
+	CPPUNIT_ASSERT_EQUAL(uint64_t(1152 * 10), p->frame);
+
+	/* each plugin has its own tables */
+	SeekIndex c;
+	CPPUNIT_ASSERT(c.Open(*is, "other"));
+	CPPUNIT_ASSERT(!c.Load());
+	CPPUNIT_ASSERT(c.empty());
+
+	/* a file modified behind the fingerprinted beginning (with
+	   the same size) gets a new fingerprint because of its
+	   modification time */
+	FILE *file = fopen(song_path.c_str(), "r+b");
+	CPPUNIT_ASSERT(file != nullptr);
+	CPPUNIT_ASSERT_EQUAL(0, fseek(file, 80000, SEEK_SET));
+	fputc(0xff, file);
+	fclose(file);
+
+	struct utimbuf times;
+	times.actime = times.modtime = time(nullptr) + 100;
+	CPPUNIT_ASSERT_EQUAL(0, utime(song_path.c_str(), &times));
+
+	is = OpenSong();
+	SeekIndex d;
+	CPPUNIT_ASSERT(d.Open(*is, "test"));
+	CPPUNIT_ASSERT(!d.Load());
+}
+
+void
+SeekIndexTest::TestCorrupt()
+{
+	auto is = OpenSong();
+
+	SeekIndex a;
+	CPPUNIT_ASSERT(a.Open(*is, "test"));
+	Fill(a);
+	a.Save();
+
+	const std::string table_path = GetTablePath();
+
+	/* the header: 8 bytes magic, 8 bytes fingerprint, 8 bytes
+	   number of points */
+	FILE *file = fopen(table_path.c_str(), "r+b");
+	CPPUNIT_ASSERT(file != nullptr);
+
+	/* a huge number of points must not be allocated */
+	const uint64_t huge = 15 * 1024 * 1024;
+	CPPUNIT_ASSERT_EQUAL(0, fseek(file, 16, SEEK_SET));
+	CPPUNIT_ASSERT_EQUAL(size_t(1), fwrite(&huge, sizeof(huge), 1, file));
+	fflush(file);
+
+	SeekIndex b;
+	CPPUNIT_ASSERT(b.Open(*is, "test"));
+	CPPUNIT_ASSERT(!b.Load());
+	CPPUNIT_ASSERT(b.empty());
+
+	/* one point more than the file contains */
+	const uint64_t more = a.size() + 1;
+	CPPUNIT_ASSERT_EQUAL(0, fseek(file, 16, SEEK_SET));
+	CPPUNIT_ASSERT_EQUAL(size_t(1), fwrite(&more, sizeof(more), 1, file));
+	fflush(file);
+
+	CPPUNIT_ASSERT(!b.Load());
+	CPPUNIT_ASSERT(b.empty());
+
+	/* with the right number, the table is valid again */
+	const uint64_t n = a.size();
+	CPPUNIT_ASSERT_EQUAL(0, fseek(file, 16, SEEK_SET));
+	CPPUNIT_ASSERT_EQUAL(size_t(1), fwrite(&n, sizeof(n), 1, file));
+	fflush(file);
+
+	CPPUNIT_ASSERT(b.Load());
+
+	/* a broken magic */
+	CPPUNIT_ASSERT_EQUAL(0, fseek(file, 0, SEEK_SET));
+	CPPUNIT_ASSERT_EQUAL(size_t(1), fwrite("X", 1, 1, file));
+	fclose(file);
+
+	SeekIndex c;
+	CPPUNIT_ASSERT(c.Open(*is, "test"));
+	CPPUNIT_ASSERT(!c.Load());
+	CPPUNIT_ASSERT(c.empty());
+}
+
+bool
+SeekIndexTest::SaveAndLoad(uint64_t frame, uint64_t offset)
+{
+	auto is = OpenSong();
+
+	SeekIndex a;
+	CPPUNIT_ASSERT(a.Open(*is, "test"));
+	Fill(a);
+	a.push_back(frame, offset);
+	a.Save();
+
+	SeekIndex b;
+	CPPUNIT_ASSERT(b.Open(*is, "test"));
+	if (!b.Load()) {
+		CPPUNIT_ASSERT(b.empty());
+		return false;
+	}
+
+	CPPUNIT_ASSERT_EQUAL(a.size(), b.size());
+	return true;
+}
+
+void
+SeekIndexTest::TestInvalid()
+{
+	/* the end of the song */
+	CPPUNIT_ASSERT(SaveAndLoad(1152 * 1000, 100000));
+
+	/* not sorted by frame */
+	CPPUNIT_ASSERT(!SaveAndLoad(1152 * 10, 99999));
+
+	/* offsets not increasing */
+	CPPUNIT_ASSERT(!SaveAndLoad(1152 * 1000, 100));
+
+	/* beyond the end of the song */
+	CPPUNIT_ASSERT(!SaveAndLoad(1152 * 1000, 100001));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(SeekIndexTest);
+
+int
+main(gcc_unused int argc, gcc_unused char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	auto &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+	return runner.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}